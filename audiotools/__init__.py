@@ -21,6 +21,7 @@ import sys
 import re
 import os
 import os.path
+import weakref
 import audiotools.pcm as pcm
 from functools import total_ordering
 from fractions import Fraction
@@ -136,6 +137,9 @@ BIN = __system_binaries__(config)
 
 DEFAULT_CDROM = config.get_default("System", "cdrom", "/dev/cdrom")
 
+# an optional file in which to cache the stream properties of opened files
+PROPERTIES_CACHE = config.get_default("System", "properties_cache", "")
+
 FREEDB_SERVICE = config.getboolean_default("FreeDB", "service", True)
 FREEDB_SERVER = config.get_default("FreeDB", "server", "us.freedb.org")
 FREEDB_PORT = config.getint_default("FreeDB", "port", 80)
@@ -1935,9 +1939,24 @@ def sorted_tracks(audiofiles):
     return sorted(audiofiles, key=lambda f: f.__sort_key__())
 
 
+def open_properties_cache():
+    """returns a PropertiesCache object for the configured cache file
+    or None if no cache is configured or it cannot be opened"""
+
+    if len(PROPERTIES_CACHE) == 0:
+        return None
+
+    from audiotools.propcache import PropertiesCache
+
+    try:
+        return PropertiesCache(os.path.expanduser(PROPERTIES_CACHE))
+    except IOError:
+        return None
+
+
 def open_files(filename_list, sorted=True, messenger=None,
                no_duplicates=False, warn_duplicates=False,
-               opened_files=None):
+               opened_files=None, properties_cache=None):
     """returns a list of AudioFile objects
     from a list of filename strings or Filename objects
 
@@ -1955,6 +1974,10 @@ def open_files(filename_list, sorted=True, messenger=None,
 
     "opened_files" is a set object containing previously opened
     Filename objects and which newly opened Filename objects are added to
+
+    "properties_cache" is a PropertiesCache object
+    from which files' stream properties are fetched and stored
+    if None, the configured cache is used, if any
     """
 
     from audiotools.text import (ERR_DUPLICATE_FILE,
@@ -1963,6 +1986,11 @@ def open_files(filename_list, sorted=True, messenger=None,
     if opened_files is None:
         opened_files = set()
 
+    if properties_cache is None:
+        cache = open_properties_cache()
+    else:
+        cache = properties_cache
+
     to_return = []
 
     for filename in map(Filename, filename_list):
@@ -1975,6 +2003,12 @@ def open_files(filename_list, sorted=True, messenger=None,
                 messenger.warning(ERR_DUPLICATE_FILE.format(filename))
 
         try:
+            if cache is not None:
+                audiofile = cache.open(str(filename))
+                if audiofile is not None:
+                    to_return.append(audiofile)
+                continue
+
             with __open__(str(filename), "rb") as f:
                 audio_class = file_type(f)
 
@@ -1983,13 +2017,19 @@ def open_files(filename_list, sorted=True, messenger=None,
             else:
                 # not a support audio type
                 pass
-        except IOError as err:
+        except (IOError, OSError) as err:
             if messenger is not None:
                 messenger.warning(ERR_OPEN_IOERROR.format(filename))
         except InvalidFile as err:
             if messenger is not None:
                 messenger.error(str(err))
 
+    if cache is not None:
+        if properties_cache is None:
+            cache.close()
+        else:
+            cache.flush()
+
     return (sorted_tracks(to_return) if sorted else to_return)
 
 
@@ -2002,14 +2042,21 @@ def open_directory(directory, sorted=True, messenger=None):
     error messages are sent to messenger, if given
     """
 
-    for (basedir, subdirs, filenames) in os.walk(directory):
-        if sorted:
-            subdirs.sort()
-        for audiofile in open_files([os.path.join(basedir, filename)
-                                     for filename in filenames],
-                                    sorted=sorted,
-                                    messenger=messenger):
-            yield audiofile
+    cache = open_properties_cache()
+
+    try:
+        for (basedir, subdirs, filenames) in os.walk(directory):
+            if sorted:
+                subdirs.sort()
+            for audiofile in open_files([os.path.join(basedir, filename)
+                                         for filename in filenames],
+                                        sorted=sorted,
+                                        messenger=messenger,
+                                        properties_cache=cache):
+                yield audiofile
+    finally:
+        if cache is not None:
+            cache.close()
 
 
 def group_tracks(tracks):
@@ -2720,39 +2767,13 @@ def pcm_frame_cmp(pcmreader1, pcmreader2):
         pcmreader2.close()
         return 0
 
-    frame_number = 0
-    reader1 = BufferedPCMReader(pcmreader1)
-    reader2 = BufferedPCMReader(pcmreader2)
+    from audiotools.pcmconverter import pcm_frame_cmp as frame_cmp
+
     try:
-        framelist1 = reader1.read(FRAMELIST_SIZE)
-        framelist2 = reader2.read(FRAMELIST_SIZE)
-
-        # so long as both framelists contain data
-        while (len(framelist1) > 0) and (len(framelist2) > 0):
-            # compare both entire framelists
-            if framelist1 == framelist2:
-                # if they both match, continue to the next pair
-                frame_number += framelist1.frames
-                framelist1 = reader1.read(FRAMELIST_SIZE)
-                framelist2 = reader2.read(FRAMELIST_SIZE)
-            else:
-                # if there's a mismatch, determine the exact frame
-                for i in range(min(framelist1.frames, framelist2.frames)):
-                    if framelist1.frame(i) != framelist2.frame(i):
-                        return frame_number + i
-                else:
-                    return frame_number + i
-        else:
-            # at least one framelist is empty
-            if (len(framelist1) == 0) and (len(framelist2) == 0):
-                # if they're both empty, there's no mismatch
-                return None
-            else:
-                # if only one is empty, return as far as we've gotten
-                return frame_number
+        return frame_cmp(pcmreader1, pcmreader2)
     finally:
-        reader1.close()
-        reader2.close()
+        pcmreader1.close()
+        pcmreader2.close()
 
 
 class PCMCat(PCMReader):
@@ -3679,6 +3700,54 @@ class Image(object):
         self.description = description
         self.type = type
 
+    def __getattr__(self, attr):
+        if ((attr == "data") and
+                ("__data_reference__" in self.__dict__)):
+            # data referenced within a file is read each time it's needed
+            # rather than being held in memory
+            return self.__data_reference__.read()
+        else:
+            raise AttributeError(attr)
+
+    def reference_data(self, reference):
+        """replaces this image's data with an ImageReference
+        whose data is only read from disk when needed
+
+        returns this image"""
+
+        self.__dict__.pop("data", None)
+        self.__dict__["__data_reference__"] = reference
+        return self
+
+    def data_reference(self):
+        """returns this image's ImageReference
+        or None if its data is held in memory"""
+
+        if "data" in self.__dict__:
+            return None
+        else:
+            return self.__dict__.get("__data_reference__", None)
+
+    def data_size(self):
+        """returns the size of the image's data in bytes
+        without reading it"""
+
+        reference = self.data_reference()
+        if reference is None:
+            return len(self.data)
+        else:
+            return reference.length
+
+    def transfer_data(self, to_function):
+        """sends the image's data to to_function as one or more strings
+        without holding all of referenced data in memory at once"""
+
+        reference = self.data_reference()
+        if reference is None:
+            to_function(self.data)
+        else:
+            reference.transfer(to_function)
+
     def suffix(self):
         """returns the image's recommended suffix as a plain string
 
@@ -3756,7 +3825,11 @@ class Image(object):
 
     def __eq__(self, image):
         if image is not None:
-            if hasattr(image, "data"):
+            if ((isinstance(image, Image) and
+                 (self.data_reference() is not None) and
+                 (self.data_reference() is image.data_reference()))):
+                return True
+            elif hasattr(image, "data"):
                 return self.data == image.data
             else:
                 return False
@@ -3771,6 +3844,108 @@ class InvalidImage(Exception):
     """raised if an image cannot be parsed correctly"""
 
 
+class ImageReference(object):
+    """the location of an image's data within a file"""
+
+    def __init__(self, filename, offset, length):
+        """filename is the path of the file containing the image data
+        offset is the data's position from the start of the file in bytes
+        and length is the data's size in bytes"""
+
+        self.filename = filename
+        self.offset = offset
+        self.length = length
+        self.__data__ = None
+        self.__stat__ = self.__signature__()
+        __IMAGE_REFERENCES__.add(self)
+
+    def __signature__(self):
+        stat = os.stat(self.filename)
+        return (stat.st_dev, stat.st_ino, stat.st_size, stat.st_mtime)
+
+    def __opened__(self):
+        from audiotools.text import ERR_IMAGE_FILE_MODIFIED
+
+        try:
+            if self.__signature__() != self.__stat__:
+                raise IOError(ERR_IMAGE_FILE_MODIFIED)
+        except OSError:
+            raise IOError(ERR_IMAGE_FILE_MODIFIED)
+
+        f = __open__(self.filename, "rb")
+        f.seek(self.offset, 0)
+        return f
+
+    def read(self):
+        """returns the referenced data as a binary string
+
+        raises IOError if the file has been modified
+        since the reference was made"""
+
+        if self.__data__ is not None:
+            return self.__data__
+
+        from audiotools.text import ERR_IMAGE_FILE_MODIFIED
+
+        with self.__opened__() as f:
+            data = f.read(self.length)
+        if len(data) != self.length:
+            raise IOError(ERR_IMAGE_FILE_MODIFIED)
+        return data
+
+    def transfer(self, to_function):
+        """sends the referenced data to to_function
+        in strings of at most BUFFER_SIZE bytes
+
+        raises IOError if the file has been modified
+        since the reference was made"""
+
+        if self.__data__ is not None:
+            to_function(self.__data__)
+            return
+
+        from audiotools.text import ERR_IMAGE_FILE_MODIFIED
+
+        with self.__opened__() as f:
+            remaining = self.length
+            while remaining > 0:
+                data = f.read(min(remaining, BUFFER_SIZE))
+                if len(data) == 0:
+                    raise IOError(ERR_IMAGE_FILE_MODIFIED)
+                to_function(data)
+                remaining -= len(data)
+
+    def detach(self):
+        """reads the referenced data into memory
+        so that it remains available after the file is modified"""
+
+        if self.__data__ is None:
+            self.__data__ = self.read()
+            __IMAGE_REFERENCES__.discard(self)
+
+
+__IMAGE_REFERENCES__ = weakref.WeakSet()
+
+
+def detach_image_references(filename):
+    """given a file about to be modified,
+    reads the data of any images still referencing it into memory"""
+
+    try:
+        stat = os.stat(filename)
+    except OSError:
+        return
+
+    for reference in list(__IMAGE_REFERENCES__):
+        if reference.__stat__[0:2] == (stat.st_dev, stat.st_ino):
+            try:
+                reference.detach()
+            except IOError:
+                # the file has already been modified by something else
+                # so the reference is unusable anyway
+                __IMAGE_REFERENCES__.discard(reference)
+
+
 class ReplayGain(object):
     """a container for ReplayGain data"""
 
@@ -4089,6 +4264,18 @@ class AudioFile(object):
 
         raise NotImplementedError()
 
+    @classmethod
+    def from_pcm_format(cls, sample_rate, channels, channel_mask,
+                        bits_per_sample):
+        """given the attributes of a PCMReader passed to from_pcm()
+        returns a (sample_rate, channels, channel_mask, bits_per_sample)
+        tuple of the stream from_pcm() converts it to before encoding
+
+        this allows streams bound for several encoders
+        to be converted only once per distinct format"""
+
+        return (sample_rate, channels, channel_mask, bits_per_sample)
+
     def convert(self, target_path, target_class,
                 compression=None, progress=None):
         """encodes a new AudioFile from existing AudioFile
@@ -4105,6 +4292,24 @@ class AudioFile(object):
             total_pcm_frames=(self.total_frames() if self.lossless()
                               else None))
 
+    def convert_many(self, targets, progress=None):
+        """encodes several new AudioFiles from a single decode
+        of this AudioFile
+
+        targets is a list of (target_path, target_class, compression)
+        tuples and the new AudioFile objects are returned
+        in the same order, all encoded in parallel
+
+        unlike convert(), foreign RIFF WAVE or AIFF chunks
+        are not carried over to the new files
+
+        may raise EncodingError if some problem occurs during encoding"""
+
+        return from_pcm_many(to_pcm_progress(self, progress),
+                             targets,
+                             total_pcm_frames=(self.total_frames() if
+                                               self.lossless() else None))
+
     def seekable(self):
         """returns True if the file is seekable
 
@@ -4303,14 +4508,42 @@ class AudioFile(object):
         some problem with the file"""
 
         pcm_frame_count = 0
-        with to_pcm_progress(self, progress) as decoder:
-            try:
-                framelist = decoder.read(BUFFER_SIZE)
-                while framelist.frames > 0:
-                    pcm_frame_count += framelist.frames
+        with self.to_pcm() as decoder:
+            if hasattr(decoder, "verify"):
+                # decoders with a native verify() check their stream
+                # without building a FrameList for each frame
+                if callable(progress):
+                    total_frames = max(self.total_frames(), 1)
+                    frames_progress = lambda frames: progress(
+                        Fraction(frames, total_frames))
+                else:
+                    frames_progress = None
+                try:
+                    (pcm_frame_count,
+                     bad_frame_offset,
+                     error) = decoder.verify(frames_progress)
+                except (IOError, ValueError) as err:
+                    raise InvalidFile(str(err))
+                if error is not None:
+                    if bad_frame_offset is not None:
+                        from audiotools.text import ERR_BAD_FRAME
+                        raise InvalidFile(
+                            ERR_BAD_FRAME.format(error=error,
+                                                 offset=bad_frame_offset))
+                    else:
+                        raise InvalidFile(error)
+            else:
+                if callable(progress):
+                    decoder = PCMReaderProgress(decoder,
+                                                self.total_frames(),
+                                                progress)
+                try:
                     framelist = decoder.read(BUFFER_SIZE)
-            except (IOError, ValueError) as err:
-                raise InvalidFile(str(err))
+                    while framelist.frames > 0:
+                        pcm_frame_count += framelist.frames
+                        framelist = decoder.read(BUFFER_SIZE)
+                except (IOError, ValueError) as err:
+                    raise InvalidFile(str(err))
 
         if self.lossless():
             if pcm_frame_count == self.total_frames():
@@ -5157,6 +5390,283 @@ class PCMReaderDeHead(PCMReader):
         self.read = self.read_closed
 
 
+def __split_pcm__(pcmreader, outputs, buffer_size, result_pipe):
+    """runs pcmconverter.split_pcm in a splitter subprocess,
+    sending None or the raised exception to result_pipe"""
+
+    from audiotools.pcmconverter import split_pcm
+
+    try:
+        split_pcm(pcmreader, outputs, buffer_size)
+        result_pipe.send(None)
+    except Exception as err:
+        result_pipe.send(err)
+    finally:
+        pcmreader.close()
+        result_pipe.close()
+
+
+class __PCMSplitterReader__(PCMFileReader):
+    """a PCMReader of a single PCMSplitter span"""
+
+    def close(self):
+        """discards the rest of the span before closing the stream
+
+        other processes may hold copies of the span's pipe,
+        so a reader which stops early would otherwise leave
+        the splitter waiting on it and starve the remaining spans"""
+
+        if not self.file.closed:
+            while len(self.file.read(self.bytes_per_frame * 4096)) > 0:
+                pass
+        PCMFileReader.close(self)
+
+
+class PCMSplitter(object):
+    """decodes a PCMReader once in a subprocess
+    and routes spans of its PCM frames to separate PCMReaders
+    which may be read concurrently by other processes
+
+    each span's frames pass through an OS pipe
+    and no more than about buffer_size bytes are held back
+    for readers which aren't keeping up,
+    so the full stream is never staged anywhere"""
+
+    def __init__(self, pcmreader, spans, buffer_size=2 ** 24):
+        """pcmreader is a PCMReader object
+
+        spans is a list of (pcm_frames_offset, pcm_frames) tuples
+        where frames outside every span are discarded,
+        spans past the end of the stream are padded with silence
+        and a pcm_frames of None runs to the end of the stream
+
+        spans may overlap, but the stream only advances
+        as fast as its slowest reader once buffer_size is reached,
+        so readers of overlapping spans should run concurrently
+
+        buffer_size is the most bytes to hold for full pipes
+
+        may raise ValueError if the spans are invalid"""
+
+        from multiprocessing import Process, Pipe
+
+        for (offset, pcm_frames) in spans:
+            if (offset < 0) or ((pcm_frames is not None) and
+                                (pcm_frames < 0)):
+                raise ValueError("invalid span")
+
+        self.sample_rate = pcmreader.sample_rate
+        self.channels = pcmreader.channels
+        self.channel_mask = pcmreader.channel_mask
+        self.bits_per_sample = pcmreader.bits_per_sample
+
+        self.__pcmreader__ = pcmreader
+        pipes = [os.pipe() for span in spans]
+        self.__read_fds__ = [r for (r, w) in pipes]
+        (self.__result_pipe__, child_conn) = Pipe(False)
+
+        def split(read_fds, *args):
+            for fd in read_fds:
+                os.close(fd)
+            __split_pcm__(*args)
+
+        self.__process__ = Process(
+            target=split,
+            args=(self.__read_fds__,
+                  pcmreader,
+                  [(w, offset, pcm_frames)
+                   for ((r, w), (offset, pcm_frames)) in zip(pipes, spans)],
+                  buffer_size,
+                  child_conn))
+        self.__process__.daemon = True
+        self.__process__.start()
+
+        # only the splitter subprocess writes to the pipes
+        # so each reader gets EOF once its span is complete
+        for (r, w) in pipes:
+            os.close(w)
+        child_conn.close()
+
+    def reader(self, index):
+        """returns a PCMReader of the span at the given index
+
+        the span's frames are only available once,
+        so each index should be read by a single PCMReader"""
+
+        return __PCMSplitterReader__(
+            file=os.fdopen(os.dup(self.__read_fds__[index]), "rb"),
+            sample_rate=self.sample_rate,
+            channels=self.channels,
+            channel_mask=self.channel_mask,
+            bits_per_sample=self.bits_per_sample)
+
+    def close(self):
+        """waits for the splitter subprocess to finish
+        and closes the source PCMReader
+
+        any spans not yet read are discarded
+
+        raises DecodingError if the source PCMReader
+        raised an error during splitting"""
+
+        for fd in self.__read_fds__:
+            os.close(fd)
+        self.__read_fds__ = []
+
+        try:
+            error = self.__result_pipe__.recv()
+        except EOFError:
+            error = ValueError("splitter exited unexpectedly")
+        self.__result_pipe__.close()
+        self.__process__.join()
+        self.__pcmreader__.close()
+
+        if error is not None:
+            raise DecodingError(str(error))
+
+
+def from_pcm_many(pcmreader, targets, total_pcm_frames=None,
+                  buffer_size=2 ** 24):
+    """encodes several new files from a single pass over a PCMReader
+
+    targets is a list of (filename, AudioFile class, compression) tuples
+    and the new AudioFile objects are returned in the same order
+
+    the stream is read in the current process
+    while each target is encoded in its own subprocess,
+    and targets whose from_pcm_format() is the same
+    share a single conversion subprocess for that format
+
+    total_pcm_frames is passed to targets which need no conversion
+
+    buffer_size is the most bytes to hold for encoders not keeping up
+
+    may raise EncodingError if some problem occurs when encoding
+    or when reading from pcmreader"""
+
+    from multiprocessing import Process, Pipe
+    from audiotools.pcmconverter import split_pcm
+
+    source_format = (pcmreader.sample_rate,
+                     pcmreader.channels,
+                     pcmreader.channel_mask,
+                     pcmreader.bits_per_sample)
+
+    # target indexes grouped by the format they're encoded from
+    # with unconverted targets in the first group
+    groups = [(source_format, [])]
+    for (i, (filename, audio_class, compression)) in enumerate(targets):
+        target_format = audio_class.from_pcm_format(*source_format)
+        for (group_format, indexes) in groups:
+            if group_format == target_format:
+                indexes.append(i)
+                break
+        else:
+            groups.append((target_format, [i]))
+
+    # a pipe per target and per converted format
+    target_pipes = [os.pipe() for t in targets]
+    group_pipes = [os.pipe() for g in groups[1:]]
+    all_fds = [fd for pipe in target_pipes + group_pipes for fd in pipe]
+
+    def run(function, keep_fds, result_pipe, *args):
+        # each subprocess holds only its own pipe ends
+        # so readers see EOF and writers see EPIPE as expected
+        for fd in all_fds:
+            if fd not in keep_fds:
+                os.close(fd)
+        try:
+            function(*args)
+            result_pipe.send(None)
+        except Exception as err:
+            result_pipe.send(str(err))
+        result_pipe.close()
+
+    def pipe_reader(fd, pcm_format):
+        (sample_rate, channels, channel_mask, bits_per_sample) = pcm_format
+        return PCMFileReader(file=os.fdopen(fd, "rb"),
+                             sample_rate=sample_rate,
+                             channels=channels,
+                             channel_mask=channel_mask,
+                             bits_per_sample=bits_per_sample)
+
+    def encode(fd, pcm_format, filename, audio_class, compression, total):
+        audio_class.from_pcm(filename,
+                             pipe_reader(fd, pcm_format),
+                             compression,
+                             total)
+
+    def convert(fd, pcm_format, output_fds):
+        reader = PCMConverter(pipe_reader(fd, source_format), *pcm_format)
+        try:
+            split_pcm(reader,
+                      [(output_fd, 0, None) for output_fd in output_fds],
+                      buffer_size)
+        finally:
+            reader.close()
+
+    def start(function, keep_fds, *args):
+        # each process is started before the next Pipe is made
+        # so no sibling inherits another's result connection
+        # and a process which dies is seen as EOF
+        (result_pipe, child_conn) = Pipe(False)
+        process = Process(target=run,
+                          args=(function, keep_fds, child_conn) + args)
+        process.start()
+        child_conn.close()
+        return (process, result_pipe)
+
+    processes = []
+    for (group, (group_format, indexes)) in enumerate(groups):
+        for i in indexes:
+            (filename, audio_class, compression) = targets[i]
+            (r, w) = target_pipes[i]
+            processes.append(
+                start(encode, [r],
+                      r, group_format, filename, audio_class, compression,
+                      total_pcm_frames if group == 0 else None))
+
+        if group > 0:
+            (r, w) = group_pipes[group - 1]
+            output_fds = [target_pipes[i][1] for i in indexes]
+            processes.append(
+                start(convert, [r] + output_fds,
+                      r, group_format, output_fds))
+
+    # the current process only writes the unconverted stream
+    outputs = ([target_pipes[i][1] for i in groups[0][1]] +
+               [w for (r, w) in group_pipes])
+    for fd in all_fds:
+        if fd not in outputs:
+            os.close(fd)
+
+    errors = []
+    try:
+        split_pcm(pcmreader, [(fd, 0, None) for fd in outputs], buffer_size)
+    except (ValueError, IOError) as err:
+        errors.append(str(err))
+    finally:
+        pcmreader.close()
+
+    for (process, result_pipe) in processes:
+        try:
+            error = result_pipe.recv()
+        except EOFError:
+            error = "encoding subprocess exited unexpectedly"
+        result_pipe.close()
+        process.join()
+        if error is not None:
+            errors.append(error)
+
+    if len(errors) > 0:
+        for (filename, audio_class, compression) in targets:
+            audio_class.__unlink__(filename)
+        raise EncodingError(errors[0])
+    else:
+        return [audio_class(filename)
+                for (filename, audio_class, compression) in targets]
+
+
 # returns the value in item_list which occurs most often
 def most_numerous(item_list, empty_list=None, all_differ=None):
     """returns the value in the item list which occurs most often
@@ -5871,6 +6381,7 @@ class TemporaryFile(object):
         and the temporary file is closed and deleted"""
 
         self.__temp_file__.close()
+        detach_image_references(self.__original_filename__)
         original_mode = os.stat(self.__original_filename__).st_mode
         try:
             os.rename(self.__temp_path__, self.__original_filename__)
@@ -581,7 +581,7 @@ class ApeTag(MetaData):
 
         may return None if the file object has no tag"""
 
-        from audiotools.bitstream import BitstreamReader, parse
+        from audiotools._tags import parse_apev2_footer, parse_apev2_items
 
         apefile.seek(-32, 2)
         tag_footer = apefile.read(32)
@@ -590,57 +590,34 @@ class ApeTag(MetaData):
             # not enough bytes for an ApeV2 tag
             return None
 
-        (preamble,
-         version,
-         tag_size,
-         item_count,
-         read_only,
-         item_encoding,
-         is_header,
-         no_footer,
-         has_header) = parse(cls.HEADER_FORMAT, True, tag_footer)
-
-        if (preamble != b"APETAGEX") or (version != 2000):
+        try:
+            (tag_size,
+             item_count,
+             has_header) = parse_apev2_footer(tag_footer)
+        except ValueError:
             return None
 
         apefile.seek(-tag_size, 2)
-        reader = BitstreamReader(apefile, True)
+        try:
+            items = parse_apev2_items(apefile.read(tag_size - 32), item_count)
+        except ValueError as err:
+            raise IOError(str(err))
 
-        return cls([ApeTagItem.parse(reader) for i in range(item_count)],
+        return cls([ApeTagItem(item_type, read_only, key, value)
+                    for (item_type, read_only, key, value) in items],
                    contains_header=has_header,
                    contains_footer=True)
 
     def build(self, writer):
         """outputs an APEv2 tag to BitstreamWriter"""
 
-        tag_size = sum(tag.total_size() for tag in self.tags) + 32
+        from audiotools._tags import build_apev2
 
-        if self.contains_header:
-            writer.build(ApeTag.HEADER_FORMAT,
-                         (b"APETAGEX",               # preamble
-                          2000,                      # version
-                          tag_size,                  # tag size
-                          len(self.tags),            # item count
-                          0,                         # read only
-                          0,                         # encoding
-                          1,                         # is header
-                          not self.contains_footer,  # no footer
-                          self.contains_header))     # has header
-
-        for tag in self.tags:
-            tag.build(writer)
-
-        if self.contains_footer:
-            writer.build(ApeTag.HEADER_FORMAT,
-                         (b"APETAGEX",               # preamble
-                          2000,                      # version
-                          tag_size,                  # tag size
-                          len(self.tags),            # item count
-                          0,                         # read only
-                          0,                         # encoding
-                          0,                         # is header
-                          not self.contains_footer,  # no footer
-                          self.contains_header))     # has header
+        writer.write_bytes(
+            build_apev2([(tag.type, tag.read_only, tag.key, tag.data)
+                         for tag in self.tags],
+                        self.contains_header,
+                        self.contains_footer))
 
     def clean(self):
         import re
@@ -24,91 +24,7 @@ class InvalidAU(InvalidFile):
     pass
 
 
-class AuReader(object):
-    def __init__(self, au_filename):
-        from audiotools.bitstream import BitstreamReader
-        from audiotools.text import (ERR_AU_INVALID_HEADER,
-                                     ERR_AU_UNSUPPORTED_FORMAT)
-
-        self.stream = BitstreamReader(open(au_filename, "rb"), False)
-        (magic_number,
-         self.data_offset,
-         data_size,
-         encoding_format,
-         self.sample_rate,
-         self.channels) = self.stream.parse("4b 5* 32u")
-
-        if magic_number != b'.snd':
-            self.stream.close()
-            raise ValueError(ERR_AU_INVALID_HEADER)
-        try:
-            self.bits_per_sample = {2: 8, 3: 16, 4: 24}[encoding_format]
-        except KeyError:
-            self.stream.close()
-            raise ValueError(ERR_AU_UNSUPPORTED_FORMAT)
-
-        self.channel_mask = {1: 0x4, 2: 0x3}.get(self.channels, 0)
-        self.bytes_per_pcm_frame = ((self.bits_per_sample // 8) *
-                                    self.channels)
-        self.total_pcm_frames = (data_size // self.bytes_per_pcm_frame)
-        self.remaining_pcm_frames = self.total_pcm_frames
-
-    def __enter__(self):
-        return self
-
-    def __exit__(self, exc_type, exc_value, traceback):
-        self.close()
-
-    def read(self, pcm_frames):
-        # try to read requested PCM frames or remaining frames
-        requested_pcm_frames = min(max(pcm_frames, 1),
-                                   self.remaining_pcm_frames)
-        requested_bytes = (self.bytes_per_pcm_frame *
-                           requested_pcm_frames)
-        pcm_data = self.stream.read_bytes(requested_bytes)
-
-        # raise exception if data block exhausted early
-        if len(pcm_data) < requested_bytes:
-            from audiotools.text import ERR_AU_TRUNCATED_DATA
-            raise IOError(ERR_AU_TRUNCATED_DATA)
-        else:
-            self.remaining_pcm_frames -= requested_pcm_frames
-
-            # return parsed chunk
-            return FrameList(pcm_data,
-                             self.channels,
-                             self.bits_per_sample,
-                             True,
-                             True)
-
-    def read_closed(self, pcm_frames):
-        raise ValueError("cannot read closed stream")
-
-    def seek(self, pcm_frame_offset):
-        if pcm_frame_offset < 0:
-            from audiotools.text import ERR_NEGATIVE_SEEK
-            raise ValueError(ERR_NEGATIVE_SEEK)
-
-        # ensure one doesn't walk off the end of the file
-        pcm_frame_offset = min(pcm_frame_offset,
-                               self.total_pcm_frames)
-
-        # position file in data block
-        self.stream.seek(self.data_offset +
-                         (pcm_frame_offset *
-                          self.bytes_per_pcm_frame), 0)
-        self.remaining_pcm_frames = (self.total_pcm_frames -
-                                     pcm_frame_offset)
-
-        return pcm_frame_offset
-
-    def seek_closed(self, pcm_frame_offset):
-        raise ValueError("cannot seek closed stream")
-
-    def close(self):
-        self.stream.close()
-        self.read = self.read_closed
-        self.seek = self.seek_closed
+from audiotools.decoders import AuDecoder as AuReader
 
 
 def au_header(sample_rate,
@@ -25,6 +25,13 @@ from audiotools.vorbiscomment import VorbisComment
 # the maximum padding size to use when rewriting metadata blocks
 MAX_PADDING_SIZE = 2 ** 20
 
+# the minimum padding size to reserve when the whole file is rewritten
+DEFAULT_PADDING_SIZE = 4096
+
+# values returned by FlacAudio.last_metadata_update()
+METADATA_IN_PLACE = "in-place"
+METADATA_REWRITTEN = "rewritten"
+
 
 class InvalidFLAC(InvalidFile):
     pass
@@ -292,9 +299,13 @@ class FlacMetaData(MetaData):
             return MetaData.intersection(self, metadata)
 
     @classmethod
-    def parse(cls, reader):
+    def parse(cls, reader, filename=None, offset=0):
         """returns a FlacMetaData object from the given BitstreamReader
-        which has already parsed the 4-byte 'fLaC' file ID"""
+        which has already parsed the 4-byte 'fLaC' file ID
+
+        if filename is given, offset is the position of the
+        first metadata block in that file
+        and PICTURE block data is referenced from it rather than read"""
 
         block_list = []
 
@@ -302,6 +313,7 @@ class FlacMetaData(MetaData):
 
         while last != 1:
             (last, block_type, block_length) = reader.parse("1u7u24u")
+            offset += 4
 
             if block_type == 0:    # STREAMINFO
                 block_list.append(
@@ -322,8 +334,12 @@ class FlacMetaData(MetaData):
                 block_list.append(
                     Flac_CUESHEET.parse(reader))
             elif block_type == 6:  # PICTURE
-                block_list.append(
-                    Flac_PICTURE.parse(reader))
+                if filename is not None:
+                    block_list.append(
+                        Flac_PICTURE.parse(reader, filename, offset))
+                else:
+                    block_list.append(
+                        Flac_PICTURE.parse(reader))
             elif (block_type >= 7) and (block_type <= 126):
                 from audiotools.text import ERR_FLAC_RESERVED_BLOCK
                 raise ValueError(ERR_FLAC_RESERVED_BLOCK.format(block_type))
@@ -331,6 +347,8 @@ class FlacMetaData(MetaData):
                 from audiotools.text import ERR_FLAC_INVALID_BLOCK
                 raise ValueError(ERR_FLAC_INVALID_BLOCK)
 
+            offset += block_length
+
         return cls(block_list)
 
     def raw_info(self):
@@ -1267,14 +1285,7 @@ class Flac_PICTURE(Image):
     def copy(self):
         """returns a duplicate of this metadata block"""
 
-        return Flac_PICTURE(self.picture_type,
-                            self.mime_type,
-                            self.description,
-                            self.width,
-                            self.height,
-                            self.color_depth,
-                            self.color_count,
-                            self.data)
+        return self.converted(self)
 
     def __getattr__(self, attr):
         if attr == "type":
@@ -1300,7 +1311,7 @@ class Flac_PICTURE(Image):
                     5: LEAFLET_PAGE,
                     6: MEDIA}.get(self.picture_type, OTHER)
         else:
-            return Image.__getattribute__(self, attr)
+            return Image.__getattr__(self, attr)
 
     def __setattr__(self, attr, value):
         if attr == "type":
@@ -1354,29 +1365,49 @@ class Flac_PICTURE(Image):
              u"          height = {:d}".format(self.height),
              u"     color depth = {:d}".format(self.color_depth),
              u"     color count = {:d}".format(self.color_count),
-             u"           bytes = {:d}".format(len(self.data))])
+             u"           bytes = {:d}".format(self.data_size())])
 
     @classmethod
-    def parse(cls, reader):
-        """returns this metadata block from a BitstreamReader"""
+    def parse(cls, reader, filename=None, offset=0):
+        """returns this metadata block from a BitstreamReader
+
+        if filename is given, offset is the position of the block
+        in that file, not including its 4-byte header,
+        and the picture's data is skipped and referenced from the file"""
+
+        from audiotools import ImageReference
 
         picture_type = reader.read(32)
-        mime_type = reader.read_bytes(reader.read(32)).decode('ascii')
-        description = reader.read_bytes(reader.read(32)).decode('utf-8')
+        mime_type = reader.read_bytes(reader.read(32))
+        description = reader.read_bytes(reader.read(32))
         width = reader.read(32)
         height = reader.read(32)
         color_depth = reader.read(32)
         color_count = reader.read(32)
-        data = reader.read_bytes(reader.read(32))
+        data_length = reader.read(32)
 
-        return cls(picture_type=picture_type,
-                   mime_type=mime_type,
-                   description=description,
-                   width=width,
-                   height=height,
-                   color_depth=color_depth,
-                   color_count=color_count,
-                   data=data)
+        if filename is None:
+            data = reader.read_bytes(data_length)
+        else:
+            reader.skip_bytes(data_length)
+            data = b""
+
+        picture = cls(picture_type=picture_type,
+                      mime_type=mime_type.decode('ascii'),
+                      description=description.decode('utf-8'),
+                      width=width,
+                      height=height,
+                      color_depth=color_depth,
+                      color_count=color_count,
+                      data=data)
+
+        if filename is None:
+            return picture
+        else:
+            return picture.reference_data(
+                ImageReference(filename,
+                               offset + 32 + len(mime_type) + len(description),
+                               data_length))
 
     def build(self, writer):
         """writes this metadata block to a BitstreamWriter"""
@@ -1392,8 +1423,8 @@ class Flac_PICTURE(Image):
         writer.write(32, self.height)
         writer.write(32, self.color_depth)
         writer.write(32, self.color_count)
-        writer.write(32, len(self.data))
-        writer.write_bytes(self.data)
+        writer.write(32, self.data_size())
+        self.transfer_data(writer.write_bytes)
 
     def size(self):
         """the size of this metadata block
@@ -1406,13 +1437,17 @@ class Flac_PICTURE(Image):
                 4 +  # height
                 4 +  # color_count
                 4 +  # color_depth
-                4 + len(self.data))
+                4 + self.data_size())
 
     @classmethod
     def converted(cls, image):
-        """converts an Image object to a FlacPictureComment"""
+        """converts an Image object to a FlacPictureComment
+
+        data referenced from a file remains referenced"""
 
-        return cls(
+        reference = image.data_reference()
+
+        picture = cls(
             picture_type={4: 0, 0: 3, 1: 4, 2: 5, 3: 6}.get(image.type, 0),
             mime_type=image.mime_type,
             description=image.description,
@@ -1420,7 +1455,12 @@ class Flac_PICTURE(Image):
             height=image.height,
             color_depth=image.color_depth,
             color_count=image.color_count,
-            data=image.data)
+            data=image.data if reference is None else b"")
+
+        if reference is None:
+            return picture
+        else:
+            return picture.reference_data(reference)
 
     def type_string(self):
         """returns the image's type as a human readable plain string
@@ -1509,6 +1549,10 @@ class FlacAudio(WaveContainer, AiffContainer):
         self.__total_frames__ = 0
         self.__md5__ = b"\x00" * 16
 
+        # which of METADATA_IN_PLACE or METADATA_REWRITTEN
+        # the last update_metadata() call took, if any
+        self.__last_metadata_update__ = None
+
         try:
             with open(self.filename, "rb") as f:
                 # check for leading ID3v3 tag
@@ -1628,7 +1672,10 @@ class FlacAudio(WaveContainer, AiffContainer):
         with BitstreamReader(open(self.filename, 'rb'), False) as reader:
             reader.seek(self.__stream_offset__, 0)
             if reader.read_bytes(4) == b"fLaC":
-                return FlacMetaData.parse(reader)
+                # leave PICTURE data on disk until it's needed
+                return FlacMetaData.parse(reader,
+                                          self.filename,
+                                          self.__stream_offset__ + 4)
             else:
                 # shouldn't be able to get here
                 return None
@@ -1638,13 +1685,12 @@ class FlacAudio(WaveContainer, AiffContainer):
         as returned by get_metadata() and sets this track's metadata
         with any fields updated in that object
 
+        any metadata update journal left behind by an interrupted write
+        is replayed first
+
         raises IOError if unable to write the file
         """
 
-        from audiotools.bitstream import BitstreamWriter
-        from audiotools.bitstream import BitstreamReader
-        from operator import add
-
         if metadata is None:
             return
 
@@ -1652,84 +1698,126 @@ class FlacAudio(WaveContainer, AiffContainer):
             from audiotools.text import ERR_FOREIGN_METADATA
             raise ValueError(ERR_FOREIGN_METADATA)
 
+        with MetadataWriteLock(self.filename):
+            replay_metadata_journal(self.filename)
+            self.__last_metadata_update__ = \
+                self.__update_metadata__(FlacMetaData(metadata.block_list))
+
+    def __update_metadata__(self, metadata):
+        """writes the given FlacMetaData object to disk,
+        adjusting its PADDING blocks as necessary
+
+        returns METADATA_IN_PLACE if the metadata blocks
+        were overwritten in place,
+        or METADATA_REWRITTEN if the whole file was rewritten
+
+        must be called with the file's MetadataWriteLock held"""
+
+        from audiotools.bitstream import BitstreamWriter
+        from audiotools.bitstream import BitstreamRecorder
+
         old_metadata = self.get_metadata()
         padding_blocks = metadata.get_blocks(Flac_PADDING.BLOCK_ID)
-        has_padding = len(padding_blocks) > 0
         padding_unchanged = (old_metadata.get_blocks(Flac_PADDING.BLOCK_ID) ==
                              padding_blocks)
-        total_padding_size = sum(b.size() for b in padding_blocks)
-
-        metadata_delta = metadata.size() - old_metadata.size()
-
-        if (has_padding and padding_unchanged and
-            (metadata_delta <= total_padding_size) and
-            ((-metadata_delta + total_padding_size) <= MAX_PADDING_SIZE)):
-            # if padding size is larger than change in metadata
-            # shrink padding blocks so that new size matches old size
-            # (if metadata_delta is negative,
-            #  this will enlarge padding blocks as necessary)
-
-            for padding in padding_blocks:
-                if metadata_delta > 0:
-                    # extract bytes from PADDING blocks
-                    # until the metadata_delta is exhausted
-                    if metadata_delta <= padding.length:
-                        padding.length -= metadata_delta
-                        metadata_delta = 0
-                    else:
-                        metadata_delta -= padding.length
-                        padding.length = 0
-                elif metadata_delta < 0:
-                    # dump all our new bytes into the first PADDING block found
-                    padding.length += -metadata_delta
-                    metadata_delta = 0
-                else:
-                    break
-
-            # then overwrite the beginning of the file
-            stream = open(self.filename, 'r+b')
-            stream.seek(self.__stream_offset__, 0)
-            writer = BitstreamWriter(stream, 0)
-            writer.write_bytes(b'fLaC')
-            metadata.build(writer)
-            writer.flush()
-            writer.close()
-        else:
-            # if padding is smaller than change in metadata,
-            # the padding would get excessively large,
-            # or file has no padding blocks,
-            # rewrite entire file to fit new metadata
-
-            from audiotools import TemporaryFile, transfer_data
-            from audiotools.bitstream import parse
-
-            # dump any prefix data from old file to new one
-            old_file = open(self.filename, "rb")
-            new_file = TemporaryFile(self.filename)
 
-            new_file.write(old_file.read(self.__stream_offset__))
+        # the size of all non-PADDING blocks, including headers
+        data_size = sum(4 + b.size() for b in metadata.blocks()
+                        if (b.BLOCK_ID != Flac_PADDING.BLOCK_ID))
+
+        if padding_unchanged:
+            # if the caller hasn't specified any PADDING blocks of its own
+            # the new blocks may use all of the space
+            # occupied by the old blocks, including any which were removed,
+            # with what's left over becoming a single PADDING block
+            remaining = self.__metadata_length__() - data_size
+
+            if remaining == 0:
+                metadata.replace_blocks(Flac_PADDING.BLOCK_ID, [])
+            elif (remaining >= 4) and ((remaining - 4) <= MAX_PADDING_SIZE):
+                metadata.replace_blocks(Flac_PADDING.BLOCK_ID,
+                                        [Flac_PADDING(remaining - 4)])
+            else:
+                # reserve a new padding budget proportional
+                # to the size of the metadata being written
+                # so that subsequent updates are likely to fit in place
+                metadata.replace_blocks(
+                    Flac_PADDING.BLOCK_ID,
+                    [Flac_PADDING(min(DEFAULT_PADDING_SIZE + data_size // 8,
+                                      MAX_PADDING_SIZE))])
+                remaining = None
+
+            if remaining is not None:
+                # overwrite the old metadata blocks in place
+                header = BitstreamRecorder(False)
+                metadata.build(header)
+                write_metadata_journaled(self.filename,
+                                         self.__stream_offset__ + 4,
+                                         header.data())
+                return METADATA_IN_PLACE
+
+        # if padding is smaller than change in metadata,
+        # the padding would get excessively large,
+        # or the caller has specified its own PADDING blocks,
+        # rewrite entire file to fit new metadata
+
+        from audiotools import TemporaryFile, transfer_data
+        from audiotools.bitstream import parse
+
+        # dump any prefix data from old file to new one
+        old_file = open(self.filename, "rb")
+        new_file = TemporaryFile(self.filename)
+
+        new_file.write(old_file.read(self.__stream_offset__))
+
+        # skip existing file ID and metadata blocks
+        if old_file.read(4) != b'fLaC':
+            from audiotools.text import ERR_FLAC_INVALID_FILE
+            raise InvalidFLAC(ERR_FLAC_INVALID_FILE)
+
+        stop = 0
+        while stop == 0:
+            (stop, length) = parse("1u 7p 24u", False, old_file.read(4))
+            old_file.read(length)
+
+        # write new metadata to new file
+        writer = BitstreamWriter(new_file, False)
+        writer.write_bytes(b"fLaC")
+        metadata.build(writer)
+
+        # write remaining old data to new file
+        transfer_data(old_file.read, writer.write_bytes)
+
+        # commit change to disk
+        old_file.close()
+        writer.close()
+
+        return METADATA_REWRITTEN
+
+    def last_metadata_update(self):
+        """returns METADATA_IN_PLACE if the last update_metadata()
+        or set_metadata() call overwrote the metadata blocks in place,
+        METADATA_REWRITTEN if it rewrote the whole file,
+        or None if no metadata has been written by this object"""
+
+        return self.__last_metadata_update__
+
+    def __metadata_length__(self):
+        """returns the total size of the file's metadata blocks
+        including block headers
+        but not including the 4 byte 'fLaC' file ID"""
 
-            # skip existing file ID and metadata blocks
-            if old_file.read(4) != b'fLaC':
-                from audiotools.text import ERR_FLAC_INVALID_FILE
-                raise InvalidFLAC(ERR_FLAC_INVALID_FILE)
+        from audiotools.bitstream import BitstreamReader
 
+        with BitstreamReader(open(self.filename, "rb"), False) as reader:
+            reader.seek(self.__stream_offset__ + 4, 0)
+            total_length = 0
             stop = 0
             while stop == 0:
-                (stop, length) = parse("1u 7p 24u", False, old_file.read(4))
-                old_file.read(length)
-
-            # write new metadata to new file
-            writer = BitstreamWriter(new_file, False)
-            writer.write_bytes(b"fLaC")
-            metadata.build(writer)
-
-            # write remaining old data to new file
-            transfer_data(old_file.read, writer.write_bytes)
-
-            # commit change to disk
-            old_file.close()
-            writer.close()
+                (stop, length) = reader.parse("1u 7p 24u")
+                reader.skip_bytes(length)
+                total_length += 4 + length
+            return total_length
 
     def set_metadata(self, metadata):
         """takes a MetaData object and sets this track's metadata
@@ -1742,6 +1830,10 @@ class FlacAudio(WaveContainer, AiffContainer):
 
         new_metadata = self.METADATA_CLASS.converted(metadata)
 
+        # finish any interrupted update before reading the old metadata
+        with MetadataWriteLock(self.filename):
+            replay_metadata_journal(self.filename)
+
         old_metadata = self.get_metadata()
         if old_metadata is None:
             # this shouldn't happen
@@ -1983,7 +2075,12 @@ class FlacAudio(WaveContainer, AiffContainer):
         optional total_pcm_frames integer
         encodes a new audio file from pcmreader's data
         at the given filename with the specified compression level
-        and returns a new FlacAudio object"""
+        and returns a new FlacAudio object
+
+        if total_pcm_frames is unknown, frames are written directly
+        after space reserved for the SEEKTABLE
+        and whatever space the SEEKTABLE doesn't use
+        is left as PADDING in addition to the default"""
 
         from audiotools.encoders import encode_flac
         from audiotools import EncodingError
@@ -3053,6 +3150,174 @@ class OggFlacMetaData(FlacMetaData):
         return sequence_number
 
 
+def metadata_journal_path(filename):
+    """given a FLAC filename,
+    returns the path of its metadata update journal"""
+
+    import os.path
+
+    (dirname, basename) = os.path.split(filename)
+    return os.path.join(dirname, "." + basename + ".journal")
+
+
+def __pwrite__(fd, data, offset):
+    import os
+
+    if hasattr(os, "pwrite"):
+        while len(data) > 0:
+            written = os.pwrite(fd, data, offset)
+            data = data[written:]
+            offset += written
+    else:
+        os.lseek(fd, offset, os.SEEK_SET)
+        while len(data) > 0:
+            data = data[os.write(fd, data):]
+
+
+def __fsync_dir__(path):
+    import os
+
+    try:
+        fd = os.open(path, os.O_RDONLY)
+    except OSError:
+        return
+    try:
+        os.fsync(fd)
+    except OSError:
+        pass
+    finally:
+        os.close(fd)
+
+
+class MetadataWriteLock(object):
+    """an exclusive advisory lock on a FLAC file
+    held while its metadata journal is written or replayed
+
+    on platforms without fcntl, this does nothing"""
+
+    def __init__(self, filename):
+        self.filename = filename
+        self.__fd__ = None
+
+    def __enter__(self):
+        import os
+
+        try:
+            import fcntl
+        except ImportError:
+            return self
+
+        self.__fd__ = os.open(self.filename, os.O_RDONLY)
+        try:
+            fcntl.flock(self.__fd__, fcntl.LOCK_EX)
+        except (IOError, OSError):
+            # locking unsupported by the filesystem
+            pass
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        import os
+
+        if self.__fd__ is not None:
+            # closing the descriptor releases the lock
+            os.close(self.__fd__)
+            self.__fd__ = None
+
+
+def write_metadata_journaled(filename, offset, data):
+    """overwrites the given data string at the given byte offset
+    of the given FLAC file, syncing it to disk before returning
+
+    the data is first committed to a journal file alongside
+    the original so that if writing is interrupted,
+    the next call to replay_metadata_journal() completes it
+
+    callers should hold the file's MetadataWriteLock
+
+    if the journal cannot be created, the data is written directly
+
+    raises IOError or OSError if unable to write the file"""
+
+    import os
+    from zlib import crc32
+    from audiotools import detach_image_references
+    from audiotools.bitstream import build
+
+    detach_image_references(filename)
+
+    journal_path = metadata_journal_path(filename)
+    entry = build("8b 64U 32u", False,
+                  (b"fLaCjrnl", offset, len(data))) + data
+    entry += build("32u", False, (crc32(entry) & 0xFFFFFFFF,))
+
+    try:
+        journal = os.open(journal_path,
+                          os.O_WRONLY | os.O_CREAT | os.O_TRUNC, 0o600)
+    except OSError:
+        journal = None
+
+    if journal is not None:
+        try:
+            __pwrite__(journal, entry, 0)
+            os.fsync(journal)
+        finally:
+            os.close(journal)
+        __fsync_dir__(os.path.dirname(journal_path) or os.curdir)
+
+    fd = os.open(filename, os.O_WRONLY)
+    try:
+        __pwrite__(fd, data, offset)
+        os.fsync(fd)
+    finally:
+        os.close(fd)
+
+    if journal is not None:
+        os.unlink(journal_path)
+
+
+def replay_metadata_journal(filename):
+    """if the given FLAC file has a metadata update journal
+    left behind by an interrupted write_metadata_journaled() call,
+    writes its data to the file and removes the journal
+
+    returns True if the journal was replayed,
+    False if there's no journal or it was incomplete
+    (in which case the file itself was never modified)
+
+    callers should hold the file's MetadataWriteLock
+
+    raises IOError or OSError if unable to write the file"""
+
+    import os
+    from zlib import crc32
+    from audiotools.bitstream import parse
+
+    journal_path = metadata_journal_path(filename)
+    if not os.path.isfile(journal_path):
+        return False
+
+    with open(journal_path, "rb") as journal:
+        entry = journal.read()
+
+    replayed = False
+    if len(entry) >= 24:
+        (magic, offset, length) = parse("8b 64U 32u", False, entry[0:20])
+        if ((magic == b"fLaCjrnl") and
+            (len(entry) == (24 + length)) and
+            (parse("32u", False, entry[-4:])[0] ==
+             (crc32(entry[0:-4]) & 0xFFFFFFFF))):
+            fd = os.open(filename, os.O_WRONLY)
+            try:
+                __pwrite__(fd, entry[20:-4], offset)
+                os.fsync(fd)
+            finally:
+                os.close(fd)
+            replayed = True
+
+    os.unlink(journal_path)
+    return replayed
+
+
 def sizes_to_offsets(sizes):
     """takes list of (frame_size, frame_frames) tuples
     and converts it to a list of (cumulative_size, frame_frames)
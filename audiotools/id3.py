@@ -263,6 +263,21 @@ def __number_pair__(current, total):
             return __padded__(current) + u"/" + __padded__(total)
 
 
+def read_id3v2_data(reader):
+    """given a BitstreamReader positioned at the start of an ID3v2 tag,
+    returns the complete tag as bytes, including its header
+
+    may raise ValueError if the tag's header is invalid"""
+
+    from audiotools.bitstream import parse
+
+    header = reader.read_bytes(10)
+    if header[0:3] != b'ID3':
+        raise ValueError("invalid ID3 header")
+    (tag_size,) = parse("48p 32u", False, header[0:10])
+    return header + reader.read_bytes(decode_syncsafe32(tag_size))
+
+
 def read_id3v2_comment(filename):
     """given a filename, returns an ID3v22Comment or a subclass
 
@@ -273,21 +288,13 @@ def read_id3v2_comment(filename):
     from audiotools.bitstream import BitstreamReader
 
     with BitstreamReader(open(filename, "rb"), False) as reader:
-        start = reader.getpos()
-        (tag, version_major, version_minor) = reader.parse("3b 8u 8u")
-        if tag != b'ID3':
-            raise ValueError("invalid ID3 header")
-        elif version_major == 0x2:
-            reader.setpos(start)
-            return ID3v22Comment.parse(reader)
-        elif version_major == 0x3:
-            reader.setpos(start)
-            return ID3v23Comment.parse(reader)
-        elif version_major == 0x4:
-            reader.setpos(start)
-            return ID3v24Comment.parse(reader)
-        else:
-            raise ValueError("unsupported ID3 version")
+        data = read_id3v2_data(reader)
+
+    for comment_class in [ID3v22Comment, ID3v23Comment, ID3v24Comment]:
+        if ord(data[3:4]) == comment_class.MAJOR_VERSION:
+            return comment_class.parse_data(data)
+    else:
+        raise ValueError("unsupported ID3 version")
 
 
 def skip_id3v2_comment(file):
@@ -1177,13 +1184,54 @@ class ID3v22Comment(MetaData):
     COMMENT_FRAME = ID3v22_COM_Frame
     IMAGE_FRAME = ID3v22_PIC_Frame
     IMAGE_FRAME_ID = b'PIC'
+    USER_TEXT_FRAME_ID = b'TXX'
+    USER_WEB_FRAME_ID = b'WXX'
+    COMMENT_FRAME_ID = b'COM'
+
+    MAJOR_VERSION = 2
+    FRAME_HEADER_SIZE = 6
 
     def __init__(self, frames, total_size=None):
         MetaData.__setattr__(self, "frames", frames[:])
         MetaData.__setattr__(self, "total_size", total_size)
 
+    @classmethod
+    def __from_frame_table__(cls, frame_table, total_size):
+        """given a list of (frame_id, frame_data) tuples
+        returns a comment whose frames are only parsed when needed"""
+
+        comment = cls.__new__(cls)
+        MetaData.__setattr__(comment,
+                             "__frame_table__",
+                             [[frame_id, frame_data, None]
+                              for (frame_id, frame_data) in frame_table])
+        MetaData.__setattr__(comment, "total_size", total_size)
+        return comment
+
+    def __frame_table_pending__(self):
+        """returns True if our frames have not been parsed yet"""
+
+        return "frames" not in self.__dict__
+
+    def __table_frame__(self, entry):
+        """given a [frame_id, frame_data, frame] frame table entry,
+        returns its parsed frame object"""
+
+        if entry[2] is None:
+            from audiotools.bitstream import BitstreamReader
+
+            entry[2] = self.parse_frame(entry[0],
+                                        len(entry[1]),
+                                        BitstreamReader(entry[1], False))
+        return entry[2]
+
     def copy(self):
-        return self.__class__([frame.copy() for frame in self])
+        if self.__frame_table_pending__():
+            return self.__from_frame_table__(
+                [(frame_id, frame_data) for (frame_id, frame_data, frame)
+                 in self.__frame_table__], None)
+        else:
+            return self.__class__([frame.copy() for frame in self])
 
     def __repr__(self):
         return "ID3v22Comment({!r}, {!r})".format(self.frames,
@@ -1204,62 +1252,81 @@ class ID3v22Comment(MetaData):
     def parse(cls, reader):
         """given a BitstreamReader, returns a parsed ID3v22Comment"""
 
-        (id3,
-         major_version,
+        return cls.parse_data(read_id3v2_data(reader))
+
+    @classmethod
+    def parse_data(cls, data):
+        """given a complete ID3v2 tag as bytes, including its header,
+        returns a parsed comment
+
+        frames are split from the tag immediately
+        but each frame is only parsed the first time it's needed"""
+
+        from audiotools._tags import parse_id3v2
+
+        (major_version,
          minor_version,
-         flags) = reader.parse("3b 8u 8u 8u")
-        if id3 != b'ID3':
-            raise ValueError("invalid ID3 header")
-        elif major_version != 0x02:
+         flags,
+         total_size,
+         frame_table) = parse_id3v2(data)
+        if major_version != cls.MAJOR_VERSION:
             raise ValueError("invalid major version")
         elif minor_version != 0x00:
             raise ValueError("invalid minor version")
-        total_size = remaining_size = decode_syncsafe32(reader.read(32))
 
-        frames = []
+        return cls.__from_frame_table__(frame_table, total_size)
 
-        while remaining_size > 6:
-            (frame_id, frame_size) = reader.parse("3b 24u")
+    @classmethod
+    def parse_frame(cls, frame_id, frame_size, reader):
+        """given a frame ID, its size and a BitstreamReader
+        of the frame's data, returns a parsed frame object"""
+
+        if frame_id == cls.USER_TEXT_FRAME_ID:
+            return cls.USER_TEXT_FRAME.parse(frame_id, frame_size, reader)
+        elif frame_id == cls.USER_WEB_FRAME_ID:
+            return cls.USER_WEB_FRAME.parse(frame_id, frame_size, reader)
+        elif frame_id == cls.COMMENT_FRAME_ID:
+            return cls.COMMENT_FRAME.parse(frame_id, frame_size, reader)
+        elif frame_id == cls.IMAGE_FRAME_ID:
+            return cls.IMAGE_FRAME.parse(frame_id, frame_size, reader)
+        elif frame_id.startswith(b'T'):
+            return cls.TEXT_FRAME.parse(frame_id, frame_size, reader)
+        elif frame_id.startswith(b'W'):
+            return cls.WEB_FRAME.parse(frame_id, frame_size, reader)
+        else:
+            return cls.RAW_FRAME.parse(frame_id, frame_size, reader)
 
-            if frame_id == b"\x00" * 3:
-                break
-            elif frame_id == b'TXX':
-                frames.append(
-                    cls.USER_TEXT_FRAME.parse(
-                        frame_id, frame_size, reader.substream(frame_size)))
-            elif frame_id == b'WXX':
-                frames.append(
-                    cls.USER_WEB_FRAME.parse(
-                        frame_id, frame_size, reader.substream(frame_size)))
-            elif frame_id == b'COM':
-                frames.append(
-                    cls.COMMENT_FRAME.parse(
-                        frame_id, frame_size, reader.substream(frame_size)))
-            elif frame_id == b'PIC':
-                frames.append(
-                    cls.IMAGE_FRAME.parse(
-                        frame_id, frame_size, reader.substream(frame_size)))
-            elif frame_id.startswith(b'T'):
-                frames.append(
-                    cls.TEXT_FRAME.parse(
-                        frame_id, frame_size, reader.substream(frame_size)))
-            elif frame_id.startswith(b'W'):
-                frames.append(
-                    cls.WEB_FRAME.parse(
-                        frame_id, frame_size, reader.substream(frame_size)))
-            else:
-                frames.append(
-                    cls.RAW_FRAME.parse(
-                        frame_id, frame_size, reader.substream(frame_size)))
+    def build_frame_table(self, writer):
+        """writes our unparsed frames back to the given BitstreamWriter
+        as a complete tag"""
 
-            remaining_size -= (6 + frame_size)
+        from audiotools._tags import build_id3v2
+        from audiotools.bitstream import BitstreamRecorder
 
-        return cls(frames, total_size)
+        def frame_data(entry):
+            # frames handed out by __getitem__ may have been modified
+            # so rebuild them rather than reusing their original data
+            if entry[2] is None:
+                return entry[1]
+            else:
+                recorder = BitstreamRecorder(False)
+                entry[2].build(recorder)
+                return recorder.data()
+
+        writer.write_bytes(
+            build_id3v2(self.MAJOR_VERSION,
+                        [(entry[0], frame_data(entry))
+                         for entry in self.__frame_table__],
+                        (self.total_size if self.total_size is not None
+                         else 0)))
 
     def build(self, writer):
         """writes the complete ID3v22Comment data
         to the given BitstreamWriter"""
 
+        if self.__frame_table_pending__():
+            return self.build_frame_table(writer)
+
         tags_size = sum([6 + frame.size() for frame in self])
 
         writer.build("3b 8u 8u 8u 32u",
@@ -1280,17 +1347,36 @@ class ID3v22Comment(MetaData):
             writer.write_bytes(u"\x00" * (self.total_size - tags_size))
 
     def size(self):
-        """returns the total size of the ID3v22Comment, including its header"""
+        """returns the total size of the comment, including its header"""
+
+        if self.__frame_table_pending__():
+            frames_size = sum([self.FRAME_HEADER_SIZE +
+                               (len(frame_data) if frame is None
+                                else frame.size())
+                               for (frame_id, frame_data, frame)
+                               in self.__frame_table__])
+        else:
+            frames_size = sum([self.FRAME_HEADER_SIZE + frame.size()
+                               for frame in self])
 
-        return 10 + max(sum([6 + frame.size() for frame in self]),
+        return 10 + max(frames_size,
                         (self.total_size if self.total_size is not None
                          else 0))
 
     def __len__(self):
-        return len(self.frames)
+        if self.__frame_table_pending__():
+            return len(self.__frame_table__)
+        else:
+            return len(self.frames)
 
     def __getitem__(self, frame_id):
-        frames = [frame for frame in self if (frame.id == frame_id)]
+        if self.__frame_table_pending__():
+            # only parse the frames being requested
+            frames = [self.__table_frame__(entry)
+                      for entry in self.__frame_table__
+                      if (entry[0] == frame_id)]
+        else:
+            frames = [frame for frame in self if (frame.id == frame_id)]
         if len(frames) > 0:
             return frames
         else:
@@ -1326,7 +1412,10 @@ class ID3v22Comment(MetaData):
             raise KeyError(frame_id)
 
     def keys(self):
-        return list({frame.id for frame in self})
+        if self.__frame_table_pending__():
+            return list({entry[0] for entry in self.__frame_table__})
+        else:
+            return list({frame.id for frame in self})
 
     def values(self):
         return [self[key] for key in self.keys()]
@@ -1350,6 +1439,12 @@ class ID3v22Comment(MetaData):
                 return None
         elif attr in self.FIELDS:
             return None
+        elif attr == "frames":
+            # parse any unparsed frames on first access
+            frames = [self.__table_frame__(entry)
+                      for entry in self.__frame_table__]
+            MetaData.__setattr__(self, "frames", frames)
+            return frames
         else:
             return MetaData.__getattribute__(self, attr)
 
@@ -1848,71 +1943,24 @@ class ID3v23Comment(ID3v22Comment):
     COMMENT_FRAME = ID3v23_COMM_Frame
     IMAGE_FRAME = ID3v23_APIC_Frame
     IMAGE_FRAME_ID = b'APIC'
+    USER_TEXT_FRAME_ID = b'TXXX'
+    USER_WEB_FRAME_ID = b'WXXX'
+    COMMENT_FRAME_ID = b'COMM'
     ITUNES_COMPILATION_ID = b'TCMP'
 
+    MAJOR_VERSION = 3
+    FRAME_HEADER_SIZE = 10
+
     def __repr__(self):
         return "ID3v23Comment({!r}, {!r})".format(self.frames, self.total_size)
 
-    @classmethod
-    def parse(cls, reader):
-        """given a BitstreamReader, returns a parsed ID3v23Comment"""
-
-        (id3,
-         major_version,
-         minor_version,
-         flags) = reader.parse("3b 8u 8u 8u")
-        if id3 != b'ID3':
-            raise ValueError("invalid ID3 header")
-        elif major_version != 0x03:
-            raise ValueError("invalid major version")
-        elif minor_version != 0x00:
-            raise ValueError("invalid minor version")
-        total_size = remaining_size = decode_syncsafe32(reader.read(32))
-
-        frames = []
-
-        while remaining_size > 10:
-            (frame_id, frame_size, frame_flags) = reader.parse("4b 32u 16u")
-
-            if frame_id == b"\x00" * 4:
-                break
-            elif frame_id == b'TXXX':
-                frames.append(
-                    cls.USER_TEXT_FRAME.parse(
-                        frame_id, frame_size, reader.substream(frame_size)))
-            elif frame_id == b'WXXX':
-                frames.append(
-                    cls.USER_WEB_FRAME.parse(
-                        frame_id, frame_size, reader.substream(frame_size)))
-            elif frame_id == b'COMM':
-                frames.append(
-                    cls.COMMENT_FRAME.parse(
-                        frame_id, frame_size, reader.substream(frame_size)))
-            elif frame_id == b'APIC':
-                frames.append(
-                    cls.IMAGE_FRAME.parse(
-                        frame_id, frame_size, reader.substream(frame_size)))
-            elif frame_id.startswith(b'T'):
-                frames.append(
-                    cls.TEXT_FRAME.parse(
-                        frame_id, frame_size, reader.substream(frame_size)))
-            elif frame_id.startswith(b'W'):
-                frames.append(
-                    cls.WEB_FRAME.parse(
-                        frame_id, frame_size, reader.substream(frame_size)))
-            else:
-                frames.append(
-                    cls.RAW_FRAME.parse(
-                        frame_id, frame_size, reader.substream(frame_size)))
-
-            remaining_size -= (10 + frame_size)
-
-        return cls(frames, total_size)
-
     def build(self, writer):
         """writes the complete ID3v23Comment data
         to the given BitstreamWriter"""
 
+        if self.__frame_table_pending__():
+            return self.build_frame_table(writer)
+
         tags_size = sum([10 + frame.size() for frame in self])
 
         writer.build("3b 8u 8u 8u 32u",
@@ -1932,12 +1980,6 @@ class ID3v23Comment(ID3v22Comment):
              ((self.total_size - tags_size) > 0))):
             writer.write_bytes(b"\x00" * (self.total_size - tags_size))
 
-    def size(self):
-        """returns the total size of the ID3v23Comment, including its header"""
-
-        return 10 + max(sum([10 + frame.size() for frame in self]),
-                        (self.total_size if self.total_size is not None
-                         else 0))
 
 
 ############################################################
@@ -2274,71 +2316,18 @@ class ID3v24Comment(ID3v23Comment):
     IMAGE_FRAME_ID = b'APIC'
     ITUNES_COMPILATION_ID = b'TCMP'
 
+    MAJOR_VERSION = 4
+
     def __repr__(self):
         return "ID3v24Comment({!r}, {!r})".format(self.frames, self.total_size)
 
-    @classmethod
-    def parse(cls, reader):
-        """given a BitstreamReader, returns a parsed ID3v24Comment"""
-
-        (id3,
-         major_version,
-         minor_version,
-         flags) = reader.parse("3b 8u 8u 8u")
-        if id3 != b'ID3':
-            raise ValueError("invalid ID3 header")
-        elif major_version != 0x04:
-            raise ValueError("invalid major version")
-        elif minor_version != 0x00:
-            raise ValueError("invalid minor version")
-        total_size = remaining_size = decode_syncsafe32(reader.read(32))
-
-        frames = []
-
-        while remaining_size > 10:
-            frame_id = reader.read_bytes(4)
-            frame_size = decode_syncsafe32(reader.read(32))
-            flags = reader.read(16)
-
-            if frame_id == b"\x00" * 4:
-                break
-            elif frame_id == b'TXXX':
-                frames.append(
-                    cls.USER_TEXT_FRAME.parse(
-                        frame_id, frame_size, reader.substream(frame_size)))
-            elif frame_id == b'WXXX':
-                frames.append(
-                    cls.USER_WEB_FRAME.parse(
-                        frame_id, frame_size, reader.substream(frame_size)))
-            elif frame_id == b'COMM':
-                frames.append(
-                    cls.COMMENT_FRAME.parse(
-                        frame_id, frame_size, reader.substream(frame_size)))
-            elif frame_id == b'APIC':
-                frames.append(
-                    cls.IMAGE_FRAME.parse(
-                        frame_id, frame_size, reader.substream(frame_size)))
-            elif frame_id.startswith(b'T'):
-                frames.append(
-                    cls.TEXT_FRAME.parse(
-                        frame_id, frame_size, reader.substream(frame_size)))
-            elif frame_id.startswith(b'W'):
-                frames.append(
-                    cls.WEB_FRAME.parse(
-                        frame_id, frame_size, reader.substream(frame_size)))
-            else:
-                frames.append(
-                    cls.RAW_FRAME.parse(
-                        frame_id, frame_size, reader.substream(frame_size)))
-
-            remaining_size -= (10 + frame_size)
-
-        return cls(frames, total_size)
-
     def build(self, writer):
         """writes the complete ID3v24Comment data
         to the given BitstreamWriter"""
 
+        if self.__frame_table_pending__():
+            return self.build_frame_table(writer)
+
         tags_size = sum([10 + frame.size() for frame in self])
 
         writer.build("3b 8u 8u 8u 32u",
@@ -2360,13 +2349,6 @@ class ID3v24Comment(ID3v23Comment):
              ((self.total_size - tags_size) > 0))):
             writer.write_bytes(b"\x00" * (self.total_size - tags_size))
 
-    def size(self):
-        """returns the total size of the ID3v24Comment, including its header"""
-
-        return 10 + max(sum([10 + frame.size() for frame in self]),
-                        (self.total_size if self.total_size is not None
-                         else 0))
-
 
 ID3v2Comment = ID3v22Comment
 
@@ -165,24 +165,19 @@ class ID3v1Comment(MetaData):
 
         raises ValueError if the comment is invalid"""
 
-        from audiotools.bitstream import parse
+        from audiotools._tags import parse_id3v1
 
         def decode_string(s):
             return s.rstrip(b"\x00").decode("ascii", "replace")
 
         mp3_file.seek(-128, 2)
-        (tag,
-         track_name,
+        (track_name,
          artist_name,
          album_name,
          year,
          comment,
          track_number,
-         genre) = parse("3b 30b 30b 30b 4b 28b 8p 8u 8u",
-                        False,
-                        mp3_file.read(128))
-        if tag != b'TAG':
-            raise ValueError(u"invalid ID3v1 tag")
+         genre) = parse_id3v1(mp3_file.read(128))
 
         return ID3v1Comment(track_name=decode_string(track_name),
                             artist_name=decode_string(artist_name),
@@ -195,26 +190,16 @@ class ID3v1Comment(MetaData):
     def build(self, mp3_file):
         """given an MP3 file positioned at the file's end, generate a tag"""
 
-        from audiotools.bitstream import build
-
-        def encode_string(u, max_chars):
-            s = u.encode("ascii", "replace")
-            if len(s) >= max_chars:
-                return s[0:max_chars]
-            else:
-                return s + b"\x00" * (max_chars - len(s))
+        from audiotools._tags import build_id3v1
 
         mp3_file.write(
-            build("3b 30b 30b 30b 4b 28b 8p 8u 8u",
-                  False,
-                  (b"TAG",
-                   encode_string(self.__track_name__, 30),
-                   encode_string(self.__artist_name__, 30),
-                   encode_string(self.__album_name__, 30),
-                   encode_string(self.__year__, 4),
-                   encode_string(self.__comment__, 28),
-                   self.__track_number__,
-                   self.__genre__)))
+            build_id3v1(self.__track_name__.encode("ascii", "replace"),
+                        self.__artist_name__.encode("ascii", "replace"),
+                        self.__album_name__.encode("ascii", "replace"),
+                        self.__year__.encode("ascii", "replace"),
+                        self.__comment__.encode("ascii", "replace"),
+                        self.__track_number__,
+                        self.__genre__))
 
     @classmethod
     def supports_images(cls):
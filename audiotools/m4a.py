@@ -120,15 +120,16 @@ class M4ATaggedAudio(object):
         raises IOError if unable to read the file"""
 
         from audiotools.bitstream import BitstreamReader
+        from audiotools._m4a import parse_file
 
-        with BitstreamReader(open(self.filename, 'rb'), False) as reader:
-            try:
-                (meta_size,
-                 meta_reader) = get_m4a_atom(reader, b"moov", b"udta", b"meta")
-            except KeyError:
-                return None
+        try:
+            meta = parse_file(self.filename).find(b"moov", b"udta", b"meta")
+        except KeyError:
+            return None
 
-            return M4A_META_Atom.parse(b"meta", meta_size, meta_reader,
+        meta_data = meta.data()
+        with BitstreamReader(meta_data, False) as meta_reader:
+            return M4A_META_Atom.parse(b"meta", len(meta_data), meta_reader,
                                        {b"hdlr": M4A_HDLR_Atom,
                                         b"ilst": M4A_Tree_Atom,
                                         b"free": M4A_FREE_Atom,
@@ -163,8 +164,8 @@ class M4ATaggedAudio(object):
         """
 
         from audiotools.bitstream import BitstreamWriter
-        from audiotools.bitstream import BitstreamReader
-        import os.path
+        from audiotools.bitstream import BitstreamRecorder
+        from audiotools._m4a import parse_file
 
         if metadata is None:
             return
@@ -190,10 +191,9 @@ class M4ATaggedAudio(object):
                               (metadata.size() -
                                metadata[b"free"].size())))
 
+            meta = parse_file(self.filename).find(b"moov", b"udta", b"meta")
             f = open(self.filename, 'r+b')
-            (meta_size, meta_offset) = get_m4a_atom_offset(
-                BitstreamReader(f, False), b"moov", b"udta", b"meta")
-            f.seek(meta_offset + 8, 0)
+            f.seek(meta.offset + 8, 0)
             with BitstreamWriter(f, False) as writer:
                 metadata.build(writer)
             # writer will close "f" when finished
@@ -209,54 +209,31 @@ class M4ATaggedAudio(object):
 
             # if neither fix is possible, the whole file must be rewritten
             # which also requires adjusting the "stco" atom offsets
-            with open(self.filename, "rb") as f:
-                m4a_tree = M4A_Tree_Atom.parse(
-                    None,
-                    os.path.getsize(self.filename),
-                    BitstreamReader(f, False),
-                    {b"moov": M4A_Tree_Atom,
-                     b"trak": M4A_Tree_Atom,
-                     b"mdia": M4A_Tree_Atom,
-                     b"minf": M4A_Tree_Atom,
-                     b"stbl": M4A_Tree_Atom,
-                     b"stco": M4A_STCO_Atom,
-                     b"udta": M4A_Tree_Atom})
-
-            # find initial mdat offset
-            initial_mdat_offset = m4a_tree.child_offset(b"mdat")
+            # of every track, which the atom tree does as it's built
+            m4a_tree = parse_file(self.filename)
 
             # adjust moov -> udta -> meta atom
             # (generating sub-atoms as necessary)
-            if not m4a_tree.has_child(b"moov"):
+            try:
+                moov = m4a_tree.find(b"moov")
+            except KeyError:
                 return
-            else:
-                moov = m4a_tree[b"moov"]
-            if not moov.has_child(b"udta"):
-                moov.add_child(M4A_Tree_Atom(b"udta", []))
-            udta = moov[b"udta"]
-            if not udta.has_child(b"meta"):
-                udta.add_child(metadata)
-            else:
-                udta.replace_child(metadata)
-
-            # find new mdat offset
-            new_mdat_offset = m4a_tree.child_offset(b"mdat")
+            try:
+                udta = moov.find(b"udta")
+            except KeyError:
+                udta = moov.add_child(b"udta")
 
-            # adjust moov -> trak -> mdia -> minf -> stbl -> stco offsets
-            # based on the difference between the new mdat position and the old
+            meta_data = BitstreamRecorder(False)
+            metadata.build(meta_data)
             try:
-                delta_offset = new_mdat_offset - initial_mdat_offset
-                stco = m4a_tree[b"moov"][b"trak"][b"mdia"][b"minf"][b"stbl"][b"stco"]
-                stco.offsets = [offset + delta_offset for offset in
-                                stco.offsets]
+                udta.find(b"meta").set_data(meta_data.data())
             except KeyError:
-                # if there is no stco atom, don't worry about it
-                pass
+                udta.add_child(b"meta", meta_data.data())
 
             # then write entire tree back to disk
-            with BitstreamWriter(TemporaryFile(self.filename),
-                                 False) as writer:
-                m4a_tree.build(writer)
+            output = TemporaryFile(self.filename)
+            m4a_tree.build(output)
+            output.close()
 
     def set_metadata(self, metadata):
         """takes a MetaData object and sets this track's metadata
@@ -317,16 +294,14 @@ class M4AAudio_faac(M4ATaggedAudio, AudioFile):
         """filename is a plain string"""
 
         from audiotools.bitstream import BitstreamReader
+        from audiotools._m4a import parse_file
 
         AudioFile.__init__(self, filename)
 
         # first, fetch the mdia atom
         # which is the parent of both the mp4a and mdhd atoms
         try:
-            with BitstreamReader(open(filename, "rb"), False) as reader:
-                mdia = get_m4a_atom(reader,
-                                    b"moov", b"trak", b"mdia")[1]
-                mdia_start = mdia.getpos()
+            mdia = parse_file(filename).find(b"moov", b"trak", b"mdia")
         except IOError:
             from audiotools.text import ERR_M4A_IOERROR
             raise InvalidM4A(ERR_M4A_IOERROR)
@@ -335,8 +310,9 @@ class M4AAudio_faac(M4ATaggedAudio, AudioFile):
             raise InvalidM4A(ERR_M4A_MISSING_MDIA)
 
         try:
-            stsd = get_m4a_atom(mdia, b"minf", b"stbl", b"stsd")[1]
-        except KeyError:
+            stsd = BitstreamReader(
+                mdia.find(b"minf", b"stbl", b"stsd").data(), False)
+        except (KeyError, IOError):
             from audiotools.text import ERR_M4A_MISSING_STSD
             raise InvalidM4A(ERR_M4A_MISSING_STSD)
 
@@ -352,10 +328,9 @@ class M4AAudio_faac(M4ATaggedAudio, AudioFile):
             raise InvalidM4A(ERR_M4A_INVALID_MP4A)
 
         # finally, fetch the mdhd atom for total track length
-        mdia.setpos(mdia_start)
         try:
-            mdhd = get_m4a_atom(mdia, b"mdhd")[1]
-        except KeyError:
+            mdhd = BitstreamReader(mdia.find(b"mdhd").data(), False)
+        except (KeyError, IOError):
             from audiotools.text import ERR_M4A_MISSING_MDHD
             raise InvalidM4A(ERR_M4A_MISSING_MDHD)
         try:
@@ -726,16 +701,14 @@ class ALACAudio(M4ATaggedAudio, AudioFile):
         """filename is a plain string"""
 
         from audiotools.bitstream import BitstreamReader
+        from audiotools._m4a import parse_file
 
         AudioFile.__init__(self, filename)
 
         # first, fetch the mdia atom
         # which is the parent of both the alac and mdhd atoms
         try:
-            with BitstreamReader(open(filename, "rb"), False) as reader:
-                mdia = get_m4a_atom(reader,
-                                    b"moov", b"trak", b"mdia")[1]
-                mdia_start = mdia.getpos()
+            mdia = parse_file(filename).find(b"moov", b"trak", b"mdia")
         except IOError:
             from audiotools.text import ERR_ALAC_IOERROR
             raise InvalidALAC(ERR_ALAC_IOERROR)
@@ -744,8 +717,9 @@ class ALACAudio(M4ATaggedAudio, AudioFile):
             raise InvalidALAC(ERR_M4A_MISSING_MDIA)
 
         try:
-            stsd = get_m4a_atom(mdia, b"minf", b"stbl", b"stsd")[1]
-        except KeyError:
+            stsd = BitstreamReader(
+                mdia.find(b"minf", b"stbl", b"stsd").data(), False)
+        except (KeyError, IOError):
             from audiotools.text import ERR_M4A_MISSING_STSD
             raise InvalidALAC(ERR_M4A_MISSING_STSD)
 
@@ -777,10 +751,9 @@ class ALACAudio(M4ATaggedAudio, AudioFile):
             raise InvalidALAC(ERR_ALAC_INVALID_ALAC)
 
         # finally, fetch the mdhd atom for total track length
-        mdia.setpos(mdia_start)
         try:
-            mdhd = get_m4a_atom(mdia, b"mdhd")[1]
-        except KeyError:
+            mdhd = BitstreamReader(mdia.find(b"mdhd").data(), False)
+        except (KeyError, IOError):
             from audiotools.text import ERR_M4A_MISSING_MDHD
             raise InvalidALAC(ERR_M4A_MISSING_MDHD)
         try:
@@ -842,34 +815,16 @@ class ALACAudio(M4ATaggedAudio, AudioFile):
     def seekable(self):
         """returns True if the file is seekable"""
 
-        from audiotools.bitstream import BitstreamReader
+        from audiotools._m4a import parse_file
 
-        with BitstreamReader(open(self.filename, "rb"), False) as reader:
-            stream_start = reader.getpos()
-            has_stts = has_m4a_atom(reader,
-                                    b"moov",
-                                    b"trak",
-                                    b"mdia",
-                                    b"minf",
-                                    b"stbl",
-                                    b"stts")
-            reader.setpos(stream_start)
-            has_stsc = has_m4a_atom(reader,
-                                    b"moov",
-                                    b"trak",
-                                    b"mdia",
-                                    b"minf",
-                                    b"stbl",
-                                    b"stsc")
-            reader.setpos(stream_start)
-            has_stco = has_m4a_atom(reader,
-                                    b"moov",
-                                    b"trak",
-                                    b"mdia",
-                                    b"minf",
-                                    b"stbl",
-                                    b"stco")
-            return has_stts and has_stsc and has_stco
+        try:
+            stbl = parse_file(self.filename).find(
+                b"moov", b"trak", b"mdia", b"minf", b"stbl")
+            for atom in [b"stts", b"stsc", b"stco"]:
+                stbl.find(atom)
+            return True
+        except (KeyError, IOError):
+            return False
 
     @classmethod
     def supports_to_pcm(cls):
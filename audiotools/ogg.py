@@ -163,3 +163,149 @@ def packets_to_pages(packets, bitstream_serial_number,
             page.append(segment)
 
     yield page
+
+
+def packets_to_page_count(packets, page_count, bitstream_serial_number,
+                          starting_sequence_number=0):
+    """given a list of packet data strings and a page count,
+    returns a list of exactly page_count Page objects holding those packets
+
+    packet_continuation is filled in as needed
+    stream_beginning and stream_end are False
+    granule_position is 0
+    sequence_number increments starting from "starting_sequence_number"
+
+    raises ValueError if the packets' segments
+    can't be distributed over that many pages"""
+
+    from audiotools._ogg import Page
+
+    segments = [s for p in packets for s in packet_to_segments(p)]
+
+    if ((page_count > len(segments)) or
+        (page_count * 255 < len(segments))):
+        raise ValueError("packets do not fit in page count")
+
+    pages = []
+    continuation = False
+    for sequence_number in range(starting_sequence_number,
+                                 starting_sequence_number + page_count):
+        # fill pages as full as possible while leaving
+        # at least one segment for each remaining page
+        remaining_pages = (starting_sequence_number + page_count -
+                           sequence_number)
+        page_segments = min(255, len(segments) - (remaining_pages - 1))
+        pages.append(Page(packet_continuation=continuation,
+                          stream_beginning=False,
+                          stream_end=False,
+                          granule_position=0,
+                          bitstream_serial_number=bitstream_serial_number,
+                          sequence_number=sequence_number,
+                          segments=segments[0:page_segments]))
+        continuation = (len(segments[page_segments - 1]) == 255)
+        segments = segments[page_segments:]
+
+    return pages
+
+
+# the amount of padding to add to a stream's comment packet
+# whenever its header must be rewritten completely
+# so that subsequent updates can be performed in place
+HEADER_PADDING_SIZE = 4096
+
+# the maximum amount of padding to leave in a comment packet
+# when rewriting it in place
+MAX_PADDING_SIZE = 2 ** 20
+
+
+def rewrite_header_packets(filename, packets, padded_packet=0):
+    """given a filename of an Ogg stream whose first page
+    holds only the identification packet,
+    and a list of packet data strings to replace the header packets
+    which immediately follow it,
+    attempts to overwrite those header pages in place
+    by appending NULL padding bytes to packets[padded_packet]
+    such that the new pages occupy exactly as many bytes
+    and as many pages as the old ones
+
+    the rewritten pages keep their old sequence numbers
+    and have their checksums recalculated
+
+    returns True if the file has been updated in place,
+    False if the packets don't fit and the file is unchanged
+
+    raises IOError or ValueError if a problem occurs reading the file"""
+
+    with PageReader(open(filename, "rb")) as reader:
+        # the identification page must hold exactly one complete packet
+        page = reader.read()
+        lengths = [len(s) for s in page]
+        if ((page.sequence_number != 0) or
+            (len([l for l in lengths if l < 255]) != 1) or
+            (lengths[-1] == 255)):
+            return False
+        header_offset = page.size()
+        serial_number = page.bitstream_serial_number
+
+        # the header packets must end on a page boundary
+        # which they're required to for Vorbis and Opus streams
+        header_size = 0
+        header_pages = 0
+        packets_remaining = len(packets)
+        while packets_remaining > 0:
+            page = reader.read()
+            if page.bitstream_serial_number != serial_number:
+                return False
+            header_pages += 1
+            header_size += page.size()
+            for (i, segment) in enumerate(page):
+                if len(segment) < 255:
+                    packets_remaining -= 1
+                    if packets_remaining == 0:
+                        if i != (len(page) - 1):
+                            return False
+                        break
+
+    # find a padded packet size whose segments and data
+    # exactly fill the old header's bytes
+    def total_size(packet_length):
+        return packet_length + packet_length // 255 + 1
+
+    fixed_size = (27 * header_pages +
+                  sum(total_size(len(p)) for (i, p) in enumerate(packets)
+                      if i != padded_packet))
+    padded_size = header_size - fixed_size
+    padded_length = None
+    estimate = ((padded_size - 1) * 255) // 256
+    for length in range(estimate - 2, estimate + 3):
+        if ((length >= len(packets[padded_packet])) and
+            (total_size(length) == padded_size)):
+            padded_length = length
+            break
+    if ((padded_length is None) or
+        ((padded_length - len(packets[padded_packet])) > MAX_PADDING_SIZE)):
+        return False
+
+    packets = list(packets)
+    packets[padded_packet] += \
+        b"\x00" * (padded_length - len(packets[padded_packet]))
+
+    try:
+        pages = packets_to_page_count(packets,
+                                      header_pages,
+                                      serial_number,
+                                      starting_sequence_number=1)
+    except ValueError:
+        return False
+
+    assert(sum(p.size() for p in pages) == header_size)
+
+    # overwrite the old header pages with the new ones
+    f = open(filename, "r+b")
+    f.seek(header_offset, 0)
+    with PageWriter(f) as writer:
+        for page in pages:
+            writer.write(page)
+        writer.flush()
+
+    return True
@@ -72,7 +72,7 @@ class OpusAudio(VorbisAudio):
                 (opushead,
                  version,
                  self.__channels__,
-                 pre_skip,
+                 self.__pre_skip__,
                  input_sample_rate,
                  output_gain,
                  mapping_family) = ogg_reader.parse(
@@ -152,7 +152,9 @@ class OpusAudio(VorbisAudio):
                     page = reader.read()
                     pcm_samples = max(pcm_samples, page.granule_position)
 
-                return pcm_samples
+                # the final granule position includes the pre-skip
+                # which is trimmed from the start of the decoded stream
+                return max(pcm_samples - self.__pre_skip__, 0)
         except (IOError, ValueError):
             return 0
 
@@ -201,18 +203,32 @@ class OpusAudio(VorbisAudio):
         except ImportError:
             return False
 
+    @classmethod
+    def from_pcm_format(cls, sample_rate, channels, channel_mask,
+                        bits_per_sample):
+        """Opus always encodes 16-bit streams at 48kHz"""
+
+        return (48000, channels, channel_mask, 16)
+
     @classmethod
     def from_pcm(cls, filename, pcmreader,
-                 compression=None, total_pcm_frames=None):
+                 compression=None, total_pcm_frames=None, threads=1):
         """encodes a new file from PCM data
 
         takes a filename string, PCMReader object,
-        optional compression level string and
-        optional total_pcm_frames integer
+        optional compression level string,
+        optional total_pcm_frames integer and
+        optional threads integer
         encodes a new audio file from pcmreader's data
         at the given filename with the specified compression level
         and returns a new AudioFile-compatible object
 
+        if threads is greater than 1, the stream is encoded
+        in independent chunks by that many threads at once
+        (this is a library-only option;
+         convert(), from_pcm_many() and track2track
+         always encode each stream on a single thread)
+
         may raise EncodingError if some problem occurs when
         encoding the input file.  This includes an error
         in the input stream, a problem writing the output file,
@@ -254,14 +270,27 @@ class OpusAudio(VorbisAudio):
                 from audiotools import CounterPCMReader
                 pcmreader = CounterPCMReader(pcmreader)
 
+            if pcmreader.sample_rate != 48000:
+                # a fixed-ratio filter bank is much faster than
+                # the general-purpose Resampler PCMConverter uses
+                # for common rates such as 44100
+                from audiotools.pcmconverter import PolyphaseResampler
+                try:
+                    resampled = PolyphaseResampler(pcmreader, 48000)
+                except ValueError:
+                    resampled = pcmreader
+            else:
+                resampled = pcmreader
+
             encode_opus(filename,
-                        PCMConverter(pcmreader,
+                        PCMConverter(resampled,
                                      sample_rate=48000,
                                      channels=pcmreader.channels,
                                      channel_mask=pcmreader.channel_mask,
                                      bits_per_sample=16),
                         quality=int(compression),
-                        original_sample_rate=pcmreader.sample_rate)
+                        original_sample_rate=pcmreader.sample_rate,
+                        threads=threads)
 
             pcmreader.close()
 
@@ -291,7 +320,9 @@ class OpusAudio(VorbisAudio):
                                     PacketReader,
                                     PageWriter,
                                     packet_to_pages,
-                                    packets_to_pages)
+                                    packets_to_pages,
+                                    rewrite_header_packets,
+                                    HEADER_PADDING_SIZE)
         from audiotools.bitstream import BitstreamRecorder
 
         if metadata is None:
@@ -302,6 +333,24 @@ class OpusAudio(VorbisAudio):
         elif not os.access(self.filename, os.W_OK):
             raise IOError(self.filename)
 
+        # generate new comment packet
+        comment_writer = BitstreamRecorder(True)
+        comment_writer.write_bytes(b"OpusTags")
+        vendor_string = metadata.vendor_string.encode('utf-8')
+        comment_writer.build("32u {:d}b".format(len(vendor_string)),
+                             (len(vendor_string), vendor_string))
+        comment_writer.write(32, len(metadata.comment_strings))
+        for comment_string in metadata.comment_strings:
+            comment_string = comment_string.encode('utf-8')
+            comment_writer.build("32u {:d}b".format(len(comment_string)),
+                                 (len(comment_string), comment_string))
+
+        # if the new comment packet fits in the old header pages
+        # (with any excess taken up by padding after the comments)
+        # overwrite those pages and leave the rest of the file as-is
+        if rewrite_header_packets(self.filename, [comment_writer.data()]):
+            return
+
         original_ogg = PacketReader(PageReader(open(self.filename, "rb")))
         new_ogg = PageWriter(TemporaryFile(self.filename))
 
@@ -320,20 +369,10 @@ class OpusAudio(VorbisAudio):
         # discard the current file's comment packet
         comment_packet = original_ogg.read_packet()
 
-        # generate new comment packet
-        comment_writer = BitstreamRecorder(True)
-        comment_writer.write_bytes(b"OpusTags")
-        vendor_string = metadata.vendor_string.encode('utf-8')
-        comment_writer.build("32u {:d}b".format(len(vendor_string)),
-                             (len(vendor_string), vendor_string))
-        comment_writer.write(32, len(metadata.comment_strings))
-        for comment_string in metadata.comment_strings:
-            comment_string = comment_string.encode('utf-8')
-            comment_writer.build("32u {:d}b".format(len(comment_string)),
-                                 (len(comment_string), comment_string))
-
+        # write a padded comment packet
+        # so that future updates may be performed in place
         for page in packet_to_pages(
-                comment_writer.data(),
+                comment_writer.data() + b"\x00" * HEADER_PADDING_SIZE,
                 self.__serial_number__,
                 starting_sequence_number=sequence_number):
             new_ogg.write(page)
@@ -0,0 +1,347 @@
+# Audio Tools, a module and set of tools for manipulating audio data
+# Copyright (C) 2007-2016  Brian Langenberger
+
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+"""a persistent on-disk cache of audio file stream properties
+
+entries are keyed by a file's device, inode, size and modification time
+so that any change to a file invalidates its entry automatically"""
+
+import os
+
+# the number of bytes of the cache file to memory-map for lookups
+CACHE_MMAP_SIZE = 256 * 1024 * 1024
+
+# the class name stored for files which aren't a supported audio type
+UNSUPPORTED = u""
+
+# the sort key value used when album or track number is unknown
+NO_NUMBER = -(2 ** 31)
+
+
+class PropertiesCache(object):
+    """a stream properties index stored in an SQLite database
+
+    the database is opened in write-ahead log mode
+    so any number of processes may read it while one updates it"""
+
+    def __init__(self, path):
+        """path is the cache file's filename as a plain string
+
+        may raise IOError if the cache cannot be opened"""
+
+        import sqlite3
+
+        try:
+            self.__db__ = sqlite3.connect(path, timeout=5)
+            self.__db__.execute("PRAGMA journal_mode=WAL")
+            self.__db__.execute("PRAGMA synchronous=NORMAL")
+            self.__db__.execute(
+                "PRAGMA mmap_size={:d}".format(CACHE_MMAP_SIZE))
+            self.__db__.execute(
+                "CREATE TABLE IF NOT EXISTS properties ("
+                "device INTEGER NOT NULL, "
+                "inode INTEGER NOT NULL, "
+                "size INTEGER NOT NULL, "
+                "mtime INTEGER NOT NULL, "
+                "class_name TEXT NOT NULL, "
+                "sample_rate INTEGER, "
+                "channels INTEGER, "
+                "channel_mask INTEGER, "
+                "bits_per_sample INTEGER, "
+                "total_frames INTEGER, "
+                "album_number INTEGER, "
+                "track_number INTEGER, "
+                "track_gain REAL, "
+                "track_peak REAL, "
+                "album_gain REAL, "
+                "album_peak REAL, "
+                "PRIMARY KEY (device, inode))")
+            self.__db__.commit()
+        except sqlite3.Error as err:
+            raise IOError(str(err))
+
+        self.__pending__ = []
+
+    def close(self):
+        """writes any pending entries and closes the cache"""
+
+        self.flush()
+        self.__db__.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        self.close()
+
+    def flush(self):
+        """writes entries added since the last flush in a single transaction
+
+        if the cache is locked by another writer, the entries are dropped
+        since they will simply be regenerated next time"""
+
+        import sqlite3
+
+        if len(self.__pending__) == 0:
+            return
+
+        try:
+            with self.__db__:
+                self.__db__.executemany(
+                    "INSERT OR REPLACE INTO properties VALUES "
+                    "(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)",
+                    self.__pending__)
+        except sqlite3.Error:
+            pass
+        self.__pending__ = []
+
+    def lookup(self, stat):
+        """given an os.stat result, returns a cached row tuple
+        of (class_name, sample_rate, channels, channel_mask,
+            bits_per_sample, total_frames, album_number, track_number,
+            track_gain, track_peak, album_gain, album_peak)
+        or None if the file has no entry or its entry is stale"""
+
+        import sqlite3
+
+        try:
+            return self.__db__.execute(
+                "SELECT class_name, sample_rate, channels, channel_mask, "
+                "bits_per_sample, total_frames, album_number, track_number, "
+                "track_gain, track_peak, album_gain, album_peak "
+                "FROM properties WHERE device = ? AND inode = ? "
+                "AND size = ? AND mtime = ?",
+                __stat_key__(stat)).fetchone()
+        except sqlite3.Error:
+            return None
+
+    def add(self, stat, audiofile):
+        """given an os.stat result and an opened AudioFile object
+        or None for unsupported files, queues an entry for the file
+
+        may raise IOError or InvalidFile if the file's
+        metadata or ReplayGain cannot be read"""
+
+        if audiofile is None:
+            self.__pending__.append(
+                __stat_key__(stat) + (UNSUPPORTED,) + (None,) * 11)
+            return
+
+        metadata = audiofile.get_metadata()
+        replay_gain = audiofile.get_replay_gain()
+
+        self.__pending__.append(
+            __stat_key__(stat) +
+            (audiofile.NAME,
+             audiofile.sample_rate(),
+             audiofile.channels(),
+             int(audiofile.channel_mask()),
+             audiofile.bits_per_sample(),
+             audiofile.total_frames(),
+             (metadata.album_number if
+              ((metadata is not None) and
+               (metadata.album_number is not None)) else NO_NUMBER),
+             (metadata.track_number if
+              ((metadata is not None) and
+               (metadata.track_number is not None)) else NO_NUMBER)) +
+            ((replay_gain.track_gain,
+              replay_gain.track_peak,
+              replay_gain.album_gain,
+              replay_gain.album_peak) if replay_gain is not None else
+             (None,) * 4))
+
+    def open(self, filename):
+        """given a plain filename string, returns an AudioFile-compatible
+        object or None if the file isn't a supported audio type
+
+        files with a current cache entry are returned as CachedAudioFile
+        objects which don't touch the file until necessary,
+        otherwise the file is opened normally and its entry updated
+
+        may raise IOError or InvalidFile if the file cannot be opened"""
+
+        from audiotools import (TYPE_MAP, file_type, InvalidFile)
+
+        stat = os.stat(filename)
+        row = self.lookup(stat)
+        if row is not None:
+            if row[0] == UNSUPPORTED:
+                return None
+            elif row[0] in TYPE_MAP:
+                return CachedAudioFile(TYPE_MAP[row[0]], filename, row)
+
+        with open(filename, "rb") as f:
+            audio_class = file_type(f)
+
+        if audio_class is None:
+            self.add(stat, None)
+            return None
+
+        audiofile = audio_class(filename)
+        try:
+            self.add(stat, audiofile)
+        except (IOError, ValueError, InvalidFile):
+            # leave the file uncached and let
+            # the caller encounter any error itself
+            pass
+        return audiofile
+
+
+def __stat_key__(stat):
+    return (stat.st_dev,
+            stat.st_ino,
+            stat.st_size,
+            (stat.st_mtime_ns if hasattr(stat, "st_mtime_ns") else
+             int(stat.st_mtime * 1000000000)))
+
+
+class CachedAudioFile(object):
+    """an AudioFile proxy whose stream properties come from the cache
+
+    the actual AudioFile is opened the first time
+    any method not answerable from the cache is called,
+    and isinstance() checks treat this object as its audio class"""
+
+    def __init__(self, audio_class, filename, row):
+        self.__audio_class__ = audio_class
+        self.__audiofile__ = None
+        self.filename = filename
+        (self.__class_name__,
+         self.__sample_rate__,
+         self.__channels__,
+         self.__channel_mask__,
+         self.__bits_per_sample__,
+         self.__total_frames__,
+         self.__album_number__,
+         self.__track_number__,
+         track_gain,
+         track_peak,
+         album_gain,
+         album_peak) = row
+        if track_gain is not None:
+            from audiotools import ReplayGain
+
+            self.__replay_gain__ = ReplayGain(track_gain,
+                                              track_peak,
+                                              album_gain,
+                                              album_peak)
+        else:
+            self.__replay_gain__ = None
+
+    @property
+    def __class__(self):
+        return self.__audio_class__
+
+    def __reduce__(self):
+        return (self.__audio_class__, (self.filename,))
+
+    def __repr__(self):
+        return "CachedAudioFile({!r}, {!r})".format(
+            self.__audio_class__.__name__, self.filename)
+
+    def __getattr__(self, attr):
+        if attr.startswith("__") and attr.endswith("__"):
+            raise AttributeError(attr)
+
+        # class attributes such as NAME and SUFFIX
+        # along with classmethods such as supports_metadata()
+        # come from the audio class without opening the file
+        for cls in self.__audio_class__.__mro__:
+            if attr in cls.__dict__:
+                value = cls.__dict__[attr]
+                if (isinstance(value, (classmethod, staticmethod)) or
+                    not hasattr(value, "__get__")):
+                    return getattr(self.__audio_class__, attr)
+                break
+
+        if self.__audiofile__ is None:
+            self.__audiofile__ = self.__audio_class__(self.filename)
+        return getattr(self.__audiofile__, attr)
+
+    def sample_rate(self):
+        """returns the rate of the track's audio as an integer number of Hz"""
+
+        return self.__sample_rate__
+
+    def channels(self):
+        """returns an integer number of channels this track contains"""
+
+        return self.__channels__
+
+    def channel_mask(self):
+        """returns a ChannelMask object of this track's channel layout"""
+
+        from audiotools import ChannelMask
+
+        return ChannelMask(self.__channel_mask__)
+
+    def bits_per_sample(self):
+        """returns an integer number of bits-per-sample this track contains"""
+
+        return self.__bits_per_sample__
+
+    def total_frames(self):
+        """returns the total PCM frames of the track as an integer"""
+
+        return self.__total_frames__
+
+    def lossless(self):
+        """returns True if this track's data is stored losslessly"""
+
+        # every format answers this from its class alone
+        return self.__audio_class__.lossless(self)
+
+    def cd_frames(self):
+        """returns the total length of the track in CD frames
+
+        each CD frame is 1/75th of a second"""
+
+        return self.__audio_class__.cd_frames(self)
+
+    def seconds_length(self):
+        """returns the length of the track as a Fraction number of seconds"""
+
+        return self.__audio_class__.seconds_length(self)
+
+    def get_replay_gain(self):
+        """returns a ReplayGain object of our ReplayGain values
+
+        returns None if we have no values"""
+
+        return self.__replay_gain__
+
+    def __sort_key__(self):
+        return (self.__album_number__,
+                self.__track_number__,
+                self.filename)
+
+    def __eq__(self, audiofile):
+        from audiotools import AudioFile
+
+        if isinstance(audiofile, AudioFile):
+            return (self.__sort_key__() == audiofile.__sort_key__())
+        else:
+            return False
+
+    def __ne__(self, audiofile):
+        return not self.__eq__(audiofile)
+
+    def __lt__(self, audiofile):
+        return self.__sort_key__() < audiofile.__sort_key__()
+
+    def __gt__(self, audiofile):
+        return self.__sort_key__() > audiofile.__sort_key__()
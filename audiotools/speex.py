@@ -138,7 +138,9 @@ class SpeexAudio(AudioFile):
                                     PacketReader,
                                     PageWriter,
                                     packet_to_pages,
-                                    packets_to_pages)
+                                    packets_to_pages,
+                                    rewrite_header_packets,
+                                    HEADER_PADDING_SIZE)
         from audiotools.vorbiscomment import VorbisComment
         from audiotools.bitstream import BitstreamRecorder
 
@@ -150,6 +152,23 @@ class SpeexAudio(AudioFile):
         elif not os.access(self.filename, os.W_OK):
             raise IOError(self.filename)
 
+        # generate new comment packet
+        comment_writer = BitstreamRecorder(True)
+        vendor_string = metadata.vendor_string.encode("utf-8")
+        comment_writer.build("32u {:d}b".format(len(vendor_string)),
+                             (len(vendor_string), vendor_string))
+        comment_writer.write(32, len(metadata.comment_strings))
+        for comment_string in metadata.comment_strings:
+            comment_string = comment_string.encode("utf-8")
+            comment_writer.build("32u {:d}b".format(len(comment_string)),
+                                 (len(comment_string), comment_string))
+
+        # if the new comment packet fits in the old header pages
+        # (with any excess taken up by padding after the comments)
+        # overwrite those pages and leave the rest of the file as-is
+        if rewrite_header_packets(self.filename, [comment_writer.data()]):
+            return
+
         original_ogg = PacketReader(PageReader(open(self.filename, "rb")))
         new_ogg = PageWriter(TemporaryFile(self.filename))
 
@@ -168,19 +187,10 @@ class SpeexAudio(AudioFile):
         # discard current file's comment packet
         comment_packet = original_ogg.read_packet()
 
-        # generate new comment packet
-        comment_writer = BitstreamRecorder(True)
-        vendor_string = metadata.vendor_string.encode("utf-8")
-        comment_writer.build("32u {:d}b".format(len(vendor_string)),
-                             (len(vendor_string), vendor_string))
-        comment_writer.write(32, len(metadata.comment_strings))
-        for comment_string in metadata.comment_strings:
-            comment_string = comment_string.encode("utf-8")
-            comment_writer.build("32u {:d}b".format(len(comment_string)),
-                                 (len(comment_string), comment_string))
-
+        # write a padded comment packet
+        # so that future updates may be performed in place
         for page in packets_to_pages(
-            [comment_writer.data()],
+            [comment_writer.data() + b"\x00" * HEADER_PADDING_SIZE],
             self.__serial_number__,
             starting_sequence_number=sequence_number):
             new_ogg.write(page)
@@ -98,6 +98,8 @@ OPT_TYPE = u"the type of audio track to create"
 OPT_TYPE_AT_CONFIG = u"the default audio type to use, " + \
     u"or the type for a given default quality level"
 OPT_TYPE_TRACKVERIFY = u"a type of audio to accept"
+OPT_ADDITIONAL_TYPE = u"an additional type of audio track to create " + \
+    u"from the same decode, which may be given more than once"
 OPT_QUALITY = u"the quality to store audio tracks at"
 OPT_QUALITY_AT_CONFIG = u"the default quality level for a given audio type"
 OPT_DIR = u"the directory to store new audio tracks"
@@ -517,6 +519,7 @@ ERR_INVALID_SAMPLE_RATE = u"invalid sample rate"
 ERR_INVALID_CHANNEL_COUNT = u"invalid channel count"
 ERR_INVALID_BITS_PER_SAMPLE = u"invalid bits-per-sample"
 ERR_TOTAL_PCM_FRAMES_MISMATCH = u"total_pcm_frames mismatch"
+ERR_BAD_FRAME = u"{error} in frame at PCM offset {offset:d}"
 ERR_AMBIGUOUS_AUDIO_TYPE = u"ambiguous suffix type \"{}\""
 ERR_CHANNEL_COUNT_MASK_MISMATCH = u"channel count and channel mask mismatch"
 ERR_NO_PCMREADERS = u"you must have at least 1 PCMReader"
@@ -582,6 +585,7 @@ ERR_IMAGE_INVALID_TIFF = u"invalid TIFF"
 ERR_IMAGE_IOERROR_TIFF = u"I/O error reading TIFF data"
 ERR_IMAGE_INVALID_GIF = u"invalid GIF"
 ERR_IMAGE_IOERROR_GIF = u"I/O error reading GIF data"
+ERR_IMAGE_FILE_MODIFIED = u"image's file has been modified"
 ERR_M4A_IOERROR = u"I/O error opening M4A file"
 ERR_M4A_MISSING_MDIA = u"required mdia atom not found"
 ERR_M4A_MISSING_STSD = u"required stsd atom not found"
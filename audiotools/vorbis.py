@@ -215,15 +215,20 @@ class VorbisAudio(AudioFile):
 
     @classmethod
     def from_pcm(cls, filename, pcmreader,
-                 compression=None, total_pcm_frames=None):
+                 compression=None, total_pcm_frames=None, threads=1):
         """encodes a new file from PCM data
 
         takes a filename string, PCMReader object,
-        optional compression level string and
-        optional total_pcm_frames integer
+        optional compression level string,
+        optional total_pcm_frames integer and
+        optional threads integer
         encodes a new audio file from pcmreader's data
         at the given filename with the specified compression level
-        and returns a new VorbisAudio object"""
+        and returns a new VorbisAudio object
+
+        if threads is greater than 1, overlapping segments
+        of the stream are encoded by that many threads at once
+        and spliced together"""
 
         from audiotools import (BufferedPCMReader,
                                 __default_quality__,
@@ -260,7 +265,8 @@ class VorbisAudio(AudioFile):
 
             encode_vorbis(filename,
                           pcmreader,
-                          float(compression) / 10)
+                          float(compression) / 10,
+                          threads=threads)
 
             if ((total_pcm_frames is not None) and
                 (total_pcm_frames != pcmreader.frames_written)):
@@ -289,7 +295,9 @@ class VorbisAudio(AudioFile):
                                     PacketReader,
                                     PageWriter,
                                     packet_to_pages,
-                                    packets_to_pages)
+                                    packets_to_pages,
+                                    rewrite_header_packets,
+                                    HEADER_PADDING_SIZE)
         from audiotools.vorbiscomment import VorbisComment
         from audiotools.bitstream import BitstreamRecorder
 
@@ -301,6 +309,33 @@ class VorbisAudio(AudioFile):
         elif not os.access(self.filename, os.W_OK):
             raise IOError(self.filename)
 
+        # generate new comment packet
+        comment_writer = BitstreamRecorder(True)
+        comment_writer.build("8u 6b", (3, b"vorbis"))
+        vendor_string = metadata.vendor_string.encode('utf-8')
+        comment_writer.build("32u {:d}b".format(len(vendor_string)),
+                             (len(vendor_string), vendor_string))
+        comment_writer.write(32, len(metadata.comment_strings))
+        for comment_string in metadata.comment_strings:
+            comment_string = comment_string.encode('utf-8')
+            comment_writer.build("32u {:d}b".format(len(comment_string)),
+                                 (len(comment_string), comment_string))
+
+        comment_writer.build("1u a", (1,))  # framing bit
+
+        # get codebooks packet from original file
+        with PacketReader(PageReader(open(self.filename, "rb"))) as reader:
+            identification_packet = reader.read_packet()
+            comment_packet = reader.read_packet()
+            codebooks_packet = reader.read_packet()
+
+        # if the new comment packet fits in the old header pages
+        # (with any excess taken up by padding after the framing bit)
+        # overwrite those pages and leave the rest of the file as-is
+        if rewrite_header_packets(self.filename,
+                                  [comment_writer.data(), codebooks_packet]):
+            return
+
         original_ogg = PacketReader(PageReader(open(self.filename, "rb")))
         new_ogg = PageWriter(TemporaryFile(self.filename))
 
@@ -319,25 +354,14 @@ class VorbisAudio(AudioFile):
         # discard the current file's comment packet
         comment_packet = original_ogg.read_packet()
 
-        # generate new comment packet
-        comment_writer = BitstreamRecorder(True)
-        comment_writer.build("8u 6b", (3, b"vorbis"))
-        vendor_string = metadata.vendor_string.encode('utf-8')
-        comment_writer.build("32u {:d}b".format(len(vendor_string)),
-                             (len(vendor_string), vendor_string))
-        comment_writer.write(32, len(metadata.comment_strings))
-        for comment_string in metadata.comment_strings:
-            comment_string = comment_string.encode('utf-8')
-            comment_writer.build("32u {:d}b".format(len(comment_string)),
-                                 (len(comment_string), comment_string))
-
-        comment_writer.build("1u a", (1,))  # framing bit
-
         # transfer codebooks packet from original file to new file
+        # along with a padded comment packet
+        # so that future updates may be performed in place
         codebooks_packet = original_ogg.read_packet()
 
         for page in packets_to_pages(
-                [comment_writer.data(), codebooks_packet],
+                [comment_writer.data() + b"\x00" * HEADER_PADDING_SIZE,
+                 codebooks_packet],
                 self.__serial_number__,
                 starting_sequence_number=sequence_number):
             new_ogg.write(page)
@@ -423,159 +423,9 @@ def wave_header(sample_rate,
         raise ValueError("total size too large for wave file")
 
 
-class WaveReader(object):
-    """a PCMReader object for reading wave file contents"""
-
-    def __init__(self, wave_filename):
-        """wave_filename is a string"""
-
-        from audiotools.bitstream import BitstreamReader
-
-        self.stream = BitstreamReader(open(wave_filename, "rb"), True)
-
-        # ensure RIFF<size>WAVE header is ok
-        try:
-            (riff,
-             total_size,
-             wave) = self.stream.parse("4b 32u 4b")
-        except struct.error:
-            from audiotools.text import ERR_WAV_INVALID_WAVE
-            self.stream.close()
-            raise ValueError(ERR_WAV_INVALID_WAVE)
-
-        if riff != b'RIFF':
-            from audiotools.text import ERR_WAV_NOT_WAVE
-            self.stream.close()
-            raise ValueError(ERR_WAV_NOT_WAVE)
-        elif wave != b'WAVE':
-            from audiotools.text import ERR_WAV_INVALID_WAVE
-            self.stream.close()
-            raise ValueError(ERR_WAV_INVALID_WAVE)
-        else:
-            total_size -= 4
-            fmt_chunk_read = False
-
-        # walk through chunks until "data" chunk encountered
-        while total_size > 0:
-            try:
-                (chunk_id,
-                 chunk_size) = self.stream.parse("4b 32u")
-            except struct.error:
-                from audiotools.text import ERR_WAV_INVALID_WAVE
-                self.stream.close()
-                raise ValueError(ERR_WAV_INVALID_WAVE)
-            if not frozenset(chunk_id).issubset(WaveAudio.PRINTABLE_ASCII):
-                from audiotools.text import ERR_WAV_INVALID_CHUNK
-                self.stream.close()
-                raise ValueError(ERR_WAV_INVALID_CHUNK)
-            else:
-                total_size -= 8
-
-            if chunk_id == b"fmt ":
-                # when "fmt " chunk encountered,
-                # use it to populate PCMReader attributes
-                (self.channels,
-                 self.sample_rate,
-                 self.bits_per_sample,
-                 channel_mask) = parse_fmt(self.stream)
-                self.channel_mask = int(channel_mask)
-                self.bytes_per_pcm_frame = ((self.bits_per_sample // 8) *
-                                            self.channels)
-                fmt_chunk_read = True
-            elif chunk_id == b"data":
-                # when "data" chunk encountered,
-                # use its size to determine total PCM frames
-                # and ready PCMReader for reading
-                if not fmt_chunk_read:
-                    from audiotools.text import ERR_WAV_PREMATURE_DATA
-                    self.stream.close()
-                    raise ValueError(ERR_WAV_PREMATURE_DATA)
-                else:
-                    self.total_pcm_frames = (chunk_size //
-                                             self.bytes_per_pcm_frame)
-                    self.remaining_pcm_frames = self.total_pcm_frames
-                    self.data_start = self.stream.getpos()
-                    return
-            else:
-                # all other chunks are ignored
-                self.stream.skip_bytes(chunk_size)
-
-            if chunk_size % 2:
-                if len(self.stream.read_bytes(1)) < 1:
-                    from audiotools.text import ERR_WAV_INVALID_CHUNK
-                    self.stream.close()
-                    raise ValueError(ERR_WAV_INVALID_CHUNK)
-                total_size -= (chunk_size + 1)
-            else:
-                total_size -= chunk_size
-        else:
-            # raise an error if no "data" chunk is encountered
-            from audiotools.text import ERR_WAV_NO_DATA_CHUNK
-            self.stream.close()
-            raise ValueError(ERR_WAV_NO_DATA_CHUNK)
-
-    def __enter__(self):
-        return self
-
-    def __exit__(self, exc_type, exc_value, traceback):
-        self.close()
-
-    def read(self, pcm_frames):
-        """try to read a pcm.FrameList with the given number of PCM frames"""
-
-        # try to read requested PCM frames or remaining frames
-        requested_pcm_frames = min(max(pcm_frames, 1),
-                                   self.remaining_pcm_frames)
-
-        requested_bytes = (self.bytes_per_pcm_frame *
-                           requested_pcm_frames)
-        pcm_data = self.stream.read_bytes(requested_bytes)
-
-        # raise exception if "data" chunk exhausted early
-        if len(pcm_data) < requested_bytes:
-            from audiotools.text import ERR_WAV_TRUNCATED_DATA_CHUNK
-            raise IOError(ERR_WAV_TRUNCATED_DATA_CHUNK)
-        else:
-            self.remaining_pcm_frames -= requested_pcm_frames
-
-            # return parsed chunk
-            return FrameList(pcm_data,
-                             self.channels,
-                             self.bits_per_sample,
-                             False,
-                             self.bits_per_sample != 8)
-
-    def read_closed(self, pcm_frames):
-        raise ValueError("cannot read closed stream")
-
-    def seek(self, pcm_frame_offset):
-        """tries to seek to the given PCM frame offset
-        returns the total amount of frames actually seeked over"""
-
-        if pcm_frame_offset < 0:
-            from audiotools.text import ERR_NEGATIVE_SEEK
-            raise ValueError(ERR_NEGATIVE_SEEK)
-
-        # ensure one doesn't walk off the end of the file
-        pcm_frame_offset = min(pcm_frame_offset, self.total_pcm_frames)
-
-        # position file in "data" chunk
-        self.stream.setpos(self.data_start)
-        self.stream.seek(pcm_frame_offset * self.bytes_per_pcm_frame, 1)
-        self.remaining_pcm_frames = (self.total_pcm_frames -
-                                     pcm_frame_offset)
-
-        return pcm_frame_offset
-
-    def seek_closed(self, pcm_frame_offset):
-        raise ValueError("cannot seek closed stream")
-
-    def close(self):
-        """closes the stream for reading"""
-
-        self.stream.close()
-        self.read = self.read_closed
-        self.seek = self.seek_closed
+# plain RIFF, RF64 and WAVE_FORMAT_EXTENSIBLE files
+# are all parsed and read by the native decoder
+from audiotools.decoders import WaveDecoder as WaveReader
 
 
 class TempWaveReader(WaveReader):
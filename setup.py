@@ -519,6 +519,9 @@ class audiotools_cdio(Extension):
                             "src/framelist.c",
                             "src/pcm_conv.c"])
 
+            # for CDDAReader's read-ahead thread
+            libraries.add("pthread")
+
             self.__library_manifest__.append(("libcdio",
                                               "CDDA data extraction",
                                               True))
@@ -615,6 +618,7 @@ class audiotools_pcmconverter(Extension):
                                     "src/framelist.c",
                                     "src/pcmreader.c",
                                     "src/pcm_conv.c",
+                                    "src/polyphase.c",
                                     "src/bitstream.c",
                                     "src/buffer.c",
                                     "src/func_io.c",
@@ -671,6 +675,7 @@ class audiotools_decoders(Extension):
                    "src/decoders/alac.c",
                    "src/decoders/tta.c",
                    "src/decoders/mpc.c",
+                   "src/decoders/pcmfile.c",
                    "src/decoders/sine.c",
                    "src/decoders.c"]
         libraries = set()
@@ -793,6 +798,7 @@ class audiotools_encoders(Extension):
                    "src/common/tta_crc.c",
                    "src/encoders/alac.c",
                    "src/common/m4a_atoms.c",
+                   "src/common/encoder_stats.c",
                    "src/encoders/tta.c",
                    "src/encoders.c"]
         libraries = set()
@@ -850,6 +856,10 @@ class audiotools_encoders(Extension):
 
             defines.append(("HAS_VORBIS", None))
             sources.append("src/encoders/vorbis.c")
+
+            # for encoding segments of the stream in parallel
+            libraries.add("pthread")
+
             self.__library_manifest__.append(("vorbisenc",
                                               "Ogg Vorbis encoding",
                                               True))
@@ -868,6 +878,10 @@ class audiotools_encoders(Extension):
                     system_libraries.extra_link_args("opus"))
             defines.append(("HAS_OPUS", None))
             sources.append("src/encoders/opus.c")
+
+            # for encoding chunks of the stream in parallel
+            libraries.add("pthread")
+
             self.__library_manifest__.append(("opus",
                                               "Opus encoding",
                                               True))
@@ -916,7 +930,10 @@ class audiotools_bitstream(Extension):
                                     "src/buffer.c",
                                     "src/func_io.c",
                                     "src/mini-gmp.c",
-                                    "src/huffman.c"],
+                                    "src/huffman.c",
+                                    "src/ogg_crc.c",
+                                    "src/common/flac_crc.c",
+                                    "src/common/tta_crc.c"],
                            define_macros=[("HAS_PYTHON", None)])
 
 
@@ -934,6 +951,22 @@ class audiotools_ogg(Extension):
                            define_macros=[("HAS_PYTHON", None)])
 
 
+class audiotools_tags(Extension):
+    def __init__(self):
+        Extension.__init__(self,
+                           "audiotools._tags",
+                           sources=["src/tags.c",
+                                    "src/mod_tags.c"])
+
+
+class audiotools_m4a(Extension):
+    def __init__(self):
+        Extension.__init__(self,
+                           "audiotools._m4a",
+                           sources=["src/m4a_tree.c",
+                                    "src/mod_m4a.c"])
+
+
 class audiotools_accuraterip(Extension):
     def __init__(self):
         Extension.__init__(self,
@@ -1027,6 +1060,8 @@ ext_modules = [audiotools_pcm(),
                audiotools_encoders(system_libraries),
                audiotools_bitstream(),
                audiotools_ogg(),
+               audiotools_tags(),
+               audiotools_m4a(),
                audiotools_accuraterip(),
                audiotools_output(system_libraries)]
 
@@ -222,6 +222,12 @@ br_add_callback(BitstreamReader* self,
                 void* data);
 
 
+static void
+br_add_span_callback(BitstreamReader* self,
+                     bs_span_callback_f callback,
+                     void* data);
+
+
 static void
 br_push_callback(BitstreamReader* self,
                  struct bs_callback *callback);
@@ -520,6 +526,7 @@ DEF_BW_CLOSE_INTERNAL(bw_close_internal_stream_a, BitstreamAccumulator*)
     static void                      \
     FUNC_NAME(TYPE self);
 DEF_BW_FREE(bw_free_f, BitstreamWriter*)
+DEF_BW_FREE(bw_free_common, BitstreamWriter*)
 DEF_BW_FREE(bw_free_e, BitstreamWriter*)
 DEF_BW_FREE(bw_free_r, BitstreamRecorder*)
 DEF_BW_FREE(bw_free_sr, BitstreamRecorder*)
@@ -580,6 +587,12 @@ bw_add_callback(BitstreamWriter* self,
                 void *data);
 
 
+static void
+bw_add_span_callback(BitstreamWriter* self,
+                     bs_span_callback_f callback,
+                     void *data);
+
+
 static void
 bw_push_callback(BitstreamWriter* self,
                  struct bs_callback *callback);
@@ -892,28 +905,14 @@ bw_buf_free(struct bw_buffer* buf)
 }
 
 static inline int
-bw_buf_putc(int c, struct bw_buffer* buf)
-{
-    if (buf->pos == buf->buffer_size) {
-        if (buf->resizable) {
-            buf->buffer_size += 4096;
-            buf->buffer = realloc(buf->buffer, buf->buffer_size);
-        } else {
-            return EOF;
-        }
-    }
-    buf->buffer[buf->pos++] = (uint8_t)c;
-    buf->max_pos = MAX(buf->max_pos, buf->pos);
-    return c;
-}
-
-static int
 bw_buf_write(struct bw_buffer* buf, const uint8_t *data, unsigned data_size)
 {
     const unsigned available_bytes = buf->buffer_size - buf->pos;
     if (available_bytes < data_size) {
         if (buf->resizable) {
-            buf->buffer_size += (data_size - available_bytes);
+            /*grow geometrically since most writes are only a few bytes*/
+            buf->buffer_size = MAX(buf->pos + data_size,
+                                   MAX(buf->buffer_size * 2, 4096));
             buf->buffer = realloc(buf->buffer, buf->buffer_size);
         } else {
             return 1;
@@ -1003,6 +1002,98 @@ bw_buf_reset(struct bw_buffer* buf) {
 }
 
 
+/*******************************************************************
+ *                       write file-specific                       *
+ *******************************************************************/
+
+static struct bw_file_output*
+bw_file_new(FILE *stream)
+{
+    struct bw_file_output* output = malloc(sizeof(struct bw_file_output));
+    output->stream = stream;
+    output->pending = 0;
+    return output;
+}
+
+/*passes all pending bytes to fwrite() at once
+  returns 0 on success, EOF if a write error occurs*/
+static int
+bw_file_drain(struct bw_file_output* output)
+{
+    const unsigned pending = output->pending;
+
+    output->pending = 0;
+    if (pending &&
+        (fwrite(output->data, sizeof(uint8_t), pending, output->stream) !=
+         pending)) {
+        return EOF;
+    } else {
+        return 0;
+    }
+}
+
+/*appends the given bytes to those pending, draining them when full
+  returns 0 on success, EOF if a write error occurs*/
+static inline int
+bw_file_write(struct bw_file_output* output,
+              const uint8_t *data,
+              unsigned data_size)
+{
+    if (data_size <= (BW_FILE_BUFFER_SIZE - output->pending)) {
+        memcpy(output->data + output->pending, data, data_size);
+        output->pending += data_size;
+        return 0;
+    } else if (bw_file_drain(output)) {
+        return EOF;
+    } else if (data_size < BW_FILE_BUFFER_SIZE) {
+        memcpy(output->data, data, data_size);
+        output->pending = data_size;
+        return 0;
+    } else if (fwrite(data, sizeof(uint8_t), data_size, output->stream) !=
+               data_size) {
+        return EOF;
+    } else {
+        return 0;
+    }
+}
+
+
+/*calls each callback in turn on a contiguous span of bytes*/
+static inline void
+bs_span_callbacks(const struct bs_callback* callback,
+                  const uint8_t *bytes,
+                  unsigned count)
+{
+    for (; callback != NULL; callback = callback->next) {
+        if (callback->span != NULL) {
+            callback->span(bytes, count, callback->data);
+        } else {
+            bs_callback_f callback_func = callback->callback;
+            void* callback_data = callback->data;
+            unsigned i;
+
+            for (i = 0; i < count; i++) {
+                callback_func(bytes[i], callback_data);
+            }
+        }
+    }
+}
+
+
+/*calls each callback in turn on a single byte*/
+static inline void
+bs_byte_callbacks(const struct bs_callback* callback, uint8_t byte)
+{
+    for (; callback != NULL; callback = callback->next) {
+        if (callback->span != NULL) {
+            callback->span(&byte, 1, callback->data);
+        } else {
+            callback->callback(byte, callback->data);
+        }
+    }
+}
+
+
 /*returns a base BitstreamReader with many fields filled in
   and the rest to be filled in by the final implementation*/
 static BitstreamReader*
@@ -1054,6 +1145,7 @@ __base_bitstreamreader__(bs_endianness endianness)
     bs->byte_align = br_byte_align;
 
     bs->add_callback = br_add_callback;
+    bs->add_span_callback = br_add_span_callback;
     bs->push_callback = br_push_callback;
     bs->pop_callback = br_pop_callback;
     bs->call_callbacks = br_call_callbacks;
@@ -1213,6 +1305,7 @@ br_open_queue(bs_endianness endianness)
     bs->byte_align = br_byte_align;
 
     bs->add_callback = br_add_callback;
+    bs->add_span_callback = br_add_span_callback;
     bs->push_callback = br_push_callback;
     bs->pop_callback = br_pop_callback;
     bs->call_callbacks = br_call_callbacks;
@@ -1310,13 +1403,8 @@ br_open_external(void* user_data,
             if (result.state == 0) {                                    \
                 const int byte = BYTE_FUNC(BYTE_FUNC_ARG);              \
                 if (byte != EOF) {                                      \
-                    struct bs_callback* callback;                       \
                     result.state = NEW_STATE(byte);                     \
-                    for (callback = self->callbacks;                    \
-                         callback != NULL;                              \
-                         callback = callback->next)                     \
-                         callback->callback((uint8_t)byte,              \
-                                            callback->data);            \
+                    bs_byte_callbacks(self->callbacks, (uint8_t)byte);  \
                 } else {                                                \
                     br_abort(self);                                     \
                 }                                                       \
@@ -1347,13 +1435,8 @@ br_open_external(void* user_data,
             if (result.state == 0) {                                    \
                 const int byte = BYTE_FUNC(BYTE_FUNC_ARG);              \
                 if (byte != EOF) {                                      \
-                    struct bs_callback* callback;                       \
                     result.state = NEW_STATE(byte);                     \
-                    for (callback = self->callbacks;                    \
-                         callback != NULL;                              \
-                         callback = callback->next)                     \
-                         callback->callback((uint8_t)byte,              \
-                                            callback->data);            \
+                    bs_byte_callbacks(self->callbacks, (uint8_t)byte);  \
                 } else {                                                \
                     br_abort(self);                                     \
                 }                                                       \
@@ -1477,13 +1560,9 @@ br_read_signed_bits64_le(BitstreamReader* self, unsigned int count)
             if (result.state == 0) {                                  \
                 const int byte = BYTE_FUNC(BYTE_FUNC_ARG);            \
                 if (byte != EOF) {                                    \
-                    struct bs_callback* callback;                     \
                     result.state = NEW_STATE(byte);                   \
-                    for (callback = self->callbacks;                  \
-                         callback != NULL;                            \
-                         callback = callback->next)                   \
-                        callback->callback((uint8_t)byte,             \
-                                           callback->data);           \
+                    bs_byte_callbacks(self->callbacks,                \
+                                      (uint8_t)byte);                 \
                 } else {                                              \
                     mpz_clear(result_value);                          \
                     br_abort(self);                                   \
@@ -1530,13 +1609,9 @@ FUNC_READ_BITS_BIGINT_BE(br_read_bits_bigint_e_be, ext_getc,
             if (result.state == 0) {                                  \
                 const int byte = BYTE_FUNC(BYTE_FUNC_ARG);            \
                 if (byte != EOF) {                                    \
-                    struct bs_callback* callback;                     \
                     result.state = NEW_STATE(byte);                   \
-                    for (callback = self->callbacks;                  \
-                         callback != NULL;                            \
-                         callback = callback->next)                   \
-                         callback->callback((uint8_t)byte,            \
-                                            callback->data);          \
+                    bs_byte_callbacks(self->callbacks,                \
+                                      (uint8_t)byte);                 \
                 } else {                                              \
                     mpz_clear(result_value);                          \
                     br_abort(self);                                   \
@@ -1686,13 +1761,9 @@ br_read_signed_bits_bigint_le(BitstreamReader* self,
               if (result.state == 0) {                          \
                   const int byte = BYTE_FUNC(BYTE_FUNC_ARG);    \
                   if (byte != EOF) {                            \
-                      struct bs_callback* callback;             \
                       result.state = NEW_STATE(byte);           \
-                      for (callback = self->callbacks;          \
-                           callback != NULL;                    \
-                           callback = callback->next)           \
-                           callback->callback((uint8_t)byte,    \
-                                              callback->data);  \
+                      bs_byte_callbacks(self->callbacks,        \
+                                        (uint8_t)byte);         \
                   } else {                                      \
                       br_abort(self);                           \
                   }                                             \
@@ -1731,13 +1802,9 @@ FUNC_SKIP_BITS_BE(br_skip_bits_e_be, ext_getc, self->input.external)
               if (result.state == 0) {                         \
                   const int byte = BYTE_FUNC(BYTE_FUNC_ARG);   \
                   if (byte != EOF) {                           \
-                      struct bs_callback* callback;            \
                       result.state = NEW_STATE(byte);          \
-                      for (callback = self->callbacks;         \
-                           callback != NULL;                   \
-                           callback = callback->next)          \
-                           callback->callback((uint8_t)byte,   \
-                                              callback->data); \
+                      bs_byte_callbacks(self->callbacks,       \
+                                        (uint8_t)byte);        \
                   } else {                                     \
                       br_abort(self);                          \
                   }                                            \
@@ -1809,13 +1876,8 @@ br_unread_bit_c(BitstreamReader* self, int unread_bit)
             if (result.state == 0) {                                    \
                 const int byte = BYTE_FUNC(BYTE_FUNC_ARG);              \
                 if (byte != EOF) {                                      \
-                    struct bs_callback* callback;                       \
                     result.state = NEW_STATE(byte);                     \
-                    for (callback = self->callbacks;                    \
-                         callback != NULL;                              \
-                         callback = callback->next)                     \
-                         callback->callback((uint8_t)byte,              \
-                                            callback->data);            \
+                    bs_byte_callbacks(self->callbacks, (uint8_t)byte);  \
                 } else {                                                \
                     br_abort(self);                                     \
                 }                                                       \
@@ -1863,13 +1925,8 @@ br_read_unary_c(BitstreamReader* self, int stop_bit)
             if (result.state == 0) {                                    \
                 const int byte = BYTE_FUNC(BYTE_FUNC_ARG);              \
                 if (byte != EOF) {                                      \
-                    struct bs_callback* callback;                       \
                     result.state = NEW_STATE(byte);                     \
-                    for (callback = self->callbacks;                    \
-                         callback != NULL;                              \
-                         callback = callback->next)                     \
-                         callback->callback((uint8_t)byte,              \
-                                            callback->data);            \
+                    bs_byte_callbacks(self->callbacks, (uint8_t)byte);  \
                 } else {                                                \
                     br_abort(self);                                     \
                 }                                                       \
@@ -2038,14 +2095,9 @@ br_set_endianness_c(BitstreamReader* self, bs_endianness endianness)
         while (entry.continue_) {                                   \
             const int byte = BYTE_FUNC(BYTE_FUNC_ARG);              \
             if (byte != EOF) {                                      \
-                struct bs_callback* callback;                       \
                 const state_t state = NEW_STATE(byte);              \
                                                                     \
-                for (callback = self->callbacks;                    \
-                     callback != NULL;                              \
-                     callback = callback->next)                     \
-                     callback->callback((uint8_t)byte,              \
-                                        callback->data);            \
+                bs_byte_callbacks(self->callbacks, (uint8_t)byte);  \
                                                                     \
                 entry = table[entry.node][state];                   \
             } else {                                                \
@@ -2081,19 +2133,9 @@ br_read_bytes_file(BitstreamReader* self,
         /*fread bytes from file handle to output*/
         if (fread(bytes, sizeof(uint8_t), byte_count, self->input.file) ==
             byte_count) {
-            struct bs_callback* callback;
             /*if sufficient bytes were read
               perform callbacks on the read bytes*/
-            for (callback = self->callbacks;
-                 callback != NULL;
-                 callback = callback->next) {
-                bs_callback_f callback_func = callback->callback;
-                void* callback_data = callback->data;
-                unsigned int i;
-                for (i = 0; i < byte_count; i++) {
-                    callback_func(bytes[i], callback_data);
-                }
-            }
+            bs_span_callbacks(self->callbacks, bytes, byte_count);
         } else {
             br_abort(self);
         }
@@ -2116,19 +2158,9 @@ br_read_bytes_file(BitstreamReader* self,
                                                                       \
           /*buf_read bytes from buffer to output*/                    \
           if (READ_FUNC(READ_ARG, bytes, byte_count) == byte_count) { \
-              struct bs_callback* callback;                           \
               /*if sufficient bytes were read*/                       \
               /*perform callbacks on the read bytes*/                 \
-              for (callback = self->callbacks;                        \
-                   callback != NULL;                                  \
-                   callback = callback->next) {                       \
-                  bs_callback_f callback_func = callback->callback;   \
-                  void* callback_data = callback->data;               \
-                  unsigned int i;                                     \
-                  for (i = 0; i < byte_count; i++) {                  \
-                      callback_func(bytes[i], callback_data);         \
-                  }                                                   \
-              }                                                       \
+              bs_span_callbacks(self->callbacks, bytes, byte_count);  \
           } else {                                                    \
               br_abort(self);                                         \
           }                                                           \
@@ -2753,7 +2785,7 @@ bw_open(FILE *f, bs_endianness endianness)
     bs->endianness = endianness;
     bs->type = BW_FILE;
 
-    bs->output.file = f;
+    bs->output.file = bw_file_new(f);
 
     bs->buffer_size = 0;
     bs->buffer = 0;
@@ -2791,6 +2823,7 @@ bw_open(FILE *f, bs_endianness endianness)
     bs->byte_align = bw_byte_align;
     bs->flush = bw_flush_f;
     bs->add_callback = bw_add_callback;
+    bs->add_span_callback = bw_add_span_callback;
     bs->push_callback = bw_push_callback;
     bs->pop_callback = bw_pop_callback;
     bs->call_callbacks = bw_call_callbacks;
@@ -2868,6 +2901,7 @@ bw_open_external(void* user_data,
     bs->byte_align = bw_byte_align;
     bs->flush = bw_flush_e;
     bs->add_callback = bw_add_callback;
+    bs->add_span_callback = bw_add_span_callback;
     bs->push_callback = bw_push_callback;
     bs->pop_callback = bw_pop_callback;
     bs->call_callbacks = bw_call_callbacks;
@@ -2924,6 +2958,7 @@ bw_open_limited_recorder(bs_endianness endianness, unsigned maximum_size)
     bs->byte_align = bw_byte_align_r;
     bs->flush = bw_flush_noop;
     bs->add_callback = bw_add_callback;
+    bs->add_span_callback = bw_add_span_callback;
     bs->push_callback = bw_push_callback;
     bs->pop_callback = bw_pop_callback;
     bs->call_callbacks = bw_call_callbacks;
@@ -2997,6 +3032,7 @@ bw_open_limited_bytes_recorder(bs_endianness endianness,
     bs->byte_align = bw_byte_align;
     bs->flush = bw_flush_noop;
     bs->add_callback = bw_add_callback;
+    bs->add_span_callback = bw_add_span_callback;
     bs->push_callback = bw_push_callback;
     bs->pop_callback = bw_pop_callback;
     bs->call_callbacks = bw_call_callbacks;
@@ -3047,6 +3083,7 @@ bw_open_accumulator(bs_endianness endianness)
     bs->byte_align = bw_byte_align_a;
     bs->flush = bw_flush_noop;
     bs->add_callback = bw_add_callback;
+    bs->add_span_callback = bw_add_span_callback;
     bs->push_callback = bw_push_callback;
     bs->pop_callback = bw_pop_callback;
     bs->call_callbacks = bw_call_callbacks;
@@ -3099,6 +3136,7 @@ bw_open_limited_accumulator(bs_endianness endianness, unsigned maximum_size)
         bs->byte_align = bw_byte_align_a;
         bs->flush = bw_flush_noop;
         bs->add_callback = bw_add_callback;
+        bs->add_span_callback = bw_add_span_callback;
         bs->push_callback = bw_push_callback;
         bs->pop_callback = bw_pop_callback;
         bs->call_callbacks = bw_call_callbacks;
@@ -3118,114 +3156,125 @@ bw_open_limited_accumulator(bs_endianness endianness, unsigned maximum_size)
 }
 
 
-#define FUNC_WRITE_BITS_BE(FUNC_NAME, VALUE_TYPE, BYTE_FUNC, BYTE_FUNC_ARG) \
+/*bits are gathered in a 64-bit register
+  so that a single write of up to 32 bits
+  completes all of its bytes at once,
+  which are then passed to BYTES_FUNC and the callbacks as one span
+  leaving no more than 7 bits in the buffer between writes*/
+#define FUNC_WRITE_BITS_BE(FUNC_NAME, BYTES_FUNC, BYTES_FUNC_ARG)       \
     static void                                                         \
-    FUNC_NAME(BitstreamWriter* self, unsigned int count, VALUE_TYPE value) \
+    FUNC_NAME(BitstreamWriter* self, unsigned int count, unsigned int value) \
     {                                                                   \
-        register unsigned buffer = self->buffer;                        \
-        register unsigned buffer_size = self->buffer_size;              \
+        register uint64_t buffer;                                       \
+        register unsigned buffer_size;                                  \
+        uint8_t bytes[5];                                               \
+        unsigned byte_count = 0;                                        \
                                                                         \
-        while (count > 0) {                                             \
-            /*chop off up to 8 bits to write at a time*/                \
-            const int bits_to_write = count > 8 ? 8 : count;            \
-            const VALUE_TYPE value_to_write =                           \
-                value >> (count - bits_to_write);                       \
+        if (count > 32) {                                               \
+            /*bits beyond the value's 32 are all 0*/                    \
+            FUNC_NAME(self, count - 32, 0);                             \
+            count = 32;                                                 \
+        }                                                               \
                                                                         \
-            /*new data is added to the buffer least-significant first*/ \
-            buffer = (unsigned int)((buffer << bits_to_write) |         \
-                                    value_to_write);                    \
-            buffer_size += bits_to_write;                               \
+        /*new data is added to the buffer least-significant first*/     \
+        buffer = ((uint64_t)self->buffer << count) |                    \
+                 (value & ((UINT64_C(1) << count) - 1));                \
+        buffer_size = self->buffer_size + count;                        \
                                                                         \
-            /*if buffer is over 8 bits,*/                               \
-            /*extract bits most-significant first*/                     \
-            /*and remove them from the buffer*/                         \
-            if (buffer_size >= 8) {                                     \
-                const unsigned byte =                                   \
-                    (buffer >> (buffer_size - 8)) & 0xFF;               \
-                if (BYTE_FUNC(byte, BYTE_FUNC_ARG) != EOF) {            \
-                    struct bs_callback* callback;                       \
+        /*extract whole bytes most-significant first*/                  \
+        while (buffer_size >= 8) {                                      \
+            buffer_size -= 8;                                           \
+            bytes[byte_count++] = (uint8_t)(buffer >> buffer_size);     \
+        }                                                               \
                                                                         \
-                    for (callback = self->callbacks;                    \
-                         callback != NULL;                              \
-                         callback = callback->next)                     \
-                         callback->callback((uint8_t)byte,              \
-                                            callback->data);            \
+        self->buffer = (unsigned)buffer & ((1u << buffer_size) - 1);    \
+        self->buffer_size = buffer_size;                                \
                                                                         \
-                    buffer_size -= 8;                                   \
-                } else {                                                \
-                    self->buffer = buffer;                              \
-                    self->buffer_size = buffer_size;                    \
-                    bw_abort(self);                                     \
-                }                                                       \
+        if (byte_count) {                                               \
+            if (BYTES_FUNC(BYTES_FUNC_ARG, bytes, byte_count)) {        \
+                bw_abort(self);                                         \
             }                                                           \
-                                                                        \
-            /*decrement the count and value*/                           \
-            value -= (value_to_write << (count - bits_to_write));       \
-            count -= bits_to_write;                                     \
+            bs_span_callbacks(self->callbacks, bytes, byte_count);      \
         }                                                               \
-        self->buffer = buffer;                                          \
-        self->buffer_size = buffer_size;                                \
     }
 
-#define FUNC_WRITE_BITS_LE(FUNC_NAME, VALUE_TYPE, BYTE_FUNC, BYTE_FUNC_ARG) \
+#define FUNC_WRITE_BITS_LE(FUNC_NAME, BYTES_FUNC, BYTES_FUNC_ARG)       \
     static void                                                         \
-    FUNC_NAME(BitstreamWriter* self, unsigned int count, VALUE_TYPE value) \
+    FUNC_NAME(BitstreamWriter* self, unsigned int count, unsigned int value) \
     {                                                                   \
-        register unsigned buffer = self->buffer;                        \
-        register unsigned buffer_size = self->buffer_size;              \
+        register uint64_t buffer;                                       \
+        register unsigned buffer_size;                                  \
+        uint8_t bytes[5];                                               \
+        unsigned byte_count = 0;                                        \
                                                                         \
-        while (count > 0) {                                             \
-            /*chop off up to 8 bits to write at a time*/                \
-            const int bits_to_write = count > 8 ? 8 : count;            \
-            const VALUE_TYPE value_to_write =                           \
-                value & ((1 << bits_to_write) - 1);                     \
+        if (count > 32) {                                               \
+            /*bits beyond the value's 32 are all 0*/                    \
+            FUNC_NAME(self, 32, value);                                 \
+            FUNC_NAME(self, count - 32, 0);                             \
+            return;                                                     \
+        }                                                               \
                                                                         \
-            /*new data is added to the buffer most-significant first*/  \
-            buffer |= (unsigned int)(value_to_write << buffer_size);    \
-            buffer_size += bits_to_write;                               \
+        /*new data is added to the buffer most-significant first*/      \
+        buffer = self->buffer |                                         \
+                 ((uint64_t)(value & ((UINT64_C(1) << count) - 1)) <<   \
+                  self->buffer_size);                                   \
+        buffer_size = self->buffer_size + count;                        \
                                                                         \
-            /*if buffer is over 8 bits,*/                               \
-            /*extract bits least-significant first*/                    \
-            /*and remove them from the buffer*/                         \
-            if (buffer_size >= 8) {                                     \
-                const unsigned byte = buffer & 0xFF;                    \
-                if (BYTE_FUNC(byte, BYTE_FUNC_ARG) != EOF) {            \
-                    struct bs_callback* callback;                       \
+        /*extract whole bytes least-significant first*/                 \
+        while (buffer_size >= 8) {                                      \
+            bytes[byte_count++] = (uint8_t)buffer;                      \
+            buffer >>= 8;                                               \
+            buffer_size -= 8;                                           \
+        }                                                               \
                                                                         \
-                    for (callback = self->callbacks;                    \
-                         callback != NULL;                              \
-                         callback = callback->next)                     \
-                         callback->callback((uint8_t)byte,              \
-                                            callback->data);            \
-                    buffer >>= 8;                                       \
-                    buffer_size -= 8;                                   \
-                } else {                                                \
-                    self->buffer = buffer;                              \
-                    self->buffer_size = buffer_size;                    \
-                    bw_abort(self);                                     \
-                }                                                       \
-            }                                                           \
+        self->buffer = (unsigned)buffer;                                \
+        self->buffer_size = buffer_size;                                \
                                                                         \
-            /*decrement the count and value*/                           \
-            value >>= bits_to_write;                                    \
-            count -= bits_to_write;                                     \
+        if (byte_count) {                                               \
+            if (BYTES_FUNC(BYTES_FUNC_ARG, bytes, byte_count)) {        \
+                bw_abort(self);                                         \
+            }                                                           \
+            bs_span_callbacks(self->callbacks, bytes, byte_count);      \
+        }                                                               \
+    }
+
+/*64-bit values are written as two 32-bit halves*/
+#define FUNC_WRITE_BITS64_BE(FUNC_NAME, WRITE_FUNC)                     \
+    static void                                                         \
+    FUNC_NAME(BitstreamWriter* self, unsigned int count, uint64_t value) \
+    {                                                                   \
+        if (count > 32) {                                               \
+            WRITE_FUNC(self, count - 32, (unsigned)(value >> 32));      \
+            WRITE_FUNC(self, 32, (unsigned)(value & 0xFFFFFFFF));       \
+        } else {                                                        \
+            WRITE_FUNC(self, count, (unsigned)(value & 0xFFFFFFFF));    \
+        }                                                               \
+    }
+
+#define FUNC_WRITE_BITS64_LE(FUNC_NAME, WRITE_FUNC)                     \
+    static void                                                         \
+    FUNC_NAME(BitstreamWriter* self, unsigned int count, uint64_t value) \
+    {                                                                   \
+        if (count > 32) {                                               \
+            WRITE_FUNC(self, 32, (unsigned)(value & 0xFFFFFFFF));       \
+            WRITE_FUNC(self, count - 32, (unsigned)(value >> 32));      \
+        } else {                                                        \
+            WRITE_FUNC(self, count, (unsigned)(value & 0xFFFFFFFF));    \
         }                                                               \
-        self->buffer = buffer;                                          \
-        self->buffer_size = buffer_size;                                \
     }
 
 FUNC_WRITE_BITS_BE(bw_write_bits_f_be,
-                   unsigned int, fputc, self->output.file)
+                   bw_file_write, self->output.file)
 FUNC_WRITE_BITS_LE(bw_write_bits_f_le,
-                   unsigned int, fputc, self->output.file)
+                   bw_file_write, self->output.file)
 FUNC_WRITE_BITS_BE(bw_write_bits_e_be,
-                   unsigned int, ext_putc, self->output.external)
+                   ext_fwrite, self->output.external)
 FUNC_WRITE_BITS_LE(bw_write_bits_e_le,
-                   unsigned int, ext_putc, self->output.external)
+                   ext_fwrite, self->output.external)
 FUNC_WRITE_BITS_BE(bw_write_bits_sr_be,
-                   unsigned int, bw_buf_putc, self->output.string_recorder)
+                   bw_buf_write, self->output.string_recorder)
 FUNC_WRITE_BITS_LE(bw_write_bits_sr_le,
-                   unsigned int, bw_buf_putc, self->output.string_recorder)
+                   bw_buf_write, self->output.string_recorder)
 
 
 static void
@@ -3272,18 +3321,12 @@ bw_write_signed_bits_le(BitstreamWriter* self,
     }
 }
 
-FUNC_WRITE_BITS_BE(bw_write_bits64_f_be,
-                   uint64_t, fputc, self->output.file)
-FUNC_WRITE_BITS_LE(bw_write_bits64_f_le,
-                   uint64_t, fputc, self->output.file)
-FUNC_WRITE_BITS_BE(bw_write_bits64_e_be,
-                   uint64_t, ext_putc, self->output.external)
-FUNC_WRITE_BITS_LE(bw_write_bits64_e_le,
-                   uint64_t, ext_putc, self->output.external)
-FUNC_WRITE_BITS_BE(bw_write_bits64_sr_be,
-                   uint64_t, bw_buf_putc, self->output.string_recorder)
-FUNC_WRITE_BITS_LE(bw_write_bits64_sr_le,
-                   uint64_t, bw_buf_putc, self->output.string_recorder)
+FUNC_WRITE_BITS64_BE(bw_write_bits64_f_be, bw_write_bits_f_be)
+FUNC_WRITE_BITS64_LE(bw_write_bits64_f_le, bw_write_bits_f_le)
+FUNC_WRITE_BITS64_BE(bw_write_bits64_e_be, bw_write_bits_e_be)
+FUNC_WRITE_BITS64_LE(bw_write_bits64_e_le, bw_write_bits_e_le)
+FUNC_WRITE_BITS64_BE(bw_write_bits64_sr_be, bw_write_bits_sr_be)
+FUNC_WRITE_BITS64_LE(bw_write_bits64_sr_le, bw_write_bits_sr_le)
 
 static void
 bw_write_bits64_c(BitstreamWriter* self,
@@ -3331,7 +3374,7 @@ bw_write_signed_bits64_le(BitstreamWriter* self,
 }
 
 
-#define FUNC_WRITE_BITS_BIGINT_BE(FUNC_NAME, BYTE_FUNC, BYTE_FUNC_ARG)  \
+#define FUNC_WRITE_BITS_BIGINT_BE(FUNC_NAME, BYTES_FUNC, BYTES_FUNC_ARG) \
     static void                                                         \
     FUNC_NAME(BitstreamWriter* self, unsigned int count, const mpz_t value) \
     {                                                                   \
@@ -3361,17 +3404,10 @@ bw_write_signed_bits64_le(BitstreamWriter* self,
             /*extract bits most-significant first*/                     \
             /*and remove them from the buffer*/                         \
             if (buffer_size >= 8) {                                     \
-                const unsigned byte =                                   \
-                    (buffer >> (buffer_size - 8)) & 0xFF;               \
-                if (BYTE_FUNC(byte, BYTE_FUNC_ARG) != EOF) {            \
-                    struct bs_callback* callback;                       \
-                                                                        \
-                    for (callback = self->callbacks;                    \
-                         callback != NULL;                              \
-                         callback = callback->next)                     \
-                         callback->callback((uint8_t)byte,              \
-                                            callback->data);            \
-                                                                        \
+                const uint8_t byte =                                    \
+                    (uint8_t)(buffer >> (buffer_size - 8));             \
+                if (!BYTES_FUNC(BYTES_FUNC_ARG, &byte, 1)) {            \
+                    bs_span_callbacks(self->callbacks, &byte, 1);       \
                     buffer_size -= 8;                                   \
                 } else {                                                \
                     self->buffer = buffer;                              \
@@ -3397,14 +3433,14 @@ bw_write_signed_bits64_le(BitstreamWriter* self,
         mpz_clear(temp_value);                                          \
         mpz_clear(value_to_write);                                      \
     }
-FUNC_WRITE_BITS_BIGINT_BE(bw_write_bits_bigint_f_be, fputc,
+FUNC_WRITE_BITS_BIGINT_BE(bw_write_bits_bigint_f_be, bw_file_write,
                           self->output.file)
-FUNC_WRITE_BITS_BIGINT_BE(bw_write_bits_bigint_e_be, ext_putc,
+FUNC_WRITE_BITS_BIGINT_BE(bw_write_bits_bigint_e_be, ext_fwrite,
                           self->output.external)
-FUNC_WRITE_BITS_BIGINT_BE(bw_write_bits_bigint_sr_be, bw_buf_putc,
+FUNC_WRITE_BITS_BIGINT_BE(bw_write_bits_bigint_sr_be, bw_buf_write,
                           self->output.string_recorder)
 
-#define FUNC_WRITE_BITS_BIGINT_LE(FUNC_NAME, BYTE_FUNC, BYTE_FUNC_ARG)  \
+#define FUNC_WRITE_BITS_BIGINT_LE(FUNC_NAME, BYTES_FUNC, BYTES_FUNC_ARG) \
     static void                                                         \
     FUNC_NAME(BitstreamWriter* self, unsigned int count, const mpz_t value) \
     {                                                                   \
@@ -3442,15 +3478,9 @@ FUNC_WRITE_BITS_BIGINT_BE(bw_write_bits_bigint_sr_be, bw_buf_putc,
             /*extract bits least-significant first*/                    \
             /*and remove them from the buffer*/                         \
             if (buffer_size >= 8) {                                     \
-                const unsigned byte = buffer & 0xFF;                    \
-                if (BYTE_FUNC(byte, BYTE_FUNC_ARG) != EOF) {            \
-                    struct bs_callback* callback;                       \
-                                                                        \
-                    for (callback = self->callbacks;                    \
-                         callback != NULL;                              \
-                         callback = callback->next)                     \
-                         callback->callback((uint8_t)byte,              \
-                                            callback->data);            \
+                const uint8_t byte = (uint8_t)(buffer & 0xFF);          \
+                if (!BYTES_FUNC(BYTES_FUNC_ARG, &byte, 1)) {            \
+                    bs_span_callbacks(self->callbacks, &byte, 1);       \
                     buffer >>= 8;                                       \
                     buffer_size -= 8;                                   \
                 } else {                                                \
@@ -3476,11 +3506,11 @@ FUNC_WRITE_BITS_BIGINT_BE(bw_write_bits_bigint_sr_be, bw_buf_putc,
         mpz_clear(value_to_write);                                      \
         mpz_clear(bitmask);                                             \
     }
-FUNC_WRITE_BITS_BIGINT_LE(bw_write_bits_bigint_f_le, fputc,
+FUNC_WRITE_BITS_BIGINT_LE(bw_write_bits_bigint_f_le, bw_file_write,
                           self->output.file)
-FUNC_WRITE_BITS_BIGINT_LE(bw_write_bits_bigint_e_le, ext_putc,
+FUNC_WRITE_BITS_BIGINT_LE(bw_write_bits_bigint_e_le, ext_fwrite,
                           self->output.external)
-FUNC_WRITE_BITS_BIGINT_LE(bw_write_bits_bigint_sr_le, bw_buf_putc,
+FUNC_WRITE_BITS_BIGINT_LE(bw_write_bits_bigint_sr_le, bw_buf_write,
                           self->output.string_recorder)
 
 static void
@@ -3846,24 +3876,13 @@ bw_write_bytes_file(BitstreamWriter* self,
                     unsigned int count)
 {
     if (self->buffer_size == 0) {
-        struct bs_callback* callback;
-
         /*stream is byte aligned, so perform optimized write*/
-        if (fwrite(bytes, sizeof(uint8_t), count, self->output.file) != count) {
+        if (bw_file_write(self->output.file, bytes, count)) {
             bw_abort(self);
         }
 
         /*perform callbacks on the written bytes*/
-        for (callback = self->callbacks;
-             callback != NULL;
-             callback = callback->next) {
-            bs_callback_f callback_func = callback->callback;
-            void* callback_data = callback->data;
-            unsigned int i;
-            for (i = 0; i < count; i++) {
-                callback_func(bytes[i], callback_data);
-            }
-        }
+        bs_span_callbacks(self->callbacks, bytes, count);
     } else {
         /*stream is not byte-aligned, so perform multiple writes*/
         unsigned int i;
@@ -3880,24 +3899,13 @@ bw_write_bytes_e(BitstreamWriter* self,
 {
 
     if (self->buffer_size == 0) {
-        struct bs_callback* callback;
-
         /*stream is byte aligned, so performed optimized write*/
         if (ext_fwrite(self->output.external, bytes, count)) {
             bw_abort(self);
         }
 
         /*perform callbacks on the written bytes*/
-        for (callback = self->callbacks;
-             callback != NULL;
-             callback = callback->next) {
-            bs_callback_f callback_func = callback->callback;
-            void* callback_data = callback->data;
-            unsigned int i;
-            for (i = 0; i < count; i++) {
-                callback_func(bytes[i], callback_data);
-            }
-        }
+        bs_span_callbacks(self->callbacks, bytes, count);
     } else {
         /*stream is not byte-aligned, so perform multiple writes*/
         unsigned int i;
@@ -3913,25 +3921,13 @@ bw_write_bytes_sr(BitstreamWriter* self,
                   unsigned int count)
 {
     if (self->buffer_size == 0) {
-        struct bs_callback* callback;
-
         /*stream is byte aligned, so perform optimized write*/
         if (bw_buf_write(self->output.string_recorder, bytes, count)) {
             bw_abort(self);
         }
 
         /*perform callbacks on the written bytes*/
-        for (callback = self->callbacks;
-             callback != NULL;
-             callback = callback->next) {
-            bs_callback_f callback_func = callback->callback;
-            void* callback_data = callback->data;
-            unsigned int i;
-
-            for (i = 0; i < count; i++) {
-                callback_func(bytes[i], callback_data);
-            }
-        }
+        bs_span_callbacks(self->callbacks, bytes, count);
     } else {
         /*stream is not byte-aligned, so perform multiple writes*/
         unsigned int i;
@@ -4081,7 +4077,10 @@ bw_byte_align_a(BitstreamWriter* bs)
 static void
 bw_flush_f(BitstreamWriter* self)
 {
-    fflush(self->output.file);
+    if (bw_file_drain(self->output.file)) {
+        bw_abort(self);
+    }
+    fflush(self->output.file->stream);
 }
 
 static void
@@ -4107,9 +4106,13 @@ bw_getpos_file(BitstreamWriter* self)
 
     assert(self->buffer_size == 0);
 
+    if (bw_file_drain(self->output.file)) {
+        bw_abort(self);
+    }
+
     pos = malloc(sizeof(bw_pos_t));
     pos->writer = self;
-    fgetpos(self->output.file, &(pos->position.file));
+    fgetpos(self->output.file->stream, &(pos->position.file));
     pos->del = bw_pos_del_f;
     return pos;
 }
@@ -4164,7 +4167,10 @@ bw_setpos_file(BitstreamWriter* self, const bw_pos_t* pos)
     assert(pos->writer == self);
     assert(self->buffer_size == 0);
 
-    fsetpos(self->output.file, &(pos->position.file));
+    if (bw_file_drain(self->output.file)) {
+        bw_abort(self);
+    }
+    fsetpos(self->output.file->stream, &(pos->position.file));
 }
 
 static void
@@ -4205,7 +4211,8 @@ bw_seek_file(BitstreamWriter* self, long position, bs_whence whence)
 {
     assert(self->buffer_size == 0);
 
-    if (fseek(self->output.file, position, whence) == -1) {
+    if (bw_file_drain(self->output.file) ||
+        (fseek(self->output.file->stream, position, whence) == -1)) {
         bw_abort(self);
     }
 }
@@ -4283,9 +4290,12 @@ bw_close_methods(BitstreamWriter* self)
 static void
 bw_close_internal_stream_f(BitstreamWriter* self)
 {
-    /*perform fclose on FILE object
-      which automatically flushes its output*/
-    fclose(self->output.file);
+    /*pass along any pending bytes and perform fclose on FILE object
+      which automatically flushes its output
+      not much we can do if an error occurs at this point*/
+    (void)bw_file_drain(self->output.file);
+    fclose(self->output.file->stream);
+    self->output.file->stream = NULL;
 
     /*swap write methods with closed methods*/
     bw_close_methods(self);
@@ -4313,6 +4323,19 @@ bw_close_internal_stream_e(BitstreamWriter* self)
 
 static void
 bw_free_f(BitstreamWriter* self)
+{
+    /*pass any pending bytes to a FILE which is still open
+      since it may be used after the writer is gone*/
+    if (self->output.file->stream != NULL) {
+        (void)bw_file_drain(self->output.file);
+    }
+    free(self->output.file);
+
+    bw_free_common(self);
+}
+
+static void
+bw_free_common(BitstreamWriter* self)
 {
     /*deallocate callbacks*/
     while (self->callbacks != NULL) {
@@ -4350,7 +4373,7 @@ bw_free_e(BitstreamWriter* self)
     ext_free_w(self->output.external);
 
     /*perform additional deallocations on rest of struct*/
-    bw_free_f(self);
+    bw_free_common(self);
 }
 
 
@@ -4720,6 +4743,7 @@ bw_reset_r(BitstreamRecorder *self)
         entry->reset(entry);
     }
     self->output.recorder.entry_count = 0;
+    self->output.recorder.bits_written = 0;
 }
 
 static void
@@ -5119,12 +5143,29 @@ reset_noop(struct BitstreamRecorderEntry *self)
       struct bs_callback callback_node;                          \
                                                                  \
       callback_node.callback = callback;                         \
+      callback_node.span = NULL;                                 \
       callback_node.data = data;                                 \
       PUSH_CALLBACK_FUNC(self, &callback_node);                  \
   }
 FUNC_ADD_CALLBACK(br_add_callback, br_push_callback, BitstreamReader)
 FUNC_ADD_CALLBACK(bw_add_callback, bw_push_callback, BitstreamWriter)
 
+#define FUNC_ADD_SPAN_CALLBACK(FUNC_NAME, PUSH_CALLBACK_FUNC, STREAM)  \
+  static void                                                          \
+  FUNC_NAME(STREAM *self, bs_span_callback_f callback, void* data)     \
+  {                                                                    \
+      struct bs_callback callback_node;                                \
+                                                                       \
+      callback_node.callback = NULL;                                   \
+      callback_node.span = callback;                                   \
+      callback_node.data = data;                                       \
+      PUSH_CALLBACK_FUNC(self, &callback_node);                        \
+  }
+FUNC_ADD_SPAN_CALLBACK(br_add_span_callback, br_push_callback,
+                       BitstreamReader)
+FUNC_ADD_SPAN_CALLBACK(bw_add_span_callback, bw_push_callback,
+                       BitstreamWriter)
+
 #define FUNC_PUSH_CALLBACK(FUNC_NAME, STREAM)                     \
   static void                                                     \
   FUNC_NAME(STREAM *self, struct bs_callback *callback)           \
@@ -5138,6 +5179,7 @@ FUNC_ADD_CALLBACK(bw_add_callback, bw_push_callback, BitstreamWriter)
               callback_node = malloc(sizeof(struct bs_callback)); \
           }                                                       \
           callback_node->callback = callback->callback;           \
+          callback_node->span = callback->span;                   \
           callback_node->data = callback->data;                   \
           callback_node->next = self->callbacks;                  \
           self->callbacks = callback_node;                        \
@@ -5154,6 +5196,7 @@ FUNC_PUSH_CALLBACK(bw_push_callback, BitstreamWriter)
       if (c_node != NULL) {                                      \
           if (callback != NULL) {                                \
               callback->callback = c_node->callback;             \
+              callback->span = c_node->span;                     \
               callback->data = c_node->data;                     \
               callback->next = NULL;                             \
           }                                                      \
@@ -5171,12 +5214,7 @@ FUNC_POP_CALLBACK(bw_pop_callback, BitstreamWriter)
   static void                                       \
   FUNC_NAME(STREAM *self, uint8_t byte)             \
   {                                                 \
-      struct bs_callback *callback;                 \
-      for (callback = self->callbacks;              \
-           callback != NULL;                        \
-           callback = callback->next) {             \
-          callback->callback(byte, callback->data); \
-      }                                             \
+      bs_byte_callbacks(self->callbacks, byte);     \
   }
 FUNC_CALL_CALLBACKS(br_call_callbacks, BitstreamReader)
 FUNC_CALL_CALLBACKS(bw_call_callbacks, BitstreamWriter)
@@ -5257,6 +5295,10 @@ br_read_python(void *stream,
 {
     PyObject* reader = stream;
 
+    /*take the GIL, if necessary, so that decoders
+      may release it while reading from a Python stream*/
+    PyGILState_STATE gil_state = PyGILState_Ensure();
+
     /*call read() method on reader*/
     PyObject* read_result =
         PyObject_CallMethod(reader, "read", "I", buffer_size);
@@ -5268,6 +5310,7 @@ br_read_python(void *stream,
         /*some exception occurred, so clear result and return no bytes
           (which will likely turn into an I/O exception later)*/
         PyErr_Clear();
+        PyGILState_Release(gil_state);
         return 0;
     }
 
@@ -5279,6 +5322,7 @@ br_read_python(void *stream,
           so clear exception and return no bytes*/
         Py_DECREF(read_result);
         PyErr_Clear();
+        PyGILState_Release(gil_state);
         return 0;
     }
 
@@ -5295,6 +5339,7 @@ br_read_python(void *stream,
 
     /*perform cleanup and return bytes actually read*/
     Py_DECREF(read_result);
+    PyGILState_Release(gil_state);
 
     return to_copy;
 }
@@ -5679,6 +5724,7 @@ void check_alignment_e(const align_check* check,
 void func_add_one(uint8_t byte, int* value);
 void func_add_two(uint8_t byte, int* value);
 void func_mult_three(uint8_t byte, int* value);
+void func_add_span(const uint8_t* bytes, unsigned count, int* value);
 
 int main(int argc, char* argv[]) {
     int fd;
@@ -7336,7 +7382,7 @@ test_writer(bs_endianness endianness) {
                                 {15, 0x4000, 2, 0x4000},
                                 {16, 0x8000, 2, 0x8000}};
     int total_achecks = 17;
-    unsigned sums[3];
+    unsigned sums[4];
 
     /*perform file-based checks*/
     for (i = 0; i < total_checks; i++) {
@@ -7344,7 +7390,7 @@ test_writer(bs_endianness endianness) {
         assert(output_file != NULL);
         writer = bw_open(output_file, endianness);
         checks[i](writer, endianness);
-        fflush(output_file);
+        writer->flush(writer);
         check_output_file();
         writer->free(writer);
         fclose(output_file);
@@ -7407,7 +7453,7 @@ test_writer(bs_endianness endianness) {
         assert(sub_writer->bits_written(sub_writer) == 0);
         checks[i]((BitstreamWriter*)sub_writer, endianness);
         sub_writer->copy(sub_writer, writer);
-        fflush(output_file);
+        writer->flush(writer);
         check_output_file();
         writer->free(writer);
         assert(sub_writer->bits_written(sub_writer) == 32);
@@ -7420,7 +7466,7 @@ test_writer(bs_endianness endianness) {
     writer = bw_open(output_file, endianness);
     sub_writer = bw_open_recorder(endianness);
     test_rec_copy_dumps(endianness, writer, sub_writer);
-    fflush(output_file);
+    writer->flush(writer);
     check_output_file();
     sub_writer->close(sub_writer);
     writer->close(writer);
@@ -7448,7 +7494,7 @@ test_writer(bs_endianness endianness) {
     sub_writer->write((BitstreamWriter*)sub_writer, 8, 0x3B);
     sub_writer->write((BitstreamWriter*)sub_writer, 8, 0xC1);
     sub_writer->copy(sub_writer, writer);
-    fflush(output_file);
+    writer->flush(writer);
     sub_writer->close(sub_writer);
     writer->close(writer);
     check_output_file();
@@ -7486,23 +7532,27 @@ test_writer(bs_endianness endianness) {
 
     /*check file-based callback functions*/
     for (i = 0; i < total_checks; i++) {
-        sums[0] = sums[1] = 0;
+        sums[0] = sums[1] = sums[3] = 0;
         sums[2] = 1;
         output_file = fopen(temp_filename, "wb");
         writer = bw_open(output_file, endianness);
         writer->add_callback(writer, (bs_callback_f)func_add_one, &(sums[0]));
         writer->add_callback(writer, (bs_callback_f)func_add_two, &(sums[1]));
         writer->add_callback(writer, (bs_callback_f)func_mult_three, &(sums[2]));
+        writer->add_span_callback(writer,
+                                  (bs_span_callback_f)func_add_span,
+                                  &(sums[3]));
         checks[i](writer, endianness);
         writer->close(writer);
         assert(sums[0] == 4);
         assert(sums[1] == 8);
         assert(sums[2] == 81);
+        assert(sums[3] == 4);
     }
 
     /*check an external function callback functions*/
     for (i = 0; i < total_checks; i++) {
-        sums[0] = sums[1] = 0;
+        sums[0] = sums[1] = sums[3] = 0;
         sums[2] = 1;
         output_file = fopen(temp_filename, "wb");
         writer = bw_open_external(output_file,
@@ -7519,11 +7569,15 @@ test_writer(bs_endianness endianness) {
         writer->add_callback(writer, (bs_callback_f)func_add_one, &(sums[0]));
         writer->add_callback(writer, (bs_callback_f)func_add_two, &(sums[1]));
         writer->add_callback(writer, (bs_callback_f)func_mult_three, &(sums[2]));
+        writer->add_span_callback(writer,
+                                  (bs_span_callback_f)func_add_span,
+                                  &(sums[3]));
         checks[i](writer, endianness);
         writer->close(writer);
         assert(sums[0] == 4);
         assert(sums[1] == 8);
         assert(sums[2] == 81);
+        assert(sums[3] == 4);
     }
 
     /*check that recorder->recorder->file works*/
@@ -7542,7 +7596,7 @@ test_writer(bs_endianness endianness) {
         assert(sub_writer->bits_written(sub_writer) == 32);
         assert(sub_writer->bits_written(sub_sub_writer) == 32);
         sub_writer->copy(sub_writer, writer);
-        fflush(output_file);
+        writer->flush(writer);
         check_output_file();
         writer->free(writer);
         sub_writer->close(sub_writer);
@@ -8890,6 +8944,11 @@ void func_mult_three(uint8_t byte, int* value)
     *value *= 3;
 }
 
+void func_add_span(const uint8_t* bytes, unsigned count, int* value)
+{
+    *value += count;
+}
+
 void
 test_writer_marks(BitstreamWriter* writer)
 {
@@ -79,10 +79,16 @@ typedef enum {BS_SEEK_SET=0,
 
 typedef void (*bs_callback_f)(uint8_t, void*);
 
+typedef void (*bs_span_callback_f)(const uint8_t*, unsigned, void*);
+
 /*a stackable callback function,
-  used by BitstreamReader and BitstreamWriter*/
+  used by BitstreamReader and BitstreamWriter
+
+  if "span" is not NULL, it is called once per run of bytes
+  read or written together and "callback" is unused*/
 struct bs_callback {
     void (*callback)(uint8_t, void*);
+    void (*span)(const uint8_t*, unsigned, void*);
     void *data;
     struct bs_callback *next;
 };
@@ -360,6 +366,13 @@ typedef void
                     bs_callback_f callback,                              \
                     void* data);                                         \
                                                                          \
+    /*pushes a callback function into the stream*/                       \
+    /*which is called on every run of bytes read*/                       \
+    void                                                                 \
+    (*add_span_callback)(struct BitstreamReader_s* self,                 \
+                         bs_span_callback_f callback,                    \
+                         void* data);                                    \
+                                                                         \
     /*pushes the given callback onto the callback stack*/                \
     /*data from "callback" is copied onto a new internal struct*/        \
     /*it does not need to be allocated from the heap*/                   \
@@ -738,13 +751,24 @@ typedef void
 
 struct BitstreamRecorderEntry;
 
+/*the number of completed bytes a FILE-based BitstreamWriter
+  collects before passing them to fwrite() all at once*/
+#define BW_FILE_BUFFER_SIZE 4096
+
+/*a FILE object and the bytes waiting to be written to it*/
+struct bw_file_output {
+    FILE *stream;
+    unsigned pending;
+    uint8_t data[BW_FILE_BUFFER_SIZE];
+};
+
 
 #define BITSTREAMWRITER_TYPE                                \
     bs_endianness endianness;                               \
     bw_type type;                                           \
                                                             \
     union {                                                 \
-        FILE* file;                                         \
+        struct bw_file_output* file;                        \
         struct {                                            \
             unsigned bits_written;                          \
             unsigned maximum_size;                          \
@@ -761,6 +785,7 @@ struct BitstreamRecorderEntry;
         } limited_accumulator;                              \
     } output;                                               \
                                                             \
+    /*the trailing bits of a partial byte, at most 7*/      \
     unsigned int buffer_size;                               \
     unsigned int buffer;                                    \
                                                             \
@@ -851,6 +876,13 @@ struct BitstreamRecorderEntry;
                     bs_callback_f callback,                 \
                     void* data);                            \
                                                             \
+    /*pushes a callback function into the stream*/          \
+    /*which is called on every run of bytes written*/       \
+    void                                                    \
+    (*add_span_callback)(struct BitstreamWriter_s* self,    \
+                         bs_span_callback_f callback,       \
+                         void* data);                       \
+                                                            \
     /*pushes the given callback onto the callback stack*/         \
     /*data from "callback" is copied onto a new internal struct*/ \
     /*it does not need to be allocated from the heap*/            \
@@ -1145,6 +1177,8 @@ bw_pos_stack_pop(struct bw_pos_stack** stack);
  *                          Python-specific                        *
  *******************************************************************/
 
+/*reads from a Python object's read() method,
+  taking the GIL for the call if the caller has released it*/
 unsigned
 br_read_python(void *stream,
                uint8_t *buffer,
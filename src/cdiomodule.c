@@ -1,5 +1,6 @@
 #include "cdiomodule.h"
 #include <limits.h>
+#include <string.h>
 #include <cdio/cd_types.h>
 #include <cdio/audio.h>
 #include <cdio/track.h>
@@ -41,6 +42,9 @@
 #define MAX(x, y) ((x) > (y) ? (x) : (y))
 #endif
 
+/*2 channels of 588 PCM frames per CD sector*/
+#define SAMPLES_PER_SECTOR ((44100 / 75) * 2)
+
 MOD_INIT(cdio)
 {
     PyObject* m;
@@ -71,17 +75,28 @@ static int
 CDDAReader_init(cdio_CDDAReader *self, PyObject *args, PyObject *kwds)
 {
     char *device = NULL;
+    int readahead = 0;
     struct stat buf;
+    int result;
 
     self->is_cd_image = 0;
     self->is_logging = 0;
     self->dealloc = NULL;
+    self->readahead.capacity = 0;
+    self->readahead.sectors = NULL;
+    self->readahead.running = 0;
     self->closed = 0;
     self->audiotools_pcm = NULL;
     cddareader_reset_log(&(self->log));
 
-    if (!PyArg_ParseTuple(args, "s|i", &device, &(self->is_logging)))
+    if (!PyArg_ParseTuple(args, "s|ii",
+                          &device, &(self->is_logging), &readahead))
+        return -1;
+
+    if (readahead < 0) {
+        PyErr_SetString(PyExc_ValueError, "readahead must be >= 0");
         return -1;
+    }
 
     if ((self->audiotools_pcm = open_audiotools_pcm()) == NULL)
         return -1;
@@ -99,7 +114,7 @@ CDDAReader_init(cdio_CDDAReader *self, PyObject *args, PyObject *kwds)
             /*open CD image and set function pointers*/
             self->is_cd_image = 1;
             self->is_logging = 0;
-            return CDDAReader_init_image(self, device);
+            result = CDDAReader_init_image(self, device);
         } else {
             /*unsupported file*/
             PyErr_SetString(PyExc_ValueError, "unsupported CD image type");
@@ -109,7 +124,7 @@ CDDAReader_init(cdio_CDDAReader *self, PyObject *args, PyObject *kwds)
         if (cdio_is_device(device, DRIVER_LINUX)) {
             /*open CD device and set function pointers*/
             self->is_cd_image = 0;
-            return CDDAReader_init_device(self, device);
+            result = CDDAReader_init_device(self, device);
         } else {
             /*unsupported block device*/
             PyErr_SetString(PyExc_ValueError, "unsupported block device");
@@ -120,6 +135,16 @@ CDDAReader_init(cdio_CDDAReader *self, PyObject *args, PyObject *kwds)
         PyErr_SetString(PyExc_ValueError, "unsupported file type");
         return -1;
     }
+
+    if ((result == 0) && (readahead > 0)) {
+        if (cddareader_init_readahead(self, (unsigned)readahead)) {
+            PyErr_SetString(PyExc_MemoryError,
+                            "unable to allocate read-ahead buffer");
+            return -1;
+        }
+    }
+
+    return result;
 }
 
 static int
@@ -202,6 +227,8 @@ CDDAReader_init_device(cdio_CDDAReader *self, const char *device)
 static void
 CDDAReader_dealloc(cdio_CDDAReader *self)
 {
+    /*reader thread must be finished before the drive is closed*/
+    cddareader_free_readahead(self);
     if (self->dealloc) {
         self->dealloc(self);
     }
@@ -467,18 +494,32 @@ CDDAReader_read(cdio_CDDAReader* self, PyObject *args)
                               16,
                               sectors_to_read * (44100 / 75));
 
-    /*if logging is in progress, only let a single thread
-      into this function at once so that the global callback
-      can be set and used atomically
-
-      since the callback function doesn't take any state
-      we're forced to stick it in a global variable*/
-    if (!self->is_logging) {
+    if (self->readahead.capacity) {
+        /*pull sectors from the reader thread's buffer,
+          which handles logging on its own*/
         thread_state = PyEval_SaveThread();
-    }
-    sectors_read = self->read(self, sectors_to_read, framelist->samples);
-    if (!self->is_logging) {
+        sectors_read = cddareader_read_buffered(self,
+                                                sectors_to_read,
+                                                framelist->samples);
         PyEval_RestoreThread(thread_state);
+    } else {
+        /*if logging is in progress, only let a single thread
+          into this function at once so that the global callback
+          can be set and used atomically
+
+          since the callback function doesn't take any state
+          we're forced to stick it in a global variable*/
+        if (!self->is_logging) {
+            thread_state = PyEval_SaveThread();
+        } else {
+            pthread_mutex_lock(&log_mutex);
+        }
+        sectors_read = self->read(self, sectors_to_read, framelist->samples);
+        if (!self->is_logging) {
+            PyEval_RestoreThread(thread_state);
+        } else {
+            pthread_mutex_unlock(&log_mutex);
+        }
     }
 
     if (sectors_read >= 0) {
@@ -557,6 +598,182 @@ CDDAReader_read_device(cdio_CDDAReader *self,
     return initial_sectors_to_read - sectors_to_read;
 }
 
+static int
+cddareader_init_readahead(cdio_CDDAReader *self, unsigned sectors)
+{
+    struct cdio_readahead *readahead = &(self->readahead);
+
+    readahead->sectors = malloc(sizeof(int) * SAMPLES_PER_SECTOR * sectors);
+    if (readahead->sectors == NULL) {
+        return 1;
+    }
+    readahead->capacity = sectors;
+    readahead->start = 0;
+    readahead->count = 0;
+    readahead->running = 0;
+    readahead->stop = 0;
+    readahead->finished = 0;
+    readahead->error = 0;
+    pthread_mutex_init(&(readahead->mutex), NULL);
+    pthread_cond_init(&(readahead->readable), NULL);
+    pthread_cond_init(&(readahead->writable), NULL);
+    return 0;
+}
+
+static int
+cddareader_read_buffered(cdio_CDDAReader *self,
+                         unsigned sectors_to_read,
+                         int *samples)
+{
+    struct cdio_readahead *readahead = &(self->readahead);
+    unsigned sectors_read;
+
+    if (!readahead->running) {
+        if (pthread_create(&(readahead->thread),
+                           NULL,
+                           cddareader_readahead_thread,
+                           self)) {
+            return -1;
+        }
+        readahead->running = 1;
+    }
+
+    pthread_mutex_lock(&(readahead->mutex));
+
+    /*requests may be larger than the read-ahead buffer,
+      so keep draining it as the reader thread refills it
+      until the request is satisfied,
+      so short reads only occur at the end of the disc or on error*/
+    sectors_read = 0;
+    while (sectors_read < sectors_to_read) {
+        while ((readahead->count == 0) &&
+               !readahead->finished &&
+               !readahead->error) {
+            pthread_cond_wait(&(readahead->readable), &(readahead->mutex));
+        }
+
+        if (readahead->count == 0) {
+            /*reader thread is finished or has hit an error*/
+            break;
+        }
+
+        for (; (sectors_read < sectors_to_read) && readahead->count;
+             sectors_read++) {
+            memcpy(samples,
+                   readahead->sectors +
+                   (readahead->start * SAMPLES_PER_SECTOR),
+                   sizeof(int) * SAMPLES_PER_SECTOR);
+            samples += SAMPLES_PER_SECTOR;
+            readahead->start = (readahead->start + 1) % readahead->capacity;
+            readahead->count--;
+        }
+
+        pthread_cond_signal(&(readahead->writable));
+    }
+
+    if ((sectors_read == 0) && readahead->error) {
+        pthread_mutex_unlock(&(readahead->mutex));
+        return -1;
+    }
+
+    pthread_mutex_unlock(&(readahead->mutex));
+
+    return (int)sectors_read;
+}
+
+static void*
+cddareader_readahead_thread(void *arg)
+{
+    cdio_CDDAReader *self = arg;
+    struct cdio_readahead *readahead = &(self->readahead);
+    int sector[SAMPLES_PER_SECTOR];
+
+    for (;;) {
+        int result;
+
+        pthread_mutex_lock(&(readahead->mutex));
+        while ((readahead->count == readahead->capacity) && !readahead->stop) {
+            pthread_cond_wait(&(readahead->writable), &(readahead->mutex));
+        }
+        if (readahead->stop) {
+            pthread_mutex_unlock(&(readahead->mutex));
+            return NULL;
+        }
+        pthread_mutex_unlock(&(readahead->mutex));
+
+        /*read the next sector without holding the buffer's lock
+          so that the consumer can keep draining it*/
+        if (self->is_logging) {
+            pthread_mutex_lock(&log_mutex);
+        }
+        result = self->read(self, 1, sector);
+        if (self->is_logging) {
+            pthread_mutex_unlock(&log_mutex);
+        }
+
+        pthread_mutex_lock(&(readahead->mutex));
+        if (result == 1) {
+            const unsigned end =
+                (readahead->start + readahead->count) % readahead->capacity;
+            memcpy(readahead->sectors + (end * SAMPLES_PER_SECTOR),
+                   sector,
+                   sizeof(sector));
+            readahead->count++;
+        } else if (result == 0) {
+            readahead->finished = 1;
+        } else {
+            readahead->error = 1;
+        }
+        pthread_cond_signal(&(readahead->readable));
+        pthread_mutex_unlock(&(readahead->mutex));
+
+        if (result != 1) {
+            return NULL;
+        }
+    }
+}
+
+static void
+cddareader_stop_readahead(cdio_CDDAReader *self)
+{
+    struct cdio_readahead *readahead = &(self->readahead);
+
+    if (readahead->running) {
+        pthread_mutex_lock(&(readahead->mutex));
+        readahead->stop = 1;
+        pthread_cond_signal(&(readahead->writable));
+        pthread_mutex_unlock(&(readahead->mutex));
+
+        pthread_join(readahead->thread, NULL);
+        readahead->running = 0;
+    }
+
+    readahead->start = 0;
+    readahead->count = 0;
+    readahead->stop = 0;
+    readahead->finished = 0;
+    readahead->error = 0;
+}
+
+static void
+cddareader_free_readahead(cdio_CDDAReader *self)
+{
+    struct cdio_readahead *readahead = &(self->readahead);
+
+    if (readahead->capacity) {
+        PyThreadState *thread_state = PyEval_SaveThread();
+        cddareader_stop_readahead(self);
+        PyEval_RestoreThread(thread_state);
+
+        pthread_mutex_destroy(&(readahead->mutex));
+        pthread_cond_destroy(&(readahead->readable));
+        pthread_cond_destroy(&(readahead->writable));
+        free(readahead->sectors);
+        readahead->sectors = NULL;
+        readahead->capacity = 0;
+    }
+}
+
 static PyObject*
 CDDAReader_seek(cdio_CDDAReader* self, PyObject *args)
 {
@@ -580,6 +797,15 @@ CDDAReader_seek(cdio_CDDAReader* self, PyObject *args)
     } else {
         seeked_sector = (unsigned)(seeked_offset / (44100 / 75));
     }
+
+    /*discard anything read ahead of the old position
+      before the drive is repositioned*/
+    if (self->readahead.capacity) {
+        PyThreadState *thread_state = PyEval_SaveThread();
+        cddareader_stop_readahead(self);
+        PyEval_RestoreThread(thread_state);
+    }
+
     found_sector = self->seek(self, seeked_sector);
     return Py_BuildValue("I", found_sector * (44100 / 75));
 }
@@ -607,6 +833,12 @@ CDDAReader_seek_device(cdio_CDDAReader *self, unsigned sector)
 static PyObject*
 CDDAReader_close(cdio_CDDAReader* self, PyObject *args)
 {
+    if (self->readahead.capacity) {
+        PyThreadState *thread_state = PyEval_SaveThread();
+        cddareader_stop_readahead(self);
+        PyEval_RestoreThread(thread_state);
+    }
+
     self->closed = 1;
 
     Py_INCREF(Py_None);
@@ -1,4 +1,5 @@
 #include <Python.h>
+#include <pthread.h>
 #ifdef PARANOIA_LT_0_90
 #include <cdio/cdda.h>
 #include <cdio/paranoia.h>
@@ -53,6 +54,28 @@ struct cdio_log {
   to be used by the cddareader_callback*/
 struct cdio_log *log_state = NULL;
 
+/*held while log_state is in use,
+  since read-ahead threads read sectors without holding the GIL*/
+static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*a bounded ring buffer of sectors
+  filled by a reader thread ahead of calls to CDDAReader.read()
+  so that the drive keeps streaming while the caller is busy encoding*/
+struct cdio_readahead {
+    unsigned capacity;         /*total sectors in buffer, 0 if disabled*/
+    int *sectors;              /*capacity * SAMPLES_PER_SECTOR samples*/
+    unsigned start;            /*index of the oldest buffered sector*/
+    unsigned count;            /*number of buffered sectors*/
+    int running;               /*a boolean, reader thread has started*/
+    int stop;                  /*a boolean, reader thread should exit*/
+    int finished;              /*a boolean, reader thread hit end of disc*/
+    int error;                 /*a boolean, reader thread hit read error*/
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t readable;   /*signalled when sectors are added*/
+    pthread_cond_t writable;   /*signalled when sectors are removed*/
+};
+
 static void
 cddareader_callback(long int i, paranoia_cb_mode_t mode);
 
@@ -88,6 +111,8 @@ typedef struct cdio_CDDAReader_s {
     void (*set_speed)(struct cdio_CDDAReader_s *self, int new_speed);
     void (*dealloc)(struct cdio_CDDAReader_s *self);
 
+    struct cdio_readahead readahead;
+
     int closed;
     PyObject *audiotools_pcm;
 } cdio_CDDAReader;
@@ -211,6 +236,34 @@ CDDAReader_read_device(cdio_CDDAReader *self,
                        unsigned sectors_to_read,
                        int *samples);
 
+/*allocates a read-ahead buffer of the given number of sectors
+  returns 0 on success, 1 if unable to allocate it*/
+static int
+cddareader_init_readahead(cdio_CDDAReader *self, unsigned sectors);
+
+/*transfers up to "sectors_to_read" sectors from the read-ahead buffer
+  to "samples", starting the reader thread if necessary
+
+  blocks until that many sectors are available or the disc is finished
+  and returns the number of sectors transferred, or -1 on error
+
+  must be called without holding the GIL*/
+static int
+cddareader_read_buffered(cdio_CDDAReader *self,
+                         unsigned sectors_to_read,
+                         int *samples);
+
+/*stops the reader thread, if running, and discards buffered sectors*/
+static void
+cddareader_stop_readahead(cdio_CDDAReader *self);
+
+/*deallocates the read-ahead buffer, stopping the reader thread first*/
+static void
+cddareader_free_readahead(cdio_CDDAReader *self);
+
+static void*
+cddareader_readahead_thread(void *arg);
+
 static PyObject*
 CDDAReader_seek(cdio_CDDAReader* self, PyObject *args);
 
@@ -0,0 +1,235 @@
+#include "encoder_stats.h"
+#include <stdlib.h>
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+#ifndef STANDALONE
+
+/*an external output stream whose calls are wrapped in STAGE_IO*/
+struct timed_output {
+    void *user_data;
+    ext_write_f write;
+    ext_setpos_f setpos;
+    ext_getpos_f getpos;
+    ext_seek_f seek;
+    ext_flush_f flush;
+    ext_close_f close;
+    ext_free_f free;
+    struct stage_timer *timer;
+};
+
+static int
+timed_write(struct timed_output *output,
+            const uint8_t *buffer,
+            unsigned buffer_size)
+{
+    const encoder_stage_t previous =
+        stage_timer_enter(output->timer, STAGE_IO);
+    const int result = output->write(output->user_data, buffer, buffer_size);
+    stage_timer_enter(output->timer, previous);
+    return result;
+}
+
+static int
+timed_setpos(struct timed_output *output, void *pos)
+{
+    const encoder_stage_t previous =
+        stage_timer_enter(output->timer, STAGE_IO);
+    const int result = output->setpos(output->user_data, pos);
+    stage_timer_enter(output->timer, previous);
+    return result;
+}
+
+static void*
+timed_getpos(struct timed_output *output)
+{
+    const encoder_stage_t previous =
+        stage_timer_enter(output->timer, STAGE_IO);
+    void *result = output->getpos(output->user_data);
+    stage_timer_enter(output->timer, previous);
+    return result;
+}
+
+static int
+timed_seek(struct timed_output *output, long position, int whence)
+{
+    const encoder_stage_t previous =
+        stage_timer_enter(output->timer, STAGE_IO);
+    const int result = output->seek(output->user_data, position, whence);
+    stage_timer_enter(output->timer, previous);
+    return result;
+}
+
+static int
+timed_flush(struct timed_output *output)
+{
+    const encoder_stage_t previous =
+        stage_timer_enter(output->timer, STAGE_IO);
+    const int result = output->flush(output->user_data);
+    stage_timer_enter(output->timer, previous);
+    return result;
+}
+
+static int
+timed_close(struct timed_output *output)
+{
+    const encoder_stage_t previous =
+        stage_timer_enter(output->timer, STAGE_IO);
+    const int result = output->close(output->user_data);
+    stage_timer_enter(output->timer, previous);
+    return result;
+}
+
+static void
+timed_free(struct timed_output *output)
+{
+    output->free(output->user_data);
+    free(output);
+}
+
+BitstreamWriter*
+bw_open_timed(void* user_data,
+              bs_endianness endianness,
+              unsigned buffer_size,
+              ext_write_f write,
+              ext_setpos_f setpos,
+              ext_getpos_f getpos,
+              ext_free_pos_f free_pos,
+              ext_seek_f seek,
+              ext_flush_f flush,
+              ext_close_f close,
+              ext_free_f free,
+              struct stage_timer *timer)
+{
+    struct timed_output *output = malloc(sizeof(struct timed_output));
+
+    output->user_data = user_data;
+    output->write = write;
+    output->setpos = setpos;
+    output->getpos = getpos;
+    output->seek = seek;
+    output->flush = flush;
+    output->close = close;
+    output->free = free;
+    output->timer = timer;
+
+    return bw_open_external(output,
+                            endianness,
+                            buffer_size,
+                            (ext_write_f)timed_write,
+                            (ext_setpos_f)timed_setpos,
+                            (ext_getpos_f)timed_getpos,
+                            free_pos,
+                            (ext_seek_f)timed_seek,
+                            (ext_flush_f)timed_flush,
+                            (ext_close_f)timed_close,
+                            (ext_free_f)timed_free);
+}
+
+static int
+file_write(FILE *file, const uint8_t *buffer, unsigned buffer_size)
+{
+    return fwrite(buffer, sizeof(uint8_t), buffer_size, file) != buffer_size;
+}
+
+static int
+file_setpos(FILE *file, fpos_t *pos)
+{
+    return fsetpos(file, pos);
+}
+
+static fpos_t*
+file_getpos(FILE *file)
+{
+    fpos_t *pos = malloc(sizeof(fpos_t));
+    if (fgetpos(file, pos)) {
+        free(pos);
+        return NULL;
+    } else {
+        return pos;
+    }
+}
+
+static void
+file_free_pos(fpos_t *pos)
+{
+    free(pos);
+}
+
+static void
+file_free(FILE *file)
+{
+    /*the file itself is freed by fclose()*/
+    return;
+}
+
+BitstreamWriter*
+bw_open_timed_file(FILE *file,
+                   bs_endianness endianness,
+                   struct stage_timer *timer)
+{
+    return bw_open_timed(file,
+                         endianness,
+                         4096,
+                         (ext_write_f)file_write,
+                         (ext_setpos_f)file_setpos,
+                         (ext_getpos_f)file_getpos,
+                         (ext_free_pos_f)file_free_pos,
+                         (ext_seek_f)fseek,
+                         (ext_flush_f)fflush,
+                         (ext_close_f)fclose,
+                         (ext_free_f)file_free,
+                         timer);
+}
+
+PyObject*
+stage_timer_dict(const struct stage_timer *timer)
+{
+    return Py_BuildValue("{sdsdsdsdsdsdsd}",
+                         "pcm_read", timer->seconds[STAGE_PCM_READ],
+                         "md5", timer->seconds[STAGE_MD5],
+                         "lpc", timer->seconds[STAGE_LPC],
+                         "residual", timer->seconds[STAGE_RESIDUAL],
+                         "write", timer->seconds[STAGE_WRITE],
+                         "io", timer->seconds[STAGE_IO],
+                         "other", timer->seconds[STAGE_OTHER]);
+}
+
+PyObject*
+histogram_list(unsigned bins, const unsigned histogram[])
+{
+    PyObject *list = PyList_New(bins);
+    unsigned i;
+
+    if (!list) {
+        return NULL;
+    }
+    for (i = 0; i < bins; i++) {
+        PyObject *count = PyLong_FromUnsignedLong(histogram[i]);
+        if (!count) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, i, count);
+    }
+    return list;
+}
+
+#endif
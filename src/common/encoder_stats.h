@@ -0,0 +1,118 @@
+#ifndef ENCODER_STATS_H
+#define ENCODER_STATS_H
+
+#ifndef STANDALONE
+#include <Python.h>
+#endif
+#include <time.h>
+#include "../bitstream.h"
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+/*the stages an encoder's time is divided between
+
+  each moment of encoding is charged to exactly one stage,
+  so the stages' times sum to the encoder's total time*/
+typedef enum {
+    STAGE_OTHER,       /*metadata and anything not listed below*/
+    STAGE_PCM_READ,    /*pulling samples from the PCMReader*/
+    STAGE_MD5,         /*updating the stream's MD5 sum*/
+    STAGE_LPC,         /*windowing and calculating LPC coefficients*/
+    STAGE_RESIDUAL,    /*calculating residuals and their best coding*/
+    STAGE_WRITE,       /*building frames from the chosen coding*/
+    STAGE_IO,          /*passing finished bytes to the output stream*/
+    STAGE_COUNT
+} encoder_stage_t;
+
+struct stage_timer {
+    encoder_stage_t stage;      /*the stage currently being timed*/
+    struct timespec entered;    /*when the current stage was entered*/
+    double seconds[STAGE_COUNT];
+};
+
+/*starts timing the STAGE_OTHER stage with all totals at 0*/
+static inline void
+stage_timer_init(struct stage_timer *timer)
+{
+    unsigned i;
+
+    timer->stage = STAGE_OTHER;
+    clock_gettime(CLOCK_MONOTONIC, &timer->entered);
+    for (i = 0; i < STAGE_COUNT; i++) {
+        timer->seconds[i] = 0.0;
+    }
+}
+
+/*charges the time since the current stage was entered to it,
+  switches to the given stage and returns the previous one
+  so that it may be restored afterward*/
+static inline encoder_stage_t
+stage_timer_enter(struct stage_timer *timer, encoder_stage_t stage)
+{
+    const encoder_stage_t previous = timer->stage;
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    timer->seconds[previous] +=
+        (double)(now.tv_sec - timer->entered.tv_sec) +
+        (double)(now.tv_nsec - timer->entered.tv_nsec) / 1e9;
+    timer->entered = now;
+    timer->stage = stage;
+    return previous;
+}
+
+#ifndef STANDALONE
+
+/*works like bw_open_external, but charges the time spent
+  in the stream's functions to the timer's STAGE_IO stage*/
+BitstreamWriter*
+bw_open_timed(void* user_data,
+              bs_endianness endianness,
+              unsigned buffer_size,
+              ext_write_f write,
+              ext_setpos_f setpos,
+              ext_getpos_f getpos,
+              ext_free_pos_f free_pos,
+              ext_seek_f seek,
+              ext_flush_f flush,
+              ext_close_f close,
+              ext_free_f free,
+              struct stage_timer *timer);
+
+/*works like bw_open, but charges the time spent
+  passing bytes to the file to the timer's STAGE_IO stage*/
+BitstreamWriter*
+bw_open_timed_file(FILE *file,
+                   bs_endianness endianness,
+                   struct stage_timer *timer);
+
+/*returns a dict of the timer's stage names and seconds
+  or NULL with an exception on error*/
+PyObject*
+stage_timer_dict(const struct stage_timer *timer);
+
+/*returns a list of the given histogram's counts
+  or NULL with an exception on error*/
+PyObject*
+histogram_list(unsigned bins, const unsigned histogram[]);
+
+#endif
+
+#endif
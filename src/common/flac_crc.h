@@ -27,3 +27,12 @@ flac_crc8(uint8_t byte, uint8_t *checksum);
 
 void
 flac_crc16(uint8_t byte, uint16_t *checksum);
+
+/*given "size" bytes of data and the previous checksum value,
+  assigns a new checksum to that value*/
+
+void
+flac_crc8_span(const uint8_t *data, unsigned size, uint8_t *checksum);
+
+void
+flac_crc16_span(const uint8_t *data, unsigned size, uint16_t *checksum);
@@ -21,3 +21,6 @@
 
 void
 tta_crc32(uint8_t byte, uint32_t *checksum);
+
+void
+tta_crc32_span(const uint8_t *data, unsigned size, uint32_t *checksum);
@@ -38,6 +38,9 @@ extern PyTypeObject decoders_OpusDecoderType;
 #endif
 extern PyTypeObject decoders_TTADecoderType;
 extern PyTypeObject decoders_MPCDecoderType;
+extern PyTypeObject decoders_WaveDecoderType;
+extern PyTypeObject decoders_AiffDecoderType;
+extern PyTypeObject decoders_AuDecoderType;
 extern PyTypeObject decoders_Sine_Mono_Type;
 extern PyTypeObject decoders_Sine_Stereo_Type;
 extern PyTypeObject decoders_Sine_Simple_Type;
@@ -89,6 +92,18 @@ MOD_INIT(decoders)
     if (PyType_Ready(&decoders_MPCDecoderType) < 0)
         return MOD_ERROR_VAL;
 
+    decoders_WaveDecoderType.tp_new = PyType_GenericNew;
+    if (PyType_Ready(&decoders_WaveDecoderType) < 0)
+        return MOD_ERROR_VAL;
+
+    decoders_AiffDecoderType.tp_new = PyType_GenericNew;
+    if (PyType_Ready(&decoders_AiffDecoderType) < 0)
+        return MOD_ERROR_VAL;
+
+    decoders_AuDecoderType.tp_new = PyType_GenericNew;
+    if (PyType_Ready(&decoders_AuDecoderType) < 0)
+        return MOD_ERROR_VAL;
+
     decoders_Sine_Mono_Type.tp_new = PyType_GenericNew;
     if (PyType_Ready(&decoders_Sine_Mono_Type) < 0)
         return MOD_ERROR_VAL;
@@ -145,6 +160,18 @@ MOD_INIT(decoders)
     PyModule_AddObject(m, "MPCDecoder",
                        (PyObject *)&decoders_MPCDecoderType);
 
+    Py_INCREF(&decoders_WaveDecoderType);
+    PyModule_AddObject(m, "WaveDecoder",
+                       (PyObject *)&decoders_WaveDecoderType);
+
+    Py_INCREF(&decoders_AiffDecoderType);
+    PyModule_AddObject(m, "AiffDecoder",
+                       (PyObject *)&decoders_AiffDecoderType);
+
+    Py_INCREF(&decoders_AuDecoderType);
+    PyModule_AddObject(m, "AuDecoder",
+                       (PyObject *)&decoders_AuDecoderType);
+
     Py_INCREF(&decoders_Sine_Mono_Type);
     PyModule_AddObject(m, "Sine_Mono",
                        (PyObject *)&decoders_Sine_Mono_Type);
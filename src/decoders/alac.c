@@ -426,6 +426,66 @@ ALACDecoder_read(decoders_ALACDecoder* self, PyObject *args)
     return (PyObject*)framelist;
 }
 
+static unsigned
+ALACDecoder_pcm_block_size(PyObject *obj)
+{
+    decoders_ALACDecoder *self = (decoders_ALACDecoder*)obj;
+
+    return self->params.block_size;
+}
+
+static int
+ALACDecoder_pcm_read(PyObject *obj, int *pcm_data, unsigned *pcm_frames)
+{
+    decoders_ALACDecoder *self = (decoders_ALACDecoder*)obj;
+    status_t status;
+    unsigned pcm_frames_read;
+
+    if (self->closed) {
+        PyErr_SetString(PyExc_ValueError, "cannot read closed stream");
+        return 1;
+    }
+
+    if (self->read_pcm_frames >= self->total_pcm_frames) {
+        *pcm_frames = 0;
+        return 0;
+    }
+
+    if (!setjmp(*br_try(self->bitstream))) {
+        status = decode_frameset(self, &pcm_frames_read, pcm_data);
+        br_etry(self->bitstream);
+    } else {
+        br_etry(self->bitstream);
+        PyErr_SetString(PyExc_IOError, "I/O error reading stream");
+        return 1;
+    }
+
+    if (status != OK) {
+        PyErr_SetString(alac_exception(status), alac_strerror(status));
+        return 1;
+    }
+
+    reorder_channels(pcm_frames_read, self->channels, pcm_data);
+
+    self->read_pcm_frames += pcm_frames_read;
+
+    *pcm_frames = pcm_frames_read;
+    return 0;
+}
+
+static const struct pcm_source ALACDecoder_source = {
+    ALACDecoder_pcm_block_size,
+    ALACDecoder_pcm_read
+};
+
+static PyObject*
+ALACDecoder_pcm_source(decoders_ALACDecoder *self, void *closure)
+{
+    return pcm_source_capsule((PyObject*)self,
+                              &decoders_ALACDecoderType,
+                              &ALACDecoder_source);
+}
+
 static PyObject*
 ALACDecoder_seek(decoders_ALACDecoder* self, PyObject *args)
 {
@@ -87,6 +87,9 @@ ALACDecoder_channels(decoders_ALACDecoder *self, void *closure);
 static PyObject*
 ALACDecoder_channel_mask(decoders_ALACDecoder *self, void *closure);
 
+static PyObject*
+ALACDecoder_pcm_source(decoders_ALACDecoder *self, void *closure);
+
 static PyObject*
 ALACDecoder_read(decoders_ALACDecoder* self, PyObject *args);
 
@@ -111,6 +114,8 @@ PyGetSetDef ALACDecoder_getseters[] = {
      (getter)ALACDecoder_channels, NULL, "channels", NULL},
     {"channel_mask",
      (getter)ALACDecoder_channel_mask, NULL, "channel_mask", NULL},
+    {"_pcm_source",
+     (getter)ALACDecoder_pcm_source, NULL, "native PCM source", NULL},
     {NULL}
 };
 
@@ -42,7 +42,8 @@ typedef enum {OK,
               BLOCK_SIZE_MISMATCH,
               SAMPLE_RATE_MISMATCH,
               BPS_MISMATCH,
-              CHANNEL_COUNT_MISMATCH} status_t;
+              CHANNEL_COUNT_MISMATCH,
+              CRC16_MISMATCH} status_t;
 
 typedef enum {INDEPENDENT,
               LEFT_DIFFERENCE,
@@ -172,6 +173,22 @@ read_residual_block(BitstreamReader *r,
 static status_t
 read_crc16(BitstreamReader *r);
 
+/*reads the next frame's header to "frame_header"
+  and its decoded samples to "samples",
+  which must hold at least the stream's maximum block size
+  times its channel count,
+  then checks its CRC-16 and returns OK or some error
+
+  this doesn't touch any Python objects other than through
+  the stream's read callback, so the GIL may be released around it*/
+#ifndef STANDALONE
+static status_t
+decode_frame(BitstreamReader *r,
+             const struct STREAMINFO *streaminfo,
+             struct frame_header *frame_header,
+             int samples[]);
+#endif
+
 static void
 decorrelate_left_difference(unsigned block_size,
                             const int left[],
@@ -231,6 +248,15 @@ static int
 verify_md5sum(audiotools__MD5Context *stream_md5,
               const uint8_t streaminfo_md5[]);
 
+/*returns 1 if the next bits in the stream are a frame sync code,
+  0 if at end of stream or some non-frame data
+  without consuming anything from the stream
+
+  this is used for streams whose STREAMINFO has 0 total samples,
+  which indicates the stream's length was unknown at encoding time*/
+static int
+frame_follows(BitstreamReader *r);
+
 #ifndef STANDALONE
 PyObject*
 flac_exception(status_t status);
@@ -502,13 +528,15 @@ FlacDecoder_read(decoders_FlacDecoder* self, PyObject *args)
 {
     status_t status;
     struct frame_header frame_header;
-    uint16_t crc16 = 0;
+    pcm_FrameList *framelist;
 
     if (self->closed) {
         /*ensure file isn't closed*/
         PyErr_SetString(PyExc_ValueError, "cannot read closed stream");
         return NULL;
-    } else if (self->remaining_samples == 0) {
+    } else if ((self->remaining_samples == 0) &&
+               (self->streaminfo.total_samples ||
+                !frame_follows(self->bitstream))) {
         /*validate MD5 sum if still validating
           (if we haven't seeked to the middle of the file, for instance)*/
         if (self->perform_validation) {
@@ -530,64 +558,44 @@ FlacDecoder_read(decoders_FlacDecoder* self, PyObject *args)
         }
     }
 
-    self->bitstream->add_callback(self->bitstream,
-                                  (bs_callback_f)flac_crc16,
-                                  &crc16);
-
-    /*ensure frame header is read successfully*/
-    if ((status = read_frame_header(self->bitstream,
-                                    &(self->streaminfo),
-                                    &frame_header)) != OK) {
-        self->bitstream->pop_callback(self->bitstream, NULL);
+    /*setup framelist large enough for any frame in the stream
+      since decode_frame() reads the frame's actual size from its header
+      (which must match STREAMINFO's channel count and bits-per-sample)*/
+    framelist = new_FrameList(self->audiotools_pcm,
+                              self->streaminfo.channel_count,
+                              self->streaminfo.bits_per_sample,
+                              self->streaminfo.maximum_block_size);
+
+    if ((status = decode_frame(self->bitstream,
+                               &(self->streaminfo),
+                               &frame_header,
+                               framelist->samples)) != OK) {
+        Py_DECREF((PyObject*)framelist);
         PyErr_SetString(flac_exception(status), flac_strerror(status));
         return NULL;
-    } else {
-        /*setup framelist to be output once populated*/
-        pcm_FrameList *framelist = new_FrameList(self->audiotools_pcm,
-                                                 frame_header.channel_count,
-                                                 frame_header.bits_per_sample,
-                                                 frame_header.block_size);
-
-        /*decode subframes based on channel assignment*/
-        decode_f decode = get_decoder(frame_header.channel_assignment);
-        assert(decode);
-
-        if ((status = decode(self->bitstream,
-                             &frame_header,
-                             framelist->samples)) != OK) {
-            Py_DECREF((PyObject*)framelist);
-            self->bitstream->pop_callback(self->bitstream, NULL);
-            PyErr_SetString(flac_exception(status), flac_strerror(status));
-            return NULL;
-        }
+    }
 
-        /*validate CRC-16 in frame footer*/
-        status = read_crc16(self->bitstream);
-        self->bitstream->pop_callback(self->bitstream, NULL);
-        if (status != OK) {
-            PyErr_SetString(flac_exception(status), flac_strerror(status));
-            Py_DECREF((PyObject*)framelist);
-            return NULL;
-        } else if (crc16) {
-            PyErr_SetString(PyExc_ValueError, "frame CRC-16 mismatch");
-            Py_DECREF((PyObject*)framelist);
-            return NULL;
-        }
+    /*then shrink it to the frame's actual size*/
+    if (frame_header.block_size < framelist->frames) {
+        framelist->frames = frame_header.block_size;
+        framelist->samples =
+            realloc(framelist->samples,
+                    sizeof(int) * FrameList_samples_length(framelist));
+    }
 
-        /*if validating, update running MD5 sum*/
-        if (self->perform_validation) {
-            update_md5sum(&(self->md5),
-                          framelist->samples,
-                          frame_header.channel_count,
-                          frame_header.bits_per_sample,
-                          frame_header.block_size);
-        }
+    /*if validating, update running MD5 sum*/
+    if (self->perform_validation) {
+        update_md5sum(&(self->md5),
+                      framelist->samples,
+                      frame_header.channel_count,
+                      frame_header.bits_per_sample,
+                      frame_header.block_size);
+    }
 
-        self->remaining_samples -= MIN(self->remaining_samples,
-                                       frame_header.block_size);
+    self->remaining_samples -= MIN(self->remaining_samples,
+                                   frame_header.block_size);
 
-        return (PyObject*)framelist;
-    }
+    return (PyObject*)framelist;
 }
 
 static PyObject*
@@ -603,7 +611,9 @@ FlacDecoder_frame_size(decoders_FlacDecoder* self, PyObject *args)
         /*ensure file isn't closed*/
         PyErr_SetString(PyExc_ValueError, "cannot read closed stream");
         return NULL;
-    } else if (self->remaining_samples == 0) {
+    } else if ((self->remaining_samples == 0) &&
+               (self->streaminfo.total_samples ||
+                !frame_follows(self->bitstream))) {
         /*return None if samples are exhausted*/
         Py_INCREF(Py_None);
         return Py_None;
@@ -611,9 +621,9 @@ FlacDecoder_frame_size(decoders_FlacDecoder* self, PyObject *args)
 
     self->perform_validation = 0;
 
-    self->bitstream->add_callback(self->bitstream,
-                                  (bs_callback_f)flac_crc16,
-                                  &crc16);
+    self->bitstream->add_span_callback(self->bitstream,
+                                       (bs_span_callback_f)flac_crc16_span,
+                                       &crc16);
 
     self->bitstream->add_callback(self->bitstream,
                                   (bs_callback_f)byte_counter,
@@ -708,6 +718,164 @@ FlacDecoder_frame_size(decoders_FlacDecoder* self, PyObject *args)
     return Py_BuildValue("(I, I)", frame_size, frame_header.block_size);
 }
 
+static PyObject*
+FlacDecoder_verify(decoders_FlacDecoder* self, PyObject *args)
+{
+    PyObject *progress = Py_None;
+    int *samples;
+    uint64_t pcm_frames = 0;
+    status_t status = OK;
+
+    if (self->closed) {
+        PyErr_SetString(PyExc_ValueError, "cannot read closed stream");
+        return NULL;
+    }
+
+    if (!PyArg_ParseTuple(args, "|O", &progress))
+        return NULL;
+
+    /*a single buffer is reused for every frame
+      rather than building a FrameList for each*/
+    samples = malloc(self->streaminfo.maximum_block_size *
+                     self->streaminfo.channel_count *
+                     sizeof(int));
+
+    while (!((self->remaining_samples == 0) &&
+             (self->streaminfo.total_samples ||
+              !frame_follows(self->bitstream)))) {
+        struct frame_header frame_header;
+
+        Py_BEGIN_ALLOW_THREADS
+        if (((status = decode_frame(self->bitstream,
+                                    &(self->streaminfo),
+                                    &frame_header,
+                                    samples)) == OK) &&
+            self->perform_validation) {
+            update_md5sum(&(self->md5),
+                          samples,
+                          frame_header.channel_count,
+                          frame_header.bits_per_sample,
+                          frame_header.block_size);
+        }
+        Py_END_ALLOW_THREADS
+
+        if (status != OK) {
+            /*stop at the first bad frame
+              since the rest of the stream can't be trusted*/
+            free(samples);
+            self->perform_validation = 0;
+            return Py_BuildValue("(K, K, s)",
+                                 (unsigned long long)pcm_frames,
+                                 (unsigned long long)pcm_frames,
+                                 flac_strerror(status));
+        }
+
+        pcm_frames += frame_header.block_size;
+        self->remaining_samples -= MIN(self->remaining_samples,
+                                       frame_header.block_size);
+
+        if (progress != Py_None) {
+            PyObject *result = PyObject_CallFunction(
+                progress, "K", (unsigned long long)pcm_frames);
+            if (result == NULL) {
+                free(samples);
+                return NULL;
+            } else {
+                Py_DECREF(result);
+            }
+        }
+    }
+
+    free(samples);
+
+    if (self->perform_validation) {
+        self->perform_validation = 0;
+        if (!verify_md5sum(&(self->md5), self->streaminfo.MD5)) {
+            /*no particular frame is at fault*/
+            return Py_BuildValue("(K, O, s)",
+                                 (unsigned long long)pcm_frames,
+                                 Py_None,
+                                 "MD5 mismatch at end of stream");
+        }
+    }
+
+    return Py_BuildValue("(K, O, O)",
+                         (unsigned long long)pcm_frames,
+                         Py_None,
+                         Py_None);
+}
+
+static unsigned
+FlacDecoder_pcm_block_size(PyObject *obj)
+{
+    decoders_FlacDecoder *self = (decoders_FlacDecoder*)obj;
+
+    return self->streaminfo.maximum_block_size;
+}
+
+static int
+FlacDecoder_pcm_read(PyObject *obj, int *pcm_data, unsigned *pcm_frames)
+{
+    decoders_FlacDecoder *self = (decoders_FlacDecoder*)obj;
+    struct frame_header frame_header;
+    status_t status;
+
+    if (self->closed) {
+        PyErr_SetString(PyExc_ValueError, "cannot read closed stream");
+        return 1;
+    } else if ((self->remaining_samples == 0) &&
+               (self->streaminfo.total_samples ||
+                !frame_follows(self->bitstream))) {
+        /*validate MD5 sum at end of stream, as read() does*/
+        if (self->perform_validation) {
+            if (verify_md5sum(&(self->md5), self->streaminfo.MD5)) {
+                self->perform_validation = 0;
+            } else {
+                PyErr_SetString(PyExc_ValueError,
+                                "MD5 mismatch at end of stream");
+                return 1;
+            }
+        }
+        *pcm_frames = 0;
+        return 0;
+    }
+
+    if ((status = decode_frame(self->bitstream,
+                               &(self->streaminfo),
+                               &frame_header,
+                               pcm_data)) != OK) {
+        PyErr_SetString(flac_exception(status), flac_strerror(status));
+        return 1;
+    }
+
+    if (self->perform_validation) {
+        update_md5sum(&(self->md5),
+                      pcm_data,
+                      frame_header.channel_count,
+                      frame_header.bits_per_sample,
+                      frame_header.block_size);
+    }
+
+    self->remaining_samples -= MIN(self->remaining_samples,
+                                   frame_header.block_size);
+
+    *pcm_frames = frame_header.block_size;
+    return 0;
+}
+
+static const struct pcm_source FlacDecoder_source = {
+    FlacDecoder_pcm_block_size,
+    FlacDecoder_pcm_read
+};
+
+static PyObject*
+FlacDecoder_pcm_source(decoders_FlacDecoder *self, void *closure)
+{
+    return pcm_source_capsule((PyObject*)self,
+                              &decoders_FlacDecoderType,
+                              &FlacDecoder_source);
+}
+
 static PyObject*
 FlacDecoder_seek(decoders_FlacDecoder* self, PyObject *args)
 {
@@ -890,7 +1058,7 @@ read_frame_header(BitstreamReader *r,
     if (!setjmp(*br_try(r))) {
         status_t status;
 
-        r->add_callback(r, (bs_callback_f)flac_crc8, &crc8);
+        r->add_span_callback(r, (bs_span_callback_f)flac_crc8_span, &crc8);
         if (r->read(r, 14) != 0x3FFE) {
             br_etry(r);
             return INVALID_SYNC_CODE;
@@ -1497,6 +1665,41 @@ read_residual_block(BitstreamReader *r,
     return OK;
 }
 
+#ifndef STANDALONE
+static status_t
+decode_frame(BitstreamReader *r,
+             const struct STREAMINFO *streaminfo,
+             struct frame_header *frame_header,
+             int samples[])
+{
+    status_t status;
+    uint16_t crc16 = 0;
+
+    r->add_span_callback(r, (bs_span_callback_f)flac_crc16_span, &crc16);
+
+    if ((status = read_frame_header(r, streaminfo, frame_header)) != OK) {
+        r->pop_callback(r, NULL);
+        return status;
+    }
+
+    if ((status = get_decoder(frame_header->channel_assignment)(
+             r, frame_header, samples)) != OK) {
+        r->pop_callback(r, NULL);
+        return status;
+    }
+
+    status = read_crc16(r);
+    r->pop_callback(r, NULL);
+    if (status != OK) {
+        return status;
+    } else if (crc16) {
+        return CRC16_MISMATCH;
+    } else {
+        return OK;
+    }
+}
+#endif
+
 static status_t
 read_crc16(BitstreamReader *r)
 {
@@ -1722,6 +1925,25 @@ update_md5sum(audiotools__MD5Context *md5sum,
     audiotools__MD5Update(md5sum, buffer, buffer_size);
 }
 
+static int
+frame_follows(BitstreamReader *r)
+{
+    br_pos_t *pos = r->getpos(r);
+    int sync_found;
+
+    if (!setjmp(*br_try(r))) {
+        sync_found = (r->read(r, 14) == 0x3FFE);
+        br_etry(r);
+    } else {
+        br_etry(r);
+        sync_found = 0;
+    }
+
+    r->setpos(r, pos);
+    pos->del(pos);
+    return sync_found;
+}
+
 static int
 verify_md5sum(audiotools__MD5Context *stream_md5,
               const uint8_t streaminfo_md5[])
@@ -1754,6 +1976,7 @@ flac_exception(status_t status)
     case SAMPLE_RATE_MISMATCH:
     case BPS_MISMATCH:
     case CHANNEL_COUNT_MISMATCH:
+    case CRC16_MISMATCH:
         return PyExc_ValueError;
     case IOERROR_HEADER:
     case IOERROR_SUBFRAME:
@@ -1809,6 +2032,8 @@ flac_strerror(status_t status)
         return "frame header bits-per-sample mismatch";
     case CHANNEL_COUNT_MISMATCH:
         return "frame header channel count mismatch";
+    case CRC16_MISMATCH:
+        return "frame CRC-16 mismatch";
     }
 }
 
@@ -1890,7 +2115,9 @@ main(int argc, char *argv[])
         status_t status;
         uint16_t crc16 = 0;
 
-        input->add_callback(input, (bs_callback_f)flac_crc16, &crc16);
+        input->add_span_callback(input,
+                                 (bs_span_callback_f)flac_crc16_span,
+                                 &crc16);
 
         /*read header*/
         if ((status =
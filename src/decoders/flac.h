@@ -81,6 +81,9 @@ FlacDecoder_channels(decoders_FlacDecoder *self, void *closure);
 static PyObject*
 FlacDecoder_channel_mask(decoders_FlacDecoder *self, void *closure);
 
+static PyObject*
+FlacDecoder_pcm_source(decoders_FlacDecoder *self, void *closure);
+
 static PyObject*
 FlacDecoder_read(decoders_FlacDecoder* self, PyObject *args);
 
@@ -90,6 +93,9 @@ FlacDecoder_frame_size(decoders_FlacDecoder* self, PyObject *args);
 static PyObject*
 FlacDecoder_seek(decoders_FlacDecoder* self, PyObject *args);
 
+static PyObject*
+FlacDecoder_verify(decoders_FlacDecoder* self, PyObject *args);
+
 static PyObject*
 FlacDecoder_close(decoders_FlacDecoder* self, PyObject *args);
 
@@ -109,6 +115,8 @@ PyGetSetDef FlacDecoder_getseters[] = {
      (getter)FlacDecoder_channels, NULL, "channels", NULL},
     {"channel_mask",
      (getter)FlacDecoder_channel_mask, NULL, "channel mask", NULL},
+    {"_pcm_source",
+     (getter)FlacDecoder_pcm_source, NULL, "native PCM source", NULL},
     {NULL}
 };
 
@@ -119,6 +127,11 @@ PyMethodDef FlacDecoder_methods[] = {
      METH_VARARGS, "seek(desired_pcm_offset) -> actual_pcm_offset"},
     {"frame_size", (PyCFunction)FlacDecoder_frame_size,
      METH_NOARGS, "frame_size() -> (byte_length, pcm_frame_count)"},
+    {"verify", (PyCFunction)FlacDecoder_verify,
+     METH_VARARGS,
+     "verify(progress=None) -> (pcm_frames, bad_frame_offset, error)\n"
+     "decodes the rest of the stream checking CRC-16s and MD5 sum\n"
+     "where error is None if no problems are found"},
     {"close", (PyCFunction)FlacDecoder_close,
      METH_NOARGS, "close() -> None"},
     {"__enter__", (PyCFunction)FlacDecoder_enter,
@@ -175,7 +175,9 @@ OggFlacDecoder_read(decoders_OggFlacDecoder *self, PyObject *args) {
         /*decode the next FrameList from the stream*/
 
         uint16_t crc16 = 0;
-        packet->add_callback(packet, (bs_callback_f)flac_crc16, &crc16);
+        packet->add_span_callback(packet,
+                                  (bs_span_callback_f)flac_crc16_span,
+                                  &crc16);
 
         if (!setjmp(*br_try(packet))) {
             /*read frame header*/
@@ -505,7 +507,9 @@ int main(int argc, char* argv[]) {
     /*decode the next FrameList from the stream*/
     packet = oggiterator_next_packet(ogg_packets, BS_BIG_ENDIAN, &result);
     /*add callback for CRC16 calculation*/
-    packet->add_callback(packet, (bs_callback_f)flac_crc16, &crc16);
+    packet->add_span_callback(packet,
+                              (bs_span_callback_f)flac_crc16_span,
+                              &crc16);
 
     while (result != OGG_STREAM_FINISHED) {
         if (result == OGG_OK) {
@@ -0,0 +1,978 @@
+#include "pcmfile.h"
+#include "../bitstream.h"
+#include "../framelist.h"
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#define HAS_MMAP
+#endif
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+/*the most PCM frames returned by each read from the native PCM source*/
+#define PCMFILE_BLOCK_SIZE 4096
+
+typedef enum {
+    OK,
+    TRUNCATED_DATA,
+    IO_ERROR,
+    MEMORY_ERROR
+} status_t;
+
+/*parses a file's header from "reader" which is at the start of the file
+  and places its attributes in "header"
+
+  returns NULL on success or an error message if the header is invalid,
+  and may call br_abort() if the header ends prematurely*/
+typedef const char*
+(*parse_header_f)(BitstreamReader *reader,
+                  uint64_t file_size,
+                  struct pcmfile_header *header);
+
+struct pcmfile_format {
+    bs_endianness endianness;
+    parse_header_f parse_header;
+
+    /*the error raised if the header ends prematurely*/
+    const char *invalid_error;
+
+    /*the error raised if the PCM data ends prematurely*/
+    const char *truncated_error;
+};
+
+/*******************************
+ * private function signatures *
+ *******************************/
+
+static const char*
+parse_wave_header(BitstreamReader *reader,
+                  uint64_t file_size,
+                  struct pcmfile_header *header);
+
+static const char*
+parse_aiff_header(BitstreamReader *reader,
+                  uint64_t file_size,
+                  struct pcmfile_header *header);
+
+static const char*
+parse_au_header(BitstreamReader *reader,
+                uint64_t file_size,
+                struct pcmfile_header *header);
+
+static const struct pcmfile_format wave_format = {
+    BS_LITTLE_ENDIAN,
+    parse_wave_header,
+    "invalid RIFF WAVE file",
+    "premature end of data chunk"
+};
+
+static const struct pcmfile_format aiff_format = {
+    BS_BIG_ENDIAN,
+    parse_aiff_header,
+    "invalid AIFF file",
+    "premature end of SSND chunk"
+};
+
+static const struct pcmfile_format au_format = {
+    BS_BIG_ENDIAN,
+    parse_au_header,
+    "invalid Sun AU header",
+    "truncated data block"
+};
+
+/*opens the named file, parses its header with the given format
+  and readies the decoder for reading
+
+  returns 0 on success, or -1 with a Python exception set*/
+static int
+open_pcmfile(decoders_PCMFileDecoder *self,
+             PyObject *args,
+             PyTypeObject *type,
+             const struct pcmfile_format *format);
+
+/*returns nonzero if all 4 bytes of the chunk ID are printable ASCII*/
+static int
+valid_chunk_id(const uint8_t chunk_id[4]);
+
+/*returns the whole PCM frames in the header's PCM data*/
+static uint64_t
+data_pcm_frames(const struct pcmfile_header *header);
+
+/*converts "pcm_frames" PCM frames starting at the current PCM frame
+  to "samples", which must hold at least pcm_frames * channels values
+
+  this does not update the current PCM frame*/
+static status_t
+read_pcm_frames(decoders_PCMFileDecoder *self,
+                unsigned pcm_frames,
+                int *samples);
+
+/*sets a Python exception for the given status*/
+static void
+set_read_error(decoders_PCMFileDecoder *self, status_t status);
+
+/*releases the mapped region and any open file*/
+static void
+close_pcmfile(decoders_PCMFileDecoder *self);
+
+/***********************************
+ * public function implementations *
+ ***********************************/
+
+PyObject*
+PCMFileDecoder_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    decoders_PCMFileDecoder *self;
+
+    self = (decoders_PCMFileDecoder *)type->tp_alloc(type, 0);
+
+    return (PyObject *)self;
+}
+
+int
+WaveDecoder_init(decoders_PCMFileDecoder *self,
+                 PyObject *args,
+                 PyObject *kwds)
+{
+    return open_pcmfile(self, args, &decoders_WaveDecoderType, &wave_format);
+}
+
+int
+AiffDecoder_init(decoders_PCMFileDecoder *self,
+                 PyObject *args,
+                 PyObject *kwds)
+{
+    return open_pcmfile(self, args, &decoders_AiffDecoderType, &aiff_format);
+}
+
+int
+AuDecoder_init(decoders_PCMFileDecoder *self,
+               PyObject *args,
+               PyObject *kwds)
+{
+    return open_pcmfile(self, args, &decoders_AuDecoderType, &au_format);
+}
+
+void
+PCMFileDecoder_dealloc(decoders_PCMFileDecoder *self)
+{
+    close_pcmfile(self);
+    free(self->buffer);
+    Py_XDECREF(self->audiotools_pcm);
+
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static PyObject*
+PCMFileDecoder_sample_rate(decoders_PCMFileDecoder *self, void *closure)
+{
+    return Py_BuildValue("I", self->header.sample_rate);
+}
+
+static PyObject*
+PCMFileDecoder_bits_per_sample(decoders_PCMFileDecoder *self, void *closure)
+{
+    return Py_BuildValue("I", self->header.bits_per_sample);
+}
+
+static PyObject*
+PCMFileDecoder_channels(decoders_PCMFileDecoder *self, void *closure)
+{
+    return Py_BuildValue("I", self->header.channels);
+}
+
+static PyObject*
+PCMFileDecoder_channel_mask(decoders_PCMFileDecoder *self, void *closure)
+{
+    return Py_BuildValue("I", self->header.channel_mask);
+}
+
+static PyObject*
+PCMFileDecoder_total_pcm_frames(decoders_PCMFileDecoder *self,
+                                void *closure)
+{
+    return Py_BuildValue("K",
+                         (unsigned long long)self->header.total_pcm_frames);
+}
+
+static PyObject*
+PCMFileDecoder_read(decoders_PCMFileDecoder *self, PyObject *args)
+{
+    int pcm_frames;
+    uint64_t remaining_pcm_frames;
+    unsigned requested_pcm_frames;
+    pcm_FrameList *framelist;
+    status_t status;
+
+    if (self->closed) {
+        PyErr_SetString(PyExc_ValueError, "cannot read closed stream");
+        return NULL;
+    }
+
+    if (!PyArg_ParseTuple(args, "i", &pcm_frames))
+        return NULL;
+
+    remaining_pcm_frames =
+        self->header.total_pcm_frames - self->current_pcm_frame;
+
+    if (remaining_pcm_frames == 0) {
+        return empty_FrameList(self->audiotools_pcm,
+                               self->header.channels,
+                               self->header.bits_per_sample);
+    }
+
+    /*try to read requested PCM frames or remaining frames*/
+    requested_pcm_frames = pcm_frames < 1 ? 1 : (unsigned)pcm_frames;
+    if (requested_pcm_frames > remaining_pcm_frames) {
+        requested_pcm_frames = (unsigned)remaining_pcm_frames;
+    }
+
+    framelist = new_FrameList(self->audiotools_pcm,
+                              self->header.channels,
+                              self->header.bits_per_sample,
+                              requested_pcm_frames);
+    if (framelist == NULL) {
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    status = read_pcm_frames(self, requested_pcm_frames, framelist->samples);
+    Py_END_ALLOW_THREADS
+
+    if (status == OK) {
+        self->current_pcm_frame += requested_pcm_frames;
+        return (PyObject*)framelist;
+    } else {
+        Py_DECREF((PyObject*)framelist);
+        set_read_error(self, status);
+        return NULL;
+    }
+}
+
+static unsigned
+PCMFileDecoder_pcm_block_size(PyObject *obj)
+{
+    return PCMFILE_BLOCK_SIZE;
+}
+
+static int
+PCMFileDecoder_pcm_read(PyObject *obj, int *pcm_data, unsigned *pcm_frames)
+{
+    decoders_PCMFileDecoder *self = (decoders_PCMFileDecoder*)obj;
+    uint64_t remaining_pcm_frames;
+    unsigned block_size;
+    status_t status;
+
+    if (self->closed) {
+        PyErr_SetString(PyExc_ValueError, "cannot read closed stream");
+        return 1;
+    }
+
+    remaining_pcm_frames =
+        self->header.total_pcm_frames - self->current_pcm_frame;
+
+    if (remaining_pcm_frames == 0) {
+        *pcm_frames = 0;
+        return 0;
+    }
+
+    block_size = remaining_pcm_frames < PCMFILE_BLOCK_SIZE ?
+                 (unsigned)remaining_pcm_frames : PCMFILE_BLOCK_SIZE;
+
+    if ((status = read_pcm_frames(self, block_size, pcm_data)) == OK) {
+        self->current_pcm_frame += block_size;
+        *pcm_frames = block_size;
+        return 0;
+    } else {
+        set_read_error(self, status);
+        return 1;
+    }
+}
+
+static const struct pcm_source PCMFileDecoder_source = {
+    PCMFileDecoder_pcm_block_size,
+    PCMFileDecoder_pcm_read
+};
+
+static PyObject*
+PCMFileDecoder_pcm_source(decoders_PCMFileDecoder *self, void *closure)
+{
+    if (self->type == NULL) {
+        /*init wasn't called successfully*/
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+
+    return pcm_source_capsule((PyObject*)self,
+                              self->type,
+                              &PCMFileDecoder_source);
+}
+
+static PyObject*
+PCMFileDecoder_seek(decoders_PCMFileDecoder *self, PyObject *args)
+{
+    long long seeked_offset;
+
+    if (self->closed) {
+        PyErr_SetString(PyExc_ValueError, "cannot seek closed stream");
+        return NULL;
+    }
+
+    if (!PyArg_ParseTuple(args, "L", &seeked_offset))
+        return NULL;
+
+    if (seeked_offset < 0) {
+        PyErr_SetString(PyExc_ValueError, "cannot seek to negative value");
+        return NULL;
+    }
+
+    /*every PCM frame is the same size
+      so any frame can be seeked to directly,
+      though one can't walk off the end of the stream*/
+    if ((unsigned long long)seeked_offset > self->header.total_pcm_frames) {
+        self->current_pcm_frame = self->header.total_pcm_frames;
+    } else {
+        self->current_pcm_frame = (uint64_t)seeked_offset;
+    }
+
+    return Py_BuildValue("K", (unsigned long long)self->current_pcm_frame);
+}
+
+static PyObject*
+PCMFileDecoder_close(decoders_PCMFileDecoder *self, PyObject *args)
+{
+    self->closed = 1;
+
+    close_pcmfile(self);
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+static PyObject*
+PCMFileDecoder_enter(decoders_PCMFileDecoder *self, PyObject *args)
+{
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+static PyObject*
+PCMFileDecoder_exit(decoders_PCMFileDecoder *self, PyObject *args)
+{
+    self->closed = 1;
+
+    close_pcmfile(self);
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+/************************************
+ * private function implementations *
+ ************************************/
+
+static int
+open_pcmfile(decoders_PCMFileDecoder *self,
+             PyObject *args,
+             PyTypeObject *type,
+             const struct pcmfile_format *format)
+{
+    char *filename;
+    struct stat file_stat;
+    uint64_t file_size;
+    BitstreamReader *reader;
+    const char *error;
+
+    self->type = NULL;
+    self->map = NULL;
+    self->map_size = 0;
+    self->data = NULL;
+    self->file = NULL;
+    self->buffer = NULL;
+    self->buffer_size = 0;
+    self->audiotools_pcm = NULL;
+    self->closed = 1;
+
+    if (!PyArg_ParseTuple(args, "s", &filename))
+        return -1;
+
+    if ((self->file = fopen(filename, "rb")) == NULL) {
+        PyErr_SetFromErrnoWithFilename(PyExc_IOError, filename);
+        return -1;
+    }
+
+    if (fstat(fileno(self->file), &file_stat)) {
+        PyErr_SetFromErrnoWithFilename(PyExc_IOError, filename);
+        return -1;
+    } else {
+        file_size = (uint64_t)file_stat.st_size;
+    }
+
+    /*parse the file's header, leaving the FILE open afterward*/
+    reader = br_open(self->file, format->endianness);
+    memset(&self->header, 0, sizeof(struct pcmfile_header));
+    if (!setjmp(*br_try(reader))) {
+        error = format->parse_header(reader, file_size, &self->header);
+        br_etry(reader);
+    } else {
+        br_etry(reader);
+        error = format->invalid_error;
+    }
+    reader->free(reader);
+
+    if (error != NULL) {
+        PyErr_SetString(PyExc_ValueError, error);
+        return -1;
+    }
+
+    if (self->header.channels == 0) {
+        PyErr_SetString(PyExc_ValueError, format->invalid_error);
+        return -1;
+    }
+
+    switch (self->header.bits_per_sample) {
+    case 8:
+    case 16:
+    case 24:
+        break;
+    default:
+        PyErr_SetString(PyExc_ValueError, "unsupported bits per sample");
+        return -1;
+    }
+
+    self->bytes_per_pcm_frame =
+        (self->header.bits_per_sample / 8) * self->header.channels;
+    self->truncated_error = format->truncated_error;
+    self->converter = pcm_to_int_converter(self->header.bits_per_sample,
+                                           self->header.big_endian,
+                                           self->header.is_signed);
+
+    /*the header may claim more PCM data than the file holds*/
+    if (self->header.data_offset < file_size) {
+        const uint64_t remaining = file_size - self->header.data_offset;
+        self->data_available = remaining < self->header.data_size ?
+                               remaining : self->header.data_size;
+    } else {
+        self->data_available = 0;
+    }
+
+#ifdef HAS_MMAP
+    /*map the PCM data, falling back to reading the file
+      if it's too large for the address space or can't be mapped*/
+    if (self->data_available > 0) {
+        const uint64_t page_size = (uint64_t)sysconf(_SC_PAGESIZE);
+        const uint64_t map_offset =
+            self->header.data_offset - (self->header.data_offset % page_size);
+        const uint64_t map_size =
+            self->data_available + (self->header.data_offset - map_offset);
+
+        if ((map_size <= SIZE_MAX) && (map_offset <= LLONG_MAX)) {
+            void *map = mmap(NULL,
+                             (size_t)map_size,
+                             PROT_READ,
+                             MAP_PRIVATE,
+                             fileno(self->file),
+                             (off_t)map_offset);
+            if (map != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+                madvise(map, (size_t)map_size, MADV_SEQUENTIAL);
+#endif
+                self->map = map;
+                self->map_size = (size_t)map_size;
+                self->data = self->map +
+                    (self->header.data_offset - map_offset);
+
+                /*the mapping stays valid once the file is closed*/
+                fclose(self->file);
+                self->file = NULL;
+            }
+        }
+    }
+#endif
+
+    if ((self->audiotools_pcm = open_audiotools_pcm()) == NULL)
+        return -1;
+
+    self->type = type;
+    self->current_pcm_frame = 0;
+    self->closed = 0;
+
+    return 0;
+}
+
+static const char*
+parse_wave_header(BitstreamReader *reader,
+                  uint64_t file_size,
+                  struct pcmfile_header *header)
+{
+    uint8_t riff[4];
+    unsigned riff_size;
+    uint8_t wave[4];
+    int is_rf64;
+    int fmt_chunk_read = 0;
+    uint64_t rf64_data_size = 0;
+    uint64_t offset = 12;
+
+    reader->parse(reader, "4b 32u 4b", riff, &riff_size, wave);
+
+    if (!memcmp(riff, "RIFF", 4)) {
+        is_rf64 = 0;
+    } else if (!memcmp(riff, "RF64", 4)) {
+        /*an RF64 file's 32-bit sizes are placeholders
+          for the 64-bit sizes in its "ds64" chunk*/
+        is_rf64 = 1;
+    } else {
+        return "not a RIFF WAVE file";
+    }
+
+    if (memcmp(wave, "WAVE", 4)) {
+        return "invalid RIFF WAVE file";
+    }
+
+    /*walk through chunks until "data" chunk encountered*/
+    while ((offset + 8) <= file_size) {
+        uint8_t chunk_id[4];
+        unsigned chunk_size;
+
+        reader->parse(reader, "4b 32u", chunk_id, &chunk_size);
+        offset += 8;
+
+        if (!valid_chunk_id(chunk_id)) {
+            return "invalid RIFF WAVE chunk ID";
+        }
+
+        if (!memcmp(chunk_id, "fmt ", 4)) {
+            unsigned compression;
+            unsigned bytes_per_second;
+            unsigned block_align;
+
+            if (chunk_size < 16) {
+                return "invalid RIFF WAVE file";
+            }
+
+            reader->parse(reader, "16u 16u 32u 32u 16u 16u",
+                          &compression,
+                          &(header->channels),
+                          &(header->sample_rate),
+                          &bytes_per_second,
+                          &block_align,
+                          &(header->bits_per_sample));
+
+            if (compression == 1) {
+                /*if we have a multi-channel WAVE file
+                  that's not WAVE_FORMAT_EXTENSIBLE,
+                  assume the channels follow
+                  SMPTE/ITU-R recommendations
+                  and hope for the best*/
+                switch (header->channels) {
+                case 1:
+                    header->channel_mask = 0x4;
+                    break;
+                case 2:
+                    header->channel_mask = 0x3;
+                    break;
+                case 3:
+                    header->channel_mask = 0x7;
+                    break;
+                case 4:
+                    header->channel_mask = 0x33;
+                    break;
+                case 5:
+                    header->channel_mask = 0x37;
+                    break;
+                case 6:
+                    header->channel_mask = 0x3F;
+                    break;
+                default:
+                    header->channel_mask = 0;
+                    break;
+                }
+            } else if (compression == 0xFFFE) {
+                static const uint8_t PCM_SUB_FORMAT[16] =
+                    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00,
+                     0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+                unsigned cb_size;
+                unsigned valid_bits_per_sample;
+                uint8_t sub_format[16];
+
+                if (chunk_size < 40) {
+                    return "invalid RIFF WAVE file";
+                }
+
+                reader->parse(reader, "16u 16u 32u 16b",
+                              &cb_size,
+                              &valid_bits_per_sample,
+                              &(header->channel_mask),
+                              sub_format);
+
+                if (memcmp(sub_format, PCM_SUB_FORMAT, 16)) {
+                    return "invalid WAVE sub-format";
+                }
+            } else {
+                return "unsupported WAVE compression";
+            }
+
+            header->big_endian = 0;
+            header->is_signed = header->bits_per_sample > 8;
+            fmt_chunk_read = 1;
+        } else if (!memcmp(chunk_id, "ds64", 4) && is_rf64) {
+            uint64_t rf64_riff_size;
+            uint64_t rf64_sample_count;
+
+            if (chunk_size < 24) {
+                return "invalid RIFF WAVE file";
+            }
+
+            reader->parse(reader, "64U 64U 64U",
+                          &rf64_riff_size,
+                          &rf64_data_size,
+                          &rf64_sample_count);
+        } else if (!memcmp(chunk_id, "data", 4)) {
+            /*when "data" chunk encountered,
+              use its size to determine total PCM frames*/
+            if (!fmt_chunk_read) {
+                return "data chunk found before fmt";
+            }
+
+            header->data_offset = offset;
+            if (is_rf64 && (chunk_size == 0xFFFFFFFF)) {
+                header->data_size = rf64_data_size;
+            } else {
+                header->data_size = chunk_size;
+            }
+            header->total_pcm_frames = data_pcm_frames(header);
+            return NULL;
+        }
+
+        /*all other chunks are ignored*/
+        offset += chunk_size + (chunk_size % 2);
+        reader->seek(reader, (long)offset, BS_SEEK_SET);
+    }
+
+    /*raise an error if no "data" chunk is encountered*/
+    return "data chunk not found";
+}
+
+static const char*
+parse_aiff_header(BitstreamReader *reader,
+                  uint64_t file_size,
+                  struct pcmfile_header *header)
+{
+    uint8_t form[4];
+    unsigned total_size;
+    uint8_t aiff[4];
+    int is_aifc;
+    int comm_chunk_read = 0;
+    uint64_t offset = 12;
+
+    reader->parse(reader, "4b 32u 4b", form, &total_size, aiff);
+
+    if (memcmp(form, "FORM", 4)) {
+        return "not an AIFF file";
+    } else if (!memcmp(aiff, "AIFF", 4)) {
+        is_aifc = 0;
+    } else if (!memcmp(aiff, "AIFC", 4)) {
+        is_aifc = 1;
+    } else {
+        return "invalid AIFF file";
+    }
+
+    /*walk through chunks until "SSND" chunk encountered*/
+    while ((offset + 8) <= file_size) {
+        uint8_t chunk_id[4];
+        unsigned chunk_size;
+
+        reader->parse(reader, "4b 32u", chunk_id, &chunk_size);
+        offset += 8;
+
+        if (!valid_chunk_id(chunk_id)) {
+            return "invalid AIFF chunk ID";
+        }
+
+        if (!memcmp(chunk_id, "COMM", 4)) {
+            unsigned total_sample_frames;
+            unsigned sign;
+            unsigned exponent;
+            uint64_t mantissa;
+            double sample_rate;
+
+            if (chunk_size < (is_aifc ? 22 : 18)) {
+                return "invalid AIFF file";
+            }
+
+            reader->parse(reader, "16u 32u 16u 1u 15u 64U",
+                          &(header->channels),
+                          &total_sample_frames,
+                          &(header->bits_per_sample),
+                          &sign,
+                          &exponent,
+                          &mantissa);
+
+            /*the sample rate is an 80-bit IEEE extended value*/
+            if ((exponent == 0) && (mantissa == 0)) {
+                sample_rate = 0.0;
+            } else {
+                sample_rate = ldexp((double)mantissa,
+                                    (int)exponent - 16383 - 63);
+            }
+            if (sign || (sample_rate > UINT_MAX)) {
+                return "invalid AIFF file";
+            }
+
+            header->sample_rate = (unsigned)sample_rate;
+            header->total_pcm_frames = total_sample_frames;
+            header->big_endian = 1;
+            header->is_signed = 1;
+
+            switch (header->channels) {
+            case 1:
+                header->channel_mask = 0x4;
+                break;
+            case 2:
+                header->channel_mask = 0x3;
+                break;
+            default:
+                header->channel_mask = 0;
+                break;
+            }
+
+            if (is_aifc) {
+                /*AIFF-C files name their sample encoding
+                  which must be integer PCM in one byte order or the other*/
+                uint8_t compression[4];
+
+                reader->parse(reader, "4b", compression);
+
+                if (!memcmp(compression, "sowt", 4)) {
+                    header->big_endian = 0;
+                } else if (memcmp(compression, "NONE", 4) &&
+                           memcmp(compression, "twos", 4)) {
+                    return "unsupported AIFF-C compression";
+                }
+            }
+
+            comm_chunk_read = 1;
+        } else if (!memcmp(chunk_id, "SSND", 4)) {
+            /*when "SSND" chunk encountered,
+              skip past its "offset" and "block_size" fields
+              along with any padding the offset calls for*/
+            unsigned ssnd_offset;
+            unsigned block_size;
+
+            if (!comm_chunk_read) {
+                return "SSND chunk found before fmt";
+            } else if (chunk_size < 8) {
+                return "invalid AIFF chunk";
+            }
+
+            reader->parse(reader, "32u 32u", &ssnd_offset, &block_size);
+
+            if (ssnd_offset > (chunk_size - 8)) {
+                return "invalid AIFF chunk";
+            }
+
+            header->data_offset = offset + 8 + ssnd_offset;
+            header->data_size = chunk_size - 8 - ssnd_offset;
+            return NULL;
+        }
+
+        /*all other chunks are ignored*/
+        offset += chunk_size + (chunk_size % 2);
+        reader->seek(reader, (long)offset, BS_SEEK_SET);
+    }
+
+    /*raise an error if no "SSND" chunk is encountered*/
+    return "SSND chunk not found";
+}
+
+static const char*
+parse_au_header(BitstreamReader *reader,
+                uint64_t file_size,
+                struct pcmfile_header *header)
+{
+    uint8_t magic_number[4];
+    unsigned data_offset;
+    unsigned data_size;
+    unsigned encoding_format;
+
+    reader->parse(reader, "4b 5* 32u",
+                  magic_number,
+                  &data_offset,
+                  &data_size,
+                  &encoding_format,
+                  &(header->sample_rate),
+                  &(header->channels));
+
+    if (memcmp(magic_number, ".snd", 4)) {
+        return "invalid Sun AU header";
+    }
+
+    switch (encoding_format) {
+    case 2:
+        header->bits_per_sample = 8;
+        break;
+    case 3:
+        header->bits_per_sample = 16;
+        break;
+    case 4:
+        header->bits_per_sample = 24;
+        break;
+    default:
+        return "unsupported Sun AU format";
+    }
+
+    switch (header->channels) {
+    case 1:
+        header->channel_mask = 0x4;
+        break;
+    case 2:
+        header->channel_mask = 0x3;
+        break;
+    default:
+        header->channel_mask = 0;
+        break;
+    }
+
+    header->big_endian = 1;
+    header->is_signed = 1;
+    header->data_offset = data_offset;
+
+    /*a size of all 1 bits means the data runs to the end of the file*/
+    if (data_size != 0xFFFFFFFF) {
+        header->data_size = data_size;
+    } else if (data_offset < file_size) {
+        header->data_size = file_size - data_offset;
+    } else {
+        header->data_size = 0;
+    }
+    header->total_pcm_frames = data_pcm_frames(header);
+
+    return NULL;
+}
+
+static int
+valid_chunk_id(const uint8_t chunk_id[4])
+{
+    unsigned i;
+
+    for (i = 0; i < 4; i++) {
+        if ((chunk_id[i] < 0x20) || (chunk_id[i] > 0x7E)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static uint64_t
+data_pcm_frames(const struct pcmfile_header *header)
+{
+    const unsigned bytes_per_pcm_frame =
+        (header->bits_per_sample / 8) * header->channels;
+
+    return bytes_per_pcm_frame ? header->data_size / bytes_per_pcm_frame : 0;
+}
+
+static status_t
+read_pcm_frames(decoders_PCMFileDecoder *self,
+                unsigned pcm_frames,
+                int *samples)
+{
+    const uint64_t offset =
+        self->current_pcm_frame * self->bytes_per_pcm_frame;
+    const size_t size = (size_t)pcm_frames * self->bytes_per_pcm_frame;
+    const unsigned total_samples = pcm_frames * self->header.channels;
+
+    /*raise exception if PCM data exhausted early*/
+    if ((offset + size) > self->data_available) {
+        return TRUNCATED_DATA;
+    }
+
+    if (self->data != NULL) {
+        self->converter(total_samples, self->data + offset, samples);
+        return OK;
+    }
+
+    if (size > self->buffer_size) {
+        uint8_t *buffer = realloc(self->buffer, size);
+        if (buffer == NULL) {
+            return MEMORY_ERROR;
+        }
+        self->buffer = buffer;
+        self->buffer_size = size;
+    }
+
+#ifdef HAS_MMAP
+    if (fseeko(self->file,
+               (off_t)(self->header.data_offset + offset),
+               SEEK_SET)) {
+        return IO_ERROR;
+    }
+#else
+    if (fseek(self->file,
+              (long)(self->header.data_offset + offset),
+              SEEK_SET)) {
+        return IO_ERROR;
+    }
+#endif
+
+    if (fread(self->buffer, 1, size, self->file) != size) {
+        return IO_ERROR;
+    }
+
+    self->converter(total_samples, self->buffer, samples);
+    return OK;
+}
+
+static void
+set_read_error(decoders_PCMFileDecoder *self, status_t status)
+{
+    switch (status) {
+    case TRUNCATED_DATA:
+        PyErr_SetString(PyExc_IOError, self->truncated_error);
+        break;
+    case MEMORY_ERROR:
+        PyErr_NoMemory();
+        break;
+    default:
+        PyErr_SetString(PyExc_IOError, "I/O error reading PCM data");
+        break;
+    }
+}
+
+static void
+close_pcmfile(decoders_PCMFileDecoder *self)
+{
+#ifdef HAS_MMAP
+    if (self->map != NULL) {
+        munmap(self->map, self->map_size);
+        self->map = NULL;
+        self->data = NULL;
+    }
+#endif
+    if (self->file != NULL) {
+        fclose(self->file);
+        self->file = NULL;
+    }
+}
@@ -0,0 +1,221 @@
+#include <Python.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "../pcm_conv.h"
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+/*Decoders for uncompressed RIFF WAVE, AIFF and Sun AU files.
+
+  All three share the same object layout and methods
+  and differ only in how their headers are parsed.
+  Once the header is parsed, the file's PCM data is memory-mapped
+  and converted straight into FrameList samples,
+  so seeking is only a matter of changing the current PCM frame.*/
+
+struct pcmfile_header {
+    unsigned channels;
+    unsigned bits_per_sample;
+    unsigned sample_rate;
+    unsigned channel_mask;
+    int big_endian;
+    int is_signed;
+
+    /*the position and size of the file's PCM data in bytes*/
+    uint64_t data_offset;
+    uint64_t data_size;
+
+    /*the number of PCM frames the header says are present
+      which may be more than the file actually holds*/
+    uint64_t total_pcm_frames;
+};
+
+typedef struct {
+    PyObject_HEAD
+
+    struct pcmfile_header header;
+    unsigned bytes_per_pcm_frame;
+
+    /*the error raised when reading past the end of truncated data*/
+    const char *truncated_error;
+
+    /*the type whose init function opened the file,
+      since subclasses don't export a native PCM source*/
+    PyTypeObject *type;
+
+    pcm_to_int_f converter;
+
+    /*the mapped region, which starts on a page boundary
+      at or before the start of the PCM data,
+      and the PCM data's first byte within it*/
+    uint8_t *map;
+    size_t map_size;
+    const uint8_t *data;
+
+    /*the number of PCM data bytes actually present in the file*/
+    uint64_t data_available;
+
+    /*if the file can't be mapped, PCM data is read
+      from it through this buffer instead*/
+    FILE *file;
+    uint8_t *buffer;
+    size_t buffer_size;
+
+    uint64_t current_pcm_frame;
+
+    int closed;
+
+    /*a framelist generator*/
+    PyObject* audiotools_pcm;
+} decoders_PCMFileDecoder;
+
+static PyObject*
+PCMFileDecoder_sample_rate(decoders_PCMFileDecoder *self, void *closure);
+
+static PyObject*
+PCMFileDecoder_bits_per_sample(decoders_PCMFileDecoder *self, void *closure);
+
+static PyObject*
+PCMFileDecoder_channels(decoders_PCMFileDecoder *self, void *closure);
+
+static PyObject*
+PCMFileDecoder_channel_mask(decoders_PCMFileDecoder *self, void *closure);
+
+static PyObject*
+PCMFileDecoder_total_pcm_frames(decoders_PCMFileDecoder *self,
+                                void *closure);
+
+static PyObject*
+PCMFileDecoder_pcm_source(decoders_PCMFileDecoder *self, void *closure);
+
+static PyObject*
+PCMFileDecoder_read(decoders_PCMFileDecoder *self, PyObject *args);
+
+static PyObject*
+PCMFileDecoder_seek(decoders_PCMFileDecoder *self, PyObject *args);
+
+static PyObject*
+PCMFileDecoder_close(decoders_PCMFileDecoder *self, PyObject *args);
+
+static PyObject*
+PCMFileDecoder_enter(decoders_PCMFileDecoder *self, PyObject *args);
+
+static PyObject*
+PCMFileDecoder_exit(decoders_PCMFileDecoder *self, PyObject *args);
+
+PyObject*
+PCMFileDecoder_new(PyTypeObject *type, PyObject *args, PyObject *kwds);
+
+void
+PCMFileDecoder_dealloc(decoders_PCMFileDecoder *self);
+
+int
+WaveDecoder_init(decoders_PCMFileDecoder *self,
+                 PyObject *args,
+                 PyObject *kwds);
+
+int
+AiffDecoder_init(decoders_PCMFileDecoder *self,
+                 PyObject *args,
+                 PyObject *kwds);
+
+int
+AuDecoder_init(decoders_PCMFileDecoder *self,
+               PyObject *args,
+               PyObject *kwds);
+
+PyGetSetDef PCMFileDecoder_getseters[] = {
+    {"sample_rate",
+     (getter)PCMFileDecoder_sample_rate, NULL, "sample rate", NULL},
+    {"bits_per_sample",
+     (getter)PCMFileDecoder_bits_per_sample, NULL, "bits per sample", NULL},
+    {"channels",
+     (getter)PCMFileDecoder_channels, NULL, "channels", NULL},
+    {"channel_mask",
+     (getter)PCMFileDecoder_channel_mask, NULL, "channel mask", NULL},
+    {"total_pcm_frames",
+     (getter)PCMFileDecoder_total_pcm_frames, NULL,
+     "total PCM frames", NULL},
+    {"_pcm_source",
+     (getter)PCMFileDecoder_pcm_source, NULL, "native PCM source", NULL},
+    {NULL}
+};
+
+PyMethodDef PCMFileDecoder_methods[] = {
+    {"read", (PyCFunction)PCMFileDecoder_read,
+     METH_VARARGS, "read(pcm_frame_count) -> FrameList"},
+    {"seek", (PyCFunction)PCMFileDecoder_seek,
+     METH_VARARGS, "seek(desired_pcm_offset) -> actual_pcm_offset"},
+    {"close", (PyCFunction)PCMFileDecoder_close,
+     METH_NOARGS, "close() -> None"},
+    {"__enter__", (PyCFunction)PCMFileDecoder_enter,
+     METH_NOARGS, "enter() -> self"},
+    {"__exit__", (PyCFunction)PCMFileDecoder_exit,
+     METH_VARARGS, "exit(exc_type, exc_value, traceback) -> None"},
+    {NULL}
+};
+
+#define PCMFILE_DECODER_TYPE(NAME, DOC)                              \
+    PyTypeObject decoders_##NAME##Type = {                           \
+        PyVarObject_HEAD_INIT(NULL, 0)                               \
+        "decoders." #NAME,             /*tp_name*/                   \
+        sizeof(decoders_PCMFileDecoder), /*tp_basicsize*/            \
+        0,                             /*tp_itemsize*/               \
+        (destructor)PCMFileDecoder_dealloc, /*tp_dealloc*/           \
+        0,                             /*tp_print*/                  \
+        0,                             /*tp_getattr*/                \
+        0,                             /*tp_setattr*/                \
+        0,                             /*tp_compare*/                \
+        0,                             /*tp_repr*/                   \
+        0,                             /*tp_as_number*/              \
+        0,                             /*tp_as_sequence*/            \
+        0,                             /*tp_as_mapping*/             \
+        0,                             /*tp_hash */                  \
+        0,                             /*tp_call*/                   \
+        0,                             /*tp_str*/                    \
+        0,                             /*tp_getattro*/               \
+        0,                             /*tp_setattro*/               \
+        0,                             /*tp_as_buffer*/              \
+        Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /*tp_flags*/       \
+        DOC,                           /* tp_doc */                  \
+        0,                             /* tp_traverse */             \
+        0,                             /* tp_clear */                \
+        0,                             /* tp_richcompare */          \
+        0,                             /* tp_weaklistoffset */       \
+        0,                             /* tp_iter */                 \
+        0,                             /* tp_iternext */             \
+        PCMFileDecoder_methods,        /* tp_methods */              \
+        0,                             /* tp_members */              \
+        PCMFileDecoder_getseters,      /* tp_getset */               \
+        0,                             /* tp_base */                 \
+        0,                             /* tp_dict */                 \
+        0,                             /* tp_descr_get */            \
+        0,                             /* tp_descr_set */            \
+        0,                             /* tp_dictoffset */           \
+        (initproc)NAME##_init,         /* tp_init */                 \
+        0,                             /* tp_alloc */                \
+        PCMFileDecoder_new,            /* tp_new */                  \
+    }
+
+PCMFILE_DECODER_TYPE(WaveDecoder, "WaveDecoder objects");
+
+PCMFILE_DECODER_TYPE(AiffDecoder, "AiffDecoder objects");
+
+PCMFILE_DECODER_TYPE(AuDecoder, "AuDecoder objects");
@@ -303,6 +303,125 @@ TTADecoder_read(decoders_TTADecoder* self, PyObject *args)
     }
 }
 
+static PyObject*
+TTADecoder_verify(decoders_TTADecoder *self, PyObject *args)
+{
+    PyObject *progress = Py_None;
+    int *samples;
+    uint64_t pcm_frames = 0;
+
+    if (self->closed) {
+        PyErr_SetString(PyExc_ValueError, "cannot read closed stream");
+        return NULL;
+    }
+
+    if (!PyArg_ParseTuple(args, "|O", &progress))
+        return NULL;
+
+    /*a single buffer is reused for every frame
+      rather than building a FrameList for each*/
+    samples = malloc(self->header.default_block_size *
+                     self->header.channels *
+                     sizeof(int));
+
+    for (; self->current_tta_frame < self->header.total_tta_frames;
+         self->current_tta_frame++) {
+        const unsigned block_size =
+            tta_block_size(self->current_tta_frame, &self->header);
+        status_t status;
+
+        Py_BEGIN_ALLOW_THREADS
+        status = read_tta_frame(self->bitstream,
+                                self->header.channels,
+                                self->header.bits_per_sample,
+                                block_size,
+                                samples);
+        Py_END_ALLOW_THREADS
+
+        if (status != OK) {
+            /*stop at the first bad frame
+              since the rest of the stream can't be trusted*/
+            free(samples);
+            return Py_BuildValue("(K, K, s)",
+                                 (unsigned long long)pcm_frames,
+                                 (unsigned long long)pcm_frames,
+                                 tta_strerror(status));
+        }
+
+        pcm_frames += block_size;
+
+        if (progress != Py_None) {
+            PyObject *result = PyObject_CallFunction(
+                progress, "K", (unsigned long long)pcm_frames);
+            if (result == NULL) {
+                free(samples);
+                return NULL;
+            } else {
+                Py_DECREF(result);
+            }
+        }
+    }
+
+    free(samples);
+
+    return Py_BuildValue("(K, O, O)",
+                         (unsigned long long)pcm_frames,
+                         Py_None,
+                         Py_None);
+}
+
+static unsigned
+TTADecoder_pcm_block_size(PyObject *obj)
+{
+    decoders_TTADecoder *self = (decoders_TTADecoder*)obj;
+
+    return self->header.default_block_size;
+}
+
+static int
+TTADecoder_pcm_read(PyObject *obj, int *pcm_data, unsigned *pcm_frames)
+{
+    decoders_TTADecoder *self = (decoders_TTADecoder*)obj;
+
+    if (self->closed) {
+        PyErr_SetString(PyExc_ValueError, "cannot read closed stream");
+        return 1;
+    } else if (self->current_tta_frame == self->header.total_tta_frames) {
+        *pcm_frames = 0;
+        return 0;
+    } else {
+        const unsigned block_size =
+            tta_block_size(self->current_tta_frame, &self->header);
+        status_t status;
+
+        if ((status = read_tta_frame(self->bitstream,
+                                     self->header.channels,
+                                     self->header.bits_per_sample,
+                                     block_size,
+                                     pcm_data)) == OK) {
+            self->current_tta_frame += 1;
+            *pcm_frames = block_size;
+            return 0;
+        } else {
+            PyErr_SetString(tta_exception(status), tta_strerror(status));
+            return 1;
+        }
+    }
+}
+
+static const struct pcm_source TTADecoder_source = {
+    TTADecoder_pcm_block_size,
+    TTADecoder_pcm_read
+};
+
+static PyObject*
+TTADecoder_pcm_source(decoders_TTADecoder *self, void *closure)
+{
+    return pcm_source_capsule((PyObject*)self,
+                              &decoders_TTADecoderType,
+                              &TTADecoder_source);
+}
+
 static PyObject*
 TTADecoder_seek(decoders_TTADecoder *self, PyObject *args)
 {
@@ -405,9 +524,9 @@ checksum_init(BitstreamReader *frame, checksum_t *checksum)
     checksum->crc32 = 0xFFFFFFFF;
     checksum->is_valid = 0;
 
-    frame->add_callback(frame,
-                        (bs_callback_f)tta_crc32,
-                        &checksum->crc32);
+    frame->add_span_callback(frame,
+                             (bs_span_callback_f)tta_crc32_span,
+                             &checksum->crc32);
 }
 
 static void
@@ -64,12 +64,18 @@ TTADecoder_channels(decoders_TTADecoder *self, void *closure);
 static PyObject*
 TTADecoder_channel_mask(decoders_TTADecoder *self, void *closure);
 
+static PyObject*
+TTADecoder_pcm_source(decoders_TTADecoder *self, void *closure);
+
 static PyObject*
 TTADecoder_read(decoders_TTADecoder *self, PyObject *args);
 
 static PyObject*
 TTADecoder_seek(decoders_TTADecoder *self, PyObject *args);
 
+static PyObject*
+TTADecoder_verify(decoders_TTADecoder *self, PyObject *args);
+
 static PyObject*
 TTADecoder_close(decoders_TTADecoder *self, PyObject *args);
 
@@ -97,6 +103,8 @@ PyGetSetDef TTADecoder_getseters[] = {
      (getter)TTADecoder_channels, NULL, "channels", NULL},
     {"channel_mask",
      (getter)TTADecoder_channel_mask, NULL, "channel_mask", NULL},
+    {"_pcm_source",
+     (getter)TTADecoder_pcm_source, NULL, "native PCM source", NULL},
     {NULL}
 };
 
@@ -105,6 +113,11 @@ PyMethodDef TTADecoder_methods[] = {
      METH_VARARGS, "read(pcm_frame_count) -> FrameList"},
     {"seek", (PyCFunction)TTADecoder_seek,
      METH_VARARGS, "seek(desired_pcm_offset) -> actual_pcm_offset"},
+    {"verify", (PyCFunction)TTADecoder_verify,
+     METH_VARARGS,
+     "verify(progress=None) -> (pcm_frames, bad_frame_offset, error)\n"
+     "decodes the rest of the stream checking each frame's CRC-32\n"
+     "where error is None if no problems are found"},
     {"close", (PyCFunction)TTADecoder_close,
      METH_NOARGS, "close() -> None"},
     {"__enter__", (PyCFunction)TTADecoder_enter,
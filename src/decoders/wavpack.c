@@ -209,6 +209,102 @@ WavPackDecoder_read(decoders_WavPackDecoder* self, PyObject *args)
     return (PyObject*)framelist;
 }
 
+/*the number of PCM frames decoded at a time by verify()*/
+#define VERIFY_BLOCK_SIZE 4096
+
+static PyObject*
+WavPackDecoder_verify(decoders_WavPackDecoder* self, PyObject *args)
+{
+    PyObject *progress = Py_None;
+    const unsigned channel_count = WavpackGetNumChannels(self->context);
+    const unsigned bits_per_sample = WavpackGetBitsPerSample(self->context);
+    int *samples;
+    uint64_t pcm_frames = 0;
+    uint32_t frames_read;
+
+    if (self->closed) {
+        PyErr_SetString(PyExc_ValueError, "cannot read closed stream");
+        return NULL;
+    }
+
+    if (!PyArg_ParseTuple(args, "|O", &progress))
+        return NULL;
+
+    /*a single buffer is reused for every block
+      rather than building a FrameList for each*/
+    samples = malloc(VERIFY_BLOCK_SIZE * channel_count * sizeof(int));
+
+    do {
+        int errors;
+
+        /*the decoder reads its file directly
+          so no Python objects are touched while decoding*/
+        Py_BEGIN_ALLOW_THREADS
+        errors = WavpackGetNumErrors(self->context);
+        frames_read = WavpackUnpackSamples(self->context,
+                                           samples,
+                                           VERIFY_BLOCK_SIZE);
+        if (frames_read && self->verifying_md5_sum) {
+            update_md5sum(&(self->md5),
+                          samples,
+                          channel_count,
+                          bits_per_sample,
+                          frames_read);
+        }
+        errors = WavpackGetNumErrors(self->context) - errors;
+        Py_END_ALLOW_THREADS
+
+        if (errors) {
+            /*stop at the first bad block
+              since the rest of the stream can't be trusted*/
+            free(samples);
+            self->verifying_md5_sum = 0;
+            return Py_BuildValue("(K, K, s)",
+                                 (unsigned long long)pcm_frames,
+                                 (unsigned long long)pcm_frames,
+                                 "CRC mismatch in block");
+        }
+
+        pcm_frames += frames_read;
+
+        if (frames_read && (progress != Py_None)) {
+            PyObject *result = PyObject_CallFunction(
+                progress, "K", (unsigned long long)pcm_frames);
+            if (result == NULL) {
+                free(samples);
+                return NULL;
+            } else {
+                Py_DECREF(result);
+            }
+        }
+    } while (frames_read);
+
+    free(samples);
+
+    if (self->verifying_md5_sum) {
+        uint8_t stored_md5_sum[16];
+        uint8_t stream_md5_sum[16];
+
+        self->verifying_md5_sum = 0;
+
+        if (WavpackGetMD5Sum(self->context, stored_md5_sum)) {
+            audiotools__MD5Final(stream_md5_sum, &(self->md5));
+
+            if (memcmp(stored_md5_sum, stream_md5_sum, 16)) {
+                /*no particular block is at fault*/
+                return Py_BuildValue("(K, O, s)",
+                                     (unsigned long long)pcm_frames,
+                                     Py_None,
+                                     "MD5 mismatch at end of stream");
+            }
+        }
+    }
+
+    return Py_BuildValue("(K, O, O)",
+                         (unsigned long long)pcm_frames,
+                         Py_None,
+                         Py_None);
+}
 
 PyObject*
 WavPackDecoder_seek(decoders_WavPackDecoder* self, PyObject *args)
@@ -75,6 +75,9 @@ WavPackDecoder_read(decoders_WavPackDecoder* self, PyObject *args);
 PyObject*
 WavPackDecoder_seek(decoders_WavPackDecoder* self, PyObject *args);
 
+static PyObject*
+WavPackDecoder_verify(decoders_WavPackDecoder* self, PyObject *args);
+
 static PyObject*
 WavPackDecoder_enter(decoders_WavPackDecoder* self, PyObject *args);
 
@@ -86,6 +89,11 @@ PyMethodDef WavPackDecoder_methods[] = {
      METH_VARARGS, "read(pcm_frame_count) -> FrameList"},
     {"seek", (PyCFunction)WavPackDecoder_seek,
      METH_VARARGS, "seek(desired_pcm_offset) -> actual_pcm_offset"},
+    {"verify", (PyCFunction)WavPackDecoder_verify,
+     METH_VARARGS,
+     "verify(progress=None) -> (pcm_frames, bad_frame_offset, error)\n"
+     "decodes the rest of the stream checking block CRCs and MD5 sum\n"
+     "where error is None if no problems are found"},
     {"close", (PyCFunction)WavPackDecoder_close,
      METH_NOARGS, "close() -> None"},
     {"__enter__", (PyCFunction)WavPackDecoder_enter,
@@ -17,92 +17,250 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 *******************************************************/
 
-/*This is a set of reusable routines for opening a BitstreamReader
-  wrapped around the os.urandom function call
-  for generating individual bits of dither for an audio stream.*/
-
-/*this is quite similar to br_read_python
-  except that it pulls data from os.urandom()*/
-static unsigned
-read_os_random(void *user_data,
-               uint8_t* buffer,
-               unsigned buffer_size)
+#include <stdint.h>
+#include <stdlib.h>
+
+/*This is a set of reusable routines for requantizing audio samples
+  to fewer bits-per-sample with triangular (TPDF) dither
+  and optional first-order noise shaping.
+
+  Dither values come from a xoshiro256** generator
+  which is seeded once, either explicitly for reproducible output
+  or from os.urandom() otherwise.
+
+  This file is #included directly by each module that uses it,
+  so routines not every module needs are static inline
+  to avoid unused function warnings.*/
+
+/*the number of samples whose dither values are generated at once*/
+#define DITHER_BLOCK_SIZE 256
+
+struct dither {
+    uint64_t state[4];
+
+    unsigned channels;
+
+    /*if nonzero, each channel's requantization error
+      is fed back into its next sample*/
+    int noise_shaping;
+    int *error;
+};
+
+/*returns a new dither generator for the given number of channels
+  whose PRNG is seeded from the given value*/
+static struct dither*
+dither_open(unsigned channels, uint64_t seed, int noise_shaping);
+
+/*seeds the dither generator, resetting any noise shaping state*/
+static void
+dither_seed(struct dither *dither, uint64_t seed);
+
+/*places a random seed from os.urandom() in "seed"
+  and returns 0 on success
+  or returns -1 with a Python exception set if an error occurs*/
+static int
+dither_random_seed(uint64_t *seed);
+
+static void
+dither_close(struct dither *dither);
+
+/*requantizes "total_samples" interleaved samples in place
+  by reducing them by "shift" bits with TPDF dither
+  and clamping them between "min_value" and "max_value"
+
+  "shift" must be between 1 and 16, inclusive*/
+static inline void
+dither_requantize(struct dither *dither,
+                  int *samples,
+                  unsigned total_samples,
+                  unsigned shift,
+                  int min_value,
+                  int max_value);
+
+/*returns a TPDF dither value between -1.0 and 1.0, exclusive,
+  for adding to a floating point sample before rounding it*/
+static inline double
+dither_tpdf(struct dither *dither);
+
+
+static inline uint64_t
+rotl64(uint64_t x, int k)
 {
-    PyObject *os_module = user_data;
-    /*call unrandom() function on os module*/
-    PyObject* read_result =
-        PyObject_CallMethod(os_module, "urandom", "I", buffer_size);
-    char *string;
-    Py_ssize_t string_size;
-    unsigned to_copy;
+    return (x << k) | (x >> (64 - k));
+}
 
-    if (read_result == NULL) {
-        /*some exception occurred, so clear result and return no bytes
-          (which will likely turn into an I/O exception later)*/
-        PyErr_Clear();
-        return 0;
-    }
+static inline uint64_t
+dither_next(struct dither *dither)
+{
+    uint64_t *s = dither->state;
+    const uint64_t result = rotl64(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
 
-    /*get string data from returned object*/
-    if (PyBytes_AsStringAndSize(read_result,
-                                &string,
-                                &string_size) == -1) {
-        /*got something that wasn't a string from .read()
-          so clear exception and return no bytes*/
-        Py_DECREF(read_result);
-        PyErr_Clear();
-        return 0;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl64(s[3], 45);
+
+    return result;
+}
+
+static struct dither*
+dither_open(unsigned channels, uint64_t seed, int noise_shaping)
+{
+    struct dither *dither = malloc(sizeof(struct dither));
+
+    dither->channels = channels;
+    dither->noise_shaping = noise_shaping;
+    dither->error = calloc(channels ? channels : 1, sizeof(int));
+    dither_seed(dither, seed);
+
+    return dither;
+}
+
+static void
+dither_seed(struct dither *dither, uint64_t seed)
+{
+    unsigned i;
+
+    /*expand the seed into generator state with splitmix64
+      which never yields an all-zero state*/
+    for (i = 0; i < 4; i++) {
+        uint64_t z = (seed += UINT64_C(0x9E3779B97F4A7C15));
+        z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+        z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+        dither->state[i] = z ^ (z >> 31);
     }
 
-    /*write either "buffer_size" or "string_size" bytes to buffer
-      whichever is less*/
-    if (string_size >= buffer_size) {
-        /*truncate strings larger than expected*/
-        to_copy = buffer_size;
-    } else {
-        to_copy = (unsigned)string_size;
+    for (i = 0; i < dither->channels; i++) {
+        dither->error[i] = 0;
     }
+}
 
-    memcpy(buffer, (uint8_t*)string, to_copy);
+static int
+dither_random_seed(uint64_t *seed)
+{
+    PyObject *os_module;
+    PyObject *random;
+    char *string;
+    Py_ssize_t string_size;
+
+    if ((os_module = PyImport_ImportModule("os")) == NULL)
+        return -1;
 
-    /*perform cleanup and return bytes actually read*/
-    Py_DECREF(read_result);
+    random = PyObject_CallMethod(os_module, "urandom", "i", 8);
+    Py_DECREF(os_module);
+    if (random == NULL)
+        return -1;
 
-    return to_copy;
+    if (PyBytes_AsStringAndSize(random, &string, &string_size) == -1) {
+        Py_DECREF(random);
+        return -1;
+    } else if (string_size < 8) {
+        Py_DECREF(random);
+        PyErr_SetString(PyExc_IOError, "insufficient random data");
+        return -1;
+    } else {
+        memcpy(seed, string, 8);
+        Py_DECREF(random);
+        return 0;
+    }
 }
 
-static int
-close_os_random(void *user_data)
+static void
+dither_close(struct dither *dither)
 {
-    return 0;
+    free(dither->error);
+    free(dither);
 }
 
+/*fills "noise" with "count" TPDF values between -(1 << shift)
+  and (1 << shift), exclusive, two values per generator call*/
 static void
-free_os_random(void *user_data)
+dither_fill(struct dither *dither,
+            int *noise,
+            unsigned count,
+            unsigned shift)
 {
-    PyObject *os_module = user_data;
-    Py_XDECREF(os_module);
+    const uint64_t mask = (UINT64_C(1) << shift) - 1;
+    unsigned i;
+
+    for (i = 0; i < count; i += 2) {
+        const uint64_t r = dither_next(dither);
+        noise[i] = (int)(r & mask) - (int)((r >> 16) & mask);
+        noise[i + 1] = (int)((r >> 32) & mask) - (int)((r >> 48) & mask);
+    }
 }
 
-/*returns a BitstreamReader for reading 1 bit white noise dither values
-  or NULL if an error occurs opening the os module*/
-static BitstreamReader*
-open_dither(void)
+static inline void
+dither_requantize(struct dither *dither,
+                  int *samples,
+                  unsigned total_samples,
+                  unsigned shift,
+                  int min_value,
+                  int max_value)
 {
-    PyObject* os_module;
-
-    if ((os_module = PyImport_ImportModule("os")) != NULL) {
-        return br_open_external(os_module,
-                                BS_BIG_ENDIAN,
-                                4096,
-                                read_os_random,
-                                NULL, /*unseekable stream*/
-                                NULL, /*unseekable stream*/
-                                NULL, /*unseekable stream*/
-                                NULL, /*unseekable stream*/
-                                close_os_random,
-                                free_os_random);
+    const int round = 1 << (shift - 1);
+    int noise[DITHER_BLOCK_SIZE];
+
+    if (!dither->noise_shaping) {
+        while (total_samples) {
+            const unsigned block = MIN(total_samples, DITHER_BLOCK_SIZE);
+            unsigned i;
+
+            dither_fill(dither, noise, DITHER_BLOCK_SIZE, shift);
+
+            /*no dependencies between samples in this loop*/
+            for (i = 0; i < block; i++) {
+                const int s = (samples[i] + noise[i] + round) >> shift;
+                samples[i] = MIN(MAX(s, min_value), max_value);
+            }
+
+            samples += block;
+            total_samples -= block;
+        }
     } else {
-        return NULL;
+        const unsigned channels = dither->channels;
+        const int limit = 1 << shift;
+        int *error = dither->error;
+        unsigned c = 0;
+
+        while (total_samples) {
+            const unsigned block = MIN(total_samples, DITHER_BLOCK_SIZE);
+            unsigned i;
+
+            dither_fill(dither, noise, DITHER_BLOCK_SIZE, shift);
+
+            for (i = 0; i < block; i++) {
+                /*subtract the channel's previous error
+                  which pushes requantization noise
+                  toward higher frequencies*/
+                const int v = samples[i] - error[c];
+                int s = (v + noise[i] + round) >> shift;
+                int e;
+
+                s = MIN(MAX(s, min_value), max_value);
+                samples[i] = s;
+
+                /*keep clipped samples from destabilizing the loop*/
+                e = s * limit - v;
+                error[c] = MIN(MAX(e, -limit), limit);
+
+                if (++c == channels)
+                    c = 0;
+            }
+
+            samples += block;
+            total_samples -= block;
+        }
     }
 }
+
+static inline double
+dither_tpdf(struct dither *dither)
+{
+    const uint64_t r = dither_next(dither);
+
+    return ((double)(r & 0xFFFFFFFF) - (double)(r >> 32)) / 4294967296.0;
+}
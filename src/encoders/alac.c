@@ -46,6 +46,9 @@ static void
 free_alac_frame_sizes(struct alac_frame_size *frame_sizes);
 
 #ifndef STANDALONE
+/*returns the gathered statistics as a dict*/
+static PyObject*
+alac_stats_dict(const struct alacenc_stats *stats);
 
 PyObject*
 encoders_encode_alac(PyObject *dummy, PyObject *args, PyObject *keywds)
@@ -58,6 +61,7 @@ encoders_encode_alac(PyObject *dummy, PyObject *args, PyObject *keywds)
                              "history_multiplier",
                              "maximum_k",
                              "version",
+                             "stats",
                              NULL};
     PyObject *file_obj;
     BitstreamWriter *output = NULL;
@@ -68,10 +72,12 @@ encoders_encode_alac(PyObject *dummy, PyObject *args, PyObject *keywds)
     int history_multiplier;
     int maximum_k;
     const char *version;
+    int gather_stats = 0;
+    struct alacenc_stats stats;
     struct alac_frame_size *frame_sizes;
 
     /*extract a file object, PCMReader-compatible object and encoding options*/
-    if (!PyArg_ParseTupleAndKeywords(args, keywds, "OO&Liiiis",
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "OO&Liiiis|i",
                                      kwlist,
                                      &file_obj,
                                      py_obj_to_pcmreader,
@@ -81,7 +87,8 @@ encoders_encode_alac(PyObject *dummy, PyObject *args, PyObject *keywds)
                                      &initial_history,
                                      &history_multiplier,
                                      &maximum_k,
-                                     &version)) {
+                                     &version,
+                                     &gather_stats)) {
         return NULL;
     }
 
@@ -115,17 +122,34 @@ encoders_encode_alac(PyObject *dummy, PyObject *args, PyObject *keywds)
         return NULL;
     }
 
-    output = bw_open_external(file_obj,
-                              BS_BIG_ENDIAN,
-                              4096,
-                              bw_write_python,
-                              bs_setpos_python,
-                              bs_getpos_python,
-                              bs_free_pos_python,
-                              bs_fseek_python,
-                              bw_flush_python,
-                              bs_close_python,
-                              bs_free_python_nodecref);
+    if (gather_stats) {
+        memset(&stats, 0, sizeof(struct alacenc_stats));
+        stage_timer_init(&stats.timer);
+        output = bw_open_timed(file_obj,
+                               BS_BIG_ENDIAN,
+                               4096,
+                               bw_write_python,
+                               bs_setpos_python,
+                               bs_getpos_python,
+                               bs_free_pos_python,
+                               bs_fseek_python,
+                               bw_flush_python,
+                               bs_close_python,
+                               bs_free_python_nodecref,
+                               &stats.timer);
+    } else {
+        output = bw_open_external(file_obj,
+                                  BS_BIG_ENDIAN,
+                                  4096,
+                                  bw_write_python,
+                                  bs_setpos_python,
+                                  bs_getpos_python,
+                                  bs_free_pos_python,
+                                  bs_fseek_python,
+                                  bw_flush_python,
+                                  bs_close_python,
+                                  bs_free_python_nodecref);
+    }
 
     frame_sizes = encode_alac(output,
                               pcmreader,
@@ -134,15 +158,21 @@ encoders_encode_alac(PyObject *dummy, PyObject *args, PyObject *keywds)
                               initial_history,
                               history_multiplier,
                               maximum_k,
-                              version);
+                              version,
+                              gather_stats ? &stats : NULL);
 
     if (frame_sizes) {
         output->flush(output);
         output->free(output);
         free_alac_frame_sizes(frame_sizes);
 
-        Py_INCREF(Py_None);
-        return Py_None;
+        if (gather_stats) {
+            stage_timer_enter(&stats.timer, STAGE_OTHER);
+            return alac_stats_dict(&stats);
+        } else {
+            Py_INCREF(Py_None);
+            return Py_None;
+        }
     } else {
         /*indicate read error has occurred*/
         output->free(output);
@@ -151,9 +181,30 @@ encoders_encode_alac(PyObject *dummy, PyObject *args, PyObject *keywds)
     }
 }
 
-#endif
+static PyObject*
+alac_stats_dict(const struct alacenc_stats *stats)
+{
+    const uint64_t residual_bytes = stats->residual_bits / 8;
+    const uint64_t verbatim_bytes = stats->verbatim_bits / 8;
+
+    return Py_BuildValue(
+        "{sNsIsIsIsNsNsKsKsK}",
+        "times", stage_timer_dict(&stats->timer),
+        "framesets", stats->framesets,
+        "compressed_frames", stats->compressed_frames,
+        "uncompressed_frames", stats->uncompressed_frames,
+        "lpc_orders", histogram_list(MAX_QLP_COEFFS + 1, stats->lpc_orders),
+        "interlacing_leftweights",
+        histogram_list(5, stats->interlacing_leftweights),
+        "header_bytes",
+        (unsigned long long)(stats->frame_bytes -
+                             residual_bytes -
+                             verbatim_bytes),
+        "residual_bytes", (unsigned long long)residual_bytes,
+        "verbatim_bytes", (unsigned long long)verbatim_bytes);
+}
 
-#define BUFFER_SIZE 4096
+#endif
 
 static struct alac_frame_size*
 encode_alac(BitstreamWriter *output,
@@ -163,7 +214,8 @@ encode_alac(BitstreamWriter *output,
             int initial_history,
             int history_multiplier,
             int maximum_k,
-            const char encoder_version[])
+            const char encoder_version[],
+            struct alacenc_stats *stats)
 {
     time_t timestamp = time(NULL);
 
@@ -174,6 +226,8 @@ encode_alac(BitstreamWriter *output,
         struct alac_frame_size *dummy_sizes =
             dummy_frame_sizes(block_size, total_pcm_frames);
 
+        const unsigned ftyp_size = write_ftyp(output);
+
         const unsigned metadata_size = write_metadata(
             output,
             timestamp,
@@ -198,7 +252,8 @@ encode_alac(BitstreamWriter *output,
                         block_size,
                         initial_history,
                         history_multiplier,
-                        maximum_k);
+                        maximum_k,
+                        stats);
 
         if (!actual_sizes) {
             free_alac_frame_sizes(dummy_sizes);
@@ -224,6 +279,7 @@ encode_alac(BitstreamWriter *output,
         output->setpos(output, start);
         start->del(start);
 
+        write_ftyp(output);
         rewritten_size = write_metadata(output,
                                         timestamp,
                                         pcmreader->sample_rate,
@@ -235,7 +291,7 @@ encode_alac(BitstreamWriter *output,
                                         initial_history,
                                         maximum_k,
                                         actual_sizes,
-                                        metadata_size + 8,
+                                        ftyp_size + metadata_size + 8,
                                         encoder_version);
 
 #ifndef NDEBUG
@@ -251,90 +307,47 @@ encode_alac(BitstreamWriter *output,
         /*return actual frame sizes list*/
         return actual_sizes;
     } else {
-        FILE *tempfile = tmpfile();
-        BitstreamWriter *temp_output = bw_open(tempfile, BS_BIG_ENDIAN);
-        BitstreamAccumulator *metadata_size_writer =
-            bw_open_accumulator(BS_BIG_ENDIAN);
-        unsigned metadata_size;
+        /*total PCM frames isn't known in advance,
+          so write "mdat" ahead of "moov" in a single pass
+          and build metadata atoms from the actual frame sizes*/
+        const unsigned ftyp_size = write_ftyp(output);
         struct alac_frame_size *size;
         unsigned total_pcm_frames = 0;
-        uint8_t buffer[BUFFER_SIZE];
-        size_t bytes_read;
 
-        /*write mdat atom to temporary file*/
+        /*write mdat atom directly to output*/
         struct alac_frame_size *actual_sizes =
-            encode_mdat(temp_output,
+            encode_mdat(output,
                         pcmreader,
                         block_size,
                         initial_history,
                         history_multiplier,
-                        maximum_k);
+                        maximum_k,
+                        stats);
 
         if (!actual_sizes) {
-            metadata_size_writer->close(metadata_size_writer);
-            temp_output->free(temp_output);
-            fclose(tempfile);
             return NULL;
         }
 
-        temp_output->flush(temp_output);
-        temp_output->free(temp_output);
-
         /*determine total PCM frames written from frame sizes list*/
         for (size = actual_sizes; size; size = size->next) {
             total_pcm_frames += size->pcm_frames_size;
         }
 
-        /*get metadata size in order to determine chunk offsets*/
-        metadata_size = write_metadata(
-            (BitstreamWriter*)metadata_size_writer,
-            timestamp,
-            pcmreader->sample_rate,
-            pcmreader->channels,
-            pcmreader->bits_per_sample,
-            total_pcm_frames,
-            block_size,
-            history_multiplier,
-            initial_history,
-            maximum_k,
-            actual_sizes,
-            0,
-            encoder_version);
-
-        assert(metadata_size ==
-               metadata_size_writer->bytes_written(metadata_size_writer));
-
-        /*output metadata atoms*/
-        metadata_size = write_metadata(
-            output,
-            timestamp,
-            pcmreader->sample_rate,
-            pcmreader->channels,
-            pcmreader->bits_per_sample,
-            total_pcm_frames,
-            block_size,
-            history_multiplier,
-            initial_history,
-            maximum_k,
-            actual_sizes,
-            metadata_size + 8,
-            encoder_version);
-
-        assert(metadata_size ==
-              metadata_size_writer->bytes_written(metadata_size_writer));
-        metadata_size_writer->close(metadata_size_writer);
-
-        /*copy mdat atom from temporary file to output*/
-        rewind(tempfile);
-        while ((bytes_read = fread(buffer,
-                                   sizeof(uint8_t),
-                                   BUFFER_SIZE,
-                                   tempfile)) > 0) {
-            output->write_bytes(output, buffer, (unsigned)bytes_read);
-        }
+        /*output metadata atoms following mdat atom*/
+        write_metadata(output,
+                       timestamp,
+                       pcmreader->sample_rate,
+                       pcmreader->channels,
+                       pcmreader->bits_per_sample,
+                       total_pcm_frames,
+                       block_size,
+                       history_multiplier,
+                       initial_history,
+                       maximum_k,
+                       actual_sizes,
+                       ftyp_size + 8,
+                       encoder_version);
 
-        /*close temporary file and return frame sizes list*/
-        fclose(tempfile);
         return actual_sizes;
     }
 }
@@ -345,7 +358,8 @@ encode_mdat(BitstreamWriter *output,
             int block_size,
             int initial_history,
             int history_multiplier,
-            int maximum_k)
+            int maximum_k,
+            struct alacenc_stats *stats)
 {
     struct alac_context encoder;
     int *samples = malloc(pcmreader->channels *
@@ -355,6 +369,7 @@ encode_mdat(BitstreamWriter *output,
     bw_pos_t* mdat_header = NULL;
     unsigned pcm_frames_read;
     struct alac_frame_size *frame_sizes = NULL;
+    encoder_stage_t previous_stage = STAGE_OTHER;
 
     init_encoder(&encoder, block_size);
 
@@ -367,6 +382,8 @@ encode_mdat(BitstreamWriter *output,
 
     encoder.bits_per_sample = pcmreader->bits_per_sample;
 
+    encoder.stats = stats;
+
     /*FIXME - check marks/rewinds for I/O errors*/
     mdat_header = output->getpos(output);
 
@@ -378,6 +395,10 @@ encode_mdat(BitstreamWriter *output,
     output->write(output, 32, 0);
     output->write_bytes(output, (uint8_t*)"mdat", 4);
 
+    if (stats) {
+        previous_stage = stage_timer_enter(&stats->timer, STAGE_PCM_READ);
+    }
+
     /*write frames from pcm_reader until empty*/
     while ((pcm_frames_read = pcmreader->read(pcmreader,
                                               encoder.options.block_size,
@@ -385,6 +406,9 @@ encode_mdat(BitstreamWriter *output,
         frame_byte_size = 0;
 
         /*perform encoding*/
+        if (stats) {
+            stage_timer_enter(&stats->timer, STAGE_WRITE);
+        }
         write_frameset(output,
                        &encoder,
                        pcm_frames_read,
@@ -395,6 +419,16 @@ encode_mdat(BitstreamWriter *output,
         frame_sizes = push_frame_size(frame_sizes,
                                       frame_byte_size,
                                       pcm_frames_read);
+
+        if (stats) {
+            stats->framesets += 1;
+            stats->frame_bytes += frame_byte_size;
+            stage_timer_enter(&stats->timer, STAGE_PCM_READ);
+        }
+    }
+
+    if (stats) {
+        stage_timer_enter(&stats->timer, previous_stage);
     }
 
     output->pop_callback(output, NULL);
@@ -404,6 +438,7 @@ encode_mdat(BitstreamWriter *output,
         /*return to header and rewrite it with the actual value*/
         unsigned total_mdat_size = 8;
         struct alac_frame_size *frame_size;
+        bw_pos_t* mdat_end = output->getpos(output);
 
         for (frame_size = frame_sizes;
              frame_size;
@@ -415,6 +450,10 @@ encode_mdat(BitstreamWriter *output,
         output->write(output, 32, total_mdat_size);
         mdat_header->del(mdat_header);
 
+        /*then return to the end of mdat for any trailing atoms*/
+        output->setpos(output, mdat_end);
+        mdat_end->del(mdat_end);
+
         /*close and free allocated files/buffers*/
 
         free_encoder(&encoder);
@@ -647,9 +686,30 @@ write_frame(BitstreamWriter *bs,
                                    channel0, channel1);
 
             compressed_frame->copy(compressed_frame, bs);
+
+            if (encoder->stats) {
+                struct alacenc_stats *stats = encoder->stats;
+                const struct alac_frame_choice *chosen = &encoder->chosen;
+                unsigned c;
+
+                stats->compressed_frames += 1;
+                for (c = 0; c < chosen->channels; c++) {
+                    stats->lpc_orders[chosen->orders[c]] += 1;
+                }
+                if (chosen->channels == 2) {
+                    stats->interlacing_leftweights[
+                        chosen->interlacing_leftweight] += 1;
+                }
+                stats->residual_bits += chosen->residual_bits;
+                stats->verbatim_bits += chosen->verbatim_bits;
+            }
         } else {
             /*a residual overflow exception occurred,
               so write an uncompressed frame instead*/
+            if (encoder->stats) {
+                /*the jump skipped past restoring the writing stage*/
+                stage_timer_enter(&encoder->stats->timer, STAGE_WRITE);
+            }
             write_uncompressed_frame(bs,
                                      encoder,
                                      pcm_frames,
@@ -703,6 +763,12 @@ write_uncompressed_frame(BitstreamWriter *bs,
             bs->write_signed(bs, bits_per_sample, channel0[i]);
         }
     }
+
+    if (encoder->stats) {
+        encoder->stats->uncompressed_frames += 1;
+        encoder->stats->verbatim_bits +=
+            (uint64_t)pcm_frames * channel_count * bits_per_sample;
+    }
 }
 
 static void
@@ -724,6 +790,9 @@ write_compressed_frame(BitstreamWriter *bs,
                                        pcm_frames,
                                        0, NULL,
                                        channel0);
+            if (encoder->stats) {
+                encoder->chosen = encoder->candidate;
+            }
         } else {
             unsigned leftweight;
             BitstreamRecorder *interlaced_frame =
@@ -754,6 +823,9 @@ write_compressed_frame(BitstreamWriter *bs,
                         interlaced_frame->bits_written(interlaced_frame);
                     recorder_swap(&best_interlaced_frame,
                                   &interlaced_frame);
+                    if (encoder->stats) {
+                        encoder->chosen = encoder->candidate;
+                    }
                 }
             }
 
@@ -807,6 +879,9 @@ write_compressed_frame(BitstreamWriter *bs,
                         interlaced_frame->bits_written(interlaced_frame);
                     recorder_swap(&best_interlaced_frame,
                                   &interlaced_frame);
+                    if (encoder->stats) {
+                        encoder->chosen = encoder->candidate;
+                    }
                 }
             }
 
@@ -824,6 +899,9 @@ write_compressed_frame(BitstreamWriter *bs,
                                        pcm_frames,
                                        uncompressed_LSBs, LSBs,
                                        MSBs0);
+            if (encoder->stats) {
+                encoder->chosen = encoder->candidate;
+            }
         }
     }
 }
@@ -876,6 +954,16 @@ write_non_interlaced_frame(BitstreamWriter *bs,
     }
 
     residual->copy(residual, bs);
+
+    if (encoder->stats) {
+        struct alac_frame_choice *candidate = &encoder->candidate;
+
+        candidate->channels = 1;
+        candidate->interlacing_leftweight = 0;
+        candidate->orders[0] = order;
+        candidate->residual_bits = residual->bits_written(residual);
+        candidate->verbatim_bits = pcm_frames * uncompressed_LSBs * 8;
+    }
 }
 
 static void
@@ -955,6 +1043,18 @@ write_interlaced_frame(BitstreamWriter *bs,
 
     residual0->copy(residual0, bs);
     residual1->copy(residual1, bs);
+
+    if (encoder->stats) {
+        struct alac_frame_choice *candidate = &encoder->candidate;
+
+        candidate->channels = 2;
+        candidate->interlacing_leftweight = interlacing_leftweight;
+        candidate->orders[0] = order0;
+        candidate->orders[1] = order1;
+        candidate->residual_bits = residual0->bits_written(residual0) +
+                                   residual1->bits_written(residual1);
+        candidate->verbatim_bits = pcm_frames * 2 * uncompressed_LSBs * 8;
+    }
 }
 
 static void
@@ -993,6 +1093,11 @@ compute_coefficients(struct alac_context* encoder,
 {
     double windowed_signal[sample_count];
     double autocorrelated[MAX_QLP_COEFFS + 1];
+    encoder_stage_t previous_stage = STAGE_OTHER;
+
+    if (encoder->stats) {
+        previous_stage = stage_timer_enter(&encoder->stats->timer, STAGE_LPC);
+    }
 
     /*window the input samples*/
     window_signal(sample_count,
@@ -1026,6 +1131,10 @@ compute_coefficients(struct alac_context* encoder,
         /*quantize LP coefficients at order 8*/
         quantize_coefficients(8, lp_coeff, qlp_coefficients8);
 
+        if (encoder->stats) {
+            stage_timer_enter(&encoder->stats->timer, STAGE_RESIDUAL);
+        }
+
         /*calculate residuals for QLP coefficients at order 4*/
         calculate_residuals(sample_size,
                             sample_count,
@@ -1081,6 +1190,10 @@ compute_coefficients(struct alac_context* encoder,
         qlp_coefficients[2] =
         qlp_coefficients[3] = 0;
 
+        if (encoder->stats) {
+            stage_timer_enter(&encoder->stats->timer, STAGE_RESIDUAL);
+        }
+
         calculate_residuals(sample_size,
                             sample_count,
                             samples,
@@ -1094,6 +1207,10 @@ compute_coefficients(struct alac_context* encoder,
                          sample_count,
                          residual_values4);
     }
+
+    if (encoder->stats) {
+        stage_timer_enter(&encoder->stats->timer, previous_stage);
+    }
 }
 
 static void
@@ -1425,6 +1542,20 @@ dummy_frame_sizes(unsigned block_size, unsigned total_pcm_frames)
     return sizes;
 }
 
+static unsigned
+write_ftyp(BitstreamWriter* bw)
+{
+    struct qt_atom *ftyp = qt_ftyp_new((uint8_t*)"M4A ", 0, 4,
+                                       (uint8_t*)"M4A ",
+                                       (uint8_t*)"mp42",
+                                       (uint8_t*)"isom",
+                                       (uint8_t*)"\x00\x00\x00\x00");
+    const unsigned ftyp_size = ftyp->size(ftyp);
+    ftyp->build(ftyp, bw);
+    ftyp->free(ftyp);
+    return ftyp_size;
+}
+
 static unsigned
 write_metadata(BitstreamWriter* bw,
                time_t timestamp,
@@ -1463,7 +1594,6 @@ write_metadata(BitstreamWriter* bw,
     unsigned chunk_size = 0;
 
     /*some atoms to generate*/
-    struct qt_atom *ftyp;
     struct qt_atom *stts = qt_stts_new(0, 0);
     struct qt_atom *stsc = qt_stsc_new(0, 0);
     struct qt_atom *stsz = qt_stsz_new(0, 0, 0);
@@ -1521,16 +1651,6 @@ write_metadata(BitstreamWriter* bw,
     bitrate *= sample_rate;
     bitrate /= total_pcm_frames;
 
-    /*ftyp atom*/
-    ftyp = qt_ftyp_new((uint8_t*)"M4A ", 0, 4,
-                       (uint8_t*)"M4A ",
-                       (uint8_t*)"mp42",
-                       (uint8_t*)"isom",
-                       (uint8_t*)"\x00\x00\x00\x00");
-    ftyp->build(ftyp, bw);
-    total_size += ftyp->size(ftyp);
-    ftyp->free(ftyp);
-
     /*stbl atom*/
     stbl = qt_tree_new("stbl", 5,
       qt_stsd_new(0, 0, 1,
@@ -1767,7 +1887,8 @@ int main(int argc, char *argv[]) {
                               initial_history,
                               history_multiplier,
                               maximum_k,
-                              encoder_version);
+                              encoder_version,
+                              NULL);
 
     output->close(output);
     pcmreader->close(pcmreader);
@@ -9,6 +9,7 @@
 #include <time.h>
 #include "../pcmreader.h"
 #include "../bitstream.h"
+#include "../common/encoder_stats.h"
 
 /********************************************************
  Audio Tools, a module and set of tools for manipulating audio data
@@ -46,6 +47,30 @@ struct alac_encoding_options {
     unsigned maximum_interlacing_leftweight;
 };
 
+/*what went into an encoded stream, gathered only when requested*/
+struct alacenc_stats {
+    struct stage_timer timer;
+
+    unsigned framesets;
+    unsigned compressed_frames;
+    unsigned uncompressed_frames;
+    unsigned lpc_orders[MAX_QLP_COEFFS + 1];
+    unsigned interlacing_leftweights[5];
+
+    uint64_t frame_bytes;       /*complete framesets*/
+    uint64_t residual_bits;     /*residual blocks*/
+    uint64_t verbatim_bits;     /*uncompressed samples and LSBs*/
+};
+
+/*the parameters of a compressed frame and the size of its parts*/
+struct alac_frame_choice {
+    unsigned channels;
+    unsigned interlacing_leftweight;
+    unsigned orders[2];
+    unsigned residual_bits;
+    unsigned verbatim_bits;
+};
+
 /*this is a container for encoding options and reusable data buffers*/
 struct alac_context {
     struct alac_encoding_options options;
@@ -64,6 +89,13 @@ struct alac_context {
     BitstreamRecorder *interlaced_frame;
     BitstreamRecorder *best_interlaced_frame;
 
+    /*NULL unless gathering stats,
+      in which case the latest compressed frame attempt is described
+      by "candidate" and the one actually chosen by "chosen"*/
+    struct alacenc_stats *stats;
+    struct alac_frame_choice candidate;
+    struct alac_frame_choice chosen;
+
     /*set during write_frame
       in case a single residual value exceeds the maximum allowed
       when writing a compressed frame
@@ -84,8 +116,8 @@ free_encoder(struct alac_context* encoder);
 /*encodes the mdat atom and returns a linked list of frame sizes
 
   if "total_pcm_frames" is 0, assume the total size of the input
-  stream is unknown and write to a temporary file before
-  encoding to output*/
+  stream is unknown and write the metadata atoms after
+  the mdat atom rather than before it*/
 static struct alac_frame_size*
 encode_alac(BitstreamWriter *output,
             struct PCMReader *pcmreader,
@@ -94,7 +126,8 @@ encode_alac(BitstreamWriter *output,
             int initial_history,
             int history_multiplier,
             int maximum_k,
-            const char encoder_version[]);
+            const char encoder_version[],
+            struct alacenc_stats *stats);
 
 /*encodes the entire mdat atom and returns a linked list of frame sizes*/
 static struct alac_frame_size*
@@ -103,7 +136,8 @@ encode_mdat(BitstreamWriter *output,
             int block_size,
             int initial_history,
             int history_multiplier,
-            int maximum_k);
+            int maximum_k,
+            struct alacenc_stats *stats);
 
 /*writes a full set of ALAC frames,
   complete with trailing stop '111' bits and byte-aligned*/
@@ -238,8 +272,14 @@ write_residual(BitstreamWriter* residual_block,
 static struct alac_frame_size*
 dummy_frame_sizes(unsigned block_size, unsigned total_pcm_frames);
 
-/*writes the metadata atoms which precede the file's "mdat" atom
-  and returns the total size of those atoms in bytes*/
+/*writes the file's "ftyp" atom and returns its size in bytes*/
+static unsigned
+write_ftyp(BitstreamWriter* bw);
+
+/*writes the "moov" and "free" metadata atoms
+  and returns the total size of those atoms in bytes
+
+  "frames_offset" is the absolute position of the first ALAC frame*/
 static unsigned
 write_metadata(BitstreamWriter* bw,
                time_t timestamp,
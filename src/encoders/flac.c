@@ -25,10 +25,29 @@ struct flac_frame_size {
     struct flac_frame_size *next;  /*NULL at end of list*/
 };
 
+/*the encoding chosen for a single subframe
+  along with its total size in bits once written*/
+struct flac_subframe {
+    subframe_type_t type;
+    unsigned wasted_bps;
+    unsigned bits_per_sample;          /*not including wasted bits*/
+    unsigned order;                    /*FIXED and LPC only*/
+    unsigned precision;                /*LPC only*/
+    int shift;                         /*LPC only*/
+    int coefficients[MAX_QLP_COEFFS];  /*LPC only*/
+    unsigned bits;
+};
+
 /*******************************
  * private function signatures *
  *******************************/
 
+#ifndef STANDALONE
+/*returns the gathered statistics as a dict*/
+static PyObject*
+flac_stats_dict(const struct flacenc_stats *stats);
+#endif
+
 static void
 write_block_header(BitstreamWriter *output,
                    unsigned is_last,
@@ -74,6 +93,17 @@ write_SEEKTABLE(BitstreamWriter *output,
                 struct flac_frame_size *sizes,
                 unsigned seekpoint_interval);
 
+/*writes a SEEKTABLE followed by a PADDING block, if necessary,
+  such that both occupy exactly "reserved_size" bytes
+  including block headers
+
+  the seekpoint interval is widened as needed to make the table fit*/
+static void
+write_reserved_SEEKTABLE(BitstreamWriter *output,
+                         struct flac_frame_size *sizes,
+                         unsigned seekpoint_interval,
+                         unsigned reserved_size);
+
 static unsigned
 reader_mask(const struct PCMReader *pcmreader);
 
@@ -132,12 +162,23 @@ encode_bits_per_sample(unsigned bits_per_sample);
 static void
 write_utf8(BitstreamWriter *output, unsigned value);
 
+/*determines the smallest subframe encoding of the given samples
+  from the size of each candidate, without writing any of them,
+  and removes any wasted bits from the samples*/
 static void
-encode_subframe(BitstreamWriter *output,
-                const struct flac_encoding_options *options,
+choose_subframe(const struct flac_encoding_options *options,
                 unsigned sample_count,
                 int samples[],
-                unsigned bits_per_sample);
+                unsigned bits_per_sample,
+                struct flac_subframe *subframe);
+
+/*writes samples using the encoding chosen by choose_subframe()*/
+static void
+write_subframe(BitstreamWriter *output,
+               const struct flac_encoding_options *options,
+               unsigned sample_count,
+               const int samples[],
+               const struct flac_subframe *subframe);
 
 static void
 write_subframe_header(BitstreamWriter *output,
@@ -159,13 +200,25 @@ encode_verbatim_subframe(BitstreamWriter *output,
                          unsigned bits_per_sample,
                          unsigned wasted_bps);
 
+/*determines the best FIXED predictor order for the given samples
+  and returns the size of that FIXED subframe in bits,
+  not including the subframe header*/
+static unsigned
+fixed_subframe_bits(const struct flac_encoding_options *options,
+                    unsigned sample_count,
+                    const int samples[],
+                    unsigned bits_per_sample,
+                    unsigned *predictor_order);
+
+/*writes FIXED subframe to disk,
+  not including the subframe header*/
 static void
-encode_fixed_subframe(BitstreamWriter *output,
-                      const struct flac_encoding_options *options,
-                      unsigned sample_count,
-                      const int samples[],
-                      unsigned bits_per_sample,
-                      unsigned wasted_bps);
+write_fixed_subframe(BitstreamWriter *output,
+                     const struct flac_encoding_options *options,
+                     unsigned sample_count,
+                     const int samples[],
+                     unsigned bits_per_sample,
+                     unsigned predictor_order);
 
 static void
 next_fixed_order(unsigned sample_count,
@@ -175,14 +228,27 @@ next_fixed_order(unsigned sample_count,
 static uint64_t
 abs_sum(unsigned count, const int values[]);
 
-/*calculates best LPC subframe and writes LPC subframe to disk*/
-static void
-encode_lpc_subframe(BitstreamWriter *output,
-                    const struct flac_encoding_options *options,
-                    unsigned sample_count,
-                    const int samples[],
-                    unsigned bits_per_sample,
-                    unsigned wasted_bps);
+/*returns the size of the given LPC subframe in bits,
+  not including the subframe header*/
+static unsigned
+lpc_subframe_bits(const struct flac_encoding_options *options,
+                  unsigned sample_count,
+                  const int samples[],
+                  unsigned bits_per_sample,
+                  unsigned predictor_order,
+                  unsigned precision,
+                  int shift,
+                  const int coefficients[]);
+
+/*calculates sample_count - predictor_order residuals
+  from the given LPC parameters*/
+static void
+lpc_residuals(unsigned sample_count,
+              const int samples[],
+              unsigned predictor_order,
+              int shift,
+              const int coefficients[],
+              int residuals[]);
 
 /*writes actual LPC subframe to disk,
   not including the subframe header*/
@@ -242,6 +308,31 @@ quantize_lp_coefficients(unsigned lpc_order,
                          int qlp_coeff[],
                          int *shift);
 
+/*determines the coding method, partition order, Rice parameters
+  and escaped partitions for the given residuals
+  and returns the residual block's size in bits
+
+  "rice_parameters" and "escape_bits" must hold
+  2 ^ max_residual_partition_order values
+  and escape_bits[p] is nonzero if partition "p" is stored uncompressed
+  with that many bits per residual*/
+static unsigned
+plan_residual_block(const struct flac_encoding_options *options,
+                    unsigned sample_count,
+                    unsigned predictor_order,
+                    const int residuals[],
+                    unsigned *coding_method,
+                    unsigned *partition_order,
+                    unsigned rice_parameters[],
+                    unsigned escape_bits[]);
+
+/*returns the size of the given residuals' block in bits*/
+static unsigned
+residual_block_bits(const struct flac_encoding_options *options,
+                    unsigned sample_count,
+                    unsigned predictor_order,
+                    const int residuals[]);
+
 static void
 write_residual_block(BitstreamWriter *output,
                      const struct flac_encoding_options *options,
@@ -249,6 +340,13 @@ write_residual_block(BitstreamWriter *output,
                      unsigned predictor_order,
                      const int residuals[]);
 
+/*returns the size of a Rice-coded residual partition in bits*/
+static unsigned
+compressed_partition_bits(unsigned coding_method,
+                          unsigned rice_parameter,
+                          unsigned partition_size,
+                          const int residuals[]);
+
 static void
 write_compressed_residual_partition(BitstreamWriter *output,
                                     unsigned coding_method,
@@ -331,9 +429,13 @@ flacenc_init_options(struct flac_encoding_options *options)
     options->use_constant = 1;
     options->use_fixed = 1;
 
+    options->streaming = 0;
+
     /*these are just placeholders*/
     options->qlp_coeff_precision = 12;
     options->max_rice_parameter = 14;
+
+    options->stats = NULL;
 }
 
 void
@@ -361,9 +463,17 @@ flacenc_display_options(const struct flac_encoding_options *options,
            options->use_constant);
     printf("use FIXED subframes     %d\n",
            options->use_fixed);
+    printf("streaming               %d\n",
+           options->streaming);
 }
 
-#define BUFFER_SIZE 4096
+/*the extra space to reserve for a SEEKTABLE
+  when encoding a stream of unknown length,
+  which holds an hour of seekpoints at the default interval
+
+  since the frames follow it, whatever the SEEKTABLE doesn't use
+  is left as PADDING in addition to the requested padding*/
+#define SEEKTABLE_RESERVE ((8 + 8 + 2) * 360)
 
 flacenc_status_t
 flacenc_encode_flac(struct PCMReader *pcmreader,
@@ -422,7 +532,61 @@ flacenc_encode_flac(struct PCMReader *pcmreader,
     /*write signature*/
     output->write_bytes(output, signature, 4);
 
-    if (total_pcm_frames) {
+    if (options->streaming) {
+        /*output stream can't be rewound,
+          so write STREAMINFO with unknown frame sizes and MD5 sum
+          and leave out the SEEKTABLE entirely*/
+
+        uint64_t encoded_pcm_frames;
+
+        write_STREAMINFO(output,
+                         0,
+                         options->block_size,
+                         options->block_size,
+                         0,
+                         0,
+                         pcmreader->sample_rate,
+                         pcmreader->channels,
+                         pcmreader->bits_per_sample,
+                         total_pcm_frames,
+                         md5sum);
+
+        /*write VORBIS_COMMENT based on version and channel mask*/
+        write_VORBIS_COMMENT(output,
+                             padding_size ? 0 : 1,
+                             version,
+                             pcmreader);
+
+        /*write PADDING to disk, if any*/
+        if (padding_size) {
+            write_PADDING(output, 1, padding_size);
+        }
+
+        /*encode frames directly to output stream*/
+        frame_sizes = encode_frames(pcmreader,
+                                    output,
+                                    options,
+                                    &md5_context);
+
+        /*delete window now that we're done with it, if necessary*/
+        free(options->window);
+
+        if (!frame_sizes) {
+            return FLAC_READ_ERROR;
+        }
+
+        /*ensure total PCM frames matches, if known*/
+        frame_sizes_info(frame_sizes,
+                         &minimum_frame_size,
+                         &maximum_frame_size,
+                         &encoded_pcm_frames);
+
+        free_frame_sizes(frame_sizes);
+
+        if (total_pcm_frames && (encoded_pcm_frames != total_pcm_frames)) {
+            return FLAC_PCM_MISMATCH;
+        }
+    } else if (total_pcm_frames) {
         /*total number of PCM frames is known in advance*/
 
         bw_pos_t *streaminfo_start = output->getpos(output);
@@ -507,32 +671,47 @@ flacenc_encode_flac(struct PCMReader *pcmreader,
     } else {
         /*total number of PCM frames isn't known in advance*/
 
-        /*encode frames to temporary space*/
-        FILE *tempfile = tmpfile();
-        BitstreamWriter *temp_output;
-        uint8_t buffer[BUFFER_SIZE];
-        size_t amount_read;
+        bw_pos_t *streaminfo_start = output->getpos(output);
+        bw_pos_t *reserved_start;
+        const unsigned reserved_size =
+            MIN(padding_size + SEEKTABLE_RESERVE, (1 << 24) - 1);
 
-        if (tempfile) {
-            temp_output = bw_open(tempfile, BS_BIG_ENDIAN);
-        } else {
-            /*unable to open temporary file*/
-            fclose(tempfile);
-            return FLAC_NO_TEMPFILE;
-        }
+        /*write placeholder STREAMINFO*/
+        write_STREAMINFO(output,
+                         0,
+                         options->block_size,
+                         options->block_size,
+                         (1 << 24) - 1,
+                         0,
+                         pcmreader->sample_rate,
+                         pcmreader->channels,
+                         pcmreader->bits_per_sample,
+                         0,
+                         md5sum);
 
+        /*write VORBIS_COMMENT based on version and channel mask*/
+        write_VORBIS_COMMENT(output,
+                             0,
+                             version,
+                             pcmreader);
+
+        /*write PADDING large enough to hold the eventual SEEKTABLE
+          in addition to any requested padding*/
+        reserved_start = output->getpos(output);
+        write_PADDING(output, 1, reserved_size);
+
+        /*encode frames directly to output file*/
         frame_sizes = encode_frames(pcmreader,
-                                    temp_output,
+                                    output,
                                     options,
                                     &md5_context);
 
-        temp_output->free(temp_output);
-
         /*delete window now that we're done with it, if necessary*/
         free(options->window);
 
         if (!frame_sizes) {
-            fclose(tempfile);
+            streaminfo_start->del(streaminfo_start);
+            reserved_start->del(reserved_start);
             return FLAC_READ_ERROR;
         }
 
@@ -542,7 +721,9 @@ flacenc_encode_flac(struct PCMReader *pcmreader,
                          &maximum_frame_size,
                          &total_pcm_frames);
 
-        /*write STREAMINFO to disk*/
+        /*rewrite STREAMINFO based on frames information*/
+        output->setpos(output, streaminfo_start);
+        streaminfo_start->del(streaminfo_start);
         audiotools__MD5Final(md5sum, &md5_context);
         write_STREAMINFO(output,
                          0,
@@ -556,34 +737,16 @@ flacenc_encode_flac(struct PCMReader *pcmreader,
                          total_pcm_frames,
                          md5sum);
 
-        /*write SEEKTABLE to disk*/
-        write_SEEKTABLE(output,
-                        0,
-                        frame_sizes,
-                        seekpoint_interval);
+        /*carve SEEKTABLE out of the reserved PADDING block*/
+        output->setpos(output, reserved_start);
+        reserved_start->del(reserved_start);
+        write_reserved_SEEKTABLE(output,
+                                 frame_sizes,
+                                 seekpoint_interval,
+                                 4 + reserved_size);
 
         /*free frames information*/
         free_frame_sizes(frame_sizes);
-
-        /*write VORBIS_COMMENT based on version and channel mask*/
-        write_VORBIS_COMMENT(output,
-                             padding_size ? 0 : 1,
-                             version,
-                             pcmreader);
-
-        /*write PADDING to disk, if any*/
-        if (padding_size) {
-            write_PADDING(output, 1, padding_size);
-        }
-
-        /*transfer frame data from temporary space to output file*/
-        rewind(tempfile);
-        while ((amount_read = fread(buffer, 1, BUFFER_SIZE, tempfile)) > 0) {
-            output->write_bytes(output, buffer, (unsigned)amount_read);
-        }
-
-        /*free temporary space*/
-        fclose(tempfile);
     }
 
     /*return success*/
@@ -615,6 +778,7 @@ encoders_encode_flac(PyObject *dummy, PyObject *args, PyObject *keywds)
                              "disable_fixed_subframes",
                              "disable_lpc_subframes",
                              "padding_size",
+                             "stats",
                              NULL};
 
     char *filename = NULL;
@@ -635,6 +799,9 @@ encoders_encode_flac(PyObject *dummy, PyObject *args, PyObject *keywds)
     int no_fixed_subframes = 0;
     int no_lpc_subframes = 0;
 
+    int gather_stats = 0;
+    struct flacenc_stats stats;
+
     flacenc_status_t result;
 
     flacenc_init_options(&options);
@@ -642,7 +809,7 @@ encoders_encode_flac(PyObject *dummy, PyObject *args, PyObject *keywds)
     if (!PyArg_ParseTupleAndKeywords(
             args,
             keywds,
-            "sO&s|Liiiiiiiiiiii",
+            "sO&s|Liiiiiiiiiiiii",
             kwlist,
             &filename,
             py_obj_to_pcmreader,
@@ -661,7 +828,8 @@ encoders_encode_flac(PyObject *dummy, PyObject *args, PyObject *keywds)
             &no_constant_subframes,
             &no_fixed_subframes,
             &no_lpc_subframes,
-            &padding_size)) {
+            &padding_size,
+            &gather_stats)) {
         return NULL;
     }
 
@@ -730,7 +898,20 @@ encoders_encode_flac(PyObject *dummy, PyObject *args, PyObject *keywds)
         PyErr_SetFromErrnoWithFilename(PyExc_IOError, filename);
         goto error;
     }
-    output = bw_open(output_file, BS_BIG_ENDIAN);
+    if (gather_stats) {
+        memset(&stats, 0, sizeof(struct flacenc_stats));
+        stage_timer_init(&stats.timer);
+        options.stats = &stats;
+        output = bw_open_timed_file(output_file, BS_BIG_ENDIAN, &stats.timer);
+    } else {
+        output = bw_open(output_file, BS_BIG_ENDIAN);
+    }
+
+    /*pipes and other unseekable outputs are encoded in a single pass
+      without rewriting STREAMINFO afterward*/
+    if (fseek(output_file, 0, SEEK_CUR) != 0) {
+        options.streaming = 1;
+    }
 
     /*perform actual encoding*/
     result = flacenc_encode_flac(pcmreader,
@@ -746,17 +927,19 @@ encoders_encode_flac(PyObject *dummy, PyObject *args, PyObject *keywds)
     switch (result) {
     case FLAC_OK:
     default:
-        Py_INCREF(Py_None);
-        return Py_None;
+        if (gather_stats) {
+            stage_timer_enter(&stats.timer, STAGE_OTHER);
+            return flac_stats_dict(&stats);
+        } else {
+            Py_INCREF(Py_None);
+            return Py_None;
+        }
     case FLAC_READ_ERROR:
         PyErr_SetString(PyExc_IOError, "read error during encoding");
         return NULL;
     case FLAC_PCM_MISMATCH:
         PyErr_SetString(PyExc_ValueError, "total_pcm_frames mismatch");
         return NULL;
-    case FLAC_NO_TEMPFILE:
-        PyErr_SetString(PyExc_IOError, "error opening temporary file");
-        return NULL;
     }
 
 error:
@@ -764,6 +947,34 @@ error:
     return NULL;
 }
 
+static PyObject*
+flac_stats_dict(const struct flacenc_stats *stats)
+{
+    const uint64_t residual_bytes = stats->residual_bits / 8;
+    const uint64_t verbatim_bytes = stats->verbatim_bits / 8;
+
+    return Py_BuildValue(
+        "{sNsIs{sIsIsIsI}sNsNsNsNsIsKsKsK}",
+        "times", stage_timer_dict(&stats->timer),
+        "frames", stats->frames,
+        "subframe_types",
+        "constant", stats->subframe_types[CONSTANT],
+        "verbatim", stats->subframe_types[VERBATIM],
+        "fixed", stats->subframe_types[FIXED],
+        "lpc", stats->subframe_types[LPC],
+        "fixed_orders", histogram_list(5, stats->fixed_orders),
+        "lpc_orders", histogram_list(33, stats->lpc_orders),
+        "partition_orders", histogram_list(16, stats->partition_orders),
+        "rice_parameters", histogram_list(32, stats->rice_parameters),
+        "escaped_partitions", stats->escaped_partitions,
+        "header_bytes",
+        (unsigned long long)(stats->frame_bytes -
+                             residual_bytes -
+                             verbatim_bytes),
+        "residual_bytes", (unsigned long long)residual_bytes,
+        "verbatim_bytes", (unsigned long long)verbatim_bytes);
+}
+
 #endif
 
 /************************************
@@ -924,6 +1135,32 @@ write_SEEKTABLE(BitstreamWriter *output,
            total_seek_points(original_sizes, seekpoint_interval));
 }
 
+static void
+write_reserved_SEEKTABLE(BitstreamWriter *output,
+                         struct flac_frame_size *sizes,
+                         unsigned seekpoint_interval,
+                         unsigned reserved_size)
+{
+    unsigned seektable_size =
+        4 + total_seek_points(sizes, seekpoint_interval) * (8 + 8 + 2);
+
+    /*a trailing PADDING block needs at least 4 bytes for its header*/
+    while ((seektable_size > reserved_size) ||
+           ((seektable_size < reserved_size) &&
+            ((reserved_size - seektable_size) < 4))) {
+        seekpoint_interval *= 2;
+        seektable_size =
+            4 + total_seek_points(sizes, seekpoint_interval) * (8 + 8 + 2);
+    }
+
+    if (seektable_size == reserved_size) {
+        write_SEEKTABLE(output, 1, sizes, seekpoint_interval);
+    } else {
+        write_SEEKTABLE(output, 0, sizes, seekpoint_interval);
+        write_PADDING(output, 1, reserved_size - seektable_size - 4);
+    }
+}
+
 static unsigned
 reader_mask(const struct PCMReader *pcmreader)
 {
@@ -1022,12 +1259,21 @@ encode_frames(struct PCMReader *pcmreader,
     int pcm_data[options->block_size * pcmreader->channels];
     unsigned pcm_frames_read;
     unsigned frame_number = 0;
+    struct flacenc_stats *stats = options->stats;
+    encoder_stage_t previous_stage = STAGE_OTHER;
+
+    if (stats) {
+        previous_stage = stage_timer_enter(&stats->timer, STAGE_PCM_READ);
+    }
 
     while ((pcm_frames_read =
             pcmreader->read(pcmreader, options->block_size, pcm_data)) > 0) {
         unsigned frame_size = 0;
 
         /*update running MD5 of stream*/
+        if (stats) {
+            stage_timer_enter(&stats->timer, STAGE_MD5);
+        }
         update_md5sum(md5_context,
                       pcm_data,
                       pcmreader->channels,
@@ -1035,6 +1281,9 @@ encode_frames(struct PCMReader *pcmreader,
                       pcm_frames_read);
 
         /*encode frame itself*/
+        if (stats) {
+            stage_timer_enter(&stats->timer, STAGE_WRITE);
+        }
         output->add_callback(output, (bs_callback_f)byte_counter, &frame_size);
         encode_frame(pcmreader,
                      output,
@@ -1048,6 +1297,16 @@ encode_frames(struct PCMReader *pcmreader,
         frame_sizes = push_frame_size(frame_sizes,
                                       frame_size,
                                       pcm_frames_read);
+
+        if (stats) {
+            stats->frames += 1;
+            stats->frame_bytes += frame_size;
+            stage_timer_enter(&stats->timer, STAGE_PCM_READ);
+        }
+    }
+
+    if (stats) {
+        stage_timer_enter(&stats->timer, previous_stage);
     }
 
     if (pcmreader->status == PCM_OK) {
@@ -1070,7 +1329,9 @@ encode_frame(const struct PCMReader *pcmreader,
     unsigned c;
     uint16_t crc16 = 0;
 
-    output->add_callback(output, (bs_callback_f)flac_crc16, &crc16);
+    output->add_span_callback(output,
+                              (bs_span_callback_f)flac_crc16_span,
+                              &crc16);
 
     if ((pcmreader->channels == 2) &&
         (options->mid_side || options->adaptive_mid_side)) {
@@ -1080,14 +1341,10 @@ encode_frame(const struct PCMReader *pcmreader,
         int average_channel[pcm_frames];
         int difference_channel[pcm_frames];
 
-        BitstreamRecorder *left_subframe =
-            bw_open_recorder(BS_BIG_ENDIAN);
-        BitstreamRecorder *right_subframe =
-            bw_open_recorder(BS_BIG_ENDIAN);
-        BitstreamRecorder *average_subframe =
-            bw_open_recorder(BS_BIG_ENDIAN);
-        BitstreamRecorder *difference_subframe =
-            bw_open_recorder(BS_BIG_ENDIAN);
+        struct flac_subframe left_subframe;
+        struct flac_subframe right_subframe;
+        struct flac_subframe average_subframe;
+        struct flac_subframe difference_subframe;
 
         unsigned independent;
         unsigned left_side;
@@ -1103,41 +1360,39 @@ encode_frame(const struct PCMReader *pcmreader,
                            average_channel,
                            difference_channel);
 
-        encode_subframe((BitstreamWriter*)left_subframe,
-                        options,
+        /*size up each channel's best subframe
+          and only write the pair which is smallest in total*/
+        choose_subframe(options,
                         pcm_frames,
                         left_channel,
-                        pcmreader->bits_per_sample);
+                        pcmreader->bits_per_sample,
+                        &left_subframe);
 
-        encode_subframe((BitstreamWriter*)right_subframe,
-                        options,
+        choose_subframe(options,
                         pcm_frames,
                         right_channel,
-                        pcmreader->bits_per_sample);
+                        pcmreader->bits_per_sample,
+                        &right_subframe);
 
-        encode_subframe((BitstreamWriter*)average_subframe,
-                        options,
+        choose_subframe(options,
                         pcm_frames,
                         average_channel,
-                        pcmreader->bits_per_sample);
+                        pcmreader->bits_per_sample,
+                        &average_subframe);
 
-        encode_subframe((BitstreamWriter*)difference_subframe,
-                        options,
+        choose_subframe(options,
                         pcm_frames,
                         difference_channel,
-                        pcmreader->bits_per_sample + 1);
+                        pcmreader->bits_per_sample + 1,
+                        &difference_subframe);
 
-        independent = left_subframe->bits_written(left_subframe) +
-                      right_subframe->bits_written(right_subframe);
+        independent = left_subframe.bits + right_subframe.bits;
 
-        left_side = left_subframe->bits_written(left_subframe) +
-                    difference_subframe->bits_written(difference_subframe);
+        left_side = left_subframe.bits + difference_subframe.bits;
 
-        side_right = difference_subframe->bits_written(difference_subframe) +
-                     right_subframe->bits_written(right_subframe);
+        side_right = difference_subframe.bits + right_subframe.bits;
 
-        mid_side = average_subframe->bits_written(average_subframe) +
-                   difference_subframe->bits_written(difference_subframe);
+        mid_side = average_subframe.bits + difference_subframe.bits;
 
         if ((independent < left_side) &&
             (independent < side_right) &&
@@ -1150,8 +1405,10 @@ encode_frame(const struct PCMReader *pcmreader,
                                pcmreader->bits_per_sample,
                                frame_number,
                                1);
-            left_subframe->copy(left_subframe, output);
-            right_subframe->copy(right_subframe, output);
+            write_subframe(output, options, pcm_frames,
+                           left_channel, &left_subframe);
+            write_subframe(output, options, pcm_frames,
+                           right_channel, &right_subframe);
         } else if ((left_side < side_right) && (left_side < mid_side)) {
             /*write subframes using left-side order*/
             write_frame_header(output,
@@ -1161,8 +1418,10 @@ encode_frame(const struct PCMReader *pcmreader,
                                pcmreader->bits_per_sample,
                                frame_number,
                                8);
-            left_subframe->copy(left_subframe, output);
-            difference_subframe->copy(difference_subframe, output);
+            write_subframe(output, options, pcm_frames,
+                           left_channel, &left_subframe);
+            write_subframe(output, options, pcm_frames,
+                           difference_channel, &difference_subframe);
         } else if (side_right < mid_side) {
             /*write subframes using side-right order*/
             write_frame_header(output,
@@ -1172,8 +1431,10 @@ encode_frame(const struct PCMReader *pcmreader,
                                pcmreader->bits_per_sample,
                                frame_number,
                                9);
-            difference_subframe->copy(difference_subframe, output);
-            right_subframe->copy(right_subframe, output);
+            write_subframe(output, options, pcm_frames,
+                           difference_channel, &difference_subframe);
+            write_subframe(output, options, pcm_frames,
+                           right_channel, &right_subframe);
         } else {
             /*write subframes using mid-side order*/
             write_frame_header(output,
@@ -1183,14 +1444,11 @@ encode_frame(const struct PCMReader *pcmreader,
                                pcmreader->bits_per_sample,
                                frame_number,
                                10);
-            average_subframe->copy(average_subframe, output);
-            difference_subframe->copy(difference_subframe, output);
+            write_subframe(output, options, pcm_frames,
+                           average_channel, &average_subframe);
+            write_subframe(output, options, pcm_frames,
+                           difference_channel, &difference_subframe);
         }
-
-        left_subframe->close(left_subframe);
-        right_subframe->close(right_subframe);
-        average_subframe->close(average_subframe);
-        difference_subframe->close(difference_subframe);
     } else {
         /*store channels independently*/
 
@@ -1207,15 +1465,22 @@ encode_frame(const struct PCMReader *pcmreader,
         /*write 1 subframe per channel*/
         for (c = 0; c < pcmreader->channels; c++) {
             int channel_data[pcm_frames];
+            struct flac_subframe subframe;
 
             get_channel_data(pcm_data, c, pcmreader->channels,
                              pcm_frames, channel_data);
 
-            encode_subframe(output,
-                            options,
+            choose_subframe(options,
                             pcm_frames,
                             channel_data,
-                            pcmreader->bits_per_sample);
+                            pcmreader->bits_per_sample,
+                            &subframe);
+
+            write_subframe(output,
+                           options,
+                           pcm_frames,
+                           channel_data,
+                           &subframe);
         }
     }
 
@@ -1255,7 +1520,9 @@ write_frame_header(BitstreamWriter *output,
     const unsigned encoded_sample_rate = encode_sample_rate(sample_rate);
     const unsigned encoded_bps = encode_bits_per_sample(bits_per_sample);
 
-    output->add_callback(output, (bs_callback_f)flac_crc8, &crc8);
+    output->add_span_callback(output,
+                              (bs_span_callback_f)flac_crc8_span,
+                              &crc8);
 
     output->write(output, 14, 0x3FFE);            /*sync code*/
     output->write(output, 1, 0);                  /*reserved*/
@@ -1394,24 +1661,21 @@ write_utf8(BitstreamWriter *output, unsigned value)
 }
 
 static void
-encode_subframe(BitstreamWriter *output,
-                const struct flac_encoding_options *options,
+choose_subframe(const struct flac_encoding_options *options,
                 unsigned sample_count,
                 int samples[],
-                unsigned bits_per_sample)
+                unsigned bits_per_sample,
+                struct flac_subframe *subframe)
 {
     if (options->use_constant && samples_identical(sample_count, samples)) {
-        encode_constant_subframe(output,
-                                 sample_count,
-                                 samples[0],
-                                 bits_per_sample,
-                                 0);
+        subframe->type = CONSTANT;
+        subframe->wasted_bps = 0;
+        subframe->bits_per_sample = bits_per_sample;
+        subframe->bits = 8 + bits_per_sample;
     } else {
         const unsigned wasted_bps =
             calculate_wasted_bps(sample_count, samples);
-        unsigned smallest_subframe_size = 0;
-        BitstreamRecorder *fixed_subframe = NULL;
-        BitstreamRecorder *lpc_subframe = NULL;
+        unsigned largest_subframe_size;
 
         /*remove wasted bits from least-signficant bits, if any*/
         if (wasted_bps) {
@@ -1422,79 +1686,157 @@ encode_subframe(BitstreamWriter *output,
             bits_per_sample -= wasted_bps;
         }
 
-        if (options->use_verbatim) {
-            smallest_subframe_size =
-                8 + wasted_bps +
-                ((bits_per_sample - wasted_bps) * sample_count);
-        }
+        subframe->wasted_bps = wasted_bps;
+        subframe->bits_per_sample = bits_per_sample;
 
-        if (options->use_fixed) {
-            fixed_subframe =
-                bw_open_limited_recorder(BS_BIG_ENDIAN,
-                                         smallest_subframe_size);
+        /*VERBATIM is written if nothing else is available or smaller*/
+        subframe->type = VERBATIM;
+        subframe->bits =
+            8 + wasted_bps + (bits_per_sample * sample_count);
 
-            if (!setjmp(*bw_try((BitstreamWriter*)fixed_subframe))) {
-                encode_fixed_subframe((BitstreamWriter*)fixed_subframe,
-                                      options,
-                                      sample_count,
-                                      samples,
-                                      bits_per_sample,
-                                      wasted_bps);
-                bw_etry((BitstreamWriter*)fixed_subframe);
+        /*other candidates must be no larger than the current one*/
+        largest_subframe_size =
+            options->use_verbatim ? subframe->bits : UINT_MAX;
 
-                smallest_subframe_size =
-                    fixed_subframe->bits_written(fixed_subframe);
-            } else {
-                /*FIXED subframe too large*/
-                bw_etry((BitstreamWriter*)fixed_subframe);
-                fixed_subframe->close(fixed_subframe);
-                fixed_subframe = NULL;
+        if (options->use_fixed) {
+            unsigned order;
+            const unsigned fixed_bits =
+                8 + wasted_bps +
+                fixed_subframe_bits(options,
+                                    sample_count,
+                                    samples,
+                                    bits_per_sample,
+                                    &order);
+
+            if (fixed_bits <= largest_subframe_size) {
+                subframe->type = FIXED;
+                subframe->order = order;
+                subframe->bits = largest_subframe_size = fixed_bits;
             }
         }
 
         if (options->max_lpc_order) {
-            lpc_subframe =
-                bw_open_limited_recorder(BS_BIG_ENDIAN,
-                                         smallest_subframe_size);
+            unsigned order;
+            unsigned precision;
+            int shift;
+            int coefficients[MAX_QLP_COEFFS];
+            unsigned lpc_bits;
+            encoder_stage_t previous_stage = STAGE_OTHER;
+
+            if (options->stats) {
+                previous_stage =
+                    stage_timer_enter(&options->stats->timer, STAGE_LPC);
+            }
 
-            if (!setjmp(*bw_try((BitstreamWriter*)lpc_subframe))) {
-                encode_lpc_subframe((BitstreamWriter*)lpc_subframe,
-                                    options,
-                                    sample_count,
-                                    samples,
-                                    bits_per_sample,
-                                    wasted_bps);
-                bw_etry((BitstreamWriter*)lpc_subframe);
+            calculate_best_lpc_params(options,
+                                      sample_count,
+                                      samples,
+                                      bits_per_sample,
+                                      &order,
+                                      &precision,
+                                      &shift,
+                                      coefficients);
 
-                smallest_subframe_size =
-                    lpc_subframe->bits_written(lpc_subframe);
+            if (options->stats) {
+                stage_timer_enter(&options->stats->timer, previous_stage);
+            }
 
-                if (fixed_subframe) {
-                    fixed_subframe->close(fixed_subframe);
-                    fixed_subframe = NULL;
-                }
-            } else {
-                /*LPC subframe too large*/
-                bw_etry((BitstreamWriter*)lpc_subframe);
-                lpc_subframe->close(lpc_subframe);
-                lpc_subframe = NULL;
+            lpc_bits =
+                8 + wasted_bps +
+                lpc_subframe_bits(options,
+                                  sample_count,
+                                  samples,
+                                  bits_per_sample,
+                                  order,
+                                  precision,
+                                  shift,
+                                  coefficients);
+
+            if (lpc_bits <= largest_subframe_size) {
+                subframe->type = LPC;
+                subframe->order = order;
+                subframe->precision = precision;
+                subframe->shift = shift;
+                memcpy(subframe->coefficients,
+                       coefficients,
+                       order * sizeof(int));
+                subframe->bits = lpc_bits;
             }
         }
+    }
+}
 
-        if (lpc_subframe) {
-            lpc_subframe->copy(lpc_subframe, output);
-            lpc_subframe->close(lpc_subframe);
-        } else if (fixed_subframe) {
-            fixed_subframe->copy(fixed_subframe, output);
-            fixed_subframe->close(fixed_subframe);
-        } else {
-            encode_verbatim_subframe(output,
-                                     sample_count,
-                                     samples,
-                                     bits_per_sample,
-                                     wasted_bps);
+static void
+write_subframe(BitstreamWriter *output,
+               const struct flac_encoding_options *options,
+               unsigned sample_count,
+               const int samples[],
+               const struct flac_subframe *subframe)
+{
+    struct flacenc_stats *stats = options->stats;
+
+    if (stats) {
+        stats->subframe_types[subframe->type] += 1;
+        switch (subframe->type) {
+        case CONSTANT:
+            stats->verbatim_bits += subframe->bits_per_sample;
+            break;
+        case VERBATIM:
+            stats->verbatim_bits +=
+                (uint64_t)subframe->bits_per_sample * sample_count;
+            break;
+        case FIXED:
+            stats->fixed_orders[subframe->order] += 1;
+            break;
+        case LPC:
+            stats->lpc_orders[subframe->order] += 1;
+            break;
         }
     }
+
+    switch (subframe->type) {
+    case CONSTANT:
+        encode_constant_subframe(output,
+                                 sample_count,
+                                 samples[0],
+                                 subframe->bits_per_sample,
+                                 0);
+        break;
+    case VERBATIM:
+        encode_verbatim_subframe(output,
+                                 sample_count,
+                                 samples,
+                                 subframe->bits_per_sample,
+                                 subframe->wasted_bps);
+        break;
+    case FIXED:
+        write_subframe_header(output,
+                              FIXED,
+                              subframe->order,
+                              subframe->wasted_bps);
+        write_fixed_subframe(output,
+                             options,
+                             sample_count,
+                             samples,
+                             subframe->bits_per_sample,
+                             subframe->order);
+        break;
+    case LPC:
+        write_subframe_header(output,
+                              LPC,
+                              subframe->order,
+                              subframe->wasted_bps);
+        write_lpc_subframe(output,
+                           options,
+                           sample_count,
+                           samples,
+                           subframe->bits_per_sample,
+                           subframe->order,
+                           subframe->precision,
+                           subframe->shift,
+                           subframe->coefficients);
+        break;
+    }
 }
 
 static void
@@ -1555,13 +1897,12 @@ encode_verbatim_subframe(BitstreamWriter *output,
     }
 }
 
-static void
-encode_fixed_subframe(BitstreamWriter *output,
-                      const struct flac_encoding_options *options,
-                      unsigned sample_count,
-                      const int samples[],
-                      unsigned bits_per_sample,
-                      unsigned wasted_bps)
+static unsigned
+fixed_subframe_bits(const struct flac_encoding_options *options,
+                    unsigned sample_count,
+                    const int samples[],
+                    unsigned bits_per_sample,
+                    unsigned *predictor_order)
 {
     const unsigned max_order = sample_count > 4 ? 4 : sample_count - 1;
     int order1[max_order >= 1 ? sample_count - 1 : 0];
@@ -1571,7 +1912,14 @@ encode_fixed_subframe(BitstreamWriter *output,
     const int *orders[] = {samples, order1, order2, order3, order4};
     uint64_t best_order_sum;
     unsigned best_order;
+    unsigned bits;
     unsigned i;
+    encoder_stage_t previous_stage = STAGE_OTHER;
+
+    if (options->stats) {
+        previous_stage =
+            stage_timer_enter(&options->stats->timer, STAGE_RESIDUAL);
+    }
 
     /*determine best FIXED subframe order*/
     if (max_order >= 1) {
@@ -1598,23 +1946,54 @@ encode_fixed_subframe(BitstreamWriter *output,
         }
     }
 
-    /*write subframe header*/
-    write_subframe_header(output,
-                          FIXED,
-                          best_order,
-                          wasted_bps);
+    *predictor_order = best_order;
+
+    /*warm-up samples followed by residual block*/
+    bits = (best_order * bits_per_sample) +
+           residual_block_bits(options,
+                               sample_count,
+                               best_order,
+                               orders[best_order]);
+
+    if (options->stats) {
+        stage_timer_enter(&options->stats->timer, previous_stage);
+    }
+
+    return bits;
+}
+
+static void
+write_fixed_subframe(BitstreamWriter *output,
+                     const struct flac_encoding_options *options,
+                     unsigned sample_count,
+                     const int samples[],
+                     unsigned bits_per_sample,
+                     unsigned predictor_order)
+{
+    int residuals[sample_count];
+    unsigned i;
 
     /*write warm-up samples*/
-    for (i = 0; i < best_order; i++) {
+    for (i = 0; i < predictor_order; i++) {
         output->write_signed(output, bits_per_sample, samples[i]);
     }
 
+    /*difference samples in place, once per order,
+      leaving the residuals at the end of the buffer*/
+    memcpy(residuals, samples, sample_count * sizeof(int));
+    for (i = 1; i <= predictor_order; i++) {
+        unsigned j;
+        for (j = sample_count - 1; j >= i; j--) {
+            residuals[j] -= residuals[j - 1];
+        }
+    }
+
     /*write residual block*/
     write_residual_block(output,
                          options,
                          sample_count,
-                         best_order,
-                         orders[i]);
+                         predictor_order,
+                         residuals + predictor_order);
 }
 
 static void
@@ -1639,39 +2018,67 @@ abs_sum(unsigned count, const int values[])
     return accumulator;
 }
 
+static unsigned
+lpc_subframe_bits(const struct flac_encoding_options *options,
+                  unsigned sample_count,
+                  const int samples[],
+                  unsigned bits_per_sample,
+                  unsigned predictor_order,
+                  unsigned precision,
+                  int shift,
+                  const int coefficients[])
+{
+    int residuals[sample_count - predictor_order];
+    unsigned bits;
+    encoder_stage_t previous_stage = STAGE_OTHER;
+
+    if (options->stats) {
+        previous_stage =
+            stage_timer_enter(&options->stats->timer, STAGE_RESIDUAL);
+    }
+
+    lpc_residuals(sample_count,
+                  samples,
+                  predictor_order,
+                  shift,
+                  coefficients,
+                  residuals);
+
+    /*warm-up samples, precision, shift and coefficients
+      followed by residual block*/
+    bits = (predictor_order * bits_per_sample) + 4 + 5 +
+           (predictor_order * precision) +
+           residual_block_bits(options,
+                               sample_count,
+                               predictor_order,
+                               residuals);
+
+    if (options->stats) {
+        stage_timer_enter(&options->stats->timer, previous_stage);
+    }
+
+    return bits;
+}
+
 static void
-encode_lpc_subframe(BitstreamWriter *output,
-                    const struct flac_encoding_options *options,
-                    unsigned sample_count,
-                    const int samples[],
-                    unsigned bits_per_sample,
-                    unsigned wasted_bps)
+lpc_residuals(unsigned sample_count,
+              const int samples[],
+              unsigned predictor_order,
+              int shift,
+              const int coefficients[],
+              int residuals[])
 {
-    unsigned predictor_order;
-    unsigned precision;
-    int shift;
-    int coefficients[MAX_QLP_COEFFS];
-
-    calculate_best_lpc_params(options,
-                              sample_count,
-                              samples,
-                              bits_per_sample,
-                              &predictor_order,
-                              &precision,
-                              &shift,
-                              coefficients);
-
-    write_subframe_header(output, LPC, predictor_order, wasted_bps);
-
-    write_lpc_subframe(output,
-                       options,
-                       sample_count,
-                       samples,
-                       bits_per_sample,
-                       predictor_order,
-                       precision,
-                       shift,
-                       coefficients);
+    register unsigned i;
+
+    for (i = predictor_order; i < sample_count; i++) {
+        register int64_t sum = 0;
+        register unsigned j;
+        for (j = 0; j < predictor_order; j++) {
+            sum += ((int64_t)coefficients[j] * (int64_t)samples[i - j - 1]);
+        }
+        sum >>= shift;
+        residuals[i - predictor_order] = samples[i] - (int)sum;
+    }
 }
 
 static void
@@ -1685,7 +2092,7 @@ write_lpc_subframe(BitstreamWriter *output,
                    int shift,
                    const int coefficients[])
 {
-    int residuals[sample_count - 1];
+    int residuals[sample_count - predictor_order];
     register unsigned i;
 
     for (i = 0; i < predictor_order; i++) {
@@ -1696,15 +2103,12 @@ write_lpc_subframe(BitstreamWriter *output,
     for (i = 0; i < predictor_order; i++) {
         output->write_signed(output, precision, coefficients[i]);
     }
-    for (i = predictor_order; i < sample_count; i++) {
-        register int64_t sum = 0;
-        register unsigned j;
-        for (j = 0; j < predictor_order; j++) {
-            sum += ((int64_t)coefficients[j] * (int64_t)samples[i - j - 1]);
-        }
-        sum >>= shift;
-        residuals[i - predictor_order] = samples[i] - (int)sum;
-    }
+    lpc_residuals(sample_count,
+                  samples,
+                  predictor_order,
+                  shift,
+                  coefficients,
+                  residuals);
     write_residual_block(output,
                          options,
                          sample_count,
@@ -1783,13 +2187,9 @@ calculate_best_lpc_params(const struct flac_encoding_options *options,
                 unsigned best_subframe_size = UINT_MAX;
 
                 for (order = 1; order <= max_lpc_order; order++) {
-                    BitstreamAccumulator *subframe =
-                        bw_open_limited_accumulator(
-                            BS_BIG_ENDIAN,
-                            best_subframe_size == UINT_MAX ?
-                            0 : best_subframe_size);
                     int candidate_coeff[order];
                     int candidate_shift;
+                    unsigned subframe_size;
 
                     quantize_lp_coefficients(order,
                                              lp_coeff,
@@ -1797,36 +2197,25 @@ calculate_best_lpc_params(const struct flac_encoding_options *options,
                                              candidate_coeff,
                                              &candidate_shift);
 
-                    if (!setjmp(*bw_try((BitstreamWriter*)subframe))) {
-                        write_lpc_subframe((BitstreamWriter*)subframe,
-                                           options,
-                                           sample_count,
-                                           samples,
-                                           bits_per_sample,
-                                           order,
-                                           *precision,
-                                           candidate_shift,
-                                           candidate_coeff);
-
-                        bw_etry((BitstreamWriter*)subframe);
-
-                        if (subframe->bits_written(subframe) <
-                            best_subframe_size) {
-                            /*and use values which generate
-                              the smallest LPC subframe when written*/
-                            *predictor_order = order;
-                            *shift = candidate_shift;
-                            memcpy(coefficients,
-                                   candidate_coeff,
-                                   order * sizeof(int));
-                            best_subframe_size =
-                                subframe->bits_written(subframe);
-                        }
-                    } else {
-                        bw_etry((BitstreamWriter*)subframe);
+                    subframe_size = lpc_subframe_bits(options,
+                                                      sample_count,
+                                                      samples,
+                                                      bits_per_sample,
+                                                      order,
+                                                      *precision,
+                                                      candidate_shift,
+                                                      candidate_coeff);
+
+                    if (subframe_size < best_subframe_size) {
+                        /*and use values which generate
+                          the smallest LPC subframe*/
+                        *predictor_order = order;
+                        *shift = candidate_shift;
+                        memcpy(coefficients,
+                               candidate_coeff,
+                               order * sizeof(int));
+                        best_subframe_size = subframe_size;
                     }
-
-                    subframe->close(subframe);
                 }
             }
         }
@@ -1962,17 +2351,18 @@ quantize_lp_coefficients(unsigned lpc_order,
     }
 }
 
-static void
-write_residual_block(BitstreamWriter *output,
-                     const struct flac_encoding_options *options,
-                     unsigned sample_count,
-                     unsigned predictor_order,
-                     const int residuals[])
+static unsigned
+plan_residual_block(const struct flac_encoding_options *options,
+                    unsigned sample_count,
+                    unsigned predictor_order,
+                    const int residuals[],
+                    unsigned *coding_method,
+                    unsigned *partition_order,
+                    unsigned rice_parameters[],
+                    unsigned escape_bits[])
 {
-    unsigned partition_order = 0;
     unsigned partition_count;
-    unsigned rice_parameters[1 << options->max_residual_partition_order];
-    unsigned coding = 0;
+    unsigned total_bits = 2 + 4;
     unsigned p;
     unsigned i = 0;
 
@@ -1980,89 +2370,173 @@ write_residual_block(BitstreamWriter *output,
                          sample_count,
                          predictor_order,
                          residuals,
-                         &partition_order,
+                         partition_order,
                          rice_parameters);
 
-    partition_count = 1 << partition_order;
+    partition_count = 1 << *partition_order;
 
     /*adjust coding method for large Rice parameters*/
+    *coding_method = 0;
     for (p = 0; p < partition_count; p++) {
         if (rice_parameters[p] > 14) {
-            coding = 1;
+            *coding_method = 1;
         }
     }
 
-    output->write(output, 2, coding);
-    output->write(output, 4, partition_order);
-
-    /*write residual partition(s)*/
     for (p = 0; p < partition_count; p++) {
-        unsigned partition_size =
+        const unsigned partition_size =
             (sample_count / partition_count) - (p == 0 ? predictor_order : 0);
+        const unsigned compressed_bits =
+            compressed_partition_bits(*coding_method,
+                                      rice_parameters[p],
+                                      partition_size,
+                                      residuals + i);
+
+        escape_bits[p] = 0;
 
         if (options->use_verbatim || (partition_size == 0)) {
             /*if our residuals get too large,
               count on the VERBATIM subframe to bail us out*/
-
-            write_compressed_residual_partition(
-                output,
-                coding,
-                rice_parameters[p],
-                partition_size,
-                residuals + i);
-
-            i += partition_size;
+            total_bits += compressed_bits;
         } else {
             /*if VERBATIM isn't an option,
               switch to escaped values if our residuals get too large*/
-
             const unsigned max_bits =
                 largest_residual_bits(residuals + i, partition_size);
 
-            BitstreamRecorder *partition =
-                bw_open_limited_recorder(BS_BIG_ENDIAN,
-                                         max_bits * partition_size);
+            if (compressed_bits <= (max_bits * partition_size)) {
+                total_bits += compressed_bits;
+            } else {
+                escape_bits[p] = max_bits;
+                total_bits += (*coding_method ? 5 : 4) + 5 +
+                              (max_bits * partition_size);
+            }
+        }
+
+        i += partition_size;
+    }
+
+    return total_bits;
+}
+
+static unsigned
+residual_block_bits(const struct flac_encoding_options *options,
+                    unsigned sample_count,
+                    unsigned predictor_order,
+                    const int residuals[])
+{
+    unsigned coding_method;
+    unsigned partition_order;
+    unsigned rice_parameters[1 << options->max_residual_partition_order];
+    unsigned escape_bits[1 << options->max_residual_partition_order];
+
+    return plan_residual_block(options,
+                               sample_count,
+                               predictor_order,
+                               residuals,
+                               &coding_method,
+                               &partition_order,
+                               rice_parameters,
+                               escape_bits);
+}
 
-            BitstreamWriter *partition_w = (BitstreamWriter*)partition;
+static void
+write_residual_block(BitstreamWriter *output,
+                     const struct flac_encoding_options *options,
+                     unsigned sample_count,
+                     unsigned predictor_order,
+                     const int residuals[])
+{
+    unsigned coding_method;
+    unsigned partition_order;
+    unsigned partition_count;
+    unsigned rice_parameters[1 << options->max_residual_partition_order];
+    unsigned escape_bits[1 << options->max_residual_partition_order];
+    unsigned p;
+    unsigned i = 0;
+    struct flacenc_stats *stats = options->stats;
+    encoder_stage_t previous_stage = STAGE_OTHER;
+    unsigned block_bits;
 
-            if (!setjmp(*bw_try(partition_w))) {
-                write_compressed_residual_partition(
-                    partition_w,
-                    coding,
-                    rice_parameters[p],
-                    partition_size,
-                    residuals + i);
+    if (stats) {
+        previous_stage = stage_timer_enter(&stats->timer, STAGE_RESIDUAL);
+    }
 
-                i += partition_size;
+    block_bits = plan_residual_block(options,
+                                     sample_count,
+                                     predictor_order,
+                                     residuals,
+                                     &coding_method,
+                                     &partition_order,
+                                     rice_parameters,
+                                     escape_bits);
 
-                bw_etry(partition_w);
+    partition_count = 1 << partition_order;
 
-                /*ensure partition is closed
-                  even if the dump to output should fail*/
-                if (!setjmp(*bw_try(output))) {
-                    partition->copy(partition, output);
-                    bw_etry(output);
-                    partition->close(partition);
-                } else {
-                    bw_etry(output);
-                    partition->close(partition);
-                    bw_abort(output);
-                }
+    if (stats) {
+        stage_timer_enter(&stats->timer, previous_stage);
+        stats->partition_orders[partition_order] += 1;
+        for (p = 0; p < partition_count; p++) {
+            if (escape_bits[p]) {
+                stats->escaped_partitions += 1;
             } else {
-                /*partition too large, so switch to escaped values*/
-                bw_etry(partition_w);
-                partition->close(partition);
-
-                write_uncompressed_residual_partition(
-                    output,
-                    coding,
-                    max_bits,
-                    partition_size,
-                    residuals + i);
-                i += partition_size;
+                stats->rice_parameters[rice_parameters[p]] += 1;
             }
         }
+        stats->residual_bits += block_bits;
     }
+
+    output->write(output, 2, coding_method);
+    output->write(output, 4, partition_order);
+
+    /*write residual partition(s)*/
+    for (p = 0; p < partition_count; p++) {
+        const unsigned partition_size =
+            (sample_count / partition_count) - (p == 0 ? predictor_order : 0);
+
+        if (escape_bits[p]) {
+            write_uncompressed_residual_partition(
+                output,
+                coding_method,
+                escape_bits[p],
+                partition_size,
+                residuals + i);
+        } else {
+            write_compressed_residual_partition(
+                output,
+                coding_method,
+                rice_parameters[p],
+                partition_size,
+                residuals + i);
+        }
+
+        i += partition_size;
+    }
+}
+
+static unsigned
+compressed_partition_bits(unsigned coding_method,
+                          unsigned rice_parameter,
+                          unsigned partition_size,
+                          const int residuals[])
+{
+    /*each residual is a unary MSB value, its stop bit
+      and rice_parameter LSB bits*/
+    unsigned total_bits =
+        (coding_method ? 5 : 4) + (partition_size * (rice_parameter + 1));
+
+    for (; partition_size; partition_size--) {
+        const unsigned unsigned_ =
+            residuals[0] >= 0 ?
+            (unsigned)residuals[0] << 1 :
+            ((unsigned)(-residuals[0] - 1) << 1) + 1;
+
+        total_bits += unsigned_ >> rice_parameter;
+
+        residuals += 1;
+    }
+
+    return total_bits;
 }
 
 static void
@@ -2516,6 +2990,10 @@ int main(int argc, char *argv[])
                                    1,1);
     output = bw_open(output_file, BS_BIG_ENDIAN);
 
+    if (fseek(output_file, 0, SEEK_CUR) != 0) {
+        options.streaming = 1;
+    }
+
     pcmreader_display(pcmreader, stderr);
     fputs("\n", stderr);
     flacenc_display_options(&options, stderr);
@@ -2535,9 +3013,6 @@ int main(int argc, char *argv[])
     case FLAC_PCM_MISMATCH:
         fputs("*** Error: total PCM frames mismatch\n", stderr);
         break;
-    case FLAC_NO_TEMPFILE:
-        fputs("*** Error: unable to open temporary file\n", stderr);
-        break;
     }
 
     output->close(output);
@@ -3,6 +3,7 @@
 #endif
 #include "../bitstream.h"
 #include "../pcmreader.h"
+#include "../common/encoder_stats.h"
 
 /********************************************************
  Audio Tools, a module and set of tools for manipulating audio data
@@ -26,10 +27,26 @@
 typedef enum {
     FLAC_OK,           /*everything ok*/
     FLAC_READ_ERROR,   /*read error from PCMReader*/
-    FLAC_PCM_MISMATCH, /*total PCM frames mismatch*/
-    FLAC_NO_TEMPFILE   /*unable to open temporary file*/
+    FLAC_PCM_MISMATCH  /*total PCM frames mismatch*/
 } flacenc_status_t;
 
+/*what went into an encoded stream, gathered only when requested*/
+struct flacenc_stats {
+    struct stage_timer timer;
+
+    unsigned frames;
+    unsigned subframe_types[4];         /*CONSTANT, VERBATIM, FIXED, LPC*/
+    unsigned fixed_orders[5];
+    unsigned lpc_orders[33];
+    unsigned partition_orders[16];
+    unsigned rice_parameters[32];
+    unsigned escaped_partitions;
+
+    uint64_t frame_bytes;               /*complete frames, CRCs included*/
+    uint64_t residual_bits;             /*residual blocks*/
+    uint64_t verbatim_bits;             /*CONSTANT and VERBATIM samples*/
+};
+
 struct flac_encoding_options {
     unsigned block_size;                    /*typically 1152 or 4096*/
     unsigned min_residual_partition_order;  /*typically 0*/
@@ -43,9 +60,13 @@ struct flac_encoding_options {
     int use_constant;                       /*a boolean for debugging*/
     int use_fixed;                          /*a boolean for debugging*/
 
+    int streaming;                          /*a boolean, output unseekable*/
+
     unsigned qlp_coeff_precision;           /*derived from block size*/
     unsigned max_rice_parameter;            /*derived from bits-per-sample*/
     double *window;                         /*for windowing input samples*/
+
+    struct flacenc_stats *stats;            /*NULL unless gathering stats*/
 };
 
 /*sets the encoding options to sensible defaults*/
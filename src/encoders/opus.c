@@ -1,6 +1,7 @@
 #include <opus/opus.h>
 #include <opus_multistream.h>
 #include <ogg/ogg.h>
+#include <pthread.h>
 #include <time.h>
 #include <stdlib.h>
 #include <string.h>
@@ -29,6 +30,14 @@
 #define BLOCK_SIZE 2880
 #define OPUS_FRAME_LEN 0x100000
 
+/*the number of packets each chunk after the first encodes
+  from the end of the previous chunk and then discards,
+  so that its encoder's state matches the stream's at the splice*/
+#define WARMUP_PACKETS 16
+
+/*the default chunk size, in PCM frames, of parallel encoding*/
+#define DEFAULT_CHUNK_SIZE (BLOCK_SIZE * 1000)
+
 typedef enum {
     ENCODE_OK,
     ERR_IOERROR,
@@ -38,11 +47,128 @@ typedef enum {
     ERR_ENCODE_ERROR
 } result_t;
 
+/*the parameters shared by every encoder of a given stream*/
+struct opus_layout {
+    unsigned channels;
+    unsigned channel_mask;
+    int multichannel;
+    unsigned channel_mapping;
+    int quality;
+    int stream_count;
+    int coupled_stream_count;
+    unsigned char stream_map[255];
+    opus_int32 preskip;
+};
+
+/*either a mono/stereo encoder or a multistream one,
+  depending on the layout's channel count*/
+struct opus_stream_encoder {
+    OpusEncoder *encoder;
+    OpusMSEncoder *ms_encoder;
+};
+
+/*a run of packets encoded by its own thread and encoder*/
+struct opus_chunk {
+    const struct opus_layout *layout;
+
+    unsigned warmup_packets;  /*leading packets to encode and discard*/
+    unsigned packet_count;    /*packets to keep after the warm-up*/
+    int final;                /*whether the chunk ends the stream*/
+
+    /*(warmup_packets + packet_count) blocks of interleaved samples,
+      freed by the worker once encoded*/
+    opus_int16 *samples;
+
+    /*the kept packets' data, concatenated, and each packet's size*/
+    unsigned char *packets;
+    opus_int32 *packet_sizes;
+
+    result_t result;
+    int threaded;             /*whether the chunk must be joined*/
+    pthread_t thread;
+};
+
 static result_t
 encode_opus_file(char *filename,
                  struct PCMReader *pcmreader,
                  int quality,
-                 unsigned original_sample_rate);
+                 unsigned original_sample_rate,
+                 unsigned threads,
+                 unsigned chunk_size);
+
+/*opens a new encoder from the layout's channels and quality
+  and fills in the layout's stream mapping and preskip*/
+static result_t
+open_encoder(struct opus_layout *layout,
+             struct opus_stream_encoder *encoder);
+
+/*encodes a block of BLOCK_SIZE frames to packet
+  and returns its size in bytes, or a negative value on error*/
+static opus_int32
+encode_block(struct opus_stream_encoder *encoder,
+             const opus_int16 *samples,
+             unsigned char *packet);
+
+static void
+close_encoder(struct opus_stream_encoder *encoder);
+
+static void
+write_headers(ogg_stream_state *ogg_stream,
+              FILE *output_file,
+              const struct opus_layout *layout,
+              unsigned original_sample_rate,
+              ogg_int64_t *packetno);
+
+static void
+write_packet(ogg_stream_state *ogg_stream,
+             FILE *output_file,
+             unsigned char *data,
+             opus_int32 bytes,
+             int e_o_s,
+             ogg_int64_t granulepos,
+             ogg_int64_t *packetno);
+
+/*the number of packets needed to hold the preskip
+  and the given number of PCM frames*/
+static ogg_int64_t
+stream_packets(const struct opus_layout *layout, ogg_int64_t total_frames);
+
+static result_t
+encode_serial(struct PCMReader *pcmreader,
+              const struct opus_layout *layout,
+              struct opus_stream_encoder *encoder,
+              ogg_stream_state *ogg_stream,
+              FILE *output_file,
+              ogg_int64_t *packetno);
+
+static result_t
+encode_parallel(struct PCMReader *pcmreader,
+                const struct opus_layout *layout,
+                unsigned threads,
+                unsigned chunk_packets,
+                ogg_stream_state *ogg_stream,
+                FILE *output_file,
+                ogg_int64_t *packetno);
+
+static void*
+encode_chunk(struct opus_chunk *chunk);
+
+/*waits for the chunk's thread to finish
+  and, if successful, writes its packets to the Ogg stream
+  before releasing its buffers
+
+  packets_written is the number of audio packets in the stream so far
+  and total_frames the number of input PCM frames,
+  which is complete by the time the final chunk is written*/
+static result_t
+finish_chunk(struct opus_chunk *chunk,
+             int write,
+             const struct opus_layout *layout,
+             ogg_int64_t total_frames,
+             ogg_int64_t *packets_written,
+             ogg_stream_state *ogg_stream,
+             FILE *output_file,
+             ogg_int64_t *packetno);
 
 static void
 reorder_channels(unsigned channel_mask, unsigned pcm_frames, int *samples);
@@ -62,20 +188,26 @@ encoders_encode_opus(PyObject *dummy, PyObject *args, PyObject *keywds)
     struct PCMReader *pcmreader = NULL;
     int quality;
     int original_sample_rate;
+    int threads = 1;
+    int chunk_size = DEFAULT_CHUNK_SIZE;
     static char *kwlist[] = {"filename",
                              "pcmreader",
                              "quality",
                              "original_sample_rate",
+                             "threads",
+                             "chunk_size",
                              NULL};
     result_t result;
 
-    if (!PyArg_ParseTupleAndKeywords(args, keywds, "sO&ii",
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "sO&ii|ii",
                                      kwlist,
                                      &filename,
                                      py_obj_to_pcmreader,
                                      &pcmreader,
                                      &quality,
-                                     &original_sample_rate)) {
+                                     &original_sample_rate,
+                                     &threads,
+                                     &chunk_size)) {
         if (pcmreader != NULL)
             pcmreader->del(pcmreader);
         return NULL;
@@ -95,6 +227,18 @@ encoders_encode_opus(PyObject *dummy, PyObject *args, PyObject *keywds)
         return NULL;
     }
 
+    /*sanity check threads and chunk size*/
+    if (threads <= 0) {
+        PyErr_SetString(PyExc_ValueError, "threads must be > 0");
+        pcmreader->del(pcmreader);
+        return NULL;
+    }
+    if (chunk_size <= 0) {
+        PyErr_SetString(PyExc_ValueError, "chunk_size must be > 0");
+        pcmreader->del(pcmreader);
+        return NULL;
+    }
+
     /*sanity check PCMReader*/
     if (pcmreader->sample_rate != 48000) {
         PyErr_SetString(PyExc_ValueError,
@@ -109,7 +253,8 @@ encoders_encode_opus(PyObject *dummy, PyObject *args, PyObject *keywds)
     }
 
     result = encode_opus_file(filename, pcmreader,
-                              quality, original_sample_rate);
+                              quality, original_sample_rate,
+                              (unsigned)threads, (unsigned)chunk_size);
 
     pcmreader->del(pcmreader);
 
@@ -143,244 +288,578 @@ static result_t
 encode_opus_file(char *filename,
                  struct PCMReader *pcmreader,
                  int quality,
-                 unsigned original_sample_rate)
+                 unsigned original_sample_rate,
+                 unsigned threads,
+                 unsigned chunk_size)
 {
-    const int multichannel = (pcmreader->channels > 2);
-    const unsigned channel_mapping = (pcmreader->channels > 8 ? 255 :
-                                      pcmreader->channels > 2);
-    int stream_count;
-    int coupled_stream_count;
-    unsigned char stream_map[255];
-
-    int samples[BLOCK_SIZE * pcmreader->channels];
-    unsigned pcm_frames;
-    result_t result = ENCODE_OK;
+    struct opus_layout layout;
+    struct opus_stream_encoder encoder;
+    result_t result;
     FILE *output_file = NULL;
     ogg_stream_state ogg_stream;
     ogg_page ogg_page;
-    OpusEncoder *opus_encoder = NULL;
-    OpusMSEncoder *opus_ms_encoder = NULL;
-    int error;
-    opus_int16 *opus_samples = NULL;
-    unsigned char opus_frame[OPUS_FRAME_LEN];
-    ogg_int64_t granulepos = 0;
     ogg_int64_t packetno = 0;
-    opus_int32 preskip;
+
+    layout.channels = pcmreader->channels;
+    layout.channel_mask = pcmreader->channel_mask;
+    layout.multichannel = (pcmreader->channels > 2);
+    layout.channel_mapping = (pcmreader->channels > 8 ? 255 :
+                              pcmreader->channels > 2);
+    layout.quality = quality;
 
     /*open output file for writing*/
     if ((output_file = fopen(filename, "w+b")) == NULL) {
         return ERR_IOERROR;
     }
 
-    if (!multichannel) {
-        if ((opus_encoder = opus_encoder_create(48000,
-                                                pcmreader->channels,
-                                                OPUS_APPLICATION_AUDIO,
-                                                &error)) == NULL) {
-            fclose(output_file);
+    /*the first encoder determines the stream's mapping and preskip
+      and encodes the whole stream when not encoding in parallel*/
+    if ((result = open_encoder(&layout, &encoder)) != ENCODE_OK) {
+        fclose(output_file);
+        return result;
+    }
+
+    srand((unsigned)time(NULL));
+    ogg_stream_init(&ogg_stream, rand());
+
+    write_headers(&ogg_stream,
+                  output_file,
+                  &layout,
+                  original_sample_rate,
+                  &packetno);
+
+    if (threads <= 1) {
+        result = encode_serial(pcmreader,
+                               &layout,
+                               &encoder,
+                               &ogg_stream,
+                               output_file,
+                               &packetno);
+    } else {
+        /*round chunks up to whole packets,
+          and to no fewer packets than are used for warming up*/
+        unsigned chunk_packets = (chunk_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        if (chunk_packets < WARMUP_PACKETS) {
+            chunk_packets = WARMUP_PACKETS;
+        }
+
+        result = encode_parallel(pcmreader,
+                                 &layout,
+                                 threads,
+                                 chunk_packets,
+                                 &ogg_stream,
+                                 output_file,
+                                 &packetno);
+    }
+
+    if (result == ENCODE_OK) {
+        /*flush any remaining Ogg pages to disk*/
+        while (ogg_stream_flush(&ogg_stream, &ogg_page)) {
+            fwrite(ogg_page.header, 1, ogg_page.header_len, output_file);
+            fwrite(ogg_page.body, 1, ogg_page.body_len, output_file);
+        }
+    }
+
+    fclose(output_file);
+    ogg_stream_clear(&ogg_stream);
+    close_encoder(&encoder);
+    return result;
+}
+
+static result_t
+open_encoder(struct opus_layout *layout,
+             struct opus_stream_encoder *encoder)
+{
+    int error;
+
+    if (!layout->multichannel) {
+        encoder->ms_encoder = NULL;
+        if ((encoder->encoder = opus_encoder_create(48000,
+                                                    layout->channels,
+                                                    OPUS_APPLICATION_AUDIO,
+                                                    &error)) == NULL) {
             return ERR_ENCODER_INIT;
         }
 
-        opus_encoder_ctl(opus_encoder, OPUS_SET_COMPLEXITY(quality));
-        opus_encoder_ctl(opus_encoder, OPUS_GET_LOOKAHEAD(&preskip));
+        opus_encoder_ctl(encoder->encoder,
+                         OPUS_SET_COMPLEXITY(layout->quality));
+        opus_encoder_ctl(encoder->encoder,
+                         OPUS_GET_LOOKAHEAD(&layout->preskip));
     } else {
-        if ((opus_ms_encoder =
+        encoder->encoder = NULL;
+        if ((encoder->ms_encoder =
              opus_multistream_surround_encoder_create(
                  48000,
-                 pcmreader->channels,
-                 channel_mapping,
-                 &stream_count,
-                 &coupled_stream_count,
-                 stream_map,
+                 layout->channels,
+                 layout->channel_mapping,
+                 &layout->stream_count,
+                 &layout->coupled_stream_count,
+                 layout->stream_map,
                  OPUS_APPLICATION_AUDIO,
                  &error)) == NULL) {
-            fclose(output_file);
             return ERR_ENCODER_INIT;
         }
 
-        opus_multistream_encoder_ctl(opus_ms_encoder,
-                                     OPUS_SET_COMPLEXITY(quality));
-        opus_multistream_encoder_ctl(opus_ms_encoder,
-                                     OPUS_GET_LOOKAHEAD(&preskip));
+        opus_multistream_encoder_ctl(encoder->ms_encoder,
+                                     OPUS_SET_COMPLEXITY(layout->quality));
+        opus_multistream_encoder_ctl(encoder->ms_encoder,
+                                     OPUS_GET_LOOKAHEAD(&layout->preskip));
     }
 
+    return ENCODE_OK;
+}
 
-    srand((unsigned)time(NULL));
-    ogg_stream_init(&ogg_stream, rand());
+static opus_int32
+encode_block(struct opus_stream_encoder *encoder,
+             const opus_int16 *samples,
+             unsigned char *packet)
+{
+    if (encoder->encoder != NULL) {
+        return opus_encode(encoder->encoder,
+                           samples,
+                           BLOCK_SIZE,
+                           packet,
+                           OPUS_FRAME_LEN);
+    } else {
+        return opus_multistream_encode(encoder->ms_encoder,
+                                       samples,
+                                       BLOCK_SIZE,
+                                       packet,
+                                       OPUS_FRAME_LEN);
+    }
+}
 
-    /*write header and comment packets to Ogg stream*/
-    {
-        BitstreamRecorder *header =
-            bw_open_bytes_recorder(BS_LITTLE_ENDIAN);
-        BitstreamWriter *header_w =(BitstreamWriter*)header;
-        BitstreamRecorder *comment =
-            bw_open_bytes_recorder(BS_LITTLE_ENDIAN);
-        BitstreamWriter *comment_w = (BitstreamWriter*)comment;
-        unsigned i;
+static void
+close_encoder(struct opus_stream_encoder *encoder)
+{
+    if (encoder->encoder != NULL) {
+        opus_encoder_destroy(encoder->encoder);
+    } else {
+        opus_multistream_encoder_destroy(encoder->ms_encoder);
+    }
+}
 
-        /*write header packet to Ogg stream*/
-        const char opushead[] = "OpusHead";
-        const char opuscomment[] = "OpusTags";
-        const char *vendor_string = opus_get_version_string();
-        const size_t vendor_string_len = strlen(vendor_string);
-        ogg_packet packet_head;
-        ogg_packet packet_tags;
-
-        header_w->write_bytes(header_w,
-                              (uint8_t*)opushead,
-                              (unsigned)strlen(opushead));
-        header_w->write(header_w, 8, 1);       /*version*/
-        header_w->write(header_w, 8, pcmreader->channels);
-        header_w->write(header_w, 16, preskip);
-        header_w->write(header_w, 32, original_sample_rate);
-        header_w->write(header_w, 16, 0);      /*output gain*/
-        header_w->write(header_w, 8, channel_mapping);
-        if (channel_mapping != 0) {
-            header_w->write(header_w, 8, stream_count);
-            header_w->write(header_w, 8, coupled_stream_count);
-            for (i = 0; i < pcmreader->channels; i++) {
-                header_w->write(header_w, 8, stream_map[i]);
-            }
-        }
+static void
+write_headers(ogg_stream_state *ogg_stream,
+              FILE *output_file,
+              const struct opus_layout *layout,
+              unsigned original_sample_rate,
+              ogg_int64_t *packetno)
+{
+    BitstreamRecorder *header =
+        bw_open_bytes_recorder(BS_LITTLE_ENDIAN);
+    BitstreamWriter *header_w =(BitstreamWriter*)header;
+    BitstreamRecorder *comment =
+        bw_open_bytes_recorder(BS_LITTLE_ENDIAN);
+    BitstreamWriter *comment_w = (BitstreamWriter*)comment;
+    unsigned i;
+    ogg_page ogg_page;
 
-        packet_head.packet = malloc(header->bytes_written(header));
-        header->data(header, (uint8_t*)packet_head.packet);
-        packet_head.bytes = header->bytes_written(header);
-        packet_head.b_o_s = 1;
-        packet_head.e_o_s = 0;
-        packet_head.granulepos = 0;
-        packet_head.packetno = packetno++;
-        header->close(header);
+    /*write header packet to Ogg stream*/
+    const char opushead[] = "OpusHead";
+    const char opuscomment[] = "OpusTags";
+    const char *vendor_string = opus_get_version_string();
+    const size_t vendor_string_len = strlen(vendor_string);
+    ogg_packet packet_head;
+    ogg_packet packet_tags;
+
+    header_w->write_bytes(header_w,
+                          (uint8_t*)opushead,
+                          (unsigned)strlen(opushead));
+    header_w->write(header_w, 8, 1);       /*version*/
+    header_w->write(header_w, 8, layout->channels);
+    header_w->write(header_w, 16, layout->preskip);
+    header_w->write(header_w, 32, original_sample_rate);
+    header_w->write(header_w, 16, 0);      /*output gain*/
+    header_w->write(header_w, 8, layout->channel_mapping);
+    if (layout->channel_mapping != 0) {
+        header_w->write(header_w, 8, layout->stream_count);
+        header_w->write(header_w, 8, layout->coupled_stream_count);
+        for (i = 0; i < layout->channels; i++) {
+            header_w->write(header_w, 8, layout->stream_map[i]);
+        }
+    }
 
-        ogg_stream_packetin(&ogg_stream, &packet_head);
+    packet_head.packet = malloc(header->bytes_written(header));
+    header->data(header, (uint8_t*)packet_head.packet);
+    packet_head.bytes = header->bytes_written(header);
+    packet_head.b_o_s = 1;
+    packet_head.e_o_s = 0;
+    packet_head.granulepos = 0;
+    packet_head.packetno = (*packetno)++;
+    header->close(header);
 
-        for (i = ogg_stream_flush(&ogg_stream, &ogg_page);
-             i != 0;
-             i = ogg_stream_flush(&ogg_stream, &ogg_page)) {
-            fwrite(ogg_page.header, 1, ogg_page.header_len, output_file);
-            fwrite(ogg_page.body, 1, ogg_page.body_len, output_file);
-        }
+    ogg_stream_packetin(ogg_stream, &packet_head);
 
-        free(packet_head.packet);
-
-        /*write comment packet to Ogg stream*/
-        comment_w->write_bytes(comment_w,
-                               (uint8_t*)opuscomment,
-                               (unsigned)strlen(opuscomment));
-        comment_w->write(comment_w, 32, (unsigned)vendor_string_len);
-        comment_w->write_bytes(comment_w,
-                               (uint8_t*)vendor_string,
-                               (unsigned)vendor_string_len);
-        comment_w->write(comment_w, 32, 0);
-
-        packet_tags.packet = malloc(comment->bytes_written(comment));
-        comment->data(comment, (uint8_t*)packet_tags.packet);
-        packet_tags.bytes = comment->bytes_written(comment);
-        packet_tags.b_o_s = 0;
-        packet_tags.e_o_s = 0;
-        packet_tags.granulepos = 0;
-        packet_tags.packetno = packetno++;
-        comment->close(comment);
-
-        ogg_stream_packetin(&ogg_stream, &packet_tags);
-
-        for (i = ogg_stream_flush(&ogg_stream, &ogg_page);
-             i != 0;
-             i = ogg_stream_flush(&ogg_stream, &ogg_page)) {
-            fwrite(ogg_page.header, 1, ogg_page.header_len, output_file);
-            fwrite(ogg_page.body, 1, ogg_page.body_len, output_file);
-        }
+    for (i = ogg_stream_flush(ogg_stream, &ogg_page);
+         i != 0;
+         i = ogg_stream_flush(ogg_stream, &ogg_page)) {
+        fwrite(ogg_page.header, 1, ogg_page.header_len, output_file);
+        fwrite(ogg_page.body, 1, ogg_page.body_len, output_file);
+    }
 
-        free(packet_tags.packet);
+    free(packet_head.packet);
+
+    /*write comment packet to Ogg stream*/
+    comment_w->write_bytes(comment_w,
+                           (uint8_t*)opuscomment,
+                           (unsigned)strlen(opuscomment));
+    comment_w->write(comment_w, 32, (unsigned)vendor_string_len);
+    comment_w->write_bytes(comment_w,
+                           (uint8_t*)vendor_string,
+                           (unsigned)vendor_string_len);
+    comment_w->write(comment_w, 32, 0);
+
+    packet_tags.packet = malloc(comment->bytes_written(comment));
+    comment->data(comment, (uint8_t*)packet_tags.packet);
+    packet_tags.bytes = comment->bytes_written(comment);
+    packet_tags.b_o_s = 0;
+    packet_tags.e_o_s = 0;
+    packet_tags.granulepos = 0;
+    packet_tags.packetno = (*packetno)++;
+    comment->close(comment);
+
+    ogg_stream_packetin(ogg_stream, &packet_tags);
+
+    for (i = ogg_stream_flush(ogg_stream, &ogg_page);
+         i != 0;
+         i = ogg_stream_flush(ogg_stream, &ogg_page)) {
+        fwrite(ogg_page.header, 1, ogg_page.header_len, output_file);
+        fwrite(ogg_page.body, 1, ogg_page.body_len, output_file);
     }
 
-    opus_samples = malloc(sizeof(opus_int16) *
-                          pcmreader->channels *
-                          BLOCK_SIZE);
+    free(packet_tags.packet);
+}
+
+static void
+write_packet(ogg_stream_state *ogg_stream,
+             FILE *output_file,
+             unsigned char *data,
+             opus_int32 bytes,
+             int e_o_s,
+             ogg_int64_t granulepos,
+             ogg_int64_t *packetno)
+{
+    ogg_packet packet;
+    ogg_page ogg_page;
+
+    packet.packet = data;
+    packet.bytes = bytes;
+    packet.b_o_s = 0;
+    packet.e_o_s = e_o_s;
+    packet.granulepos = granulepos;
+    packet.packetno = (*packetno)++;
 
-    pcm_frames = pcmreader->read(pcmreader, BLOCK_SIZE, samples);
-    if (!pcm_frames && (pcmreader->status != PCM_OK)) {
-        result = ERR_PCMREADER;
-        goto cleanup;
+    ogg_stream_packetin(ogg_stream, &packet);
+    while (ogg_stream_pageout(ogg_stream, &ogg_page)) {
+        fwrite(ogg_page.header, 1, ogg_page.header_len, output_file);
+        fwrite(ogg_page.body, 1, ogg_page.body_len, output_file);
     }
+}
+
+static ogg_int64_t
+stream_packets(const struct opus_layout *layout, ogg_int64_t total_frames)
+{
+    const ogg_int64_t packets =
+        (layout->preskip + total_frames + BLOCK_SIZE - 1) / BLOCK_SIZE;
 
-    /*for each non-empty FrameList from PCMReader, encode Opus frame*/
-    while (pcm_frames) {
-        const int short_framelist = (pcm_frames < BLOCK_SIZE);
+    /*even an empty stream needs a packet to end it*/
+    return packets ? packets : 1;
+}
+
+static result_t
+encode_serial(struct PCMReader *pcmreader,
+              const struct opus_layout *layout,
+              struct opus_stream_encoder *encoder,
+              ogg_stream_state *ogg_stream,
+              FILE *output_file,
+              ogg_int64_t *packetno)
+{
+    const unsigned channels = layout->channels;
+    int samples[BLOCK_SIZE * channels];
+    opus_int16 *opus_samples = malloc(sizeof(opus_int16) *
+                                      channels *
+                                      BLOCK_SIZE);
+    unsigned char *opus_frame = malloc(OPUS_FRAME_LEN);
+    ogg_int64_t total_frames = 0;
+    ogg_int64_t packets_written = 0;
+    int input_finished = 0;
+    int e_o_s = 0;
+    result_t result = ENCODE_OK;
+
+    /*encode blocks of input followed by as many blocks of silence
+      as it takes for the packets to cover the preskip and the input*/
+    while (!e_o_s) {
+        unsigned pcm_frames = 0;
         unsigned i;
         opus_int32 encoded_size;
-        ogg_packet packet;
 
-        granulepos += pcm_frames;
+        if (!input_finished) {
+            pcm_frames = pcmreader->read(pcmreader, BLOCK_SIZE, samples);
+            if (!pcm_frames && (pcmreader->status != PCM_OK)) {
+                result = ERR_PCMREADER;
+                break;
+            }
+            input_finished = (pcm_frames < BLOCK_SIZE);
+            total_frames += pcm_frames;
+        }
 
         /*pad FrameList with additional null samples if necessary*/
-        memset(samples + pcm_frames * pcmreader->channels,
+        memset(samples + pcm_frames * channels,
                0,
-               sizeof(int) * (BLOCK_SIZE - pcm_frames) * pcmreader->channels);
+               sizeof(int) * (BLOCK_SIZE - pcm_frames) * channels);
 
         /*rearrange channels to Vorbis order if necessary*/
-        reorder_channels(pcmreader->channel_mask, BLOCK_SIZE, samples);
+        reorder_channels(layout->channel_mask, BLOCK_SIZE, samples);
 
         /*place samples in interleaved buffer*/
-        for (i = 0; i < (pcm_frames * pcmreader->channels); i++) {
+        for (i = 0; i < (BLOCK_SIZE * channels); i++) {
             opus_samples[i] = (opus_int16)samples[i];
         }
 
-        /*call opus_encode on interleaved buffer to get next packet*/
-        if (!multichannel) {
-            encoded_size = opus_encode(opus_encoder,
-                                       opus_samples,
-                                       BLOCK_SIZE,
-                                       opus_frame,
-                                       OPUS_FRAME_LEN);
-        } else {
-            encoded_size = opus_multistream_encode(opus_ms_encoder,
-                                                   opus_samples,
-                                                   BLOCK_SIZE,
-                                                   opus_frame,
-                                                   OPUS_FRAME_LEN);
+        if ((encoded_size = encode_block(encoder,
+                                         opus_samples,
+                                         opus_frame)) < 0) {
+            result = ERR_ENCODE_ERROR;
+            break;
         }
 
-        /*get next FrameList to encode*/
-        pcm_frames = pcmreader->read(pcmreader, BLOCK_SIZE, samples);
+        /*the final packet's granule position marks
+          where the decoded stream ends within it*/
+        packets_written += 1;
+        e_o_s = (input_finished &&
+                 (packets_written >= stream_packets(layout, total_frames)));
+
+        write_packet(ogg_stream,
+                     output_file,
+                     opus_frame,
+                     encoded_size,
+                     e_o_s,
+                     e_o_s ?
+                     layout->preskip + total_frames :
+                     packets_written * BLOCK_SIZE,
+                     packetno);
+    }
+
+    free(opus_samples);
+    free(opus_frame);
+    return result;
+}
+
+static result_t
+encode_parallel(struct PCMReader *pcmreader,
+                const struct opus_layout *layout,
+                unsigned threads,
+                unsigned chunk_packets,
+                ogg_stream_state *ogg_stream,
+                FILE *output_file,
+                ogg_int64_t *packetno)
+{
+    const unsigned channels = layout->channels;
+    const unsigned chunk_frames = chunk_packets * BLOCK_SIZE;
+    const unsigned warmup_frames = WARMUP_PACKETS * BLOCK_SIZE;
+    int *samples = malloc(sizeof(int) * chunk_frames * channels);
+    opus_int16 *history = malloc(sizeof(opus_int16) *
+                                 warmup_frames *
+                                 channels);
+    unsigned history_frames = 0;
+    struct opus_chunk *chunks = malloc(sizeof(struct opus_chunk) * threads);
+    unsigned started = 0;
+    unsigned finished = 0;
+    ogg_int64_t total_frames = 0;
+    ogg_int64_t packets_written = 0;
+    int input_finished = 0;
+    result_t result = ENCODE_OK;
+
+    /*read the input a chunk at a time on this thread,
+      keeping up to one chunk per thread encoding in the background*/
+    while (!input_finished) {
+        struct opus_chunk *chunk;
+        unsigned pcm_frames;
+        unsigned i;
+
+        pcm_frames = pcmreader->read(pcmreader, chunk_frames, samples);
         if (!pcm_frames && (pcmreader->status != PCM_OK)) {
             result = ERR_PCMREADER;
-            goto cleanup;
+            break;
         }
+        input_finished = (pcm_frames < chunk_frames);
 
-        /*dump Opus packet to Ogg stream*/
-        /*do this *after* reading the next FrameList in order to detect
-          the end of stream properly based on whether the FrameList
-          has no frames*/
-        packet.packet = (unsigned char *)opus_frame;
-        packet.bytes = encoded_size;
-        packet.b_o_s = 0;
-        packet.e_o_s = (short_framelist || (pcm_frames == 0));
-        packet.granulepos = granulepos;
-        packet.packetno = packetno;
-
-        ogg_stream_packetin(&ogg_stream, &packet);
-        while (ogg_stream_pageout(&ogg_stream, &ogg_page)) {
-            fwrite(ogg_page.header, 1, ogg_page.header_len, output_file);
-            fwrite(ogg_page.body, 1, ogg_page.body_len, output_file);
+        /*rearrange channels to Vorbis order if necessary*/
+        reorder_channels(layout->channel_mask, pcm_frames, samples);
+
+        /*wait for the oldest chunk to make room for this one*/
+        if ((started - finished) == threads) {
+            if ((result = finish_chunk(&chunks[finished++ % threads],
+                                       1,
+                                       layout,
+                                       total_frames,
+                                       &packets_written,
+                                       ogg_stream,
+                                       output_file,
+                                       packetno)) != ENCODE_OK) {
+                break;
+            }
         }
+
+        /*the final chunk is padded with enough silence
+          to cover the preskip and the rest of its input*/
+        chunk = &chunks[started % threads];
+        chunk->layout = layout;
+        chunk->warmup_packets = history_frames / BLOCK_SIZE;
+        chunk->final = input_finished;
+        if (!input_finished) {
+            chunk->packet_count = chunk_packets;
+        } else {
+            chunk->packet_count =
+                (unsigned)(stream_packets(layout, total_frames + pcm_frames) -
+                           total_frames / BLOCK_SIZE);
+        }
+        chunk->samples = calloc((chunk->warmup_packets +
+                                 chunk->packet_count) * BLOCK_SIZE * channels,
+                                sizeof(opus_int16));
+
+        /*prepend the end of the previous chunk's input*/
+        memcpy(chunk->samples,
+               history,
+               sizeof(opus_int16) * history_frames * channels);
+        for (i = 0; i < (pcm_frames * channels); i++) {
+            chunk->samples[history_frames * channels + i] =
+                (opus_int16)samples[i];
+        }
+        total_frames += pcm_frames;
+
+        /*and keep the end of this chunk's input for the next*/
+        if (!input_finished) {
+            memcpy(history,
+                   chunk->samples +
+                   (history_frames + chunk_frames - warmup_frames) * channels,
+                   sizeof(opus_int16) * warmup_frames * channels);
+            history_frames = warmup_frames;
+        }
+
+        chunk->threaded = !pthread_create(&chunk->thread,
+                                          NULL,
+                                          (void*(*)(void*))encode_chunk,
+                                          chunk);
+        if (!chunk->threaded) {
+            /*encode on this thread if another can't be started*/
+            encode_chunk(chunk);
+        }
+        started++;
     }
 
-    /*flush any remaining Ogg pages to disk*/
-    while (ogg_stream_flush(&ogg_stream, &ogg_page)) {
-        fwrite(ogg_page.header, 1, ogg_page.header_len, output_file);
-        fwrite(ogg_page.body, 1, ogg_page.body_len, output_file);
+    /*write the remaining chunks to the stream in order,
+      or just wait for them and discard them after an error*/
+    while (finished < started) {
+        const result_t chunk_result =
+            finish_chunk(&chunks[finished++ % threads],
+                         result == ENCODE_OK,
+                         layout,
+                         total_frames,
+                         &packets_written,
+                         ogg_stream,
+                         output_file,
+                         packetno);
+        if (result == ENCODE_OK) {
+            result = chunk_result;
+        }
     }
 
-cleanup:
-    fclose(output_file);
-    ogg_stream_clear(&ogg_stream);
-    if (!multichannel) {
-        opus_encoder_destroy(opus_encoder);
-    } else {
-        opus_multistream_encoder_destroy(opus_ms_encoder);
+    free(samples);
+    free(history);
+    free(chunks);
+    return result;
+}
+
+static void*
+encode_chunk(struct opus_chunk *chunk)
+{
+    /*each encoder fills in its own copy of the stream's mapping*/
+    struct opus_layout layout = *(chunk->layout);
+    struct opus_stream_encoder encoder;
+    const unsigned blocks = chunk->warmup_packets + chunk->packet_count;
+    unsigned char *packet = malloc(OPUS_FRAME_LEN);
+    size_t packets_size = 0;
+    size_t packets_allocated = 0;
+    unsigned i;
+
+    chunk->packets = NULL;
+    chunk->packet_sizes = malloc(sizeof(opus_int32) * chunk->packet_count);
+
+    if ((chunk->result = open_encoder(&layout, &encoder)) == ENCODE_OK) {
+        for (i = 0; i < blocks; i++) {
+            const opus_int32 encoded_size =
+                encode_block(&encoder,
+                             chunk->samples + i * BLOCK_SIZE * layout.channels,
+                             packet);
+
+            if (encoded_size < 0) {
+                chunk->result = ERR_ENCODE_ERROR;
+                break;
+            } else if (i < chunk->warmup_packets) {
+                /*discard packets which only bring the encoder up to speed*/
+                continue;
+            }
+
+            if ((packets_size + encoded_size) > packets_allocated) {
+                packets_allocated = (packets_size + encoded_size) * 2;
+                chunk->packets = realloc(chunk->packets, packets_allocated);
+            }
+            memcpy(chunk->packets + packets_size, packet, encoded_size);
+            packets_size += encoded_size;
+            chunk->packet_sizes[i - chunk->warmup_packets] = encoded_size;
+        }
+
+        close_encoder(&encoder);
     }
-    free(opus_samples);
+
+    free(packet);
+    free(chunk->samples);
+    chunk->samples = NULL;
+    return NULL;
+}
+
+static result_t
+finish_chunk(struct opus_chunk *chunk,
+             int write,
+             const struct opus_layout *layout,
+             ogg_int64_t total_frames,
+             ogg_int64_t *packets_written,
+             ogg_stream_state *ogg_stream,
+             FILE *output_file,
+             ogg_int64_t *packetno)
+{
+    result_t result;
+
+    if (chunk->threaded) {
+        pthread_join(chunk->thread, NULL);
+    }
+
+    if (((result = chunk->result) == ENCODE_OK) && write) {
+        unsigned char *packet = chunk->packets;
+        unsigned i;
+
+        for (i = 0; i < chunk->packet_count; i++) {
+            const int e_o_s = (chunk->final &&
+                               (i == (chunk->packet_count - 1)));
+
+            *packets_written += 1;
+            write_packet(ogg_stream,
+                         output_file,
+                         packet,
+                         chunk->packet_sizes[i],
+                         e_o_s,
+                         e_o_s ?
+                         layout->preskip + total_frames :
+                         *packets_written * BLOCK_SIZE,
+                         packetno);
+            packet += chunk->packet_sizes[i];
+        }
+    }
+
+    free(chunk->packets);
+    free(chunk->packet_sizes);
     return result;
 }
 
@@ -482,6 +961,7 @@ int main(int argc, char *argv[])
     char* output_file = NULL;
     unsigned channels = 2;
     unsigned original_sample_rate = 48000;
+    unsigned threads = 1;
     const unsigned sample_rate = 48000;
     const unsigned bits_per_sample = 16;
     struct PCMReader *pcmreader = NULL;
@@ -492,9 +972,10 @@ int main(int argc, char *argv[])
         {"help",                    no_argument,       NULL, 'h'},
         {"channels",                required_argument, NULL, 'c'},
         {"original-sample-rate",    required_argument, NULL, 'r'},
+        {"threads",                 required_argument, NULL, 't'},
         {NULL,                      no_argument,       NULL,  0}
     };
-    const static char* short_opts = "-hc:";
+    const static char* short_opts = "-hc:r:t:";
 
     while ((c = getopt_long(argc,
                             argv,
@@ -523,6 +1004,12 @@ int main(int argc, char *argv[])
                 return 1;
             }
             break;
+        case 't':
+            if (((threads = strtoul(optarg, NULL, 10)) == 0) && errno) {
+                printf("invalid --threads \"%s\"\n", optarg);
+                return 1;
+            }
+            break;
         case 'h': /*fallthrough*/
         case ':':
         case '?':
@@ -531,6 +1018,8 @@ int main(int argc, char *argv[])
                     "number of input channels\n");
             printf("-r, --orignal-sample=rate=#  "
                     "stream's original sample rate\n");
+            printf("-t, --threads=#              "
+                    "number of threads to encode with\n");
             return 0;
         default:
             break;
@@ -560,7 +1049,8 @@ int main(int argc, char *argv[])
                                    1);
 
     switch (result = encode_opus_file(output_file, pcmreader,
-                                      10, original_sample_rate)) {
+                                      10, original_sample_rate,
+                                      threads, DEFAULT_CHUNK_SIZE)) {
     case ENCODE_OK:
         break;
     default:
@@ -201,7 +201,9 @@ write_header(unsigned bits_per_sample,
 {
     const uint8_t signature[] = "TTA1";
     uint32_t crc32 = 0xFFFFFFFF;
-    output->add_callback(output, (bs_callback_f)tta_crc32, &crc32);
+    output->add_span_callback(output,
+                              (bs_span_callback_f)tta_crc32_span,
+                              &crc32);
     output->write_bytes(output, signature, 4);
     output->write(output, 16, 1);
     output->write(output, 16, channels);
@@ -217,7 +219,9 @@ write_seektable(const struct tta_frame_size *frame_sizes,
                 BitstreamWriter *output)
 {
     uint32_t crc32 = 0xFFFFFFFF;
-    output->add_callback(output, (bs_callback_f)tta_crc32, &crc32);
+    output->add_span_callback(output,
+                              (bs_span_callback_f)tta_crc32_span,
+                              &crc32);
     for (; frame_sizes; frame_sizes = frame_sizes->next) {
         output->write(output, 32, frame_sizes->byte_size);
     }
@@ -246,7 +250,9 @@ encode_frame(unsigned bits_per_sample,
     }
 
     /*setup CRC-32 calculation*/
-    output->add_callback(output, (bs_callback_f)tta_crc32, &crc32);
+    output->add_span_callback(output,
+                              (bs_span_callback_f)tta_crc32_span,
+                              &crc32);
 
     /*encode one PCM frame at a time*/
     for (; block_size; block_size--) {
@@ -1,11 +1,25 @@
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <pthread.h>
 #include <vorbis/vorbisenc.h>
 #include <ogg/ogg.h>
 #include "../pcmreader.h"
 
 #define BLOCK_SIZE 1024
 
+/*the number of frames each segment after the first starts
+  ahead of its boundary with the previous segment,
+  and the number the previous segment carries on past it,
+  so that both encoders have settled where they're spliced*/
+#define OVERLAP_FRAMES 32768
+
+/*the largest block size Vorbis allows*/
+#define SEGMENT_ALIGNMENT 8192
+
+/*the default segment size, in PCM frames, of parallel encoding*/
+#define DEFAULT_SEGMENT_SIZE (1 << 21)
+
 /********************************************************
  Audio Tools, a module and set of tools for manipulating audio data
  Copyright (C) 2007-2016  Brian Langenberger
@@ -37,6 +51,45 @@ typedef enum {
     ERR_FRAMELIST_SIZE,
 } result_t;
 
+/*an encoded packet held until segments are spliced together*/
+struct vorbis_packet {
+    unsigned char *data;
+    long bytes;
+    long blocksize;
+    ogg_int64_t granulepos;     /*from the start of the whole stream*/
+    int e_o_s;
+};
+
+/*a span of input encoded by its own thread and encoder*/
+struct vorbis_segment {
+    vorbis_info *info;          /*shared by every segment's encoder*/
+    unsigned channels;
+    int_to_float_f converter;
+
+    ogg_int64_t start;          /*the stream's frame the input starts at*/
+    unsigned pcm_frames;        /*the number of input frames*/
+    int final;                  /*whether the input ends the stream*/
+
+    int *samples;               /*interleaved input, freed once converted*/
+    float **channel_data;       /*converted input, one array per channel*/
+
+    /*the segment's encoder, left open after the segment's input
+      so that it can carry on into the next segment if necessary*/
+    int encoder_open;
+    vorbis_dsp_state dsp;
+    vorbis_block block;
+    ogg_int64_t encoded_to;     /*the stream's frame the encoder is up to*/
+    int ended;                  /*whether the encoder has ended the stream*/
+
+    struct vorbis_packet *packets;
+    unsigned packet_count;
+    unsigned packets_allocated;
+
+    result_t result;
+    int threaded;               /*whether the segment must be joined*/
+    pthread_t thread;
+};
+
 #ifndef STANDALONE
 static PyObject*
 encode_exception(result_t result);
@@ -56,7 +109,83 @@ swap_channel_data(int *pcm_data,
                   unsigned pcm_frames);
 
 static result_t
-encode_ogg_vorbis(char *filename, struct PCMReader *pcmreader, float quality);
+encode_ogg_vorbis(char *filename,
+                  struct PCMReader *pcmreader,
+                  float quality,
+                  unsigned threads,
+                  unsigned segment_size);
+
+static result_t
+encode_serial(struct PCMReader *pcmreader,
+              vorbis_dsp_state *vorbis_dsp,
+              vorbis_block *vorbis_block,
+              ogg_stream_state *ogg_stream,
+              FILE *output);
+
+static result_t
+encode_parallel(struct PCMReader *pcmreader,
+                vorbis_info *vorbis_info,
+                unsigned threads,
+                unsigned segment_frames,
+                ogg_stream_state *ogg_stream,
+                FILE *output);
+
+static void*
+encode_segment(struct vorbis_segment *segment);
+
+/*passes the given frames of converted input to the segment's encoder,
+  followed by the end of the stream if end_of_stream is set,
+  and adds any packets it completes to the segment*/
+static void
+analyze_frames(struct vorbis_segment *segment,
+               float **channel_data,
+               unsigned offset,
+               unsigned pcm_frames,
+               int end_of_stream);
+
+/*finds the earliest point at or after the given frame
+  where the current segment's packets may be followed by the next's
+
+  that's a packet from each ending at the same granule position,
+  with the same block size, and followed by packets of the same size,
+  so the decoder overlaps the same windows on either side of the splice
+
+  returns 1 and the indexes of both packets if found, 0 if not*/
+static int
+find_splice(const struct vorbis_segment *current,
+            unsigned first_packet,
+            const struct vorbis_segment *next,
+            ogg_int64_t earliest,
+            unsigned *current_packet,
+            unsigned *next_packet);
+
+/*waits for the next segment's thread to finish and splices it
+  onto the current segment, writing the current segment's packets
+  up to the splice and making the next segment current
+
+  if no splice is found, the current segment's encoder carries on
+  through the next segment's input, and the next segment is dropped
+  should that encoder reach the end of it first
+
+  the segment is always closed or made current*/
+static result_t
+join_segment(struct vorbis_segment **current,
+             unsigned *first_packet,
+             struct vorbis_segment *next,
+             ogg_stream_state *ogg_stream,
+             FILE *output,
+             ogg_int64_t *packetno);
+
+static void
+write_packets(const struct vorbis_segment *segment,
+              unsigned first_packet,
+              unsigned last_packet,
+              ogg_stream_state *ogg_stream,
+              FILE *output,
+              ogg_int64_t *packetno);
+
+static void
+close_segment(struct vorbis_segment *segment);
 
 #ifndef STANDALONE
 PyObject*
@@ -65,22 +194,43 @@ encoders_encode_vorbis(PyObject *dummy, PyObject *args, PyObject *keywds)
     char *filename;
     struct PCMReader *pcmreader;
     float quality;
+    int threads = 1;
+    int segment_size = DEFAULT_SEGMENT_SIZE;
     result_t result;
 
     static char *kwlist[] = {"filename",
                              "pcmreader",
                              "quality",
+                             "threads",
+                             "segment_size",
                              NULL};
 
-    if (!PyArg_ParseTupleAndKeywords(args, keywds, "sO&f", kwlist,
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "sO&f|ii", kwlist,
                                      &filename,
                                      py_obj_to_pcmreader,
                                      &pcmreader,
-                                     &quality)) {
+                                     &quality,
+                                     &threads,
+                                     &segment_size)) {
+        return NULL;
+    }
+
+    if (threads <= 0) {
+        PyErr_SetString(PyExc_ValueError, "threads must be > 0");
+        pcmreader->del(pcmreader);
+        return NULL;
+    }
+    if (segment_size <= 0) {
+        PyErr_SetString(PyExc_ValueError, "segment_size must be > 0");
+        pcmreader->del(pcmreader);
         return NULL;
     }
 
-    result = encode_ogg_vorbis(filename, pcmreader, quality);
+    result = encode_ogg_vorbis(filename,
+                               pcmreader,
+                               quality,
+                               (unsigned)threads,
+                               (unsigned)segment_size);
 
     pcmreader->del(pcmreader);
 
@@ -161,9 +311,12 @@ enum {
 };
 
 static result_t
-encode_ogg_vorbis(char *filename, struct PCMReader *pcmreader, float quality)
+encode_ogg_vorbis(char *filename,
+                  struct PCMReader *pcmreader,
+                  float quality,
+                  unsigned threads,
+                  unsigned segment_size)
 {
-    int samples[BLOCK_SIZE * pcmreader->channels];
     FILE *output;
     result_t result = ENCODE_OK;
     vorbis_info vorbis_info;
@@ -172,9 +325,6 @@ encode_ogg_vorbis(char *filename, struct PCMReader *pcmreader, float quality)
     vorbis_block vorbis_block;
     ogg_stream_state ogg_stream;
     ogg_page ogg_page;
-    int end_of_stream = 0;
-    int_to_float_f converter =
-        int_to_float_converter(pcmreader->bits_per_sample);
 
     /*ensure PCMReader object is compatible with Vorbis output*/
     if ((pcmreader->channels == 0) || (pcmreader->channels > 255)) {
@@ -224,7 +374,11 @@ encode_ogg_vorbis(char *filename, struct PCMReader *pcmreader, float quality)
         return ERR_INIT_VBR;
     }
 
-    /*initialize analysis state and block storage*/
+    /*initialize analysis state and block storage
+
+      this also builds the codebooks in vorbis_info
+      which every segment's encoder shares when encoding in parallel,
+      so it must happen before any of them start*/
     vorbis_comment_init(&vorbis_comment);
     vorbis_analysis_init(&vorbis_dsp, &vorbis_info);
     vorbis_block_init(&vorbis_dsp, &vorbis_block);
@@ -257,6 +411,55 @@ encode_ogg_vorbis(char *filename, struct PCMReader *pcmreader, float quality)
         }
     }
 
+    if (threads <= 1) {
+        result = encode_serial(pcmreader,
+                               &vorbis_dsp,
+                               &vorbis_block,
+                               &ogg_stream,
+                               output);
+    } else {
+        /*segments must be long enough to overlap
+          both the segment before and the segment after,
+          and start on multiples of the largest block size
+          so that neighboring encoders' blocks tend to line up*/
+        unsigned segment_frames =
+            (segment_size + SEGMENT_ALIGNMENT - 1) / SEGMENT_ALIGNMENT *
+            SEGMENT_ALIGNMENT;
+        if (segment_frames < (OVERLAP_FRAMES * 2)) {
+            segment_frames = OVERLAP_FRAMES * 2;
+        }
+
+        result = encode_parallel(pcmreader,
+                                 &vorbis_info,
+                                 threads,
+                                 segment_frames,
+                                 &ogg_stream,
+                                 output);
+    }
+
+    ogg_stream_clear(&ogg_stream);
+    vorbis_block_clear(&vorbis_block);
+    vorbis_dsp_clear(&vorbis_dsp);
+    vorbis_comment_clear(&vorbis_comment);
+    vorbis_info_clear(&vorbis_info);
+    fclose(output);
+
+    return result;
+}
+
+static result_t
+encode_serial(struct PCMReader *pcmreader,
+              vorbis_dsp_state *vorbis_dsp,
+              vorbis_block *vorbis_block,
+              ogg_stream_state *ogg_stream,
+              FILE *output)
+{
+    int samples[BLOCK_SIZE * pcmreader->channels];
+    ogg_page ogg_page;
+    int end_of_stream = 0;
+    int_to_float_f converter =
+        int_to_float_converter(pcmreader->bits_per_sample);
+
     while (!end_of_stream) {
         ogg_packet ogg_packet;
         unsigned pcm_frames = pcmreader->read(pcmreader, BLOCK_SIZE, samples);
@@ -270,7 +473,7 @@ encode_ogg_vorbis(char *filename, struct PCMReader *pcmreader, float quality)
             reorder_channels(pcmreader->channel_mask, pcm_frames, samples);
 
             /*grab buffer to be populated*/
-            buffer = vorbis_analysis_buffer(&vorbis_dsp, pcm_frames);
+            buffer = vorbis_analysis_buffer(vorbis_dsp, pcm_frames);
 
             /*populate buffer with floating point samples
               on channel-by-channel basis*/
@@ -286,23 +489,22 @@ encode_ogg_vorbis(char *filename, struct PCMReader *pcmreader, float quality)
                 converter(pcm_frames, channel, buffer[c]);
             }
 
-            vorbis_analysis_wrote(&vorbis_dsp, pcm_frames);
+            vorbis_analysis_wrote(vorbis_dsp, pcm_frames);
         } else if (pcmreader->status != PCM_OK) {
-            result = ERR_PCMREADER;
-            goto cleanup;
+            return ERR_PCMREADER;
         } else {
-            vorbis_analysis_wrote(&vorbis_dsp, 0);
+            vorbis_analysis_wrote(vorbis_dsp, 0);
         }
 
-        while (vorbis_analysis_blockout(&vorbis_dsp, &vorbis_block) == 1) {
-            vorbis_analysis(&vorbis_block, NULL);
-            vorbis_bitrate_addblock(&vorbis_block);
+        while (vorbis_analysis_blockout(vorbis_dsp, vorbis_block) == 1) {
+            vorbis_analysis(vorbis_block, NULL);
+            vorbis_bitrate_addblock(vorbis_block);
 
-            while (vorbis_bitrate_flushpacket(&vorbis_dsp, &ogg_packet)) {
-                ogg_stream_packetin(&ogg_stream, &ogg_packet);
+            while (vorbis_bitrate_flushpacket(vorbis_dsp, &ogg_packet)) {
+                ogg_stream_packetin(ogg_stream, &ogg_packet);
 
                 while (!end_of_stream) {
-                    if (ogg_stream_pageout(&ogg_stream, &ogg_page) == 0) {
+                    if (ogg_stream_pageout(ogg_stream, &ogg_page) == 0) {
                         break;
                     }
 
@@ -316,17 +518,416 @@ encode_ogg_vorbis(char *filename, struct PCMReader *pcmreader, float quality)
         }
     }
 
-cleanup:
-    ogg_stream_clear(&ogg_stream);
-    vorbis_block_clear(&vorbis_block);
-    vorbis_dsp_clear(&vorbis_dsp);
-    vorbis_comment_clear(&vorbis_comment);
-    vorbis_info_clear(&vorbis_info);
-    fclose(output);
+    return ENCODE_OK;
+}
+
+static result_t
+encode_parallel(struct PCMReader *pcmreader,
+                vorbis_info *vorbis_info,
+                unsigned threads,
+                unsigned segment_frames,
+                ogg_stream_state *ogg_stream,
+                FILE *output)
+{
+    const unsigned channels = pcmreader->channels;
+    const unsigned overlap = OVERLAP_FRAMES * 2;
+    const int_to_float_f converter =
+        int_to_float_converter(pcmreader->bits_per_sample);
+    int *history = malloc(sizeof(int) * overlap * channels);
+    unsigned history_frames = 0;
+    struct vorbis_segment **segments =
+        malloc(sizeof(struct vorbis_segment*) * threads);
+    unsigned started = 0;
+    unsigned finished = 0;
+    struct vorbis_segment *current = NULL;
+    unsigned first_packet = 0;
+    ogg_int64_t frames_read = 0;
+    ogg_int64_t packetno = 3;
+    ogg_page ogg_page;
+    int end_of_stream = 0;
+    result_t result = ENCODE_OK;
+
+    /*read the input a segment at a time on this thread,
+      keeping up to one segment per thread encoding in the background*/
+    while (!end_of_stream) {
+        /*the first segment reads on past its boundary with the next,
+          and later segments start with the end of the previous one*/
+        const unsigned to_read =
+            segment_frames + (history_frames ? 0 : OVERLAP_FRAMES);
+        struct vorbis_segment *segment =
+            malloc(sizeof(struct vorbis_segment));
+        unsigned pcm_frames;
+
+        segment->samples =
+            malloc(sizeof(int) * (history_frames + to_read) * channels);
+        memcpy(segment->samples,
+               history,
+               sizeof(int) * history_frames * channels);
+
+        pcm_frames = pcmreader->read(pcmreader,
+                                     to_read,
+                                     segment->samples +
+                                     history_frames * channels);
+        if (!pcm_frames && (pcmreader->status != PCM_OK)) {
+            free(segment->samples);
+            free(segment);
+            result = ERR_PCMREADER;
+            break;
+        }
+        end_of_stream = (pcm_frames < to_read);
+
+        /*reorder channels from .wav to Vorbis order*/
+        reorder_channels(pcmreader->channel_mask,
+                         pcm_frames,
+                         segment->samples + history_frames * channels);
+
+        segment->info = vorbis_info;
+        segment->channels = channels;
+        segment->converter = converter;
+        segment->start = frames_read - history_frames;
+        segment->pcm_frames = history_frames + pcm_frames;
+        segment->final = end_of_stream;
+        segment->channel_data = NULL;
+        segment->encoder_open = 0;
+        segment->encoded_to = segment->start;
+        segment->ended = 0;
+        segment->packets = NULL;
+        segment->packet_count = 0;
+        segment->packets_allocated = 0;
+        segment->result = ENCODE_OK;
+        segment->threaded = 0;
+        frames_read += pcm_frames;
+
+        /*keep the end of this segment's input to start the next*/
+        if (!end_of_stream) {
+            memcpy(history,
+                   segment->samples +
+                   (segment->pcm_frames - overlap) * channels,
+                   sizeof(int) * overlap * channels);
+            history_frames = overlap;
+        }
+
+        /*wait for the oldest segment to make room for this one*/
+        if ((started - finished) == threads) {
+            if ((result = join_segment(&current,
+                                       &first_packet,
+                                       segments[finished++ % threads],
+                                       ogg_stream,
+                                       output,
+                                       &packetno)) != ENCODE_OK) {
+                close_segment(segment);
+                break;
+            }
+        }
+
+        segment->threaded = !pthread_create(&segment->thread,
+                                            NULL,
+                                            (void*(*)(void*))encode_segment,
+                                            segment);
+        if (!segment->threaded) {
+            /*encode on this thread if another can't be started*/
+            encode_segment(segment);
+        }
+        segments[started++ % threads] = segment;
+    }
+
+    /*splice the remaining segments together in order,
+      or just wait for them and discard them after an error*/
+    while (finished < started) {
+        struct vorbis_segment *segment = segments[finished++ % threads];
+
+        if (result == ENCODE_OK) {
+            result = join_segment(&current,
+                                  &first_packet,
+                                  segment,
+                                  ogg_stream,
+                                  output,
+                                  &packetno);
+        } else {
+            if (segment->threaded) {
+                pthread_join(segment->thread, NULL);
+            }
+            close_segment(segment);
+        }
+    }
 
+    /*the last segment standing has ended the stream*/
+    if (current != NULL) {
+        if (result == ENCODE_OK) {
+            write_packets(current,
+                          first_packet,
+                          current->packet_count,
+                          ogg_stream,
+                          output,
+                          &packetno);
+
+            while (ogg_stream_flush(ogg_stream, &ogg_page)) {
+                fwrite(ogg_page.header, 1, ogg_page.header_len, output);
+                fwrite(ogg_page.body, 1, ogg_page.body_len, output);
+            }
+        }
+        close_segment(current);
+    }
+
+    free(history);
+    free(segments);
     return result;
 }
 
+static void*
+encode_segment(struct vorbis_segment *segment)
+{
+    const unsigned channels = segment->channels;
+    const unsigned pcm_frames = segment->pcm_frames;
+    int *channel = malloc(sizeof(int) * pcm_frames);
+    unsigned c;
+    unsigned i;
+
+    /*convert input to floating point samples
+      on channel-by-channel basis*/
+    segment->channel_data = malloc(sizeof(float*) * channels);
+    for (c = 0; c < channels; c++) {
+        segment->channel_data[c] = malloc(sizeof(float) * pcm_frames);
+        get_channel_data(segment->samples,
+                         c,
+                         channels,
+                         pcm_frames,
+                         channel);
+        segment->converter(pcm_frames, channel, segment->channel_data[c]);
+    }
+    free(channel);
+    free(segment->samples);
+    segment->samples = NULL;
+
+    if (vorbis_analysis_init(&segment->dsp, segment->info)) {
+        segment->result = ERR_INIT_VBR;
+        return NULL;
+    }
+    vorbis_block_init(&segment->dsp, &segment->block);
+    segment->encoder_open = 1;
+
+    /*pass input to the encoder in the same pieces as the serial encoder*/
+    for (i = 0; i < pcm_frames; i += BLOCK_SIZE) {
+        analyze_frames(segment,
+                       segment->channel_data,
+                       i,
+                       (pcm_frames - i) < BLOCK_SIZE ?
+                       (pcm_frames - i) : BLOCK_SIZE,
+                       0);
+    }
+    if (segment->final) {
+        analyze_frames(segment, segment->channel_data, pcm_frames, 0, 1);
+    }
+
+    return NULL;
+}
+
+static void
+analyze_frames(struct vorbis_segment *segment,
+               float **channel_data,
+               unsigned offset,
+               unsigned pcm_frames,
+               int end_of_stream)
+{
+    ogg_packet ogg_packet;
+
+    if (pcm_frames) {
+        float **buffer = vorbis_analysis_buffer(&segment->dsp, pcm_frames);
+        unsigned c;
+
+        for (c = 0; c < segment->channels; c++) {
+            memcpy(buffer[c],
+                   channel_data[c] + offset,
+                   sizeof(float) * pcm_frames);
+        }
+
+        vorbis_analysis_wrote(&segment->dsp, pcm_frames);
+        segment->encoded_to += pcm_frames;
+    }
+    if (end_of_stream) {
+        vorbis_analysis_wrote(&segment->dsp, 0);
+        segment->ended = 1;
+    }
+
+    while (vorbis_analysis_blockout(&segment->dsp, &segment->block) == 1) {
+        vorbis_analysis(&segment->block, NULL);
+        vorbis_bitrate_addblock(&segment->block);
+
+        while (vorbis_bitrate_flushpacket(&segment->dsp, &ogg_packet)) {
+            struct vorbis_packet *packet;
+
+            if (segment->packet_count == segment->packets_allocated) {
+                segment->packets_allocated =
+                    segment->packets_allocated ?
+                    segment->packets_allocated * 2 : 256;
+                segment->packets =
+                    realloc(segment->packets,
+                            sizeof(struct vorbis_packet) *
+                            segment->packets_allocated);
+            }
+
+            packet = &segment->packets[segment->packet_count++];
+            packet->data = malloc(ogg_packet.bytes);
+            memcpy(packet->data, ogg_packet.packet, ogg_packet.bytes);
+            packet->bytes = ogg_packet.bytes;
+            packet->blocksize =
+                vorbis_packet_blocksize(segment->info, &ogg_packet);
+            packet->granulepos = segment->start + ogg_packet.granulepos;
+            packet->e_o_s = ogg_packet.e_o_s;
+        }
+    }
+}
+
+static int
+find_splice(const struct vorbis_segment *current,
+            unsigned first_packet,
+            const struct vorbis_segment *next,
+            ogg_int64_t earliest,
+            unsigned *current_packet,
+            unsigned *next_packet)
+{
+    unsigned i = first_packet;
+    unsigned j = 0;
+
+    while (((i + 1) < current->packet_count) &&
+           ((j + 1) < next->packet_count)) {
+        const struct vorbis_packet *a = &current->packets[i];
+        const struct vorbis_packet *b = &next->packets[j];
+
+        if ((a->granulepos < earliest) || (a->granulepos < b->granulepos)) {
+            i++;
+        } else if (b->granulepos < a->granulepos) {
+            j++;
+        } else if ((a->blocksize == b->blocksize) &&
+                   (a[1].blocksize == b[1].blocksize)) {
+            *current_packet = i;
+            *next_packet = j;
+            return 1;
+        } else {
+            i++;
+            j++;
+        }
+    }
+
+    return 0;
+}
+
+static result_t
+join_segment(struct vorbis_segment **current,
+             unsigned *first_packet,
+             struct vorbis_segment *next,
+             ogg_stream_state *ogg_stream,
+             FILE *output,
+             ogg_int64_t *packetno)
+{
+    struct vorbis_segment *previous = *current;
+    const ogg_int64_t next_end = next->start + next->pcm_frames;
+    unsigned i;
+    unsigned j;
+
+    if (next->threaded) {
+        pthread_join(next->thread, NULL);
+    }
+
+    if (next->result != ENCODE_OK) {
+        const result_t result = next->result;
+        close_segment(next);
+        return result;
+    } else if (previous == NULL) {
+        /*the first segment has nothing to splice onto*/
+        *current = next;
+        *first_packet = 0;
+        return ENCODE_OK;
+    }
+
+    /*splice only after the next segment's encoder has settled*/
+    while (!find_splice(previous,
+                        *first_packet,
+                        next,
+                        next->start + OVERLAP_FRAMES,
+                        &i,
+                        &j)) {
+        if ((previous->encoded_to < next_end) ||
+            (next->final && !previous->ended)) {
+            /*carry the previous encoder on into the next segment's input
+              a block at a time until a splice turns up*/
+            const unsigned pcm_frames =
+                (next_end - previous->encoded_to) < BLOCK_SIZE ?
+                (unsigned)(next_end - previous->encoded_to) : BLOCK_SIZE;
+
+            analyze_frames(previous,
+                           next->channel_data,
+                           (unsigned)(previous->encoded_to - next->start),
+                           pcm_frames,
+                           next->final &&
+                           ((previous->encoded_to + pcm_frames) == next_end));
+        } else {
+            /*the previous encoder has covered all of the next segment,
+              so the previous segment remains current*/
+            close_segment(next);
+            return ENCODE_OK;
+        }
+    }
+
+    write_packets(previous, *first_packet, i + 1, ogg_stream, output, packetno);
+    close_segment(previous);
+    *current = next;
+    *first_packet = j + 1;
+    return ENCODE_OK;
+}
+
+static void
+write_packets(const struct vorbis_segment *segment,
+              unsigned first_packet,
+              unsigned last_packet,
+              ogg_stream_state *ogg_stream,
+              FILE *output,
+              ogg_int64_t *packetno)
+{
+    ogg_page ogg_page;
+
+    for (; first_packet < last_packet; first_packet++) {
+        const struct vorbis_packet *packet = &segment->packets[first_packet];
+        ogg_packet ogg_packet;
+
+        ogg_packet.packet = packet->data;
+        ogg_packet.bytes = packet->bytes;
+        ogg_packet.b_o_s = 0;
+        ogg_packet.e_o_s = packet->e_o_s;
+        ogg_packet.granulepos = packet->granulepos;
+        ogg_packet.packetno = (*packetno)++;
+
+        ogg_stream_packetin(ogg_stream, &ogg_packet);
+        while (ogg_stream_pageout(ogg_stream, &ogg_page)) {
+            fwrite(ogg_page.header, 1, ogg_page.header_len, output);
+            fwrite(ogg_page.body, 1, ogg_page.body_len, output);
+        }
+    }
+}
+
+static void
+close_segment(struct vorbis_segment *segment)
+{
+    unsigned i;
+
+    if (segment->encoder_open) {
+        vorbis_block_clear(&segment->block);
+        vorbis_dsp_clear(&segment->dsp);
+    }
+    for (i = 0; i < segment->packet_count; i++) {
+        free(segment->packets[i].data);
+    }
+    free(segment->packets);
+    if (segment->channel_data != NULL) {
+        for (i = 0; i < segment->channels; i++) {
+            free(segment->channel_data[i]);
+        }
+        free(segment->channel_data);
+    }
+    free(segment->samples);
+    free(segment);
+}
+
 static void
 reorder_channels(unsigned channel_mask, unsigned pcm_frames, int *samples)
 {
@@ -414,7 +1015,8 @@ int main(int argc, char *argv[])
     unsigned channels = 2;
     unsigned sample_rate = 44100;
     unsigned bits_per_sample = 16;
-    pcmreader *pcmreader = NULL;
+    unsigned threads = 1;
+    struct PCMReader *pcmreader = NULL;
     result_t result;
 
     char c;
@@ -423,9 +1025,10 @@ int main(int argc, char *argv[])
         {"channels",                required_argument, NULL, 'c'},
         {"sample-rate",             required_argument, NULL, 'r'},
         {"bits-per-sample",         required_argument, NULL, 'b'},
+        {"threads",                 required_argument, NULL, 't'},
         {NULL,                      no_argument,       NULL,  0}
     };
-    const static char* short_opts = "-hc:r:b:";
+    const static char* short_opts = "-hc:r:b:t:";
 
     while ((c = getopt_long(argc,
                             argv,
@@ -459,6 +1062,12 @@ int main(int argc, char *argv[])
                 return 1;
             }
             break;
+        case 't':
+            if (((threads = strtoul(optarg, NULL, 10)) == 0) && errno) {
+                printf("invalid --threads \"%s\"\n", optarg);
+                return 1;
+            }
+            break;
         case 'h': /*fallthrough*/
         case ':':
         case '?':
@@ -466,6 +1075,7 @@ int main(int argc, char *argv[])
             printf("-c, --channels=#          number of input channels\n");
             printf("-r, --sample_rate=#       input sample rate in Hz\n");
             printf("-b, --bits-per-sample=#   bits per input sample\n");
+            printf("-t, --threads=#           number of threads to encode with\n");
             return 0;
         default:
             break;
@@ -490,15 +1100,16 @@ int main(int argc, char *argv[])
     printf("bits per sample %u\n", bits_per_sample);
     printf("little-endian, signed samples\n");
 
-    pcmreader = open_pcmreader(stdin,
-                               sample_rate,
-                               channels,
-                               0,
-                               bits_per_sample,
-                               0,
-                               1);
+    pcmreader = pcmreader_open_raw(stdin,
+                                   sample_rate,
+                                   channels,
+                                   0,
+                                   bits_per_sample,
+                                   0,
+                                   1);
 
-    switch (result = encode_ogg_vorbis(output_file, pcmreader, 0.3)) {
+    switch (result = encode_ogg_vorbis(output_file, pcmreader, 0.3,
+                                       threads, DEFAULT_SEGMENT_SIZE)) {
     case ENCODE_OK:
         break;
     default:
@@ -56,6 +56,34 @@ empty_FrameList(PyObject* audiotools_pcm,
         audiotools_pcm,
         "empty_framelist", "ii", channels, bits_per_sample);
 }
+
+PyObject*
+pcm_source_capsule(PyObject *self,
+                   PyTypeObject *type,
+                   const struct pcm_source *source)
+{
+    PyObject *capsule;
+
+    if (Py_TYPE(self) != type) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+
+    if ((capsule = PyCapsule_New((void*)source,
+                                 PCM_SOURCE_CAPSULE,
+                                 NULL)) == NULL) {
+        return NULL;
+    }
+
+    /*tag the capsule with its object so that it can't be used
+      by some other object forwarding its attributes*/
+    if (PyCapsule_SetContext(capsule, self)) {
+        Py_DECREF(capsule);
+        return NULL;
+    }
+
+    return capsule;
+}
 #endif
 
 void
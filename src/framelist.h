@@ -55,6 +55,37 @@ empty_FrameList(PyObject* audiotools_pcm,
                 unsigned channels,
                 unsigned bits_per_sample);
 
+/*A C type which generates PCM data may also export it as a pcm_source
+  through a capsule returned by its "_pcm_source" attribute.
+
+  C routines reading the object through a PCMReader struct
+  then take its samples directly rather than calling its read() method,
+  so no FrameList objects are built between the two.*/
+
+#define PCM_SOURCE_CAPSULE "audiotools.pcm_source"
+
+struct pcm_source {
+    /*returns the most PCM frames a single call to read may return*/
+    unsigned (*block_size)(PyObject *self);
+
+    /*decodes the next block of PCM frames into "pcm_data"
+      which must hold at least block_size * channels samples,
+      places the number of frames decoded in "pcm_frames"
+      (which is 0 at the end of the stream) and returns 0,
+      or returns 1 with a Python exception set if an error occurs*/
+    int (*read)(PyObject *self, int *pcm_data, unsigned *pcm_frames);
+};
+
+/*returns a new capsule wrapping "source" for the given object
+  to be returned by its "_pcm_source" attribute
+
+  returns None if the object is a subclass of "type",
+  since a subclass may override read()*/
+PyObject*
+pcm_source_capsule(PyObject *self,
+                   PyTypeObject *type,
+                   const struct pcm_source *source);
+
 #endif
 
 /*pcm_data must contain at least:  channel_count * pcm_frames  entries
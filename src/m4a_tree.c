@@ -0,0 +1,797 @@
+#include "m4a_tree.h"
+#include <stdlib.h>
+#include <string.h>
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+/*the size of the buffer used when copying atoms from the file*/
+#define COPY_BUFFER_SIZE 65536
+
+/*atoms whose payloads are parsed as other atoms*/
+static const char *const CONTAINERS[] = {
+    "moov", "trak", "mdia", "minf", "stbl", "udta", "edts", "dinf",
+    "mvex", "moof", "traf", "mfra", "meta", "ilst", NULL
+};
+
+/*the containers leading from the top of the file to chunk offset atoms*/
+static const char *const CHUNK_OFFSET_PATH[] = {
+    "moov", "trak", "mdia", "minf", "stbl", NULL
+};
+
+/*an unmodified top-level atom's original position and how far it's moved*/
+struct m4a_shift {
+    uint64_t offset;
+    uint64_t size;
+    int64_t delta;
+};
+
+struct m4a_shifts {
+    unsigned count;
+    struct m4a_shift *shifts;
+};
+
+static inline uint32_t
+read_be32(const uint8_t *data)
+{
+    return ((uint32_t)data[0] << 24) |
+           ((uint32_t)data[1] << 16) |
+           ((uint32_t)data[2] << 8) |
+           (uint32_t)data[3];
+}
+
+static inline uint64_t
+read_be64(const uint8_t *data)
+{
+    return ((uint64_t)read_be32(data) << 32) | read_be32(data + 4);
+}
+
+static inline void
+write_be32(uint8_t *data, uint32_t value)
+{
+    data[0] = (value >> 24) & 0xFF;
+    data[1] = (value >> 16) & 0xFF;
+    data[2] = (value >> 8) & 0xFF;
+    data[3] = value & 0xFF;
+}
+
+static inline void
+write_be64(uint8_t *data, uint64_t value)
+{
+    write_be32(data, (uint32_t)(value >> 32));
+    write_be32(data + 4, (uint32_t)value);
+}
+
+static int
+name_in(const uint8_t name[4], const char *const names[])
+{
+    unsigned i;
+
+    for (i = 0; names[i] != NULL; i++) {
+        if (!memcmp(name, names[i], 4))
+            return 1;
+    }
+    return 0;
+}
+
+const char*
+m4a_strerror(m4a_status status)
+{
+    switch (status) {
+    case M4A_OK:
+        return "no error";
+    case M4A_IO_ERROR:
+        return "I/O error reading M4A file";
+    case M4A_INVALID_ATOM:
+        return "invalid M4A atom";
+    case M4A_NOT_CONTAINER:
+        return "M4A atom has no child atoms";
+    case M4A_OFFSET_OVERFLOW:
+        return "M4A chunk offset too large for stco atom";
+    case M4A_WRITE_ERROR:
+        return "error writing M4A atom";
+    default:
+        return "unknown error";
+    }
+}
+
+static m4a_status
+read_source(struct m4a_tree *tree, uint64_t offset, uint8_t *data, size_t size)
+{
+    if (fseek(tree->file, (long)offset, SEEK_SET) ||
+        (fread(data, 1, size, tree->file) != size)) {
+        return M4A_IO_ERROR;
+    } else {
+        return M4A_OK;
+    }
+}
+
+static void
+free_atom(struct m4a_atom *atom)
+{
+    unsigned i;
+
+    for (i = 0; i < atom->child_count; i++) {
+        free_atom(atom->children[i]);
+    }
+    free(atom->children);
+    free(atom->data);
+    free(atom);
+}
+
+static void
+detach_atom(struct m4a_tree *tree, struct m4a_atom *atom)
+{
+    if (tree->detached_count == tree->detached_capacity) {
+        tree->detached_capacity = tree->detached_capacity ?
+            tree->detached_capacity * 2 : 8;
+        tree->detached = realloc(tree->detached,
+                                 tree->detached_capacity *
+                                 sizeof(struct m4a_atom*));
+    }
+    atom->parent = NULL;
+    tree->detached[tree->detached_count++] = atom;
+}
+
+static void
+append_child(struct m4a_atom *parent, struct m4a_atom *child)
+{
+    if (parent->child_count == parent->child_capacity) {
+        parent->child_capacity = parent->child_capacity ?
+            parent->child_capacity * 2 : 4;
+        parent->children = realloc(parent->children,
+                                   parent->child_capacity *
+                                   sizeof(struct m4a_atom*));
+    }
+    child->parent = parent;
+    parent->children[parent->child_count++] = child;
+}
+
+/*marks the atom and all of its parents as differing from the file*/
+static void
+mark_modified(struct m4a_atom *atom)
+{
+    for (; atom != NULL; atom = atom->parent) {
+        atom->in_source = 0;
+    }
+}
+
+/*parses the atoms between "start" and "end" in the file
+  and appends them to "parent"*/
+static m4a_status
+parse_atoms(struct m4a_tree *tree,
+            struct m4a_atom *parent,
+            uint64_t start,
+            uint64_t end)
+{
+    uint64_t position = start;
+
+    while (position < end) {
+        uint8_t header[16];
+        unsigned header_size = 8;
+        uint64_t size;
+        struct m4a_atom *atom;
+        m4a_status status;
+
+        if ((end - position) < 8) {
+            /*keep any few leftover bytes so the container's size is kept*/
+            parent->trailer_size = (unsigned)(end - position);
+            return read_source(tree, position,
+                               parent->trailer, parent->trailer_size);
+        }
+
+        if ((status = read_source(tree, position, header, 8)) != M4A_OK)
+            return status;
+
+        size = read_be32(header);
+        if (size == 1) {
+            /*64-bit size follows the atom's name*/
+            if ((end - position) < 16)
+                return M4A_INVALID_ATOM;
+            if ((status = read_source(tree, position + 8,
+                                      header + 8, 8)) != M4A_OK)
+                return status;
+            size = read_be64(header + 8);
+            header_size = 16;
+        } else if (size == 0) {
+            /*atom extends to the end of its parent*/
+            size = end - position;
+        }
+
+        if ((size > (end - position)) && (parent == &(tree->root))) {
+            /*a truncated final atom, such as an incomplete "mdat",
+              runs to the end of the file
+              so that its contents are still copied as-is*/
+            size = end - position;
+        }
+
+        if ((size < header_size) || (size > (end - position)))
+            return M4A_INVALID_ATOM;
+
+        atom = calloc(1, sizeof(struct m4a_atom));
+        memcpy(atom->name, header + 4, 4);
+        atom->in_source = 1;
+        atom->source_offset = position;
+        atom->source_header_size = header_size;
+        atom->source_size = size;
+        atom->is_container = name_in(atom->name, CONTAINERS);
+        append_child(parent, atom);
+
+        position += size;
+    }
+
+    return M4A_OK;
+}
+
+m4a_status
+m4a_tree_open(FILE *file, struct m4a_tree **tree)
+{
+    struct m4a_tree *new_tree;
+    long file_size;
+    m4a_status status;
+
+    if (fseek(file, 0, SEEK_END) || ((file_size = ftell(file)) < 0))
+        return M4A_IO_ERROR;
+
+    new_tree = calloc(1, sizeof(struct m4a_tree));
+    new_tree->file = file;
+    new_tree->file_size = (uint64_t)file_size;
+    new_tree->root.in_source = 1;
+    new_tree->root.source_size = new_tree->file_size;
+    new_tree->root.is_container = 1;
+    new_tree->root.children_parsed = 1;
+
+    if ((status = parse_atoms(new_tree, &new_tree->root,
+                              0, new_tree->file_size)) != M4A_OK) {
+        /*leave the file for the caller to close*/
+        new_tree->file = NULL;
+        m4a_tree_free(new_tree);
+        return status;
+    }
+
+    *tree = new_tree;
+    return M4A_OK;
+}
+
+void
+m4a_tree_free(struct m4a_tree *tree)
+{
+    unsigned i;
+
+    for (i = 0; i < tree->root.child_count; i++) {
+        free_atom(tree->root.children[i]);
+    }
+    free(tree->root.children);
+    for (i = 0; i < tree->detached_count; i++) {
+        free_atom(tree->detached[i]);
+    }
+    free(tree->detached);
+    if (tree->file != NULL)
+        fclose(tree->file);
+    free(tree);
+}
+
+m4a_status
+m4a_atom_parse_children(struct m4a_tree *tree, struct m4a_atom *atom)
+{
+    uint64_t start;
+    uint64_t end;
+    m4a_status status;
+
+    if (!atom->is_container) {
+        return M4A_NOT_CONTAINER;
+    } else if (atom->children_parsed) {
+        return M4A_OK;
+    }
+
+    start = atom->source_offset + atom->source_header_size;
+    end = atom->source_offset + atom->source_size;
+
+    if (!memcmp(atom->name, "meta", 4)) {
+        /*ISO "meta" atoms have a version and flags before their children
+          while QuickTime ones do not*/
+        uint8_t peek[8];
+
+        if ((end - start) >= 8) {
+            if ((status = read_source(tree, start, peek, 8)) != M4A_OK)
+                return status;
+            if (memcmp(peek + 4, "hdlr", 4)) {
+                memcpy(atom->prefix, peek, 4);
+                atom->prefix_size = 4;
+            }
+        }
+    }
+
+    atom->children_parsed = 1;
+    if ((status = parse_atoms(tree, atom,
+                              start + atom->prefix_size, end)) != M4A_OK) {
+        /*leave the atom as an unparsed container*/
+        unsigned i;
+        for (i = 0; i < atom->child_count; i++) {
+            free_atom(atom->children[i]);
+        }
+        atom->child_count = 0;
+        atom->prefix_size = 0;
+        atom->trailer_size = 0;
+        atom->children_parsed = 0;
+        return status;
+    }
+
+    return M4A_OK;
+}
+
+m4a_status
+m4a_atom_find(struct m4a_tree *tree,
+              struct m4a_atom *atom,
+              unsigned count,
+              const uint8_t names[][4],
+              struct m4a_atom **found)
+{
+    unsigned i;
+
+    if (count == 0) {
+        *found = atom;
+        return M4A_OK;
+    }
+
+    switch (m4a_atom_parse_children(tree, atom)) {
+    case M4A_OK:
+        break;
+    case M4A_NOT_CONTAINER:
+        *found = NULL;
+        return M4A_OK;
+    default:
+        return M4A_INVALID_ATOM;
+    }
+
+    for (i = 0; i < atom->child_count; i++) {
+        if (!memcmp(atom->children[i]->name, names[0], 4)) {
+            return m4a_atom_find(tree,
+                                 atom->children[i],
+                                 count - 1,
+                                 names + 1,
+                                 found);
+        }
+    }
+
+    *found = NULL;
+    return M4A_OK;
+}
+
+/*returns the size of the atom's payload not including its header*/
+static uint64_t
+payload_size(const struct m4a_atom *atom)
+{
+    if (atom->in_source) {
+        return atom->source_size - atom->source_header_size;
+    } else if (atom->is_container) {
+        uint64_t size = atom->prefix_size + atom->trailer_size;
+        unsigned i;
+
+        for (i = 0; i < atom->child_count; i++) {
+            size += m4a_atom_size(atom->children[i]);
+        }
+        return size;
+    } else {
+        return atom->data_size;
+    }
+}
+
+/*returns the size of the header the atom is written with*/
+static unsigned
+header_size(const struct m4a_atom *atom)
+{
+    if (atom->in_source) {
+        return atom->source_header_size;
+    } else {
+        return (payload_size(atom) + 8) > 0xFFFFFFFF ? 16 : 8;
+    }
+}
+
+uint64_t
+m4a_atom_size(const struct m4a_atom *atom)
+{
+    if (atom->in_source) {
+        return atom->source_size;
+    } else {
+        return header_size(atom) + payload_size(atom);
+    }
+}
+
+static m4a_status
+copy_source(struct m4a_tree *tree,
+            uint64_t offset,
+            uint64_t size,
+            m4a_write_f write,
+            void *output)
+{
+    uint8_t buffer[COPY_BUFFER_SIZE];
+
+    if (fseek(tree->file, (long)offset, SEEK_SET))
+        return M4A_IO_ERROR;
+
+    while (size > 0) {
+        const size_t to_read =
+            size > COPY_BUFFER_SIZE ? COPY_BUFFER_SIZE : (size_t)size;
+
+        if (fread(buffer, 1, to_read, tree->file) != to_read)
+            return M4A_IO_ERROR;
+        if (write(output, buffer, (unsigned)to_read))
+            return M4A_WRITE_ERROR;
+        size -= to_read;
+    }
+
+    return M4A_OK;
+}
+
+static m4a_status
+write_header(const struct m4a_atom *atom, m4a_write_f write, void *output)
+{
+    uint8_t header[16];
+    const unsigned size = header_size(atom);
+
+    if (size == 8) {
+        write_be32(header, (uint32_t)m4a_atom_size(atom));
+        memcpy(header + 4, atom->name, 4);
+    } else {
+        write_be32(header, 1);
+        memcpy(header + 4, atom->name, 4);
+        write_be64(header + 8, m4a_atom_size(atom));
+    }
+
+    return write(output, header, size) ? M4A_WRITE_ERROR : M4A_OK;
+}
+
+/*returns the chunk offset adjusted for the atom it points into*/
+static int64_t
+shift_offset(const struct m4a_shifts *shifts, uint64_t offset)
+{
+    unsigned i;
+
+    for (i = 0; i < shifts->count; i++) {
+        const struct m4a_shift *shift = &(shifts->shifts[i]);
+        if ((offset >= shift->offset) &&
+            (offset < (shift->offset + shift->size))) {
+            return (int64_t)offset + shift->delta;
+        }
+    }
+
+    return (int64_t)offset;
+}
+
+/*writes an unmodified "stco" or "co64" atom with its offsets shifted*/
+static m4a_status
+write_chunk_offsets(struct m4a_tree *tree,
+                    const struct m4a_atom *atom,
+                    const struct m4a_shifts *shifts,
+                    m4a_write_f write,
+                    void *output)
+{
+    const int co64 = !memcmp(atom->name, "co64", 4);
+    const unsigned entry_size = co64 ? 8 : 4;
+    const uint64_t size = payload_size(atom);
+    uint8_t *payload;
+    uint64_t entries;
+    uint64_t i;
+    m4a_status status;
+
+    if (size < 8)
+        return M4A_INVALID_ATOM;
+
+    payload = malloc((size_t)size);
+    if ((status = read_source(tree,
+                              atom->source_offset + atom->source_header_size,
+                              payload,
+                              (size_t)size)) != M4A_OK) {
+        free(payload);
+        return status;
+    }
+
+    entries = read_be32(payload + 4);
+    if (entries > ((size - 8) / entry_size)) {
+        free(payload);
+        return M4A_INVALID_ATOM;
+    }
+
+    for (i = 0; i < entries; i++) {
+        uint8_t *entry = payload + 8 + i * entry_size;
+
+        if (co64) {
+            write_be64(entry, (uint64_t)shift_offset(shifts,
+                                                     read_be64(entry)));
+        } else {
+            const int64_t offset = shift_offset(shifts, read_be32(entry));
+            if ((offset < 0) || (offset > 0xFFFFFFFF)) {
+                free(payload);
+                return M4A_OFFSET_OVERFLOW;
+            }
+            write_be32(entry, (uint32_t)offset);
+        }
+    }
+
+    if ((status = write_header(atom, write, output)) == M4A_OK) {
+        if (write(output, payload, (unsigned)size))
+            status = M4A_WRITE_ERROR;
+    }
+    free(payload);
+    return status;
+}
+
+static m4a_status
+write_atom(struct m4a_tree *tree,
+           struct m4a_atom *atom,
+           const struct m4a_shifts *shifts,
+           m4a_write_f write,
+           void *output);
+
+static m4a_status
+write_payload(struct m4a_tree *tree,
+              struct m4a_atom *atom,
+              const struct m4a_shifts *shifts,
+              m4a_write_f write,
+              void *output)
+{
+    m4a_status status;
+
+    if ((shifts != NULL) && atom->in_source && atom->is_container &&
+        name_in(atom->name, CHUNK_OFFSET_PATH)) {
+        /*descend toward any chunk offset atoms
+          which need adjusting*/
+        if ((status = m4a_atom_parse_children(tree, atom)) != M4A_OK)
+            return status;
+    } else if (atom->in_source) {
+        return copy_source(tree,
+                           atom->source_offset + atom->source_header_size,
+                           payload_size(atom),
+                           write,
+                           output);
+    }
+
+    if (atom->is_container) {
+        unsigned i;
+
+        if (write(output, atom->prefix, atom->prefix_size))
+            return M4A_WRITE_ERROR;
+        for (i = 0; i < atom->child_count; i++) {
+            if ((status = write_atom(tree,
+                                     atom->children[i],
+                                     shifts,
+                                     write,
+                                     output)) != M4A_OK)
+                return status;
+        }
+        if (write(output, atom->trailer, atom->trailer_size))
+            return M4A_WRITE_ERROR;
+        return M4A_OK;
+    } else {
+        uint64_t remaining = atom->data_size;
+        const uint8_t *data = atom->data;
+
+        /*write large payloads in pieces
+          since each write takes a 32-bit size*/
+        while (remaining > 0) {
+            const unsigned size = remaining > COPY_BUFFER_SIZE ?
+                COPY_BUFFER_SIZE : (unsigned)remaining;
+            if (write(output, data, size))
+                return M4A_WRITE_ERROR;
+            data += size;
+            remaining -= size;
+        }
+        return M4A_OK;
+    }
+}
+
+static m4a_status
+write_atom(struct m4a_tree *tree,
+           struct m4a_atom *atom,
+           const struct m4a_shifts *shifts,
+           m4a_write_f write,
+           void *output)
+{
+    m4a_status status;
+
+    if ((shifts != NULL) && atom->in_source && !atom->is_container &&
+        (!memcmp(atom->name, "stco", 4) || !memcmp(atom->name, "co64", 4))) {
+        return write_chunk_offsets(tree, atom, shifts, write, output);
+    }
+
+    if ((status = write_header(atom, write, output)) != M4A_OK)
+        return status;
+
+    return write_payload(tree, atom, shifts, write, output);
+}
+
+struct m4a_buffer {
+    uint8_t *data;
+    uint64_t size;
+};
+
+static int
+write_buffer(void *output, const uint8_t *data, unsigned size)
+{
+    struct m4a_buffer *buffer = output;
+
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+    return 0;
+}
+
+m4a_status
+m4a_atom_data(struct m4a_tree *tree,
+              struct m4a_atom *atom,
+              uint8_t **data,
+              uint64_t *size)
+{
+    struct m4a_buffer buffer;
+    m4a_status status;
+
+    buffer.data = malloc((size_t)payload_size(atom) + 1);
+    buffer.size = 0;
+
+    if ((status = write_payload(tree,
+                                atom,
+                                NULL,
+                                write_buffer,
+                                &buffer)) == M4A_OK) {
+        *data = buffer.data;
+        *size = buffer.size;
+    } else {
+        free(buffer.data);
+    }
+    return status;
+}
+
+void
+m4a_atom_set_data(struct m4a_tree *tree,
+                  struct m4a_atom *atom,
+                  const uint8_t *data,
+                  uint64_t size)
+{
+    unsigned i;
+
+    for (i = 0; i < atom->child_count; i++) {
+        detach_atom(tree, atom->children[i]);
+    }
+    free(atom->children);
+    atom->children = NULL;
+    atom->child_count = atom->child_capacity = 0;
+    atom->prefix_size = atom->trailer_size = 0;
+    atom->is_container = 0;
+
+    free(atom->data);
+    atom->data = malloc((size_t)size + 1);
+    memcpy(atom->data, data, (size_t)size);
+    atom->data_size = size;
+
+    mark_modified(atom);
+}
+
+m4a_status
+m4a_atom_add_child(struct m4a_tree *tree,
+                   struct m4a_atom *parent,
+                   const uint8_t name[4],
+                   const uint8_t *data,
+                   uint64_t size,
+                   struct m4a_atom **child)
+{
+    struct m4a_atom *atom;
+    m4a_status status;
+
+    if ((status = m4a_atom_parse_children(tree, parent)) != M4A_OK)
+        return status;
+
+    atom = calloc(1, sizeof(struct m4a_atom));
+    memcpy(atom->name, name, 4);
+    if (data != NULL) {
+        atom->data = malloc((size_t)size + 1);
+        memcpy(atom->data, data, (size_t)size);
+        atom->data_size = size;
+    } else {
+        atom->is_container = 1;
+        atom->children_parsed = 1;
+        if (!memcmp(name, "meta", 4)) {
+            /*new "meta" atoms get a version and flags*/
+            atom->prefix_size = 4;
+        }
+    }
+    append_child(parent, atom);
+    mark_modified(atom);
+
+    *child = atom;
+    return M4A_OK;
+}
+
+m4a_status
+m4a_atom_remove_child(struct m4a_tree *tree,
+                      struct m4a_atom *parent,
+                      struct m4a_atom *child)
+{
+    unsigned i;
+    m4a_status status;
+
+    if ((status = m4a_atom_parse_children(tree, parent)) != M4A_OK)
+        return status;
+
+    for (i = 0; i < parent->child_count; i++) {
+        if (parent->children[i] == child) {
+            memmove(parent->children + i,
+                    parent->children + i + 1,
+                    (parent->child_count - i - 1) *
+                    sizeof(struct m4a_atom*));
+            parent->child_count--;
+            detach_atom(tree, child);
+            mark_modified(parent);
+            return M4A_OK;
+        }
+    }
+
+    return M4A_OK;
+}
+
+m4a_status
+m4a_atom_build(struct m4a_tree *tree,
+               struct m4a_atom *atom,
+               m4a_write_f write,
+               void *output)
+{
+    if (atom == &(tree->root)) {
+        return write_payload(tree, atom, NULL, write, output);
+    } else {
+        return write_atom(tree, atom, NULL, write, output);
+    }
+}
+
+m4a_status
+m4a_tree_build(struct m4a_tree *tree, m4a_write_f write, void *output)
+{
+    struct m4a_shifts shifts;
+    uint64_t offset = 0;
+    int shifted = 0;
+    unsigned i;
+    m4a_status status = M4A_OK;
+
+    /*determine how far each unmodified top-level atom moves*/
+    shifts.count = 0;
+    shifts.shifts = malloc((tree->root.child_count + 1) *
+                           sizeof(struct m4a_shift));
+    for (i = 0; i < tree->root.child_count; i++) {
+        const struct m4a_atom *atom = tree->root.children[i];
+
+        if (atom->in_source) {
+            struct m4a_shift *shift = &(shifts.shifts[shifts.count++]);
+            shift->offset = atom->source_offset;
+            shift->size = atom->source_size;
+            shift->delta = (int64_t)offset - (int64_t)atom->source_offset;
+            if (shift->delta != 0)
+                shifted = 1;
+        }
+        offset += m4a_atom_size(atom);
+    }
+
+    for (i = 0; (i < tree->root.child_count) && (status == M4A_OK); i++) {
+        status = write_atom(tree,
+                            tree->root.children[i],
+                            shifted ? &shifts : NULL,
+                            write,
+                            output);
+    }
+
+    free(shifts.shifts);
+    return status;
+}
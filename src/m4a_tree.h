@@ -0,0 +1,196 @@
+#ifndef M4A_TREE_H
+#define M4A_TREE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+/*This is a lazily-parsed tree of the atoms in an M4A file.
+
+  Only atom headers are read when the tree is opened.
+  A container atom's children are parsed the first time they're needed
+  and a leaf atom's payload stays on disk until it's read or replaced,
+  so large atoms such as "mdat" are never held in memory.
+
+  When the tree is written back out, every "stco" and "co64" atom's
+  chunk offsets are adjusted to follow the atoms they point into.*/
+
+typedef enum {
+    M4A_OK,
+    M4A_IO_ERROR,
+    M4A_INVALID_ATOM,
+    M4A_NOT_CONTAINER,
+    M4A_OFFSET_OVERFLOW,
+    M4A_WRITE_ERROR
+} m4a_status;
+
+/*returns a constant string describing the given status*/
+const char*
+m4a_strerror(m4a_status status);
+
+struct m4a_atom {
+    uint8_t name[4];
+    struct m4a_atom *parent;
+
+    /*nonzero if the atom's contents are unchanged from the file*/
+    int in_source;
+
+    /*the position of the atom's header in the file,
+      the size of that header (8 or 16 bytes)
+      and the atom's total size including its header*/
+    uint64_t source_offset;
+    unsigned source_header_size;
+    uint64_t source_size;
+
+    /*nonzero if the atom's payload is made of other atoms*/
+    int is_container;
+
+    /*for containers, the payload bytes preceding the first child,
+      such as the version and flags of a "meta" atom,
+      and any bytes following the last child too short to be an atom*/
+    unsigned prefix_size;
+    uint8_t prefix[4];
+    unsigned trailer_size;
+    uint8_t trailer[8];
+
+    int children_parsed;
+    unsigned child_count;
+    unsigned child_capacity;
+    struct m4a_atom **children;
+
+    /*a leaf's payload held in memory
+      which is NULL if the payload is still in the file*/
+    uint8_t *data;
+    uint64_t data_size;
+};
+
+struct m4a_tree {
+    FILE *file;
+    uint64_t file_size;
+
+    /*a container holding the file's top-level atoms
+      which has no header of its own*/
+    struct m4a_atom root;
+
+    /*atoms no longer in the tree, kept until the tree is freed
+      since callers may still be holding them*/
+    unsigned detached_count;
+    unsigned detached_capacity;
+    struct m4a_atom **detached;
+};
+
+/*given an M4A file opened for reading,
+  places a new tree in "tree" and returns M4A_OK,
+  or returns an error if the file's top-level atoms are invalid
+
+  the tree takes ownership of the file, which is closed by m4a_tree_free()*/
+m4a_status
+m4a_tree_open(FILE *file, struct m4a_tree **tree);
+
+void
+m4a_tree_free(struct m4a_tree *tree);
+
+/*ensures the given atom's children have been parsed
+  and returns M4A_OK or some error
+
+  returns M4A_NOT_CONTAINER if the atom is a leaf*/
+m4a_status
+m4a_atom_parse_children(struct m4a_tree *tree, struct m4a_atom *atom);
+
+/*given a list of "count" 4 byte atom names,
+  places the first atom found at the end of that path in "found"
+  or NULL if there's no such atom and returns M4A_OK,
+  or returns some error if a parent atom is invalid*/
+m4a_status
+m4a_atom_find(struct m4a_tree *tree,
+              struct m4a_atom *atom,
+              unsigned count,
+              const uint8_t names[][4],
+              struct m4a_atom **found);
+
+/*returns the atom's current total size including its header*/
+uint64_t
+m4a_atom_size(const struct m4a_atom *atom);
+
+/*places a newly allocated copy of the atom's payload,
+  not including its header, in "data" and its size in "size"
+  and returns M4A_OK or some error*/
+m4a_status
+m4a_atom_data(struct m4a_tree *tree,
+              struct m4a_atom *atom,
+              uint8_t **data,
+              uint64_t *size);
+
+/*replaces the atom's payload with a copy of the given data,
+  turning a container into a leaf,
+  and marks it and its parents as modified*/
+void
+m4a_atom_set_data(struct m4a_tree *tree,
+                  struct m4a_atom *atom,
+                  const uint8_t *data,
+                  uint64_t size);
+
+/*appends a new atom to the given container
+  which is a leaf with a copy of the given data,
+  or an empty container if data is NULL,
+  places it in "child" and returns M4A_OK or some error*/
+m4a_status
+m4a_atom_add_child(struct m4a_tree *tree,
+                   struct m4a_atom *parent,
+                   const uint8_t name[4],
+                   const uint8_t *data,
+                   uint64_t size,
+                   struct m4a_atom **child);
+
+/*removes the given child from its parent's list of children
+  and returns M4A_OK or some error
+
+  the child remains valid until the tree is freed*/
+m4a_status
+m4a_atom_remove_child(struct m4a_tree *tree,
+                      struct m4a_atom *parent,
+                      struct m4a_atom *child);
+
+/*a function which outputs "size" bytes of data
+  and returns 0 on success or nonzero if an error occurs*/
+typedef int (*m4a_write_f)(void *output, const uint8_t *data, unsigned size);
+
+/*writes the complete atom, including its header, to "output"
+  and returns M4A_OK or some error
+
+  chunk offsets are written unchanged*/
+m4a_status
+m4a_atom_build(struct m4a_tree *tree,
+               struct m4a_atom *atom,
+               m4a_write_f write,
+               void *output);
+
+/*writes every top-level atom to "output", forming a complete file,
+  and returns M4A_OK or some error
+
+  chunk offsets in "stco" and "co64" atoms which point into
+  unmodified top-level atoms are shifted by however far those atoms
+  have moved, and M4A_OFFSET_OVERFLOW is returned
+  if an "stco" offset would no longer fit in 32 bits*/
+m4a_status
+m4a_tree_build(struct m4a_tree *tree, m4a_write_f write, void *output);
+
+#endif
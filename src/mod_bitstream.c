@@ -4,6 +4,9 @@
 #include "huffman.h"
 #include "buffer.h"
 #include "mod_bitstream.h"
+#include "ogg_crc.h"
+#include "common/flac_crc.h"
+#include "common/tta_crc.h"
 
 /********************************************************
  Audio Tools, a module and set of tools for manipulating audio data
@@ -63,6 +66,10 @@ MOD_INIT(bitstream)
     if (PyType_Ready(&bitstream_BitstreamWriterPositionType) < 0)
         return MOD_ERROR_VAL;
 
+    bitstream_FormatType.tp_new = PyType_GenericNew;
+    if (PyType_Ready(&bitstream_FormatType) < 0)
+        return MOD_ERROR_VAL;
+
     Py_INCREF(&bitstream_BitstreamReaderType);
     PyModule_AddObject(m, "BitstreamReader",
                        (PyObject *)&bitstream_BitstreamReaderType);
@@ -87,6 +94,10 @@ MOD_INIT(bitstream)
     PyModule_AddObject(m, "BitstreamWriterPosition",
                        (PyObject *)&bitstream_BitstreamWriterPositionType);
 
+    Py_INCREF(&bitstream_FormatType);
+    PyModule_AddObject(m, "Format",
+                       (PyObject *)&bitstream_FormatType);
+
     return MOD_SUCCESS_VAL(m);
 }
 
@@ -973,6 +984,30 @@ BitstreamReader_add_callback(bitstream_BitstreamReader *self, PyObject *args)
     return Py_None;
 }
 
+static PyObject*
+BitstreamReader_add_span_callback(bitstream_BitstreamReader *self,
+                                  PyObject *args)
+{
+    PyObject* callback;
+
+    if (!PyArg_ParseTuple(args, "O", &callback))
+        return NULL;
+
+    if (!PyCallable_Check(callback)) {
+        PyErr_SetString(PyExc_TypeError, "callback must be callable");
+        return NULL;
+    }
+
+    Py_INCREF(callback);
+    self->bitstream->add_span_callback(
+        self->bitstream,
+        (bs_span_callback_f)bitstream_span_callback,
+        callback);
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
 static PyObject*
 BitstreamReader_pop_callback(bitstream_BitstreamReader *self, PyObject *args)
 {
@@ -1055,9 +1090,12 @@ BitstreamReader_substream(bitstream_BitstreamReader *self, PyObject *args)
 static PyObject*
 BitstreamReader_parse(bitstream_BitstreamReader *self, PyObject *args)
 {
-    char* format;
+    PyObject *format_obj;
+    bitstream_Format *format;
 
-    if (!PyArg_ParseTuple(args, "s", &format)) {
+    if (!PyArg_ParseTuple(args, "O", &format_obj)) {
+        return NULL;
+    } else if ((format = bitstream_get_format(format_obj)) == NULL) {
         return NULL;
     } else {
         PyObject *values = PyList_New(0);
@@ -1065,8 +1103,10 @@ BitstreamReader_parse(bitstream_BitstreamReader *self, PyObject *args)
         if (!bitstream_parse(self->bitstream,
                              format,
                              values)) {
+            Py_DECREF((PyObject*)format);
             return values;
         } else {
+            Py_DECREF((PyObject*)format);
             Py_DECREF(values);
             return NULL;
         }
@@ -1879,21 +1919,27 @@ BitstreamWriter_write_bytes(bitstream_BitstreamWriter *self,
 static PyObject*
 BitstreamWriter_build(bitstream_BitstreamWriter *self, PyObject *args)
 {
-    char* format;
+    PyObject *format_obj;
+    bitstream_Format *format;
     PyObject *values;
     PyObject *iterator;
+    int result;
 
-    if (!PyArg_ParseTuple(args, "sO", &format, &values)) {
+    if (!PyArg_ParseTuple(args, "OO", &format_obj, &values)) {
+        return NULL;
+    } else if ((format = bitstream_get_format(format_obj)) == NULL) {
         return NULL;
     } else if ((iterator = PyObject_GetIter(values)) == NULL) {
+        Py_DECREF((PyObject*)format);
         return NULL;
-    } else if (bitstream_build(self->bitstream,
-                               format,
-                               iterator)) {
-        Py_DECREF(iterator);
+    }
+
+    result = bitstream_build(self->bitstream, format, iterator);
+    Py_DECREF(iterator);
+    Py_DECREF((PyObject*)format);
+    if (result) {
         return NULL;
     } else {
-        Py_DECREF(iterator);
         Py_INCREF(Py_None);
         return Py_None;
     }
@@ -1963,6 +2009,30 @@ BitstreamWriter_add_callback(bitstream_BitstreamWriter *self,
     return Py_None;
 }
 
+static PyObject*
+BitstreamWriter_add_span_callback(bitstream_BitstreamWriter *self,
+                                  PyObject *args)
+{
+    PyObject* callback;
+
+    if (!PyArg_ParseTuple(args, "O", &callback))
+        return NULL;
+
+    if (!PyCallable_Check(callback)) {
+        PyErr_SetString(PyExc_TypeError, "callback must be callable");
+        return NULL;
+    }
+
+    Py_INCREF(callback);
+    self->bitstream->add_span_callback(
+        self->bitstream,
+        (bs_span_callback_f)bitstream_span_callback,
+        callback);
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
 static PyObject*
 BitstreamWriter_pop_callback(bitstream_BitstreamWriter *self,
                              PyObject *args)
@@ -2261,21 +2331,27 @@ static PyObject*
 BitstreamRecorder_build(bitstream_BitstreamRecorder *self,
                         PyObject *args)
 {
-    char* format;
+    PyObject *format_obj;
+    bitstream_Format *format;
     PyObject *values;
     PyObject *iterator;
+    int result;
 
-    if (!PyArg_ParseTuple(args, "sO", &format, &values)) {
+    if (!PyArg_ParseTuple(args, "OO", &format_obj, &values)) {
+        return NULL;
+    } else if ((format = bitstream_get_format(format_obj)) == NULL) {
         return NULL;
     } else if ((iterator = PyObject_GetIter(values)) == NULL) {
+        Py_DECREF((PyObject*)format);
         return NULL;
-    } else if (bitstream_build((BitstreamWriter*)self->bitstream,
-                               format,
-                               iterator)) {
-        Py_DECREF(iterator);
+    }
+
+    result = bitstream_build((BitstreamWriter*)self->bitstream, format, iterator);
+    Py_DECREF(iterator);
+    Py_DECREF((PyObject*)format);
+    if (result) {
         return NULL;
     } else {
-        Py_DECREF(iterator);
         Py_INCREF(Py_None);
         return Py_None;
     }
@@ -2442,6 +2518,30 @@ BitstreamRecorder_add_callback(bitstream_BitstreamRecorder *self,
     return Py_None;
 }
 
+static PyObject*
+BitstreamRecorder_add_span_callback(bitstream_BitstreamRecorder *self,
+                                    PyObject *args)
+{
+    BitstreamWriter *writer = (BitstreamWriter*)self->bitstream;
+    PyObject* callback;
+
+    if (!PyArg_ParseTuple(args, "O", &callback))
+        return NULL;
+
+    if (!PyCallable_Check(callback)) {
+        PyErr_SetString(PyExc_TypeError, "callback must be callable");
+        return NULL;
+    }
+
+    Py_INCREF(callback);
+    writer->add_span_callback(writer,
+                              (bs_span_callback_f)bitstream_span_callback,
+                              callback);
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
 static PyObject*
 BitstreamRecorder_pop_callback(bitstream_BitstreamRecorder *self,
                                PyObject *args)
@@ -2603,6 +2703,30 @@ BitstreamWriter_callback(uint8_t byte, PyObject *callback)
     }
 }
 
+void
+bitstream_span_callback(const uint8_t *bytes,
+                        unsigned count,
+                        PyObject *callback)
+{
+    PyObject* result;
+    PyObject* span = PyBytes_FromStringAndSize((const char*)bytes,
+                                               (Py_ssize_t)count);
+
+    if (span == NULL) {
+        PyErr_PrintEx(0);
+        return;
+    }
+
+    result = PyObject_CallFunctionObjArgs(callback, span, NULL);
+    Py_DECREF(span);
+
+    if (result != NULL) {
+        Py_DECREF(result);
+    } else {
+        PyErr_PrintEx(0);
+    }
+}
+
 static PyObject*
 BitstreamWriterPosition_new(PyTypeObject *type, PyObject *args,
                             PyObject *kwds)
@@ -2662,7 +2786,8 @@ BitstreamWriterPosition_dealloc(bitstream_BitstreamWriterPosition *self)
 PyObject*
 bitstream_parse_func(PyObject *dummy, PyObject *args)
 {
-    char *format;
+    PyObject *format_obj;
+    bitstream_Format *format;
     int is_little_endian;
     char *data;
 #ifdef PY_SSIZE_T_CLEAN
@@ -2671,8 +2796,13 @@ bitstream_parse_func(PyObject *dummy, PyObject *args)
     int data_length;
 #endif
 
-    if (!PyArg_ParseTuple(args, "sis#",
-                          &format, &is_little_endian, &data, &data_length)) {
+    if (!PyArg_ParseTuple(args, "Ois#",
+                          &format_obj,
+                          &is_little_endian,
+                          &data,
+                          &data_length)) {
+        return NULL;
+    } else if ((format = bitstream_get_format(format_obj)) == NULL) {
         return NULL;
     } else {
         BitstreamReader* stream =
@@ -2681,11 +2811,12 @@ bitstream_parse_func(PyObject *dummy, PyObject *args)
                 (unsigned)data_length,
                 is_little_endian ? BS_LITTLE_ENDIAN : BS_BIG_ENDIAN);
         PyObject* values = PyList_New(0);
-        if (!bitstream_parse(stream, format, values)) {
-            stream->close(stream);
+        const int result = bitstream_parse(stream, format, values);
+        stream->close(stream);
+        Py_DECREF((PyObject*)format);
+        if (!result) {
             return values;
         } else {
-            stream->close(stream);
             Py_DECREF(values);
             return NULL;
         }
@@ -2695,47 +2826,367 @@ bitstream_parse_func(PyObject *dummy, PyObject *args)
 PyObject*
 bitstream_build_func(PyObject *dummy, PyObject *args)
 {
-    char *format;
+    PyObject *format_obj;
+    bitstream_Format *format;
     int is_little_endian;
     PyObject *values;
     PyObject *iterator;
 
-    if (!PyArg_ParseTuple(args, "siO", &format, &is_little_endian, &values)) {
+    if (!PyArg_ParseTuple(args, "OiO",
+                          &format_obj, &is_little_endian, &values)) {
+        return NULL;
+    } else if ((format = bitstream_get_format(format_obj)) == NULL) {
         return NULL;
     } else if ((iterator = PyObject_GetIter(values)) == NULL) {
+        Py_DECREF((PyObject*)format);
         return NULL;
     } else {
         BitstreamRecorder* stream =
             bw_open_bytes_recorder(
                 is_little_endian ? BS_LITTLE_ENDIAN : BS_BIG_ENDIAN);
-        if (!bitstream_build((BitstreamWriter*)stream,
-                             format,
-                             iterator)) {
+        const int result = bitstream_build((BitstreamWriter*)stream,
+                                           format,
+                                           iterator);
+        Py_DECREF(iterator);
+        Py_DECREF((PyObject*)format);
+        if (!result) {
             PyObject* data = recorder_to_bytes(stream);
             stream->close(stream);
-            Py_DECREF(iterator);
             return data;
         } else {
             stream->close(stream);
-            Py_DECREF(iterator);
             return NULL;
         }
     }
 }
 
+PyObject*
+bitstream_checksum_func(PyObject *dummy, PyObject *args)
+{
+    const char *algorithm;
+    Py_buffer buffer;
+    unsigned long initial = 0;
+    int span = 1;
+    const uint8_t *data;
+    unsigned size;
+    unsigned long checksum;
+    unsigned i;
+
+    if (!PyArg_ParseTuple(args, "ss*|ki",
+                          &algorithm, &buffer, &initial, &span))
+        return NULL;
+
+    data = buffer.buf;
+    size = (unsigned)buffer.len;
+
+    /*span checksums take the whole run of bytes at once
+      while the others are fed one byte at a time
+      as from a per-byte callback*/
+    if (!strcmp(algorithm, "flac_crc8")) {
+        uint8_t crc = (uint8_t)initial;
+        if (span) {
+            flac_crc8_span(data, size, &crc);
+        } else {
+            for (i = 0; i < size; i++)
+                flac_crc8(data[i], &crc);
+        }
+        checksum = crc;
+    } else if (!strcmp(algorithm, "flac_crc16")) {
+        uint16_t crc = (uint16_t)initial;
+        if (span) {
+            flac_crc16_span(data, size, &crc);
+        } else {
+            for (i = 0; i < size; i++)
+                flac_crc16(data[i], &crc);
+        }
+        checksum = crc;
+    } else if (!strcmp(algorithm, "tta_crc32")) {
+        uint32_t crc = (uint32_t)initial;
+        if (span) {
+            tta_crc32_span(data, size, &crc);
+        } else {
+            for (i = 0; i < size; i++)
+                tta_crc32(data[i], &crc);
+        }
+        checksum = crc;
+    } else if (!strcmp(algorithm, "ogg_crc")) {
+        uint32_t crc = (uint32_t)initial;
+        if (span) {
+            ogg_crc_span(data, size, &crc);
+        } else {
+            for (i = 0; i < size; i++)
+                ogg_crc(data[i], &crc);
+        }
+        checksum = crc;
+    } else {
+        PyBuffer_Release(&buffer);
+        PyErr_SetString(PyExc_ValueError, "unknown checksum algorithm");
+        return NULL;
+    }
+
+    PyBuffer_Release(&buffer);
+    return Py_BuildValue("k", checksum);
+}
+
+/*the format cache maps format strings to compiled Format objects
+  which are also linked from most to least recently used
+  so that a hit or an eviction takes constant time*/
+static PyObject *format_cache = NULL;
+static bitstream_Format *format_cache_newest = NULL;
+static bitstream_Format *format_cache_oldest = NULL;
+
+static int
+format_cache_linked(const bitstream_Format *format)
+{
+    return (format->newer != NULL) ||
+           (format->older != NULL) ||
+           (format_cache_newest == format);
+}
+
+static void
+format_cache_unlink(bitstream_Format *format)
+{
+    if (format->newer != NULL) {
+        format->newer->older = format->older;
+    } else {
+        format_cache_newest = format->older;
+    }
+    if (format->older != NULL) {
+        format->older->newer = format->newer;
+    } else {
+        format_cache_oldest = format->newer;
+    }
+    format->newer = NULL;
+    format->older = NULL;
+}
+
+static void
+format_cache_push(bitstream_Format *format)
+{
+    format->newer = NULL;
+    format->older = format_cache_newest;
+    if (format_cache_newest != NULL) {
+        format_cache_newest->newer = format;
+    } else {
+        format_cache_oldest = format;
+    }
+    format_cache_newest = format;
+}
+
+static PyObject*
+Format_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    bitstream_Format *self;
+
+    self = (bitstream_Format *)type->tp_alloc(type, 0);
+
+    return (PyObject *)self;
+}
+
 int
-bitstream_parse(BitstreamReader* stream,
-                const char* format,
-                PyObject* values)
+Format_init(bitstream_Format *self, PyObject *args)
 {
+    PyObject *format_string;
+    const char *format;
+    const char *remaining;
     bs_instruction_t inst;
+    unsigned i;
+
+    if (!PyArg_ParseTuple(args, "O", &format_string))
+        return -1;
+    if (!PyArg_Parse(format_string, "s", &format))
+        return -1;
 
+    /*release any format from a previous __init__ call*/
+    Py_XDECREF(self->format_string);
+    free(self->ops);
+    self->ops = NULL;
+
+    Py_INCREF(format_string);
+    self->format_string = format_string;
+
+    /*count the format's instructions*/
+    self->op_count = 0;
+    remaining = format;
     do {
         unsigned times;
         unsigned size;
 
-        format = bs_parse_format(format, &times, &size, &inst);
-        switch (inst) {
+        remaining = bs_parse_format(remaining, &times, &size, &inst);
+        if (inst != BS_INST_EOF) {
+            self->op_count++;
+        }
+    } while (inst != BS_INST_EOF);
+
+    /*then tokenize them into the instruction array*/
+    self->ops = malloc(sizeof(struct bs_format_op) *
+                       (self->op_count ? self->op_count : 1));
+    if (self->ops == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    remaining = format;
+    for (i = 0; i < self->op_count; i++) {
+        remaining = bs_parse_format(remaining,
+                                    &(self->ops[i].times),
+                                    &(self->ops[i].size),
+                                    &(self->ops[i].inst));
+    }
+
+    self->size = bs_format_size(format);
+
+    return 0;
+}
+
+void
+Format_dealloc(bitstream_Format *self)
+{
+    if (format_cache_linked(self)) {
+        format_cache_unlink(self);
+    }
+    Py_XDECREF(self->format_string);
+    free(self->ops);
+
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static PyObject*
+Format_repr(bitstream_Format *self)
+{
+    if (self->format_string != NULL) {
+        return PyUnicode_FromFormat("Format(%R)", self->format_string);
+    } else {
+        return PyUnicode_FromString("Format()");
+    }
+}
+
+static PyObject*
+Format_parse(bitstream_Format *self, PyObject *args)
+{
+    bitstream_BitstreamReader *reader;
+    PyObject *values;
+
+    if (!PyArg_ParseTuple(args, "O!",
+                          &bitstream_BitstreamReaderType, &reader))
+        return NULL;
+
+    values = PyList_New(0);
+    if (!bitstream_parse(reader->bitstream, self, values)) {
+        return values;
+    } else {
+        Py_DECREF(values);
+        return NULL;
+    }
+}
+
+static PyObject*
+Format_build(bitstream_Format *self, PyObject *args)
+{
+    PyObject *writer_obj;
+    BitstreamWriter *writer;
+    PyObject *values;
+    PyObject *iterator;
+    int result;
+
+    if (!PyArg_ParseTuple(args, "OO", &writer_obj, &values))
+        return NULL;
+
+    if ((writer = internal_writer(writer_obj)) == NULL) {
+        PyErr_SetString(PyExc_TypeError,
+                        "writer must be a BitstreamWriter or Recorder");
+        return NULL;
+    }
+
+    if ((iterator = PyObject_GetIter(values)) == NULL)
+        return NULL;
+
+    result = bitstream_build(writer, self, iterator);
+    Py_DECREF(iterator);
+    if (result) {
+        return NULL;
+    } else {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+}
+
+static PyObject*
+Format_size(bitstream_Format *self, PyObject *args)
+{
+    return Py_BuildValue("I", self->size);
+}
+
+static PyObject*
+Format_byte_size(bitstream_Format *self, PyObject *args)
+{
+    return Py_BuildValue("I", self->size / 8);
+}
+
+static bitstream_Format*
+bitstream_get_format(PyObject *format)
+{
+    bitstream_Format *compiled;
+
+    if (PyObject_TypeCheck(format, &bitstream_FormatType)) {
+        Py_INCREF(format);
+        return (bitstream_Format*)format;
+    }
+
+    if ((format_cache == NULL) &&
+        ((format_cache = PyDict_New()) == NULL)) {
+        return NULL;
+    }
+
+    /*use a previously compiled Format, if any*/
+    if ((compiled =
+         (bitstream_Format*)PyDict_GetItem(format_cache, format)) != NULL) {
+        if (format_cache_newest != compiled) {
+            format_cache_unlink(compiled);
+            format_cache_push(compiled);
+        }
+        Py_INCREF((PyObject*)compiled);
+        return compiled;
+    }
+
+    /*otherwise, compile a new Format*/
+    if ((compiled = (bitstream_Format*)PyObject_CallFunctionObjArgs(
+            (PyObject*)&bitstream_FormatType, format, NULL)) == NULL) {
+        return NULL;
+    }
+
+    /*and make room for it in the cache
+      by removing the least recently used entry*/
+    if ((PyDict_Size(format_cache) >= FORMAT_CACHE_SIZE) &&
+        (format_cache_oldest != NULL)) {
+        bitstream_Format *oldest = format_cache_oldest;
+        format_cache_unlink(oldest);
+        if (PyDict_DelItem(format_cache, oldest->format_string) == -1) {
+            PyErr_Clear();
+        }
+    }
+
+    if (PyDict_SetItem(format_cache, format, (PyObject*)compiled) == 0) {
+        format_cache_push(compiled);
+    } else {
+        /*an unhashable format string is usable, just not cacheable*/
+        PyErr_Clear();
+    }
+
+    return compiled;
+}
+
+int
+bitstream_parse(BitstreamReader* stream,
+                const bitstream_Format* format,
+                PyObject* values)
+{
+    unsigned i;
+
+    for (i = 0; i < format->op_count; i++) {
+        unsigned times = format->ops[i].times;
+        const unsigned size = format->ops[i].size;
+
+        switch (format->ops[i].inst) {
         case BS_INST_UNSIGNED:
         case BS_INST_UNSIGNED64:
         case BS_INST_UNSIGNED_BIGINT:
@@ -2824,7 +3275,7 @@ bitstream_parse(BitstreamReader* stream,
         case BS_INST_EOF:
             break;
         }
-    } while (inst != BS_INST_EOF);
+    }
 
     return 0;
 }
@@ -2833,17 +3284,16 @@ bitstream_parse(BitstreamReader* stream,
 
 int
 bitstream_build(BitstreamWriter* stream,
-                const char* format,
+                const bitstream_Format* format,
                 PyObject* iterator)
 {
-    bs_instruction_t inst;
+    unsigned i;
 
-    do {
-        unsigned times;
-        unsigned size;
+    for (i = 0; i < format->op_count; i++) {
+        unsigned times = format->ops[i].times;
+        const unsigned size = format->ops[i].size;
 
-        format = bs_parse_format(format, &times, &size, &inst);
-        switch (inst) {
+        switch (format->ops[i].inst) {
         case BS_INST_UNSIGNED:
         case BS_INST_UNSIGNED64:
         case BS_INST_UNSIGNED_BIGINT:
@@ -3007,7 +3457,7 @@ bitstream_build(BitstreamWriter* stream,
         case BS_INST_EOF:
             break;
         }
-    } while (inst != BS_INST_EOF);
+    }
 
     return 0;
 }
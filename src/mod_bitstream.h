@@ -39,6 +39,15 @@ bitstream_parse_func(PyObject *dummy, PyObject *args);
 PyObject*
 bitstream_build_func(PyObject *dummy, PyObject *args);
 
+PyObject*
+bitstream_checksum_func(PyObject *dummy, PyObject *args);
+
+/*calls a Python callback with each span of bytes as a string*/
+void
+bitstream_span_callback(const uint8_t *bytes,
+                        unsigned count,
+                        PyObject *callback);
+
 PyMethodDef module_methods[] = {
     {"format_size", (PyCFunction)bitstream_format_size,
      METH_VARARGS, "Calculate size of format string in bits"}, /*FIXME*/
@@ -48,9 +57,131 @@ PyMethodDef module_methods[] = {
      METH_VARARGS, "parse(format, is_little_endian, data) -> [values]"},
     {"build", (PyCFunction)bitstream_build_func,
      METH_VARARGS, "build(format, is_little_endian, [values]) -> data"},
+    {"checksum", (PyCFunction)bitstream_checksum_func,
+     METH_VARARGS,
+     "checksum(algorithm, data[, initial[, span]]) -> int\n"
+     "where algorithm is \"flac_crc8\", \"flac_crc16\", "
+     "\"tta_crc32\" or \"ogg_crc\""},
+    {NULL}
+};
+
+/*a single instruction from a compiled format string*/
+struct bs_format_op {
+    bs_instruction_t inst;
+    unsigned times;
+    unsigned size;
+};
+
+/*the Format object
+  a format string compiled once to an array of instructions
+  which may then be used for any number of parse or build calls*/
+
+typedef struct bitstream_Format_s {
+    PyObject_HEAD
+
+    PyObject *format_string;
+    unsigned op_count;
+    struct bs_format_op *ops;
+
+    /*the format's total size in bits*/
+    unsigned size;
+
+    /*neighbors on the format cache's recently used list
+      or NULL if not adjacent to another cached Format*/
+    struct bitstream_Format_s *newer;
+    struct bitstream_Format_s *older;
+} bitstream_Format;
+
+static PyObject*
+Format_new(PyTypeObject *type, PyObject *args, PyObject *kwds);
+
+int
+Format_init(bitstream_Format *self, PyObject *args);
+
+void
+Format_dealloc(bitstream_Format *self);
+
+static PyObject*
+Format_repr(bitstream_Format *self);
+
+static PyObject*
+Format_parse(bitstream_Format *self, PyObject *args);
+
+static PyObject*
+Format_build(bitstream_Format *self, PyObject *args);
+
+static PyObject*
+Format_size(bitstream_Format *self, PyObject *args);
+
+static PyObject*
+Format_byte_size(bitstream_Format *self, PyObject *args);
+
+PyMethodDef Format_methods[] = {
+    {"parse", (PyCFunction)Format_parse, METH_VARARGS,
+     "parse(reader) -> [value1, value2, ...]\n"
+     "parses the format from the given BitstreamReader"},
+    {"build", (PyCFunction)Format_build, METH_VARARGS,
+     "build(writer, [value1, value2, ...])\n"
+     "builds the format to the given BitstreamWriter or Recorder"},
+    {"size", (PyCFunction)Format_size, METH_NOARGS,
+     "size() -> size of format in bits"},
+    {"byte_size", (PyCFunction)Format_byte_size, METH_NOARGS,
+     "byte_size() -> size of format in bytes"},
     {NULL}
 };
 
+PyTypeObject bitstream_FormatType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "bitstream.Format",        /*tp_name*/
+    sizeof(bitstream_Format),  /*tp_basicsize*/
+    0,                         /*tp_itemsize*/
+    (destructor)Format_dealloc, /*tp_dealloc*/
+    0,                         /*tp_print*/
+    0,                         /*tp_getattr*/
+    0,                         /*tp_setattr*/
+    0,                         /*tp_compare*/
+    (reprfunc)Format_repr,     /*tp_repr*/
+    0,                         /*tp_as_number*/
+    0,                         /*tp_as_sequence*/
+    0,                         /*tp_as_mapping*/
+    0,                         /*tp_hash */
+    0,                         /*tp_call*/
+    0,                         /*tp_str*/
+    0,                         /*tp_getattro*/
+    0,                         /*tp_setattro*/
+    0,                         /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT,        /*tp_flags*/
+    "Format(format_string)",   /* tp_doc */
+    0,                         /* tp_traverse */
+    0,                         /* tp_clear */
+    0,                         /* tp_richcompare */
+    0,                         /* tp_weaklistoffset */
+    0,                         /* tp_iter */
+    0,                         /* tp_iternext */
+    Format_methods,            /* tp_methods */
+    0,                         /* tp_members */
+    0,                         /* tp_getset */
+    0,                         /* tp_base */
+    0,                         /* tp_dict */
+    0,                         /* tp_descr_get */
+    0,                         /* tp_descr_set */
+    0,                         /* tp_dictoffset */
+    (initproc)Format_init,     /* tp_init */
+    0,                         /* tp_alloc */
+    Format_new,                /* tp_new */
+};
+
+/*the maximum number of compiled format strings
+  retained by the format cache*/
+#define FORMAT_CACHE_SIZE 256
+
+/*given a Format object or format string,
+  returns a new reference to a compiled Format object
+  which is fetched from the format cache if possible,
+  or returns NULL with PyErr set if an error occurs*/
+static bitstream_Format*
+bitstream_get_format(PyObject *format);
+
 /*the BitstreamReader object
   a simple wrapper around our Bitstream reading struct*/
 
@@ -155,6 +286,10 @@ BitstreamReader_seek(bitstream_BitstreamReader *self, PyObject *args);
 static PyObject*
 BitstreamReader_add_callback(bitstream_BitstreamReader *self, PyObject *args);
 
+static PyObject*
+BitstreamReader_add_span_callback(bitstream_BitstreamReader *self,
+                                  PyObject *args);
+
 static PyObject*
 BitstreamReader_pop_callback(bitstream_BitstreamReader *self, PyObject *args);
 
@@ -222,7 +357,8 @@ PyMethodDef BitstreamReader_methods[] = {
      "\"#b\" -> read_bytes(#)\n"
      "\"a\"  -> byte_align()\n\n"
      "for instance:\n"
-     "r.parse(\"3u 4s 36u\") == [r.read(3), r.read_signed(4), r.read(36)]"},
+     "r.parse(\"3u 4s 36u\") == [r.read(3), r.read_signed(4), r.read(36)]\n"
+     "\"format_string\" may also be a compiled Format object"},
     {"close", (PyCFunction)BitstreamReader_close, METH_NOARGS,
      "close()\n"
      "closes the stream and any underlying file object"},
@@ -240,6 +376,11 @@ PyMethodDef BitstreamReader_methods[] = {
      "add_callback(function)\n"
      "where \"function\" takes a single byte as an argument\n"
      "and is called upon each read byte from the stream"},
+    {"add_span_callback", (PyCFunction)BitstreamReader_add_span_callback,
+     METH_VARARGS,
+     "add_span_callback(function)\n"
+     "where \"function\" takes a string of bytes as an argument\n"
+     "and is called upon each run of bytes read from the stream"},
     {"pop_callback", (PyCFunction)BitstreamReader_pop_callback, METH_NOARGS,
      "pop_callback() -> function\n"
      "removes and returns the most recently added callback"},
@@ -431,23 +572,37 @@ PyTypeObject bitstream_BitstreamReaderPositionType = {
 PyObject*
 bitstream_format_size(PyObject *dummy, PyObject *args)
 {
-    char* format_string;
+    PyObject *format_obj;
+    bitstream_Format *format;
+    PyObject *size;
+
+    if (!PyArg_ParseTuple(args, "O", &format_obj))
+        return NULL;
 
-    if (!PyArg_ParseTuple(args, "s", &format_string))
+    if ((format = bitstream_get_format(format_obj)) == NULL)
         return NULL;
 
-    return Py_BuildValue("I", bs_format_size(format_string));
+    size = Py_BuildValue("I", format->size);
+    Py_DECREF((PyObject*)format);
+    return size;
 }
 
 PyObject*
 bitstream_format_byte_size(PyObject *dummy, PyObject *args)
 {
-    char* format_string;
+    PyObject *format_obj;
+    bitstream_Format *format;
+    PyObject *size;
+
+    if (!PyArg_ParseTuple(args, "O", &format_obj))
+        return NULL;
 
-    if (!PyArg_ParseTuple(args, "s", &format_string))
+    if ((format = bitstream_get_format(format_obj)) == NULL)
         return NULL;
 
-    return Py_BuildValue("I", bs_format_byte_size(format_string));
+    size = Py_BuildValue("I", format->size / 8);
+    Py_DECREF((PyObject*)format);
+    return size;
 }
 
 typedef struct {
@@ -514,6 +669,10 @@ static PyObject*
 BitstreamWriter_add_callback(bitstream_BitstreamWriter *self,
                              PyObject *args);
 
+static PyObject*
+BitstreamWriter_add_span_callback(bitstream_BitstreamWriter *self,
+                                  PyObject *args);
+
 static PyObject*
 BitstreamWriter_pop_callback(bitstream_BitstreamWriter *self,
                              PyObject *args);
@@ -596,6 +755,11 @@ PyMethodDef BitstreamWriter_methods[] = {
      "add_callback(function)\n"
      "where \"function\" takes a single byte as an argument\n"
      "and is called upon each written byte to the stream"},
+    {"add_span_callback", (PyCFunction)BitstreamWriter_add_span_callback,
+     METH_VARARGS,
+     "add_span_callback(function)\n"
+     "where \"function\" takes a string of bytes as an argument\n"
+     "and is called upon each run of bytes written to the stream"},
     {"pop_callback", (PyCFunction)BitstreamWriter_pop_callback, METH_NOARGS,
      "pop_callback() -> function\n"
      "removes and returns the most recently added callback"},
@@ -725,6 +889,10 @@ static PyObject*
 BitstreamRecorder_add_callback(bitstream_BitstreamRecorder *self,
                                PyObject *args);
 
+static PyObject*
+BitstreamRecorder_add_span_callback(bitstream_BitstreamRecorder *self,
+                                    PyObject *args);
+
 static PyObject*
 BitstreamRecorder_pop_callback(bitstream_BitstreamRecorder *self,
                                PyObject *args);
@@ -840,6 +1008,11 @@ PyMethodDef BitstreamRecorder_methods[] = {
      "add_callback(function)\n"
      "where \"function\" takes a single byte as an argument\n"
      "and is called upon each written byte to the stream"},
+    {"add_span_callback", (PyCFunction)BitstreamRecorder_add_span_callback,
+     METH_VARARGS,
+     "add_span_callback(function)\n"
+     "where \"function\" takes a string of bytes as an argument\n"
+     "and is called upon each run of bytes written to the stream"},
     {"pop_callback", (PyCFunction)BitstreamRecorder_pop_callback,
      METH_NOARGS,
      "pop_callback() -> function\n"
@@ -968,20 +1141,20 @@ PyTypeObject bitstream_BitstreamWriterPositionType = {
     BitstreamWriterPosition_new, /* tp_new */
 };
 
-/*given a BitstreamReader, format string and list object
+/*given a BitstreamReader, compiled Format and list object
   parses the format from the reader and appends Python values to the list
   returns 0 on success, 1 on failure (with PyErr set)*/
 int
 bitstream_parse(BitstreamReader* stream,
-                const char* format,
+                const bitstream_Format* format,
                 PyObject* values);
 
-/*given a BitstreamWriter, format string and PySequence of Python values,
+/*given a BitstreamWriter, compiled Format and iterator of Python values,
   writes those values to the writer
   returns 0 on success, 1 on failure (with PyErr set)*/
 int
 bitstream_build(BitstreamWriter* stream,
-                const char* format,
+                const bitstream_Format* format,
                 PyObject* iterator);
 
 void
@@ -0,0 +1,410 @@
+#include <stdlib.h>
+#include <string.h>
+#include "mod_m4a.h"
+#include "mod_defs.h"
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+MOD_INIT(_m4a)
+{
+    PyObject* m;
+
+    MOD_DEF(m, "_m4a", "a lazy M4A atom tree module", module_methods)
+
+    if (PyType_Ready(&m4a_AtomType) < 0)
+        return MOD_ERROR_VAL;
+
+    Py_INCREF(&m4a_AtomType);
+    PyModule_AddObject(m, "Atom",
+                       (PyObject *)&m4a_AtomType);
+
+    return MOD_SUCCESS_VAL(m);
+}
+
+/*sets a Python exception matching the given status and returns NULL*/
+static PyObject*
+m4a_error(m4a_status status)
+{
+    switch (status) {
+    case M4A_NOT_CONTAINER:
+        PyErr_SetString(PyExc_TypeError, m4a_strerror(status));
+        break;
+    case M4A_OFFSET_OVERFLOW:
+        PyErr_SetString(PyExc_ValueError, m4a_strerror(status));
+        break;
+    case M4A_WRITE_ERROR:
+        /*the output's exception is already set*/
+        if (!PyErr_Occurred())
+            PyErr_SetString(PyExc_IOError, m4a_strerror(status));
+        break;
+    default:
+        PyErr_SetString(PyExc_IOError, m4a_strerror(status));
+        break;
+    }
+    return NULL;
+}
+
+/*returns a new Atom object pointing into the given tree*/
+static PyObject*
+new_atom(struct m4a_tree_ref *tree, struct m4a_atom *atom)
+{
+    m4a_Atom *obj = (m4a_Atom*)m4a_AtomType.tp_alloc(&m4a_AtomType, 0);
+
+    if (obj == NULL)
+        return NULL;
+    obj->tree = tree;
+    obj->atom = atom;
+    tree->references++;
+    return (PyObject*)obj;
+}
+
+/*given a bytes object, places a 4 byte atom name in "name"
+  and returns 0, or returns -1 with an exception set*/
+static int
+atom_name(PyObject *obj, uint8_t name[4])
+{
+    char *buffer;
+    Py_ssize_t length;
+
+    if (PyBytes_AsStringAndSize(obj, &buffer, &length) == -1) {
+        return -1;
+    } else if (length != 4) {
+        PyErr_SetString(PyExc_ValueError, "atom names must be 4 bytes");
+        return -1;
+    } else {
+        memcpy(name, buffer, 4);
+        return 0;
+    }
+}
+
+static PyObject*
+m4a_parse_file(PyObject *dummy, PyObject *args)
+{
+    char *filename;
+    FILE *file;
+    struct m4a_tree *tree;
+    struct m4a_tree_ref *ref;
+    m4a_status status;
+    PyObject *root;
+
+    if (!PyArg_ParseTuple(args, "s", &filename))
+        return NULL;
+
+    if ((file = fopen(filename, "rb")) == NULL) {
+        PyErr_SetFromErrnoWithFilename(PyExc_IOError, filename);
+        return NULL;
+    }
+
+    if ((status = m4a_tree_open(file, &tree)) != M4A_OK) {
+        fclose(file);
+        return m4a_error(status);
+    }
+
+    ref = malloc(sizeof(struct m4a_tree_ref));
+    ref->tree = tree;
+    ref->references = 0;
+
+    if ((root = new_atom(ref, &(tree->root))) == NULL) {
+        m4a_tree_free(tree);
+        free(ref);
+    }
+    return root;
+}
+
+static PyObject*
+Atom_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    PyErr_SetString(PyExc_TypeError,
+                    "Atom objects are returned by parse_file()");
+    return NULL;
+}
+
+void
+Atom_dealloc(m4a_Atom *self)
+{
+    if ((self->tree != NULL) && (--self->tree->references == 0)) {
+        m4a_tree_free(self->tree->tree);
+        free(self->tree);
+    }
+
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static PyObject*
+Atom_get_name(m4a_Atom *self, void *closure)
+{
+    if (self->atom == &(self->tree->tree->root)) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    } else {
+        return PyBytes_FromStringAndSize((char*)self->atom->name, 4);
+    }
+}
+
+static PyObject*
+Atom_get_offset(m4a_Atom *self, void *closure)
+{
+    if ((self->atom == &(self->tree->tree->root)) || !self->atom->in_source) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    } else {
+        return Py_BuildValue("K",
+                             (unsigned long long)self->atom->source_offset);
+    }
+}
+
+static PyObject*
+Atom_get_is_container(m4a_Atom *self, void *closure)
+{
+    return PyBool_FromLong(self->atom->is_container);
+}
+
+static PyObject*
+Atom_size(m4a_Atom *self, PyObject *args)
+{
+    if (self->atom == &(self->tree->tree->root)) {
+        /*the root has no header of its own*/
+        uint64_t size = 0;
+        unsigned i;
+
+        for (i = 0; i < self->atom->child_count; i++) {
+            size += m4a_atom_size(self->atom->children[i]);
+        }
+        return Py_BuildValue("K", (unsigned long long)size);
+    } else {
+        return Py_BuildValue("K",
+                             (unsigned long long)m4a_atom_size(self->atom));
+    }
+}
+
+static PyObject*
+Atom_children(m4a_Atom *self, PyObject *args)
+{
+    m4a_status status;
+    PyObject *children;
+    unsigned i;
+
+    if ((status = m4a_atom_parse_children(self->tree->tree,
+                                          self->atom)) != M4A_OK) {
+        return m4a_error(status);
+    }
+
+    if ((children = PyList_New(0)) == NULL)
+        return NULL;
+
+    for (i = 0; i < self->atom->child_count; i++) {
+        PyObject *child = new_atom(self->tree, self->atom->children[i]);
+        if (child == NULL) {
+            Py_DECREF(children);
+            return NULL;
+        } else if (PyList_Append(children, child) == -1) {
+            Py_DECREF(child);
+            Py_DECREF(children);
+            return NULL;
+        } else {
+            Py_DECREF(child);
+        }
+    }
+
+    return children;
+}
+
+static PyObject*
+Atom_find(m4a_Atom *self, PyObject *args)
+{
+    const Py_ssize_t count = PyTuple_Size(args);
+    uint8_t (*names)[4];
+    struct m4a_atom *found;
+    m4a_status status;
+    Py_ssize_t i;
+
+    names = malloc((count + 1) * sizeof(uint8_t[4]));
+    for (i = 0; i < count; i++) {
+        if (atom_name(PyTuple_GET_ITEM(args, i), names[i])) {
+            free(names);
+            return NULL;
+        }
+    }
+
+    status = m4a_atom_find(self->tree->tree,
+                           self->atom,
+                           (unsigned)count,
+                           (const uint8_t (*)[4])names,
+                           &found);
+    free(names);
+
+    if (status != M4A_OK) {
+        return m4a_error(status);
+    } else if (found == NULL) {
+        PyErr_SetObject(PyExc_KeyError, args);
+        return NULL;
+    } else {
+        return new_atom(self->tree, found);
+    }
+}
+
+static PyObject*
+Atom_data(m4a_Atom *self, PyObject *args)
+{
+    uint8_t *data;
+    uint64_t size;
+    m4a_status status;
+    PyObject *data_obj;
+
+    if ((status = m4a_atom_data(self->tree->tree,
+                                self->atom,
+                                &data,
+                                &size)) != M4A_OK) {
+        return m4a_error(status);
+    }
+
+    data_obj = PyBytes_FromStringAndSize((char*)data, (Py_ssize_t)size);
+    free(data);
+    return data_obj;
+}
+
+static PyObject*
+Atom_set_data(m4a_Atom *self, PyObject *args)
+{
+    PyObject *data_obj;
+    char *data;
+    Py_ssize_t size;
+
+    if (!PyArg_ParseTuple(args, "O", &data_obj))
+        return NULL;
+    if (PyBytes_AsStringAndSize(data_obj, &data, &size) == -1)
+        return NULL;
+    if (self->atom == &(self->tree->tree->root)) {
+        PyErr_SetString(PyExc_ValueError, "cannot set data of root atom");
+        return NULL;
+    }
+
+    m4a_atom_set_data(self->tree->tree,
+                      self->atom,
+                      (uint8_t*)data,
+                      (uint64_t)size);
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+static PyObject*
+Atom_add_child(m4a_Atom *self, PyObject *args)
+{
+    PyObject *name_obj;
+    PyObject *data_obj = Py_None;
+    uint8_t name[4];
+    char *data = NULL;
+    Py_ssize_t size = 0;
+    struct m4a_atom *child;
+    m4a_status status;
+
+    if (!PyArg_ParseTuple(args, "O|O", &name_obj, &data_obj))
+        return NULL;
+    if (atom_name(name_obj, name))
+        return NULL;
+    if ((data_obj != Py_None) &&
+        (PyBytes_AsStringAndSize(data_obj, &data, &size) == -1))
+        return NULL;
+
+    if ((status = m4a_atom_add_child(self->tree->tree,
+                                     self->atom,
+                                     name,
+                                     (uint8_t*)data,
+                                     (uint64_t)size,
+                                     &child)) != M4A_OK) {
+        return m4a_error(status);
+    }
+
+    return new_atom(self->tree, child);
+}
+
+static PyObject*
+Atom_remove_child(m4a_Atom *self, PyObject *args)
+{
+    m4a_Atom *child;
+    m4a_status status;
+
+    if (!PyArg_ParseTuple(args, "O!", &m4a_AtomType, &child))
+        return NULL;
+    if (child->tree != self->tree) {
+        PyErr_SetString(PyExc_ValueError, "atom is from a different tree");
+        return NULL;
+    }
+
+    if ((status = m4a_atom_remove_child(self->tree->tree,
+                                        self->atom,
+                                        child->atom)) != M4A_OK) {
+        return m4a_error(status);
+    }
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+/*writes data to a Python file object,
+  returning 0 on success or 1 with an exception set*/
+static int
+write_file_obj(void *output, const uint8_t *data, unsigned size)
+{
+    PyObject *data_obj;
+    PyObject *result;
+
+    if (size == 0)
+        return 0;
+
+    if ((data_obj = PyBytes_FromStringAndSize((char*)data, size)) == NULL)
+        return 1;
+
+    result = PyObject_CallMethod((PyObject*)output, "write", "O", data_obj);
+    Py_DECREF(data_obj);
+    if (result == NULL) {
+        return 1;
+    } else {
+        Py_DECREF(result);
+        return 0;
+    }
+}
+
+static PyObject*
+Atom_build(m4a_Atom *self, PyObject *args)
+{
+    PyObject *file_obj;
+    m4a_status status;
+
+    if (!PyArg_ParseTuple(args, "O", &file_obj))
+        return NULL;
+
+    if (self->atom == &(self->tree->tree->root)) {
+        status = m4a_tree_build(self->tree->tree, write_file_obj, file_obj);
+    } else {
+        status = m4a_atom_build(self->tree->tree,
+                                self->atom,
+                                write_file_obj,
+                                file_obj);
+    }
+
+    if (status != M4A_OK) {
+        return m4a_error(status);
+    } else {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+}
@@ -0,0 +1,166 @@
+#include <Python.h>
+#include "m4a_tree.h"
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+static PyObject*
+m4a_parse_file(PyObject *dummy, PyObject *args);
+
+PyMethodDef module_methods[] = {
+    {"parse_file", (PyCFunction)m4a_parse_file,
+     METH_VARARGS,
+     "parse_file(filename) -> Atom\n"
+     "returns the root of the file's atom tree"},
+    {NULL}
+};
+
+/*a tree shared by all the Atom objects pointing into it
+  which is freed along with the last of them*/
+struct m4a_tree_ref {
+    struct m4a_tree *tree;
+    unsigned references;
+};
+
+typedef struct {
+    PyObject_HEAD
+
+    struct m4a_tree_ref *tree;
+    struct m4a_atom *atom;
+} m4a_Atom;
+
+static PyObject*
+Atom_new(PyTypeObject *type, PyObject *args, PyObject *kwds);
+
+void
+Atom_dealloc(m4a_Atom *self);
+
+static PyObject*
+Atom_get_name(m4a_Atom *self, void *closure);
+
+static PyObject*
+Atom_get_offset(m4a_Atom *self, void *closure);
+
+static PyObject*
+Atom_get_is_container(m4a_Atom *self, void *closure);
+
+PyGetSetDef Atom_getseters[] = {
+    {"name",
+     (getter)Atom_get_name, NULL,
+     "the atom's 4 byte name, or None for the root", NULL},
+    {"offset",
+     (getter)Atom_get_offset, NULL,
+     "the atom's position in the file, or None if modified", NULL},
+    {"is_container",
+     (getter)Atom_get_is_container, NULL,
+     "whether the atom contains other atoms", NULL},
+    {NULL}
+};
+
+static PyObject*
+Atom_size(m4a_Atom *self, PyObject *args);
+
+static PyObject*
+Atom_children(m4a_Atom *self, PyObject *args);
+
+static PyObject*
+Atom_find(m4a_Atom *self, PyObject *args);
+
+static PyObject*
+Atom_data(m4a_Atom *self, PyObject *args);
+
+static PyObject*
+Atom_set_data(m4a_Atom *self, PyObject *args);
+
+static PyObject*
+Atom_add_child(m4a_Atom *self, PyObject *args);
+
+static PyObject*
+Atom_remove_child(m4a_Atom *self, PyObject *args);
+
+static PyObject*
+Atom_build(m4a_Atom *self, PyObject *args);
+
+PyMethodDef Atom_methods[] = {
+    {"size", (PyCFunction)Atom_size,
+     METH_NOARGS, "size() -> total size of atom in bytes"},
+    {"children", (PyCFunction)Atom_children,
+     METH_NOARGS, "children() -> [Atom, Atom, ...]"},
+    {"find", (PyCFunction)Atom_find,
+     METH_VARARGS,
+     "find(name, name, ...) -> Atom\n"
+     "raises KeyError if no atom is found at that path"},
+    {"data", (PyCFunction)Atom_data,
+     METH_NOARGS, "data() -> atom's payload as bytes, not including header"},
+    {"set_data", (PyCFunction)Atom_set_data,
+     METH_VARARGS, "set_data(data) replaces atom's payload"},
+    {"add_child", (PyCFunction)Atom_add_child,
+     METH_VARARGS,
+     "add_child(name, data=None) -> Atom\n"
+     "appends a leaf atom, or an empty container if data is None"},
+    {"remove_child", (PyCFunction)Atom_remove_child,
+     METH_VARARGS, "remove_child(atom)"},
+    {"build", (PyCFunction)Atom_build,
+     METH_VARARGS,
+     "build(file) writes the atom to the given file object\n"
+     "where building the root writes a complete file "
+     "with its chunk offsets adjusted"},
+    {NULL}
+};
+
+PyTypeObject m4a_AtomType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "_m4a.Atom",               /*tp_name*/
+    sizeof(m4a_Atom),          /*tp_basicsize*/
+    0,                         /*tp_itemsize*/
+    (destructor)Atom_dealloc,  /*tp_dealloc*/
+    0,                         /*tp_print*/
+    0,                         /*tp_getattr*/
+    0,                         /*tp_setattr*/
+    0,                         /*tp_compare*/
+    0,                         /*tp_repr*/
+    0,                         /*tp_as_number*/
+    0,                         /*tp_as_sequence*/
+    0,                         /*tp_as_mapping*/
+    0,                         /*tp_hash */
+    0,                         /*tp_call*/
+    0,                         /*tp_str*/
+    0,                         /*tp_getattro*/
+    0,                         /*tp_setattro*/
+    0,                         /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT,        /*tp_flags*/
+    "M4A Atom objects",        /* tp_doc */
+    0,                         /* tp_traverse */
+    0,                         /* tp_clear */
+    0,                         /* tp_richcompare */
+    0,                         /* tp_weaklistoffset */
+    0,                         /* tp_iter */
+    0,                         /* tp_iternext */
+    Atom_methods,              /* tp_methods */
+    0,                         /* tp_members */
+    Atom_getseters,            /* tp_getset */
+    0,                         /* tp_base */
+    0,                         /* tp_dict */
+    0,                         /* tp_descr_get */
+    0,                         /* tp_descr_set */
+    0,                         /* tp_dictoffset */
+    0,                         /* tp_init */
+    0,                         /* tp_alloc */
+    Atom_new,                  /* tp_new */
+};
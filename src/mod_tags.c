@@ -0,0 +1,408 @@
+#include <stdlib.h>
+#include <string.h>
+#include "mod_tags.h"
+#include "mod_defs.h"
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+MOD_INIT(_tags)
+{
+    PyObject* m;
+
+    MOD_DEF(m, "_tags", "an ID3v2, ID3v1 and APEv2 tag handling module",
+            module_methods)
+
+    return MOD_SUCCESS_VAL(m);
+}
+
+/*given a bytes object, places its data and size in "data" and "size"
+  and returns 0, or returns -1 with an exception set*/
+static int
+bytes_data(PyObject *obj, uint8_t **data, unsigned *size)
+{
+    char *buffer;
+    Py_ssize_t length;
+
+    if (PyBytes_AsStringAndSize(obj, &buffer, &length) == -1) {
+        return -1;
+    } else if ((uint64_t)length > UINT32_MAX) {
+        PyErr_SetString(PyExc_ValueError, "data too large");
+        return -1;
+    } else {
+        *data = (uint8_t*)buffer;
+        *size = (unsigned)length;
+        return 0;
+    }
+}
+
+static PyObject*
+tags_parse_id3v2(PyObject *dummy, PyObject *args)
+{
+    PyObject *data_obj;
+    uint8_t *data;
+    unsigned size;
+    struct id3v2_tag tag;
+    tag_status status;
+    PyObject *frames;
+    unsigned i;
+
+    if (!PyArg_ParseTuple(args, "O", &data_obj))
+        return NULL;
+    if (bytes_data(data_obj, &data, &size))
+        return NULL;
+
+    if ((status = id3v2_parse(data, size, &tag)) != TAG_OK) {
+        PyErr_SetString(PyExc_ValueError, tag_strerror(status));
+        return NULL;
+    }
+
+    if ((frames = PyList_New(tag.frame_count)) == NULL) {
+        id3v2_free(&tag);
+        return NULL;
+    }
+
+    for (i = 0; i < tag.frame_count; i++) {
+        const struct id3v2_frame *frame = &(tag.frames[i]);
+        PyObject *frame_obj = Py_BuildValue(
+            "(NN)",
+            PyBytes_FromStringAndSize(
+                (char*)frame->id, id3v2_id_size(tag.major_version)),
+            PyBytes_FromStringAndSize((char*)frame->data, frame->size));
+
+        if (frame_obj == NULL) {
+            Py_DECREF(frames);
+            id3v2_free(&tag);
+            return NULL;
+        }
+        PyList_SET_ITEM(frames, i, frame_obj);
+    }
+
+    id3v2_free(&tag);
+
+    return Py_BuildValue("(IIIIN)",
+                         tag.major_version,
+                         tag.minor_version,
+                         tag.flags,
+                         tag.total_size,
+                         frames);
+}
+
+static PyObject*
+tags_build_id3v2(PyObject *dummy, PyObject *args)
+{
+    unsigned major_version;
+    PyObject *frames_obj;
+    unsigned total_size;
+    PyObject *frames_seq;
+    Py_ssize_t frame_count;
+    struct id3v2_frame *frames;
+    PyObject *tag_obj;
+    tag_status status;
+    Py_ssize_t i;
+
+    if (!PyArg_ParseTuple(args, "IOI",
+                          &major_version, &frames_obj, &total_size))
+        return NULL;
+
+    if ((major_version < 2) || (major_version > 4)) {
+        PyErr_SetString(PyExc_ValueError, "unsupported ID3v2 version");
+        return NULL;
+    }
+
+    if ((frames_seq = PySequence_Fast(frames_obj,
+                                      "frames must be a sequence")) == NULL)
+        return NULL;
+
+    frame_count = PySequence_Fast_GET_SIZE(frames_seq);
+    frames = malloc((frame_count ? frame_count : 1) *
+                    sizeof(struct id3v2_frame));
+
+    /*frames refer to the data of their bytes objects
+      which remain alive as long as "frames_seq" does*/
+    for (i = 0; i < frame_count; i++) {
+        PyObject *frame_id;
+        PyObject *frame_data;
+        uint8_t *id;
+        unsigned id_size;
+
+        if (!PyArg_ParseTuple(PySequence_Fast_GET_ITEM(frames_seq, i),
+                              "OO", &frame_id, &frame_data) ||
+            bytes_data(frame_id, &id, &id_size) ||
+            bytes_data(frame_data, &(frames[i].data), &(frames[i].size))) {
+            free(frames);
+            Py_DECREF(frames_seq);
+            return NULL;
+        }
+        if (id_size != id3v2_id_size(major_version)) {
+            PyErr_SetString(PyExc_ValueError, "invalid frame ID size");
+            free(frames);
+            Py_DECREF(frames_seq);
+            return NULL;
+        }
+        memcpy(frames[i].id, id, id_size);
+        frames[i].flags = 0;
+    }
+
+    tag_obj = PyBytes_FromStringAndSize(
+        NULL,
+        id3v2_size(major_version, (unsigned)frame_count, frames, total_size));
+    if (tag_obj == NULL) {
+        free(frames);
+        Py_DECREF(frames_seq);
+        return NULL;
+    }
+
+    status = id3v2_build(major_version,
+                         (unsigned)frame_count,
+                         frames,
+                         total_size,
+                         (uint8_t*)PyBytes_AS_STRING(tag_obj));
+    free(frames);
+    Py_DECREF(frames_seq);
+
+    if (status == TAG_OK) {
+        return tag_obj;
+    } else {
+        Py_DECREF(tag_obj);
+        PyErr_SetString(PyExc_ValueError, tag_strerror(status));
+        return NULL;
+    }
+}
+
+static PyObject*
+tags_parse_id3v1(PyObject *dummy, PyObject *args)
+{
+    PyObject *data_obj;
+    uint8_t *data;
+    unsigned size;
+    struct id3v1_tag tag;
+
+    if (!PyArg_ParseTuple(args, "O", &data_obj))
+        return NULL;
+    if (bytes_data(data_obj, &data, &size))
+        return NULL;
+
+    if ((size != ID3V1_SIZE) || (id3v1_parse(data, &tag) != TAG_OK)) {
+        PyErr_SetString(PyExc_ValueError, "invalid ID3v1 tag");
+        return NULL;
+    }
+
+    return Py_BuildValue("(NNNNNII)",
+                         PyBytes_FromStringAndSize((char*)tag.track_name, 30),
+                         PyBytes_FromStringAndSize((char*)tag.artist_name, 30),
+                         PyBytes_FromStringAndSize((char*)tag.album_name, 30),
+                         PyBytes_FromStringAndSize((char*)tag.year, 4),
+                         PyBytes_FromStringAndSize((char*)tag.comment, 28),
+                         tag.track_number,
+                         tag.genre);
+}
+
+/*copies as much of the bytes object as fits to a NULL-padded field
+  and returns 0, or returns -1 with an exception set*/
+static int
+id3v1_field(PyObject *obj, uint8_t *field, unsigned field_size)
+{
+    uint8_t *data;
+    unsigned size;
+
+    if (bytes_data(obj, &data, &size)) {
+        return -1;
+    } else {
+        if (size > field_size)
+            size = field_size;
+        memcpy(field, data, size);
+        memset(field + size, 0, field_size - size);
+        return 0;
+    }
+}
+
+static PyObject*
+tags_build_id3v1(PyObject *dummy, PyObject *args)
+{
+    PyObject *track_name;
+    PyObject *artist_name;
+    PyObject *album_name;
+    PyObject *year;
+    PyObject *comment;
+    struct id3v1_tag tag;
+    uint8_t output[ID3V1_SIZE];
+
+    if (!PyArg_ParseTuple(args, "OOOOOII",
+                          &track_name,
+                          &artist_name,
+                          &album_name,
+                          &year,
+                          &comment,
+                          &(tag.track_number),
+                          &(tag.genre)))
+        return NULL;
+
+    if (id3v1_field(track_name, tag.track_name, 30) ||
+        id3v1_field(artist_name, tag.artist_name, 30) ||
+        id3v1_field(album_name, tag.album_name, 30) ||
+        id3v1_field(year, tag.year, 4) ||
+        id3v1_field(comment, tag.comment, 28))
+        return NULL;
+
+    id3v1_build(&tag, output);
+
+    return PyBytes_FromStringAndSize((char*)output, ID3V1_SIZE);
+}
+
+static PyObject*
+tags_parse_apev2_footer(PyObject *dummy, PyObject *args)
+{
+    PyObject *data_obj;
+    uint8_t *data;
+    unsigned size;
+    struct apev2_footer footer;
+    tag_status status;
+
+    if (!PyArg_ParseTuple(args, "O", &data_obj))
+        return NULL;
+    if (bytes_data(data_obj, &data, &size))
+        return NULL;
+
+    if (size != APEV2_FOOTER_SIZE) {
+        PyErr_SetString(PyExc_ValueError, "APEv2 footer must be 32 bytes");
+        return NULL;
+    } else if ((status = apev2_parse_footer(data, &footer)) != TAG_OK) {
+        PyErr_SetString(PyExc_ValueError, tag_strerror(status));
+        return NULL;
+    }
+
+    return Py_BuildValue("(IIO)",
+                         footer.tag_size,
+                         footer.item_count,
+                         footer.flags & APEV2_HAS_HEADER ? Py_True : Py_False);
+}
+
+static PyObject*
+tags_parse_apev2_items(PyObject *dummy, PyObject *args)
+{
+    PyObject *data_obj;
+    unsigned item_count;
+    uint8_t *data;
+    unsigned size;
+    struct apev2_item *items;
+    tag_status status;
+    PyObject *items_obj;
+    unsigned i;
+
+    if (!PyArg_ParseTuple(args, "OI", &data_obj, &item_count))
+        return NULL;
+    if (bytes_data(data_obj, &data, &size))
+        return NULL;
+
+    if ((status = apev2_parse_items(data,
+                                    size,
+                                    item_count,
+                                    &items)) != TAG_OK) {
+        PyErr_SetString(PyExc_ValueError, tag_strerror(status));
+        return NULL;
+    }
+
+    if ((items_obj = PyList_New(item_count)) == NULL) {
+        apev2_free_items(item_count, items);
+        return NULL;
+    }
+
+    for (i = 0; i < item_count; i++) {
+        const struct apev2_item *item = &(items[i]);
+        PyObject *item_obj = Py_BuildValue(
+            "(IINN)",
+            item->type,
+            item->read_only,
+            PyBytes_FromStringAndSize((char*)item->key, item->key_size),
+            PyBytes_FromStringAndSize((char*)item->value, item->value_size));
+
+        if (item_obj == NULL) {
+            Py_DECREF(items_obj);
+            apev2_free_items(item_count, items);
+            return NULL;
+        }
+        PyList_SET_ITEM(items_obj, i, item_obj);
+    }
+
+    apev2_free_items(item_count, items);
+
+    return items_obj;
+}
+
+static PyObject*
+tags_build_apev2(PyObject *dummy, PyObject *args)
+{
+    PyObject *items_obj;
+    int has_header;
+    int has_footer;
+    PyObject *items_seq;
+    Py_ssize_t item_count;
+    struct apev2_item *items;
+    PyObject *tag_obj;
+    Py_ssize_t i;
+
+    if (!PyArg_ParseTuple(args, "Oii", &items_obj, &has_header, &has_footer))
+        return NULL;
+
+    if ((items_seq = PySequence_Fast(items_obj,
+                                     "items must be a sequence")) == NULL)
+        return NULL;
+
+    item_count = PySequence_Fast_GET_SIZE(items_seq);
+    items = malloc((item_count ? item_count : 1) *
+                   sizeof(struct apev2_item));
+
+    /*items refer to the data of their bytes objects
+      which remain alive as long as "items_seq" does*/
+    for (i = 0; i < item_count; i++) {
+        struct apev2_item *item = &(items[i]);
+        PyObject *key;
+        PyObject *value;
+
+        if (!PyArg_ParseTuple(PySequence_Fast_GET_ITEM(items_seq, i),
+                              "IIOO",
+                              &(item->type),
+                              &(item->read_only),
+                              &key,
+                              &value) ||
+            bytes_data(key, &(item->key), &(item->key_size)) ||
+            bytes_data(value, &(item->value), &(item->value_size))) {
+            free(items);
+            Py_DECREF(items_seq);
+            return NULL;
+        }
+    }
+
+    tag_obj = PyBytes_FromStringAndSize(
+        NULL,
+        apev2_size((unsigned)item_count, items, has_header, has_footer));
+    if (tag_obj != NULL) {
+        apev2_build((unsigned)item_count,
+                    items,
+                    has_header,
+                    has_footer,
+                    (uint8_t*)PyBytes_AS_STRING(tag_obj));
+    }
+
+    free(items);
+    Py_DECREF(items_seq);
+
+    return tag_obj;
+}
@@ -0,0 +1,76 @@
+#include <Python.h>
+#include "tags.h"
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+static PyObject*
+tags_parse_id3v2(PyObject *dummy, PyObject *args);
+
+static PyObject*
+tags_build_id3v2(PyObject *dummy, PyObject *args);
+
+static PyObject*
+tags_parse_id3v1(PyObject *dummy, PyObject *args);
+
+static PyObject*
+tags_build_id3v1(PyObject *dummy, PyObject *args);
+
+static PyObject*
+tags_parse_apev2_footer(PyObject *dummy, PyObject *args);
+
+static PyObject*
+tags_parse_apev2_items(PyObject *dummy, PyObject *args);
+
+static PyObject*
+tags_build_apev2(PyObject *dummy, PyObject *args);
+
+PyMethodDef module_methods[] = {
+    {"parse_id3v2", (PyCFunction)tags_parse_id3v2,
+     METH_VARARGS,
+     "parse_id3v2(data) -> (major_version, minor_version, flags, "
+     "total_size, [(frame_id, frame_data), ...])\n"
+     "where data is a complete ID3v2 tag including its header"},
+    {"build_id3v2", (PyCFunction)tags_build_id3v2,
+     METH_VARARGS,
+     "build_id3v2(major_version, [(frame_id, frame_data), ...], "
+     "total_size) -> bytes"},
+    {"parse_id3v1", (PyCFunction)tags_parse_id3v1,
+     METH_VARARGS,
+     "parse_id3v1(data) -> (track_name, artist_name, album_name, "
+     "year, comment, track_number, genre)\n"
+     "where data is the final 128 bytes of a file"},
+    {"build_id3v1", (PyCFunction)tags_build_id3v1,
+     METH_VARARGS,
+     "build_id3v1(track_name, artist_name, album_name, "
+     "year, comment, track_number, genre) -> bytes"},
+    {"parse_apev2_footer", (PyCFunction)tags_parse_apev2_footer,
+     METH_VARARGS,
+     "parse_apev2_footer(data) -> (tag_size, item_count, has_header)\n"
+     "where data is a 32 byte APEv2 footer"},
+    {"parse_apev2_items", (PyCFunction)tags_parse_apev2_items,
+     METH_VARARGS,
+     "parse_apev2_items(data, item_count) -> "
+     "[(item_type, read_only, key, value), ...]"},
+    {"build_apev2", (PyCFunction)tags_build_apev2,
+     METH_VARARGS,
+     "build_apev2([(item_type, read_only, key, value), ...], "
+     "has_header, has_footer) -> bytes"},
+    {NULL}
+};
@@ -81,7 +81,9 @@ read_ogg_page(BitstreamReader *ogg_stream,
         ogg_status result;
 
         /*attach checksum calculator to stream*/
-        ogg_stream->add_callback(ogg_stream, (bs_callback_f)ogg_crc, &checksum);
+        ogg_stream->add_span_callback(ogg_stream,
+                                      (bs_span_callback_f)ogg_crc_span,
+                                      &checksum);
 
         /*read header*/
         if ((result = read_ogg_page_header(ogg_stream,
@@ -160,9 +162,9 @@ write_ogg_page(BitstreamWriter *ogg_stream,
     uint8_t i;
 
     /*attach checksum calculator to stream*/
-    ogg_stream->add_callback(ogg_stream,
-                             (bs_callback_f)ogg_crc,
-                             &checksum);
+    ogg_stream->add_span_callback(ogg_stream,
+                                  (bs_span_callback_f)ogg_crc_span,
+                                  &checksum);
 
     /*write page header*/
     ogg_stream->write(ogg_stream, 32, page->header.magic_number);
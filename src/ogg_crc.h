@@ -25,3 +25,9 @@
 void
 ogg_crc(uint8_t byte, uint32_t *checksum);
 
+/*given "size" bytes of data and the previous checksum value,
+  assigns a new checksum to that value*/
+
+void
+ogg_crc_span(const uint8_t *data, unsigned size, uint32_t *checksum);
+
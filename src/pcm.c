@@ -3,6 +3,7 @@
 #include "mod_defs.h"
 #endif
 #include <stdlib.h>
+#include <string.h>
 
 /********************************************************
  Audio Tools, a module and set of tools for manipulating audio data
@@ -60,6 +61,16 @@ PyMethodDef module_methods[] = {
     {"from_float_channels", (PyCFunction)FloatFrameList_from_channels,
      METH_VARARGS,
      "from_float_channels(floatframelist_list) -> FloatFrameList"},
+    {"conversion_isas", (PyCFunction)pcm_conversion_isas,
+     METH_NOARGS,
+     "conversion_isas() -> [isa_name, ...]\n"
+     "returns the instruction sets this CPU can use to convert\n"
+     "between FrameLists and bytes, best last"},
+    {"set_conversion_isa", (PyCFunction)pcm_set_conversion_isa,
+     METH_VARARGS,
+     "set_conversion_isa(isa_name) -> None\n"
+     "restricts FrameList and bytes conversion to the given\n"
+     "instruction set, for testing"},
     {NULL}
 };
 
@@ -1570,6 +1581,52 @@ FloatFrameList_converter(PyObject* obj, void** floatframelist)
     }
 }
 
+PyObject*
+pcm_conversion_isas(PyObject *dummy, PyObject *args)
+{
+    const pcm_conv_isa_t best = pcm_conv_best_isa();
+    PyObject *list = PyList_New(0);
+    int isa;
+
+    if (list == NULL)
+        return NULL;
+
+    for (isa = PCM_CONV_SCALAR; isa <= (int)best; isa++) {
+        PyObject *name =
+            Py_BuildValue("s", pcm_conv_isa_name((pcm_conv_isa_t)isa));
+        if ((name == NULL) || PyList_Append(list, name)) {
+            Py_XDECREF(name);
+            Py_DECREF(list);
+            return NULL;
+        }
+        Py_DECREF(name);
+    }
+
+    return list;
+}
+
+PyObject*
+pcm_set_conversion_isa(PyObject *dummy, PyObject *args)
+{
+    const pcm_conv_isa_t best = pcm_conv_best_isa();
+    const char *isa_name;
+    int isa;
+
+    if (!PyArg_ParseTuple(args, "s", &isa_name))
+        return NULL;
+
+    for (isa = PCM_CONV_SCALAR; isa <= (int)best; isa++) {
+        if (!strcmp(isa_name, pcm_conv_isa_name((pcm_conv_isa_t)isa))) {
+            pcm_conv_set_isa((pcm_conv_isa_t)isa);
+            Py_INCREF(Py_None);
+            return Py_None;
+        }
+    }
+
+    PyErr_SetString(PyExc_ValueError, "unsupported instruction set");
+    return NULL;
+}
+
 MOD_INIT(pcm)
 {
     PyObject* m;
@@ -221,6 +221,12 @@ FloatFrameList_from_channels(PyObject *dummy, PyObject *args);
 /*for use with the PyArg_ParseTuple function*/
 int
 FloatFrameList_converter(PyObject* obj, void** floatframelist);
+
+PyObject*
+pcm_conversion_isas(PyObject *dummy, PyObject *args);
+
+PyObject*
+pcm_set_conversion_isa(PyObject *dummy, PyObject *args);
 #endif
 
 #endif
@@ -2,6 +2,16 @@
 #include <stdlib.h>
 #include <math.h>
 
+/*the SIMD converters need SSE2 at compile time,
+  which every x86-64 compiler provides,
+  while the SSSE3 and AVX2 converters are compiled per-function
+  and only chosen if the running CPU supports them*/
+#if defined(__GNUC__) && defined(__SSE2__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define PCM_CONV_X86
+#include <immintrin.h>
+#endif
+
 /********************************************************
  Audio Tools, a module and set of tools for manipulating audio data
  Copyright (C) 2007-2016  Brian Langenberger
@@ -79,6 +89,551 @@ PCM_INT_CONV_DEFS(8)
 PCM_INT_CONV_DEFS(16)
 PCM_INT_CONV_DEFS(24)
 
+#ifdef PCM_CONV_X86
+
+/*each SIMD converter handles as many samples as its vectors allow
+  and leaves the remainder to the scalar converter*/
+#define PCM_CONV_SIMD(name, isa, target, bytes, kernel, big_endian, is_signed)\
+    target static void                                                      \
+    pcm_##name##_to_int_##isa(unsigned total_samples,                       \
+                              const unsigned char pcm_samples[],            \
+                              int int_samples[])                            \
+    {                                                                       \
+        const unsigned converted =                                          \
+            isa##_pcm##kernel##_to_int(total_samples,                       \
+                                       pcm_samples,                         \
+                                       int_samples,                         \
+                                       big_endian,                          \
+                                       is_signed);                          \
+        pcm_##name##_to_int(total_samples - converted,                      \
+                            pcm_samples + (converted * bytes),              \
+                            int_samples + converted);                       \
+    }                                                                       \
+                                                                            \
+    target static void                                                      \
+    int_to_##name##_pcm_##isa(unsigned total_samples,                       \
+                              const int int_samples[],                      \
+                              unsigned char pcm_samples[])                  \
+    {                                                                       \
+        const unsigned converted =                                          \
+            isa##_int_to_pcm##kernel(total_samples,                         \
+                                     int_samples,                           \
+                                     pcm_samples,                           \
+                                     big_endian,                            \
+                                     is_signed);                            \
+        int_to_##name##_pcm(total_samples - converted,                      \
+                            int_samples + converted,                        \
+                            pcm_samples + (converted * bytes));             \
+    }
+
+#define SSE2_TARGET
+#define SSSE3_TARGET __attribute__((target("ssse3")))
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+#define SIMD_KERNEL(target) static inline __attribute__((always_inline)) target
+
+/*swaps the bytes of each 16-bit value*/
+SIMD_KERNEL(SSE2_TARGET) __m128i
+sse2_swap16(__m128i v)
+{
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+/*sign-extends the low "bits" bits of each 32-bit value,
+  which truncates values to be stored unsigned*/
+#define SSE2_LOW_BITS(v, bits) \
+    _mm_srai_epi32(_mm_slli_epi32((v), 32 - (bits)), 32 - (bits))
+
+/*clamps each 32-bit value between "min" and "max"*/
+SIMD_KERNEL(SSE2_TARGET) __m128i
+sse2_clamp32(__m128i v, __m128i min, __m128i max)
+{
+    __m128i mask = _mm_cmpgt_epi32(v, max);
+    v = _mm_or_si128(_mm_and_si128(mask, max), _mm_andnot_si128(mask, v));
+    mask = _mm_cmplt_epi32(v, min);
+    return _mm_or_si128(_mm_and_si128(mask, min), _mm_andnot_si128(mask, v));
+}
+
+/*unsigned samples are converted as signed ones
+  with their most significant bit flipped,
+  since (u - bias) and (u ^ bias) agree in the sample's low bits*/
+
+SIMD_KERNEL(SSE2_TARGET) unsigned
+sse2_pcm8_to_int(unsigned total_samples,
+                 const unsigned char pcm_samples[],
+                 int int_samples[],
+                 int big_endian,
+                 int is_signed)
+{
+    const __m128i flip = _mm_set1_epi8(is_signed ? 0 : (char)0x80);
+    unsigned i;
+
+    for (i = 0; (i + 16) <= total_samples; i += 16) {
+        const __m128i bytes = _mm_xor_si128(
+            _mm_loadu_si128((const __m128i*)(pcm_samples + i)), flip);
+        /*repeat each byte across a 32-bit value
+          then shift it down from the top to extend its sign*/
+        const __m128i lo = _mm_unpacklo_epi8(bytes, bytes);
+        const __m128i hi = _mm_unpackhi_epi8(bytes, bytes);
+        _mm_storeu_si128((__m128i*)(int_samples + i),
+                         _mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 24));
+        _mm_storeu_si128((__m128i*)(int_samples + i + 4),
+                         _mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 24));
+        _mm_storeu_si128((__m128i*)(int_samples + i + 8),
+                         _mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 24));
+        _mm_storeu_si128((__m128i*)(int_samples + i + 12),
+                         _mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 24));
+    }
+
+    return i;
+}
+
+SIMD_KERNEL(SSE2_TARGET) unsigned
+sse2_int_to_pcm8(unsigned total_samples,
+                 const int int_samples[],
+                 unsigned char pcm_samples[],
+                 int big_endian,
+                 int is_signed)
+{
+    const __m128i flip = _mm_set1_epi8(is_signed ? 0 : (char)0x80);
+    unsigned i;
+
+    for (i = 0; (i + 16) <= total_samples; i += 16) {
+        __m128i v0 = _mm_loadu_si128((const __m128i*)(int_samples + i));
+        __m128i v1 = _mm_loadu_si128((const __m128i*)(int_samples + i + 4));
+        __m128i v2 = _mm_loadu_si128((const __m128i*)(int_samples + i + 8));
+        __m128i v3 = _mm_loadu_si128((const __m128i*)(int_samples + i + 12));
+        if (!is_signed) {
+            /*unsigned samples wrap rather than saturate*/
+            v0 = SSE2_LOW_BITS(v0, 8);
+            v1 = SSE2_LOW_BITS(v1, 8);
+            v2 = SSE2_LOW_BITS(v2, 8);
+            v3 = SSE2_LOW_BITS(v3, 8);
+        }
+        /*signed packing saturates each value to 8 bits*/
+        _mm_storeu_si128((__m128i*)(pcm_samples + i),
+                         _mm_xor_si128(
+                             _mm_packs_epi16(_mm_packs_epi32(v0, v1),
+                                             _mm_packs_epi32(v2, v3)),
+                             flip));
+    }
+
+    return i;
+}
+
+SIMD_KERNEL(SSE2_TARGET) unsigned
+sse2_pcm16_to_int(unsigned total_samples,
+                  const unsigned char pcm_samples[],
+                  int int_samples[],
+                  int big_endian,
+                  int is_signed)
+{
+    const __m128i flip = _mm_set1_epi16(is_signed ? 0 : (short)0x8000);
+    unsigned i;
+
+    for (i = 0; (i + 8) <= total_samples; i += 8) {
+        __m128i words =
+            _mm_loadu_si128((const __m128i*)(pcm_samples + (i * 2)));
+        if (big_endian) {
+            words = sse2_swap16(words);
+        }
+        words = _mm_xor_si128(words, flip);
+        _mm_storeu_si128((__m128i*)(int_samples + i),
+                         _mm_srai_epi32(_mm_unpacklo_epi16(words, words), 16));
+        _mm_storeu_si128((__m128i*)(int_samples + i + 4),
+                         _mm_srai_epi32(_mm_unpackhi_epi16(words, words), 16));
+    }
+
+    return i;
+}
+
+SIMD_KERNEL(SSE2_TARGET) unsigned
+sse2_int_to_pcm16(unsigned total_samples,
+                  const int int_samples[],
+                  unsigned char pcm_samples[],
+                  int big_endian,
+                  int is_signed)
+{
+    const __m128i flip = _mm_set1_epi16(is_signed ? 0 : (short)0x8000);
+    unsigned i;
+
+    for (i = 0; (i + 8) <= total_samples; i += 8) {
+        __m128i v0 = _mm_loadu_si128((const __m128i*)(int_samples + i));
+        __m128i v1 = _mm_loadu_si128((const __m128i*)(int_samples + i + 4));
+        __m128i words;
+        if (!is_signed) {
+            v0 = SSE2_LOW_BITS(v0, 16);
+            v1 = SSE2_LOW_BITS(v1, 16);
+        }
+        words = _mm_xor_si128(_mm_packs_epi32(v0, v1), flip);
+        if (big_endian) {
+            words = sse2_swap16(words);
+        }
+        _mm_storeu_si128((__m128i*)(pcm_samples + (i * 2)), words);
+    }
+
+    return i;
+}
+
+/*24-bit samples are moved to and from the top 3 bytes
+  of 32-bit values with byte shuffles*/
+
+SIMD_KERNEL(SSSE3_TARGET) __m128i
+ssse3_unpack24_mask(int big_endian)
+{
+    if (big_endian) {
+        return _mm_setr_epi8(-128, 2, 1, 0, -128, 5, 4, 3,
+                             -128, 8, 7, 6, -128, 11, 10, 9);
+    } else {
+        return _mm_setr_epi8(-128, 0, 1, 2, -128, 3, 4, 5,
+                             -128, 6, 7, 8, -128, 9, 10, 11);
+    }
+}
+
+SIMD_KERNEL(SSSE3_TARGET) __m128i
+ssse3_pack24_mask(int big_endian)
+{
+    if (big_endian) {
+        return _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9,
+                             8, 14, 13, 12, -128, -128, -128, -128);
+    } else {
+        return _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9,
+                             10, 12, 13, 14, -128, -128, -128, -128);
+    }
+}
+
+SIMD_KERNEL(SSSE3_TARGET) unsigned
+ssse3_pcm24_to_int(unsigned total_samples,
+                   const unsigned char pcm_samples[],
+                   int int_samples[],
+                   int big_endian,
+                   int is_signed)
+{
+    const __m128i mask = ssse3_unpack24_mask(big_endian);
+    const __m128i flip = _mm_set1_epi32(is_signed ? 0 : (int)0x80000000);
+    unsigned i;
+
+    /*each 16 byte load holds 4 whole samples,
+      so stop while the load still fits in the input*/
+    for (i = 0; (i + 6) <= total_samples; i += 4) {
+        const __m128i bytes =
+            _mm_loadu_si128((const __m128i*)(pcm_samples + (i * 3)));
+        _mm_storeu_si128(
+            (__m128i*)(int_samples + i),
+            _mm_srai_epi32(
+                _mm_xor_si128(_mm_shuffle_epi8(bytes, mask), flip), 8));
+    }
+
+    return i;
+}
+
+SIMD_KERNEL(SSSE3_TARGET) unsigned
+ssse3_int_to_pcm24(unsigned total_samples,
+                   const int int_samples[],
+                   unsigned char pcm_samples[],
+                   int big_endian,
+                   int is_signed)
+{
+    const __m128i mask = ssse3_pack24_mask(big_endian);
+    const __m128i min = _mm_set1_epi32(-0x800000);
+    const __m128i max = _mm_set1_epi32(0x7FFFFF);
+    const __m128i flip = _mm_set1_epi32(0x800000);
+    unsigned i;
+
+    /*each 16 byte store holds 4 whole samples and 4 unused bytes
+      which the next store overwrites,
+      so stop while the store still fits in the output*/
+    for (i = 0; (i + 6) <= total_samples; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(int_samples + i));
+        if (is_signed) {
+            v = sse2_clamp32(v, min, max);
+        } else {
+            v = _mm_xor_si128(v, flip);
+        }
+        _mm_storeu_si128((__m128i*)(pcm_samples + (i * 3)),
+                         _mm_shuffle_epi8(v, mask));
+    }
+
+    return i;
+}
+
+SIMD_KERNEL(AVX2_TARGET) unsigned
+avx2_pcm16_to_int(unsigned total_samples,
+                  const unsigned char pcm_samples[],
+                  int int_samples[],
+                  int big_endian,
+                  int is_signed)
+{
+    const __m256i flip = _mm256_set1_epi16(is_signed ? 0 : (short)0x8000);
+    unsigned i;
+
+    for (i = 0; (i + 16) <= total_samples; i += 16) {
+        __m256i words =
+            _mm256_loadu_si256((const __m256i*)(pcm_samples + (i * 2)));
+        if (big_endian) {
+            words = _mm256_or_si256(_mm256_slli_epi16(words, 8),
+                                    _mm256_srli_epi16(words, 8));
+        }
+        words = _mm256_xor_si256(words, flip);
+        _mm256_storeu_si256(
+            (__m256i*)(int_samples + i),
+            _mm256_cvtepi16_epi32(_mm256_castsi256_si128(words)));
+        _mm256_storeu_si256(
+            (__m256i*)(int_samples + i + 8),
+            _mm256_cvtepi16_epi32(_mm256_extracti128_si256(words, 1)));
+    }
+
+    return i;
+}
+
+SIMD_KERNEL(AVX2_TARGET) unsigned
+avx2_int_to_pcm16(unsigned total_samples,
+                  const int int_samples[],
+                  unsigned char pcm_samples[],
+                  int big_endian,
+                  int is_signed)
+{
+    const __m256i flip = _mm256_set1_epi16(is_signed ? 0 : (short)0x8000);
+    unsigned i;
+
+    for (i = 0; (i + 16) <= total_samples; i += 16) {
+        __m256i v0 = _mm256_loadu_si256((const __m256i*)(int_samples + i));
+        __m256i v1 =
+            _mm256_loadu_si256((const __m256i*)(int_samples + i + 8));
+        __m256i words;
+        if (!is_signed) {
+            v0 = _mm256_srai_epi32(_mm256_slli_epi32(v0, 16), 16);
+            v1 = _mm256_srai_epi32(_mm256_slli_epi32(v1, 16), 16);
+        }
+        /*packing works within each 128-bit lane,
+          so put the lanes' halves back in order afterward*/
+        words = _mm256_permute4x64_epi64(_mm256_packs_epi32(v0, v1), 0xD8);
+        words = _mm256_xor_si256(words, flip);
+        if (big_endian) {
+            words = _mm256_or_si256(_mm256_slli_epi16(words, 8),
+                                    _mm256_srli_epi16(words, 8));
+        }
+        _mm256_storeu_si256((__m256i*)(pcm_samples + (i * 2)), words);
+    }
+
+    return i;
+}
+
+SIMD_KERNEL(AVX2_TARGET) unsigned
+avx2_pcm24_to_int(unsigned total_samples,
+                  const unsigned char pcm_samples[],
+                  int int_samples[],
+                  int big_endian,
+                  int is_signed)
+{
+    const __m128i mask128 = ssse3_unpack24_mask(big_endian);
+    const __m256i mask = _mm256_broadcastsi128_si256(mask128);
+    const __m256i flip = _mm256_set1_epi32(is_signed ? 0 : (int)0x80000000);
+    unsigned i;
+
+    /*8 samples are loaded as two 16 byte halves 12 bytes apart
+      so that each 128-bit lane holds 4 whole samples*/
+    for (i = 0; (i + 10) <= total_samples; i += 8) {
+        const unsigned char *bytes = pcm_samples + (i * 3);
+        const __m256i v = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(
+                _mm_loadu_si128((const __m128i*)bytes)),
+            _mm_loadu_si128((const __m128i*)(bytes + 12)),
+            1);
+        _mm256_storeu_si256(
+            (__m256i*)(int_samples + i),
+            _mm256_srai_epi32(
+                _mm256_xor_si256(_mm256_shuffle_epi8(v, mask), flip), 8));
+    }
+
+    return i;
+}
+
+SIMD_KERNEL(AVX2_TARGET) unsigned
+avx2_int_to_pcm24(unsigned total_samples,
+                  const int int_samples[],
+                  unsigned char pcm_samples[],
+                  int big_endian,
+                  int is_signed)
+{
+    const __m128i mask128 = ssse3_pack24_mask(big_endian);
+    const __m256i mask = _mm256_broadcastsi128_si256(mask128);
+    const __m256i min = _mm256_set1_epi32(-0x800000);
+    const __m256i max = _mm256_set1_epi32(0x7FFFFF);
+    const __m256i flip = _mm256_set1_epi32(0x800000);
+    unsigned i;
+
+    /*each lane packs to 12 bytes which are stored 12 bytes apart,
+      the second store overwriting the first one's unused bytes*/
+    for (i = 0; (i + 10) <= total_samples; i += 8) {
+        unsigned char *bytes = pcm_samples + (i * 3);
+        __m256i v = _mm256_loadu_si256((const __m256i*)(int_samples + i));
+        if (is_signed) {
+            v = _mm256_min_epi32(_mm256_max_epi32(v, min), max);
+        } else {
+            v = _mm256_xor_si256(v, flip);
+        }
+        v = _mm256_shuffle_epi8(v, mask);
+        _mm_storeu_si128((__m128i*)bytes, _mm256_castsi256_si128(v));
+        _mm_storeu_si128((__m128i*)(bytes + 12),
+                         _mm256_extracti128_si256(v, 1));
+    }
+
+    return i;
+}
+
+PCM_CONV_SIMD(S8, sse2, SSE2_TARGET, 1, 8, 0, 1)
+PCM_CONV_SIMD(U8, sse2, SSE2_TARGET, 1, 8, 0, 0)
+PCM_CONV_SIMD(SB16, sse2, SSE2_TARGET, 2, 16, 1, 1)
+PCM_CONV_SIMD(SL16, sse2, SSE2_TARGET, 2, 16, 0, 1)
+PCM_CONV_SIMD(UB16, sse2, SSE2_TARGET, 2, 16, 1, 0)
+PCM_CONV_SIMD(UL16, sse2, SSE2_TARGET, 2, 16, 0, 0)
+PCM_CONV_SIMD(SB24, ssse3, SSSE3_TARGET, 3, 24, 1, 1)
+PCM_CONV_SIMD(SL24, ssse3, SSSE3_TARGET, 3, 24, 0, 1)
+PCM_CONV_SIMD(UB24, ssse3, SSSE3_TARGET, 3, 24, 1, 0)
+PCM_CONV_SIMD(UL24, ssse3, SSSE3_TARGET, 3, 24, 0, 0)
+PCM_CONV_SIMD(SB16, avx2, AVX2_TARGET, 2, 16, 1, 1)
+PCM_CONV_SIMD(SL16, avx2, AVX2_TARGET, 2, 16, 0, 1)
+PCM_CONV_SIMD(UB16, avx2, AVX2_TARGET, 2, 16, 1, 0)
+PCM_CONV_SIMD(UL16, avx2, AVX2_TARGET, 2, 16, 0, 0)
+PCM_CONV_SIMD(SB24, avx2, AVX2_TARGET, 3, 24, 1, 1)
+PCM_CONV_SIMD(SL24, avx2, AVX2_TARGET, 3, 24, 0, 1)
+PCM_CONV_SIMD(UB24, avx2, AVX2_TARGET, 3, 24, 1, 0)
+PCM_CONV_SIMD(UL24, avx2, AVX2_TARGET, 3, 24, 0, 0)
+
+/*the converters for each instruction set, indexed by pcm_conv_isa_t,
+  where a set with nothing better for a format repeats the one before it*/
+#define PCM_CONV_ISAS(scalar, sse2, ssse3, avx2) {scalar, sse2, ssse3, avx2}
+#else
+#define PCM_CONV_ISAS(scalar, sse2, ssse3, avx2) {scalar}
+#endif
+
+static const pcm_to_int_f pcm_S8_to_int_isas[] =
+    PCM_CONV_ISAS(pcm_S8_to_int,
+                  pcm_S8_to_int_sse2,
+                  pcm_S8_to_int_sse2,
+                  pcm_S8_to_int_sse2);
+
+static const int_to_pcm_f int_to_S8_pcm_isas[] =
+    PCM_CONV_ISAS(int_to_S8_pcm,
+                  int_to_S8_pcm_sse2,
+                  int_to_S8_pcm_sse2,
+                  int_to_S8_pcm_sse2);
+
+static const pcm_to_int_f pcm_U8_to_int_isas[] =
+    PCM_CONV_ISAS(pcm_U8_to_int,
+                  pcm_U8_to_int_sse2,
+                  pcm_U8_to_int_sse2,
+                  pcm_U8_to_int_sse2);
+
+static const int_to_pcm_f int_to_U8_pcm_isas[] =
+    PCM_CONV_ISAS(int_to_U8_pcm,
+                  int_to_U8_pcm_sse2,
+                  int_to_U8_pcm_sse2,
+                  int_to_U8_pcm_sse2);
+
+static const pcm_to_int_f pcm_SB16_to_int_isas[] =
+    PCM_CONV_ISAS(pcm_SB16_to_int,
+                  pcm_SB16_to_int_sse2,
+                  pcm_SB16_to_int_sse2,
+                  pcm_SB16_to_int_avx2);
+
+static const int_to_pcm_f int_to_SB16_pcm_isas[] =
+    PCM_CONV_ISAS(int_to_SB16_pcm,
+                  int_to_SB16_pcm_sse2,
+                  int_to_SB16_pcm_sse2,
+                  int_to_SB16_pcm_avx2);
+
+static const pcm_to_int_f pcm_SL16_to_int_isas[] =
+    PCM_CONV_ISAS(pcm_SL16_to_int,
+                  pcm_SL16_to_int_sse2,
+                  pcm_SL16_to_int_sse2,
+                  pcm_SL16_to_int_avx2);
+
+static const int_to_pcm_f int_to_SL16_pcm_isas[] =
+    PCM_CONV_ISAS(int_to_SL16_pcm,
+                  int_to_SL16_pcm_sse2,
+                  int_to_SL16_pcm_sse2,
+                  int_to_SL16_pcm_avx2);
+
+static const pcm_to_int_f pcm_UB16_to_int_isas[] =
+    PCM_CONV_ISAS(pcm_UB16_to_int,
+                  pcm_UB16_to_int_sse2,
+                  pcm_UB16_to_int_sse2,
+                  pcm_UB16_to_int_avx2);
+
+static const int_to_pcm_f int_to_UB16_pcm_isas[] =
+    PCM_CONV_ISAS(int_to_UB16_pcm,
+                  int_to_UB16_pcm_sse2,
+                  int_to_UB16_pcm_sse2,
+                  int_to_UB16_pcm_avx2);
+
+static const pcm_to_int_f pcm_UL16_to_int_isas[] =
+    PCM_CONV_ISAS(pcm_UL16_to_int,
+                  pcm_UL16_to_int_sse2,
+                  pcm_UL16_to_int_sse2,
+                  pcm_UL16_to_int_avx2);
+
+static const int_to_pcm_f int_to_UL16_pcm_isas[] =
+    PCM_CONV_ISAS(int_to_UL16_pcm,
+                  int_to_UL16_pcm_sse2,
+                  int_to_UL16_pcm_sse2,
+                  int_to_UL16_pcm_avx2);
+
+static const pcm_to_int_f pcm_SB24_to_int_isas[] =
+    PCM_CONV_ISAS(pcm_SB24_to_int,
+                  pcm_SB24_to_int,
+                  pcm_SB24_to_int_ssse3,
+                  pcm_SB24_to_int_avx2);
+
+static const int_to_pcm_f int_to_SB24_pcm_isas[] =
+    PCM_CONV_ISAS(int_to_SB24_pcm,
+                  int_to_SB24_pcm,
+                  int_to_SB24_pcm_ssse3,
+                  int_to_SB24_pcm_avx2);
+
+static const pcm_to_int_f pcm_SL24_to_int_isas[] =
+    PCM_CONV_ISAS(pcm_SL24_to_int,
+                  pcm_SL24_to_int,
+                  pcm_SL24_to_int_ssse3,
+                  pcm_SL24_to_int_avx2);
+
+static const int_to_pcm_f int_to_SL24_pcm_isas[] =
+    PCM_CONV_ISAS(int_to_SL24_pcm,
+                  int_to_SL24_pcm,
+                  int_to_SL24_pcm_ssse3,
+                  int_to_SL24_pcm_avx2);
+
+static const pcm_to_int_f pcm_UB24_to_int_isas[] =
+    PCM_CONV_ISAS(pcm_UB24_to_int,
+                  pcm_UB24_to_int,
+                  pcm_UB24_to_int_ssse3,
+                  pcm_UB24_to_int_avx2);
+
+static const int_to_pcm_f int_to_UB24_pcm_isas[] =
+    PCM_CONV_ISAS(int_to_UB24_pcm,
+                  int_to_UB24_pcm,
+                  int_to_UB24_pcm_ssse3,
+                  int_to_UB24_pcm_avx2);
+
+static const pcm_to_int_f pcm_UL24_to_int_isas[] =
+    PCM_CONV_ISAS(pcm_UL24_to_int,
+                  pcm_UL24_to_int,
+                  pcm_UL24_to_int_ssse3,
+                  pcm_UL24_to_int_avx2);
+
+static const int_to_pcm_f int_to_UL24_pcm_isas[] =
+    PCM_CONV_ISAS(int_to_UL24_pcm,
+                  int_to_UL24_pcm,
+                  int_to_UL24_pcm_ssse3,
+                  int_to_UL24_pcm_avx2);
+
+/*-1 until the instruction set in use has been chosen*/
+static int pcm_conv_isa = -1;
+
+static pcm_conv_isa_t
+current_isa(void);
+
 /***********************************
  * public function implementations *
  ***********************************/
@@ -88,24 +643,34 @@ pcm_to_int_converter(unsigned bits_per_sample,
                      int is_big_endian,
                      int is_signed)
 {
+    const pcm_conv_isa_t isa = current_isa();
+
     switch (bits_per_sample) {
     case 8:
         if (is_signed) {
-            return pcm_S8_to_int;
+            return pcm_S8_to_int_isas[isa];
         } else {
-            return pcm_U8_to_int;
+            return pcm_U8_to_int_isas[isa];
         }
     case 16:
         if (is_signed) {
-            return is_big_endian ? pcm_SB16_to_int : pcm_SL16_to_int;
+            return (is_big_endian ?
+                    pcm_SB16_to_int_isas[isa] :
+                    pcm_SL16_to_int_isas[isa]);
         } else {
-            return is_big_endian ? pcm_UB16_to_int : pcm_UL16_to_int;
+            return (is_big_endian ?
+                    pcm_UB16_to_int_isas[isa] :
+                    pcm_UL16_to_int_isas[isa]);
         }
     case 24:
         if (is_signed) {
-            return is_big_endian ? pcm_SB24_to_int : pcm_SL24_to_int;
+            return (is_big_endian ?
+                    pcm_SB24_to_int_isas[isa] :
+                    pcm_SL24_to_int_isas[isa]);
         } else {
-            return is_big_endian ? pcm_UB24_to_int : pcm_UL24_to_int;
+            return (is_big_endian ?
+                    pcm_UB24_to_int_isas[isa] :
+                    pcm_UL24_to_int_isas[isa]);
         }
     default:
         return NULL;
@@ -117,24 +682,34 @@ int_to_pcm_converter(unsigned bits_per_sample,
                      int is_big_endian,
                      int is_signed)
 {
+    const pcm_conv_isa_t isa = current_isa();
+
     switch (bits_per_sample) {
     case 8:
         if (is_signed) {
-            return int_to_S8_pcm;
+            return int_to_S8_pcm_isas[isa];
         } else {
-            return int_to_U8_pcm;
+            return int_to_U8_pcm_isas[isa];
         }
     case 16:
         if (is_signed) {
-            return is_big_endian ? int_to_SB16_pcm : int_to_SL16_pcm;
+            return (is_big_endian ?
+                    int_to_SB16_pcm_isas[isa] :
+                    int_to_SL16_pcm_isas[isa]);
         } else {
-            return is_big_endian ? int_to_UB16_pcm : int_to_UL16_pcm;
+            return (is_big_endian ?
+                    int_to_UB16_pcm_isas[isa] :
+                    int_to_UL16_pcm_isas[isa]);
         }
     case 24:
         if (is_signed) {
-            return is_big_endian ? int_to_SB24_pcm : int_to_SL24_pcm;
+            return (is_big_endian ?
+                    int_to_SB24_pcm_isas[isa] :
+                    int_to_SL24_pcm_isas[isa]);
         } else {
-            return is_big_endian ? int_to_UB24_pcm : int_to_UL24_pcm;
+            return (is_big_endian ?
+                    int_to_UB24_pcm_isas[isa] :
+                    int_to_UL24_pcm_isas[isa]);
         }
     default:
         return NULL;
@@ -201,10 +776,58 @@ float_to_int_converter(unsigned bits_per_sample)
     }
 }
 
+pcm_conv_isa_t
+pcm_conv_best_isa(void)
+{
+#ifdef PCM_CONV_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return PCM_CONV_AVX2;
+    } else if (__builtin_cpu_supports("ssse3")) {
+        return PCM_CONV_SSSE3;
+    } else {
+        return PCM_CONV_SSE2;
+    }
+#else
+    return PCM_CONV_SCALAR;
+#endif
+}
+
+void
+pcm_conv_set_isa(pcm_conv_isa_t isa)
+{
+    pcm_conv_isa = MIN(isa, pcm_conv_best_isa());
+}
+
+const char*
+pcm_conv_isa_name(pcm_conv_isa_t isa)
+{
+    switch (isa) {
+    case PCM_CONV_SCALAR:
+    default:
+        return "scalar";
+    case PCM_CONV_SSE2:
+        return "sse2";
+    case PCM_CONV_SSSE3:
+        return "ssse3";
+    case PCM_CONV_AVX2:
+        return "avx2";
+    }
+}
+
 /************************************
  * private function implementations *
  ************************************/
 
+static pcm_conv_isa_t
+current_isa(void)
+{
+    if (pcm_conv_isa < 0) {
+        pcm_conv_isa = pcm_conv_best_isa();
+    }
+    return (pcm_conv_isa_t)pcm_conv_isa;
+}
+
 static void
 pcm_S8_to_int(unsigned total_samples,
               const unsigned char pcm_samples[],
@@ -98,4 +98,31 @@ typedef void (*float_to_int_f)(unsigned total_samples,
 float_to_int_f
 float_to_int_converter(unsigned bits_per_sample);
 
+
+/*the instruction sets the PCM byte converters may use, in order*/
+typedef enum {
+    PCM_CONV_SCALAR,
+    PCM_CONV_SSE2,
+    PCM_CONV_SSSE3,
+    PCM_CONV_AVX2
+} pcm_conv_isa_t;
+
+/*returns the best instruction set supported by the running CPU
+  which is what pcm_to_int_converter() and int_to_pcm_converter()
+  choose from by default*/
+pcm_conv_isa_t
+pcm_conv_best_isa(void);
+
+/*restricts the converters returned afterward by
+  pcm_to_int_converter() and int_to_pcm_converter()
+  to the given instruction set, or the best available if that's lower
+
+  this is meant for testing each set's converters against the others*/
+void
+pcm_conv_set_isa(pcm_conv_isa_t isa);
+
+/*returns a constant name such as "sse2" for the given instruction set*/
+const char*
+pcm_conv_isa_name(pcm_conv_isa_t isa);
+
 #endif
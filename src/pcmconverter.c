@@ -5,8 +5,13 @@
 #include "pcm_conv.h"
 #include "bitstream.h"
 #include "samplerate/samplerate.h"
+#include "polyphase.h"
 #include "pcmconverter.h"
 #include "dither.c"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
 
 /********************************************************
  Audio Tools, a module and set of tools for manipulating audio data
@@ -48,6 +53,31 @@ fade_samples(int samples[], unsigned channels, unsigned index, unsigned total)
     }
 }
 
+/*returns a FrameList of up to one block of PCM frames
+  read from the given pcm_source, or NULL on error*/
+static PyObject*
+read_framelist(PyObject *self,
+               const struct pcm_source *source,
+               PyObject *audiotools_pcm,
+               unsigned channels,
+               unsigned bits_per_sample)
+{
+    pcm_FrameList *framelist = new_FrameList(audiotools_pcm,
+                                             channels,
+                                             bits_per_sample,
+                                             source->block_size(self));
+    unsigned frames_read;
+
+    if (source->read(self, framelist->samples, &frames_read)) {
+        Py_DECREF((PyObject*)framelist);
+        return NULL;
+    }
+
+    framelist->frames = frames_read;
+
+    return (PyObject*)framelist;
+}
+
 /*******************************************************
  Averager for reducing channel count from many to 1
 *******************************************************/
@@ -113,38 +143,62 @@ Averager_channel_mask(pcmconverter_Averager *self, void *closure)
     return Py_BuildValue("i", 0x4);
 }
 
-static PyObject*
-Averager_read(pcmconverter_Averager *self, PyObject *args)
+static unsigned
+Averager_pcm_block_size(PyObject *obj)
 {
+    return CHUNK_SIZE;
+}
+
+static int
+Averager_pcm_read(PyObject *obj, int *output, unsigned *pcm_frames)
+{
+    pcmconverter_Averager *self = (pcmconverter_Averager*)obj;
     const unsigned channel_count = self->pcmreader->channels;
     int pcm_data[CHUNK_SIZE * channel_count];
     const unsigned frames_read = self->pcmreader->read(self->pcmreader,
                                                        CHUNK_SIZE,
                                                        pcm_data);
-    pcm_FrameList *framelist;
     unsigned i;
 
     if (!frames_read && (self->pcmreader->status != PCM_OK)) {
         /*some read error occurred*/
-        return NULL;
+        return 1;
     }
 
-    framelist = new_FrameList(self->audiotools_pcm,
-                              1,
-                              self->pcmreader->bits_per_sample,
-                              frames_read);
-
     for (i = 0; i < frames_read; i++) {
         int64_t accumulator = 0;
         unsigned c;
         for (c = 0; c < channel_count; c++) {
             accumulator += get_sample(pcm_data, c, channel_count, i);
         }
-        put_sample(framelist->samples, 0, 1, i,
-                   (int)(accumulator / channel_count));
+        put_sample(output, 0, 1, i, (int)(accumulator / channel_count));
     }
 
-    return (PyObject*)framelist;
+    *pcm_frames = frames_read;
+    return 0;
+}
+
+static const struct pcm_source Averager_source = {
+    Averager_pcm_block_size,
+    Averager_pcm_read
+};
+
+static PyObject*
+Averager_pcm_source(pcmconverter_Averager *self, void *closure)
+{
+    return pcm_source_capsule((PyObject*)self,
+                              &pcmconverter_AveragerType,
+                              &Averager_source);
+}
+
+static PyObject*
+Averager_read(pcmconverter_Averager *self, PyObject *args)
+{
+    return read_framelist((PyObject*)self,
+                          &Averager_source,
+                          self->audiotools_pcm,
+                          1,
+                          self->pcmreader->bits_per_sample);
 }
 
 static PyObject*
@@ -220,9 +274,16 @@ Downmixer_channel_mask(pcmconverter_Downmixer *self, void *closure)
     return Py_BuildValue("I", 0x3);
 }
 
-static PyObject*
-Downmixer_read(pcmconverter_Downmixer *self, PyObject *args)
+static unsigned
+Downmixer_pcm_block_size(PyObject *obj)
 {
+    return CHUNK_SIZE;
+}
+
+static int
+Downmixer_pcm_read(PyObject *obj, int *output, unsigned *pcm_frames)
+{
+    pcmconverter_Downmixer *self = (pcmconverter_Downmixer*)obj;
     const double REAR_GAIN = 0.6;
     const double CENTER_GAIN = 0.7;
     const int SAMPLE_MIN = -(1 << (self->pcmreader->bits_per_sample - 1));
@@ -233,7 +294,6 @@ Downmixer_read(pcmconverter_Downmixer *self, PyObject *args)
     const unsigned frames_read = self->pcmreader->read(self->pcmreader,
                                                        CHUNK_SIZE,
                                                        pcm_data);
-    pcm_FrameList *framelist;
     unsigned input_channel = 0;
     unsigned output_channel = 0;
     unsigned i;
@@ -246,14 +306,9 @@ Downmixer_read(pcmconverter_Downmixer *self, PyObject *args)
     int *six_channels[] = {fL, fR, fC, LFE, bL, bR};
 
     if (!frames_read && (self->pcmreader->status != PCM_OK)) {
-        return NULL;
+        return 1;
     }
 
-    framelist = new_FrameList(self->audiotools_pcm,
-                              2,
-                              self->pcmreader->bits_per_sample,
-                              frames_read);
-
     /*ensure PCMReader's channel mask is defined*/
     if (self->pcmreader->channel_mask != 0) {
         input_mask = self->pcmreader->channel_mask;
@@ -303,13 +358,37 @@ Downmixer_read(pcmconverter_Downmixer *self, PyObject *args)
         const long int right_i =
             lround(fR[i] - REAR_GAIN * mono_rear + CENTER_GAIN * fC[i]);
 
-        put_sample(framelist->samples, 0, 2, i,
+        put_sample(output, 0, 2, i,
                    (int)(MAX(MIN(left_i, SAMPLE_MAX), SAMPLE_MIN)));
-        put_sample(framelist->samples, 1, 2, i,
+        put_sample(output, 1, 2, i,
                    (int)(MAX(MIN(right_i, SAMPLE_MAX), SAMPLE_MIN)));
     }
 
-    return (PyObject*)framelist;
+    *pcm_frames = frames_read;
+    return 0;
+}
+
+static const struct pcm_source Downmixer_source = {
+    Downmixer_pcm_block_size,
+    Downmixer_pcm_read
+};
+
+static PyObject*
+Downmixer_pcm_source(pcmconverter_Downmixer *self, void *closure)
+{
+    return pcm_source_capsule((PyObject*)self,
+                              &pcmconverter_DownmixerType,
+                              &Downmixer_source);
+}
+
+static PyObject*
+Downmixer_read(pcmconverter_Downmixer *self, PyObject *args)
+{
+    return read_framelist((PyObject*)self,
+                          &Downmixer_source,
+                          self->audiotools_pcm,
+                          2,
+                          self->pcmreader->bits_per_sample);
 }
 
 static PyObject*
@@ -402,9 +481,17 @@ Resampler_dealloc(pcmconverter_Resampler *self)
     Py_TYPE(self)->tp_free((PyObject*)self);
 }
 
-static PyObject*
-Resampler_read(pcmconverter_Resampler *self, PyObject *args)
+static unsigned
+Resampler_pcm_block_size(PyObject *obj)
+{
+    return RESAMPLER_BLOCK_SIZE;
+}
+
+static int
+Resampler_pcm_read(PyObject *obj, int *output, unsigned *pcm_frames)
 {
+    pcmconverter_Resampler *self = (pcmconverter_Resampler*)obj;
+
     /*get data from PCMReader*/
     const unsigned channels = self->pcmreader->channels;
     const unsigned bits_per_sample = self->pcmreader->bits_per_sample;
@@ -415,10 +502,9 @@ Resampler_read(pcmconverter_Resampler *self, PyObject *args)
             (unsigned)(RESAMPLER_BLOCK_SIZE - self->src_data.input_frames),
             pcm_data);
     int process_result;
-    pcm_FrameList *framelist;
 
     if (!frames_read && (self->pcmreader->status != PCM_OK)) {
-        return NULL;
+        return 1;
     }
 
     /*convert data to floats and append them to input buffer*/
@@ -434,7 +520,7 @@ Resampler_read(pcmconverter_Resampler *self, PyObject *args)
     if ((process_result =
          src_process(self->src_state, &(self->src_data))) != 0) {
         PyErr_SetString(PyExc_ValueError, src_strerror(process_result));
-        return NULL;
+        return 1;
     }
 
     /*preserve any leftover input data*/
@@ -445,18 +531,37 @@ Resampler_read(pcmconverter_Resampler *self, PyObject *args)
              self->src_data.input_frames_used) * channels * sizeof(float));
     self->src_data.input_frames -= self->src_data.input_frames_used;
 
-    /*build FrameList from output data*/
-    framelist = new_FrameList(self->audiotools_pcm,
-                              channels,
-                              bits_per_sample,
-                              (unsigned)(self->src_data.output_frames_gen));
+    /*convert output data back to integers*/
+    *pcm_frames = (unsigned)(self->src_data.output_frames_gen);
     float_to_int_converter(
-        bits_per_sample)(FrameList_samples_length(framelist),
+        bits_per_sample)(*pcm_frames * channels,
                          self->src_data.data_out,
-                         framelist->samples);
+                         output);
 
-    /*return built FrameList*/
-    return (PyObject*)framelist;
+    return 0;
+}
+
+static const struct pcm_source Resampler_source = {
+    Resampler_pcm_block_size,
+    Resampler_pcm_read
+};
+
+static PyObject*
+Resampler_pcm_source(pcmconverter_Resampler *self, void *closure)
+{
+    return pcm_source_capsule((PyObject*)self,
+                              &pcmconverter_ResamplerType,
+                              &Resampler_source);
+}
+
+static PyObject*
+Resampler_read(pcmconverter_Resampler *self, PyObject *args)
+{
+    return read_framelist((PyObject*)self,
+                          &Resampler_source,
+                          self->audiotools_pcm,
+                          self->pcmreader->channels,
+                          self->pcmreader->bits_per_sample);
 }
 
 static PyObject*
@@ -495,16 +600,208 @@ Resampler_channel_mask(pcmconverter_Resampler *self, void *closure)
     return Py_BuildValue("i", channel_mask);
 }
 
+
+/*******************************************************
+ PolyphaseResampler for changing a PCMReader's sample rate
+ by a fixed ratio, such as 44100 to 48000
+*******************************************************/
+
+/*the amount of PCM frames to read from the source at once*/
+#define POLYPHASE_RESAMPLER_BLOCK_SIZE 4096
+
+static PyObject*
+PolyphaseResampler_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    pcmconverter_PolyphaseResampler *self;
+
+    self = (pcmconverter_PolyphaseResampler *)type->tp_alloc(type, 0);
+
+    return (PyObject *)self;
+}
+
+int
+PolyphaseResampler_init(pcmconverter_PolyphaseResampler *self,
+                        PyObject *args,
+                        PyObject *kwds)
+{
+    unsigned channels;
+
+    self->pcmreader = NULL;
+    self->resampler = NULL;
+    self->input = NULL;
+    self->output = NULL;
+    self->audiotools_pcm = NULL;
+
+    if (!PyArg_ParseTuple(args, "O&i",
+                          py_obj_to_pcmreader,
+                          &(self->pcmreader),
+                          &(self->sample_rate)))
+        return -1;
+
+    /*basic sanity checking*/
+    if (self->sample_rate <= 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "new sample rate must be positive");
+        return -1;
+    }
+
+    channels = self->pcmreader->channels;
+
+    /*build the filter bank for the two rates' ratio*/
+    if ((self->resampler =
+         polyphase_open(self->pcmreader->sample_rate,
+                        (unsigned)self->sample_rate,
+                        channels)) == NULL) {
+        PyErr_SetString(PyExc_ValueError,
+                        "unsupported sample rate ratio");
+        return -1;
+    }
+
+    /*flushing outputs no more than a full block does*/
+    self->block_size =
+        polyphase_max_output(self->resampler,
+                             MAX(POLYPHASE_RESAMPLER_BLOCK_SIZE,
+                                 self->resampler->taps));
+    self->input =
+        malloc(sizeof(float) * POLYPHASE_RESAMPLER_BLOCK_SIZE * channels);
+    self->output = malloc(sizeof(float) * self->block_size * channels);
+
+    if ((self->audiotools_pcm = open_audiotools_pcm()) == NULL)
+        return -1;
+
+    return 0;
+}
+
+void
+PolyphaseResampler_dealloc(pcmconverter_PolyphaseResampler *self)
+{
+    if (self->pcmreader)
+        self->pcmreader->del(self->pcmreader);
+    if (self->resampler)
+        polyphase_close(self->resampler);
+    free(self->input);
+    free(self->output);
+    Py_XDECREF(self->audiotools_pcm);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
 static unsigned
-read_os_random(void *user_data,
-               uint8_t* buffer,
-               unsigned buffer_size);
+PolyphaseResampler_pcm_block_size(PyObject *obj)
+{
+    pcmconverter_PolyphaseResampler *self =
+        (pcmconverter_PolyphaseResampler*)obj;
+
+    return self->block_size;
+}
 
 static int
-close_os_random(void *user_data);
+PolyphaseResampler_pcm_read(PyObject *obj, int *output, unsigned *pcm_frames)
+{
+    pcmconverter_PolyphaseResampler *self =
+        (pcmconverter_PolyphaseResampler*)obj;
+    const unsigned channels = self->pcmreader->channels;
+    const unsigned bits_per_sample = self->pcmreader->bits_per_sample;
+    int pcm_data[POLYPHASE_RESAMPLER_BLOCK_SIZE * channels];
+    unsigned frames = 0;
+
+    /*a block of input may not be enough to complete
+      an output frame when downsampling,
+      so keep reading until there's output or the stream ends*/
+    while (!frames && !self->resampler->flushed) {
+        const unsigned frames_read =
+            self->pcmreader->read(self->pcmreader,
+                                  POLYPHASE_RESAMPLER_BLOCK_SIZE,
+                                  pcm_data);
+
+        if (frames_read) {
+            int_to_float_converter(bits_per_sample)(frames_read * channels,
+                                                    pcm_data,
+                                                    self->input);
+            frames = polyphase_process(self->resampler,
+                                       self->input,
+                                       frames_read,
+                                       self->output);
+        } else if (self->pcmreader->status != PCM_OK) {
+            return 1;
+        } else {
+            frames = polyphase_flush(self->resampler, self->output);
+        }
+    }
 
-static void
-free_os_random(void *user_data);
+    /*convert output data back to integers*/
+    float_to_int_converter(bits_per_sample)(frames * channels,
+                                            self->output,
+                                            output);
+    *pcm_frames = frames;
+
+    return 0;
+}
+
+static const struct pcm_source PolyphaseResampler_source = {
+    PolyphaseResampler_pcm_block_size,
+    PolyphaseResampler_pcm_read
+};
+
+static PyObject*
+PolyphaseResampler_pcm_source(pcmconverter_PolyphaseResampler *self,
+                              void *closure)
+{
+    return pcm_source_capsule((PyObject*)self,
+                              &pcmconverter_PolyphaseResamplerType,
+                              &PolyphaseResampler_source);
+}
+
+static PyObject*
+PolyphaseResampler_read(pcmconverter_PolyphaseResampler *self,
+                        PyObject *args)
+{
+    return read_framelist((PyObject*)self,
+                          &PolyphaseResampler_source,
+                          self->audiotools_pcm,
+                          self->pcmreader->channels,
+                          self->pcmreader->bits_per_sample);
+}
+
+static PyObject*
+PolyphaseResampler_close(pcmconverter_PolyphaseResampler *self,
+                         PyObject *args)
+{
+    self->pcmreader->close(self->pcmreader);
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+static PyObject*
+PolyphaseResampler_sample_rate(pcmconverter_PolyphaseResampler *self,
+                               void *closure)
+{
+    const int sample_rate = self->sample_rate;
+    return Py_BuildValue("i", sample_rate);
+}
+
+static PyObject*
+PolyphaseResampler_bits_per_sample(pcmconverter_PolyphaseResampler *self,
+                                   void *closure)
+{
+    const int bits_per_sample = self->pcmreader->bits_per_sample;
+    return Py_BuildValue("i", bits_per_sample);
+}
+
+static PyObject*
+PolyphaseResampler_channels(pcmconverter_PolyphaseResampler *self,
+                            void *closure)
+{
+    const int channels = self->pcmreader->channels;
+    return Py_BuildValue("i", channels);
+}
+
+static PyObject*
+PolyphaseResampler_channel_mask(pcmconverter_PolyphaseResampler *self,
+                                void *closure)
+{
+    const int channel_mask = self->pcmreader->channel_mask;
+    return Py_BuildValue("i", channel_mask);
+}
 
 static PyObject*
 BPSConverter_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
@@ -521,8 +818,8 @@ BPSConverter_dealloc(pcmconverter_BPSConverter *self)
 {
     if (self->pcmreader != NULL)
         self->pcmreader->del(self->pcmreader);
-    if (self->white_noise != NULL)
-        self->white_noise->close(self->white_noise);
+    if (self->dither != NULL)
+        dither_close(self->dither);
     Py_XDECREF(self->audiotools_pcm);
 
     Py_TYPE(self)->tp_free((PyObject*)self);
@@ -532,14 +829,31 @@ int
 BPSConverter_init(pcmconverter_BPSConverter *self,
                   PyObject *args, PyObject *kwds)
 {
+    static char *kwlist[] = {"pcmreader",
+                             "bits_per_sample",
+                             "seed",
+                             "noise_shaping",
+                             NULL};
+    PyObject *seed_obj = Py_None;
+    PyObject *noise_shaping_obj = Py_False;
+    int noise_shaping;
+    unsigned PY_LONG_LONG seed;
+
     self->pcmreader = NULL;
-    self->white_noise = NULL;
+    self->dither = NULL;
     self->audiotools_pcm = NULL;
 
-    if (!PyArg_ParseTuple(args, "O&i",
-                          py_obj_to_pcmreader,
-                          &(self->pcmreader),
-                          &(self->bits_per_sample)))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&i|OO", kwlist,
+                                     py_obj_to_pcmreader,
+                                     &(self->pcmreader),
+                                     &(self->bits_per_sample),
+                                     &seed_obj,
+                                     &noise_shaping_obj))
+        return -1;
+
+    /*noise_shaping may be any object with a truth value,
+      since the "p" format unit isn't available in Python 2*/
+    if ((noise_shaping = PyObject_IsTrue(noise_shaping_obj)) == -1)
         return -1;
 
     /*ensure bits per sample is supported*/
@@ -557,8 +871,19 @@ BPSConverter_init(pcmconverter_BPSConverter *self,
     if ((self->audiotools_pcm = open_audiotools_pcm()) == NULL)
         return -1;
 
-    if ((self->white_noise = open_dither()) == NULL)
+    /*use the given seed for reproducible dither, if any*/
+    if (seed_obj == Py_None) {
+        uint64_t random_seed;
+        if (dither_random_seed(&random_seed))
+            return -1;
+        seed = random_seed;
+    } else if (!PyArg_Parse(seed_obj, "K", &seed)) {
         return -1;
+    }
+
+    self->dither = dither_open(self->pcmreader->channels,
+                               (uint64_t)seed,
+                               noise_shaping);
 
     return 0;
 }
@@ -587,54 +912,73 @@ BPSConverter_channel_mask(pcmconverter_BPSConverter *self, void *closure)
     return Py_BuildValue("i", self->pcmreader->channel_mask);
 }
 
-static PyObject*
-BPSConverter_read(pcmconverter_BPSConverter *self, PyObject *args)
+static unsigned
+BPSConverter_pcm_block_size(PyObject *obj)
 {
-    int shift = self->bits_per_sample - self->pcmreader->bits_per_sample;
+    return CHUNK_SIZE;
+}
 
-    /*read FrameList from PCMReader*/
-    pcm_FrameList *framelist = new_FrameList(
-        self->audiotools_pcm,
-        self->pcmreader->channels,
-        self->bits_per_sample,
-        CHUNK_SIZE);
+static int
+BPSConverter_pcm_read(PyObject *obj, int *output, unsigned *pcm_frames)
+{
+    pcmconverter_BPSConverter *self = (pcmconverter_BPSConverter*)obj;
+    int shift = self->bits_per_sample - self->pcmreader->bits_per_sample;
 
+    /*read samples from PCMReader to be converted in place*/
     const unsigned frames_read =
         self->pcmreader->read(self->pcmreader,
                               CHUNK_SIZE,
-                              framelist->samples);
+                              output);
+    const unsigned samples_length = frames_read * self->pcmreader->channels;
 
     unsigned i;
 
     if (!frames_read && (self->pcmreader->status != PCM_OK)) {
-        Py_DECREF((PyObject*)framelist);
-        return NULL;
+        return 1;
     }
 
-    framelist->frames = frames_read;
-
     if (shift > 0) {
         /*going from fewer bits-per-sample to more, like 16 to 24 bps
           so perform left shift on each sample*/
-        const unsigned samples_length = FrameList_samples_length(framelist);
         for (i = 0; i < samples_length; i++) {
-            framelist->samples[i] <<= shift;
+            output[i] <<= shift;
         }
     } else if (shift < 0) {
         /*going from more bits-per-sample to fewer, like 24bps to 16
-          so perform right shift on each sample and add dither*/
-        const unsigned samples_length = FrameList_samples_length(framelist);
-        BitstreamReader *white_noise = self->white_noise;
-        br_read_f read = white_noise->read;
-
-        shift = abs(shift);
-        for (i = 0; i < samples_length; i++) {
-            framelist->samples[i] >>= shift;
-            framelist->samples[i] |= read(white_noise, 1);
-        }
+          so requantize each sample with dither*/
+        dither_requantize(self->dither,
+                          output,
+                          samples_length,
+                          (unsigned)(-shift),
+                          -(1 << (self->bits_per_sample - 1)),
+                          (1 << (self->bits_per_sample - 1)) - 1);
     }
 
-    return (PyObject*)framelist;
+    *pcm_frames = frames_read;
+    return 0;
+}
+
+static const struct pcm_source BPSConverter_source = {
+    BPSConverter_pcm_block_size,
+    BPSConverter_pcm_read
+};
+
+static PyObject*
+BPSConverter_pcm_source(pcmconverter_BPSConverter *self, void *closure)
+{
+    return pcm_source_capsule((PyObject*)self,
+                              &pcmconverter_BPSConverterType,
+                              &BPSConverter_source);
+}
+
+static PyObject*
+BPSConverter_read(pcmconverter_BPSConverter *self, PyObject *args)
+{
+    return read_framelist((PyObject*)self,
+                          &BPSConverter_source,
+                          self->audiotools_pcm,
+                          self->pcmreader->channels,
+                          self->bits_per_sample);
 }
 
 static PyObject*
@@ -1082,6 +1426,522 @@ FadeOutReader_close(pcmconverter_FadeOutReader *self, PyObject *args)
     return Py_None;
 }
 
+/*******************************************************
+ PCM stream comparison
+*******************************************************/
+
+/*the number of PCM frames read from each stream at a time*/
+#define CMP_BLOCK_SIZE 65536
+
+/*the number of samples compared at once when finding a mismatch*/
+#define CMP_SPAN_SIZE 64
+
+/*given two sample buffers of "count" samples known to differ,
+  returns the index of the first differing sample*/
+static unsigned
+first_mismatch(const int *samples1, const int *samples2, unsigned count)
+{
+    unsigned i = 0;
+
+    /*skip spans which match in their entirety*/
+    while (((count - i) >= CMP_SPAN_SIZE) &&
+           !memcmp(samples1 + i, samples2 + i, CMP_SPAN_SIZE * sizeof(int))) {
+        i += CMP_SPAN_SIZE;
+    }
+
+    /*then locate the sample within the final span*/
+    while ((i < count) && (samples1[i] == samples2[i])) {
+        i++;
+    }
+
+    return i;
+}
+
+/*fills "buffer" with up to "pcm_frames" PCM frames from "reader"
+  and places the number of frames read in "frames"
+
+  returns 0 on success or 1 with an exception set if an error occurs*/
+static int
+read_pcm_block(struct PCMReader *reader,
+               unsigned pcm_frames,
+               int *buffer,
+               unsigned *frames)
+{
+    *frames = reader->read(reader, pcm_frames, buffer);
+    switch (reader->status) {
+    case PCM_OK:
+        return 0;
+    case PCM_NON_FRAMELIST:
+        if (!PyErr_Occurred()) {
+            PyErr_SetString(PyExc_TypeError,
+                            "PCMReader's read() must return FrameList");
+        }
+        return 1;
+    case PCM_INVALID_FRAMELIST:
+        if (!PyErr_Occurred()) {
+            PyErr_SetString(PyExc_ValueError,
+                            "FrameList does not match PCMReader's "
+                            "channels or bits-per-sample");
+        }
+        return 1;
+    case PCM_READ_ERROR:
+    default:
+        if (!PyErr_Occurred()) {
+            PyErr_SetString(PyExc_IOError, "I/O error reading PCM stream");
+        }
+        return 1;
+    }
+}
+
+static PyObject*
+pcmconverter_pcm_frame_cmp(PyObject *dummy, PyObject *args)
+{
+    PyObject *pcmreader1_obj;
+    PyObject *pcmreader2_obj;
+    struct PCMReader *reader1 = NULL;
+    struct PCMReader *reader2 = NULL;
+    int *buffer1 = NULL;
+    int *buffer2 = NULL;
+    unsigned channels;
+    /*the frames remaining in each buffer and the offset of the first*/
+    unsigned remaining1 = 0;
+    unsigned remaining2 = 0;
+    unsigned start1 = 0;
+    unsigned start2 = 0;
+    uint64_t frame_number = 0;
+    PyObject *result = NULL;
+
+    if (!PyArg_ParseTuple(args, "OO", &pcmreader1_obj, &pcmreader2_obj))
+        return NULL;
+
+    if ((reader1 = pcmreader_open_python(pcmreader1_obj)) == NULL)
+        goto error;
+    if ((reader2 = pcmreader_open_python(pcmreader2_obj)) == NULL)
+        goto error;
+
+    if ((reader1->channels != reader2->channels) ||
+        (reader1->bits_per_sample != reader2->bits_per_sample)) {
+        PyErr_SetString(PyExc_ValueError,
+                        "PCMReaders must have the same channels "
+                        "and bits-per-sample");
+        goto error;
+    }
+
+    if ((channels = reader1->channels) == 0) {
+        PyErr_SetString(PyExc_ValueError, "channels must be > 0");
+        goto error;
+    }
+
+    buffer1 = malloc(CMP_BLOCK_SIZE * channels * sizeof(int));
+    buffer2 = malloc(CMP_BLOCK_SIZE * channels * sizeof(int));
+
+    for (;;) {
+        unsigned to_compare;
+        const int *samples1;
+        const int *samples2;
+
+        /*refill whichever buffer has been exhausted
+          since the streams may return differently-sized blocks*/
+        if (remaining1 == 0) {
+            if (read_pcm_block(reader1, CMP_BLOCK_SIZE, buffer1, &remaining1))
+                goto error;
+            start1 = 0;
+        }
+        if (remaining2 == 0) {
+            if (read_pcm_block(reader2, CMP_BLOCK_SIZE, buffer2, &remaining2))
+                goto error;
+            start2 = 0;
+        }
+
+        if ((remaining1 == 0) || (remaining2 == 0)) {
+            break;
+        }
+
+        to_compare = MIN(remaining1, remaining2);
+        samples1 = buffer1 + (start1 * channels);
+        samples2 = buffer2 + (start2 * channels);
+
+        if (memcmp(samples1,
+                   samples2,
+                   to_compare * channels * sizeof(int))) {
+            const unsigned mismatch =
+                first_mismatch(samples1, samples2, to_compare * channels);
+            result = Py_BuildValue("K",
+                                   (unsigned long long)(frame_number +
+                                                        mismatch / channels));
+            goto done;
+        }
+
+        frame_number += to_compare;
+        start1 += to_compare;
+        start2 += to_compare;
+        remaining1 -= to_compare;
+        remaining2 -= to_compare;
+    }
+
+    if ((remaining1 == 0) && (remaining2 == 0)) {
+        /*both streams ended together with no mismatch*/
+        Py_INCREF(Py_None);
+        result = Py_None;
+    } else {
+        /*one stream is longer than the other*/
+        result = Py_BuildValue("K", (unsigned long long)frame_number);
+    }
+
+done:
+    free(buffer1);
+    free(buffer2);
+    reader1->del(reader1);
+    reader2->del(reader2);
+    return result;
+
+error:
+    free(buffer1);
+    free(buffer2);
+    if (reader1)
+        reader1->del(reader1);
+    if (reader2)
+        reader2->del(reader2);
+    return NULL;
+}
+
+/*******************************************************
+ PCM stream splitting
+*******************************************************/
+
+/*the most PCM frames read from the stream at a time*/
+#define SPLIT_BLOCK_SIZE 4096
+
+/*the end of a span which runs to the end of the stream*/
+#define SPLIT_UNBOUNDED UINT64_MAX
+
+struct split_output {
+    int fd;
+
+    /*the span of the stream's PCM frames written to "fd"*/
+    uint64_t pcm_frames_start;
+    uint64_t pcm_frames_end;
+
+    /*bytes read from the stream but not yet written to "fd"*/
+    uint8_t *pending;
+    size_t pending_start;
+    size_t pending_size;
+    size_t pending_capacity;
+
+    /*nonzero once the whole span has been read from the stream*/
+    int complete;
+
+    /*nonzero until "fd" is closed*/
+    int open;
+};
+
+/*appends "size" bytes from "data" to the output's pending bytes
+
+  bytes already written are only reclaimed from the front of the buffer
+  once they take up more than half of it,
+  so each pending byte is moved at most a constant number of times*/
+static void
+split_output_append(struct split_output *output,
+                    const uint8_t *data,
+                    size_t size)
+{
+    if (output->pending_size == 0) {
+        output->pending_start = 0;
+    } else if (((output->pending_start + output->pending_size + size) >
+                output->pending_capacity) &&
+               (output->pending_start > (output->pending_capacity / 2))) {
+        memmove(output->pending,
+                output->pending + output->pending_start,
+                output->pending_size);
+        output->pending_start = 0;
+    }
+    if ((output->pending_start + output->pending_size + size) >
+        output->pending_capacity) {
+        output->pending_capacity =
+            MAX(output->pending_capacity * 2,
+                output->pending_start + output->pending_size + size);
+        output->pending = realloc(output->pending,
+                                  output->pending_capacity);
+    }
+    memcpy(output->pending + output->pending_start + output->pending_size,
+           data,
+           size);
+    output->pending_size += size;
+}
+
+/*writes as many pending bytes to each output as its pipe will take
+  without blocking, and closes outputs which are complete
+
+  an output whose reader has gone away has its pending bytes discarded
+
+  returns 0 on success, or 1 with errno set if a write fails*/
+static int
+flush_split_outputs(struct split_output *outputs,
+                    unsigned count,
+                    size_t *pending_total)
+{
+    unsigned i;
+
+    for (i = 0; i < count; i++) {
+        struct split_output *output = &outputs[i];
+
+        if (!output->open) {
+            continue;
+        }
+
+        while (output->pending_size > 0) {
+            const ssize_t written = write(output->fd,
+                                          output->pending +
+                                          output->pending_start,
+                                          output->pending_size);
+            if (written >= 0) {
+                output->pending_start += written;
+                output->pending_size -= written;
+                *pending_total -= written;
+            } else if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+                break;
+            } else if (errno == EINTR) {
+                continue;
+            } else if (errno == EPIPE) {
+                *pending_total -= output->pending_size;
+                output->pending_size = 0;
+                break;
+            } else {
+                return 1;
+            }
+        }
+
+        if (output->complete && (output->pending_size == 0)) {
+            close(output->fd);
+            output->open = 0;
+        }
+    }
+
+    return 0;
+}
+
+static PyObject*
+pcmconverter_split_pcm(PyObject *dummy, PyObject *args)
+{
+    PyObject *pcmreader_obj;
+    PyObject *outputs_obj;
+    Py_ssize_t buffer_size;
+    PyObject *outputs_seq = NULL;
+    struct split_output *outputs = NULL;
+    unsigned count = 0;
+    unsigned i;
+    struct PCMReader *reader = NULL;
+    int_to_pcm_f converter;
+    unsigned bytes_per_frame;
+    int *samples = NULL;
+    uint8_t *data = NULL;
+    /*the next PCM frame to be read from the stream*/
+    uint64_t position = 0;
+    size_t pending_total = 0;
+    int ended = 0;
+
+    if (!PyArg_ParseTuple(args, "OOn",
+                          &pcmreader_obj, &outputs_obj, &buffer_size))
+        return NULL;
+
+    if (buffer_size <= 0) {
+        PyErr_SetString(PyExc_ValueError, "buffer size must be > 0");
+        return NULL;
+    }
+
+    if ((outputs_seq = PySequence_Fast(outputs_obj,
+                                       "outputs must be a sequence")) == NULL)
+        return NULL;
+
+    count = (unsigned)PySequence_Fast_GET_SIZE(outputs_seq);
+    outputs = calloc(count ? count : 1, sizeof(struct split_output));
+
+    for (i = 0; i < count; i++) {
+        PyObject *item = PySequence_Fast_GET_ITEM(outputs_seq, i);
+        unsigned long long offset;
+        PyObject *pcm_frames;
+
+        if (!PyArg_ParseTuple(item, "iKO",
+                              &(outputs[i].fd), &offset, &pcm_frames)) {
+            count = i;
+            goto error;
+        }
+        outputs[i].open = 1;
+        outputs[i].pcm_frames_start = offset;
+        if (pcm_frames == Py_None) {
+            outputs[i].pcm_frames_end = SPLIT_UNBOUNDED;
+        } else {
+            const unsigned long long length =
+                PyLong_AsUnsignedLongLong(pcm_frames);
+            if (PyErr_Occurred()) {
+                count = i + 1;
+                goto error;
+            }
+            outputs[i].pcm_frames_end = offset + length;
+        }
+    }
+
+    /*writes must never block since any pipe may be full
+      while others are waiting for data*/
+    for (i = 0; i < count; i++) {
+        const int flags = fcntl(outputs[i].fd, F_GETFL);
+        if ((flags == -1) ||
+            (fcntl(outputs[i].fd, F_SETFL, flags | O_NONBLOCK) == -1)) {
+            PyErr_SetFromErrno(PyExc_OSError);
+            goto error;
+        }
+    }
+
+    if ((reader = pcmreader_open_python(pcmreader_obj)) == NULL)
+        goto error;
+
+    if (reader->channels == 0) {
+        PyErr_SetString(PyExc_ValueError, "channels must be > 0");
+        goto error;
+    }
+
+    switch (reader->bits_per_sample) {
+    case 8:
+    case 16:
+    case 24:
+        break;
+    default:
+        PyErr_SetString(PyExc_ValueError, "unsupported bits per sample");
+        goto error;
+    }
+
+    converter = int_to_pcm_converter(reader->bits_per_sample, 0, 1);
+    bytes_per_frame = reader->channels * (reader->bits_per_sample / 8);
+    samples = malloc(SPLIT_BLOCK_SIZE * reader->channels * sizeof(int));
+    data = malloc(SPLIT_BLOCK_SIZE * bytes_per_frame);
+
+    for (;;) {
+        /*the end of the furthest span not yet read in full, if any*/
+        uint64_t end = 0;
+        int incomplete = 0;
+
+        for (i = 0; i < count; i++) {
+            if (outputs[i].pcm_frames_end <= position) {
+                outputs[i].complete = 1;
+            } else if (ended && (outputs[i].pcm_frames_end ==
+                                 SPLIT_UNBOUNDED)) {
+                /*only spans with a length are padded with silence*/
+                outputs[i].complete = 1;
+            }
+            if (!outputs[i].complete) {
+                incomplete = 1;
+                end = MAX(end, outputs[i].pcm_frames_end);
+            }
+        }
+
+        if (flush_split_outputs(outputs, count, &pending_total)) {
+            PyErr_SetFromErrno(PyExc_IOError);
+            goto error;
+        }
+
+        if (incomplete && (pending_total < (size_t)buffer_size)) {
+            /*read the next block of the stream
+              and hand each output its part of it*/
+            const unsigned wanted =
+                (unsigned)MIN(end - position, SPLIT_BLOCK_SIZE);
+            unsigned frames;
+
+            if (!ended) {
+                if (read_pcm_block(reader, wanted, samples, &frames))
+                    goto error;
+                ended = (frames == 0);
+                if (ended)
+                    continue;
+            } else {
+                /*like PCMReaderHead, spans past the end of the stream
+                  are padded with silence to their full length*/
+                frames = wanted;
+                memset(samples, 0, frames * reader->channels * sizeof(int));
+            }
+
+            converter(frames * reader->channels, samples, data);
+
+            for (i = 0; i < count; i++) {
+                struct split_output *output = &outputs[i];
+                const uint64_t start =
+                    MAX(output->pcm_frames_start, position);
+                const uint64_t stop =
+                    MIN(output->pcm_frames_end, position + frames);
+
+                if (output->open && (start < stop)) {
+                    const size_t size =
+                        (size_t)(stop - start) * bytes_per_frame;
+                    split_output_append(
+                        output,
+                        data + (size_t)(start - position) * bytes_per_frame,
+                        size);
+                    pending_total += size;
+                }
+            }
+
+            position += frames;
+        } else if (pending_total > 0) {
+            /*wait for some reader to make room in its pipe*/
+            struct pollfd *fds = malloc(count * sizeof(struct pollfd));
+            nfds_t nfds = 0;
+            int result;
+
+            for (i = 0; i < count; i++) {
+                if (outputs[i].open && (outputs[i].pending_size > 0)) {
+                    fds[nfds].fd = outputs[i].fd;
+                    fds[nfds].events = POLLOUT;
+                    fds[nfds].revents = 0;
+                    nfds++;
+                }
+            }
+
+            Py_BEGIN_ALLOW_THREADS
+            result = poll(fds, nfds, -1);
+            Py_END_ALLOW_THREADS
+
+            free(fds);
+
+            if (result == -1) {
+                if (errno != EINTR) {
+                    PyErr_SetFromErrno(PyExc_IOError);
+                    goto error;
+                } else if (PyErr_CheckSignals()) {
+                    goto error;
+                }
+            }
+        } else if (!incomplete) {
+            /*every output has been read and written in full*/
+            break;
+        }
+    }
+
+    free(samples);
+    free(data);
+    reader->del(reader);
+    for (i = 0; i < count; i++) {
+        free(outputs[i].pending);
+    }
+    free(outputs);
+    Py_DECREF(outputs_seq);
+
+    Py_INCREF(Py_None);
+    return Py_None;
+
+error:
+    free(samples);
+    free(data);
+    if (reader)
+        reader->del(reader);
+    for (i = 0; i < count; i++) {
+        if (outputs[i].open) {
+            close(outputs[i].fd);
+        }
+        free(outputs[i].pending);
+    }
+    free(outputs);
+    Py_DECREF(outputs_seq);
+    return NULL;
+}
 
 MOD_INIT(pcmconverter)
 {
@@ -1102,6 +1962,10 @@ MOD_INIT(pcmconverter)
     if (PyType_Ready(&pcmconverter_ResamplerType) < 0)
         return MOD_ERROR_VAL;
 
+    pcmconverter_PolyphaseResamplerType.tp_new = PyType_GenericNew;
+    if (PyType_Ready(&pcmconverter_PolyphaseResamplerType) < 0)
+        return MOD_ERROR_VAL;
+
     pcmconverter_BPSConverterType.tp_new = PyType_GenericNew;
     if (PyType_Ready(&pcmconverter_BPSConverterType) < 0)
         return MOD_ERROR_VAL;
@@ -1130,6 +1994,10 @@ MOD_INIT(pcmconverter)
     PyModule_AddObject(m, "Resampler",
                        (PyObject *)&pcmconverter_ResamplerType);
 
+    Py_INCREF(&pcmconverter_PolyphaseResamplerType);
+    PyModule_AddObject(m, "PolyphaseResampler",
+                       (PyObject *)&pcmconverter_PolyphaseResamplerType);
+
     Py_INCREF(&pcmconverter_BPSConverterType);
     PyModule_AddObject(m, "BPSConverter",
                        (PyObject *)&pcmconverter_BPSConverterType);
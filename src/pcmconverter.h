@@ -17,7 +17,30 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 *******************************************************/
 
+static PyObject*
+pcmconverter_pcm_frame_cmp(PyObject *dummy, PyObject *args);
+
+static PyObject*
+pcmconverter_split_pcm(PyObject *dummy, PyObject *args);
+
 PyMethodDef module_methods[] = {
+    {"pcm_frame_cmp", (PyCFunction)pcmconverter_pcm_frame_cmp,
+     METH_VARARGS,
+     "pcm_frame_cmp(pcmreader1, pcmreader2) -> int or None\n"
+     "returns the PCM frame number of the first mismatch, or None\n"
+     "where both PCMReaders have the same channels and bits-per-sample\n"
+     "neither PCMReader is closed once comparison is completed"},
+    {"split_pcm", (PyCFunction)pcmconverter_split_pcm,
+     METH_VARARGS,
+     "split_pcm(pcmreader, [(fd, pcm_frames_offset, pcm_frames), ...],\n"
+     "          buffer_size) -> None\n"
+     "reads the PCMReader once, writing each span of PCM frames\n"
+     "to its pipe as signed, little-endian data\n"
+     "and closing the pipe once its span is written,\n"
+     "where spans may overlap and a pcm_frames of None\n"
+     "runs to the end of the stream\n"
+     "and at most about buffer_size bytes are held for full pipes\n"
+     "the PCMReader is not closed once splitting is completed"},
     {NULL}
 };
 
@@ -40,6 +63,9 @@ Averager_channels(pcmconverter_Averager *self, void *closure);
 static PyObject*
 Averager_channel_mask(pcmconverter_Averager *self, void *closure);
 
+static PyObject*
+Averager_pcm_source(pcmconverter_Averager *self, void *closure);
+
 static PyObject*
 Averager_read(pcmconverter_Averager *self, PyObject *args);
 
@@ -60,6 +86,7 @@ PyGetSetDef Averager_getseters[] = {
     {"bits_per_sample", (getter)Averager_bits_per_sample, NULL, "bits per sample", NULL},
     {"channels", (getter)Averager_channels, NULL, "channels", NULL},
     {"channel_mask", (getter)Averager_channel_mask, NULL, "channel_mask", NULL},
+    {"_pcm_source", (getter)Averager_pcm_source, NULL, "native PCM source", NULL},
     {NULL}
 };
 
@@ -130,6 +157,9 @@ Downmixer_channels(pcmconverter_Downmixer *self, void *closure);
 static PyObject*
 Downmixer_channel_mask(pcmconverter_Downmixer *self, void *closure);
 
+static PyObject*
+Downmixer_pcm_source(pcmconverter_Downmixer *self, void *closure);
+
 static PyObject*
 Downmixer_read(pcmconverter_Downmixer *self, PyObject *args);
 
@@ -150,6 +180,7 @@ PyGetSetDef Downmixer_getseters[] = {
     {"bits_per_sample", (getter)Downmixer_bits_per_sample, NULL, "bits per sample", NULL},
     {"channels", (getter)Downmixer_channels, NULL, "channels", NULL},
     {"channel_mask", (getter)Downmixer_channel_mask, NULL, "channel_mask", NULL},
+    {"_pcm_source", (getter)Downmixer_pcm_source, NULL, "native PCM source", NULL},
     {NULL}
 };
 
@@ -222,6 +253,9 @@ Resampler_channels(pcmconverter_Resampler *self, void *closure);
 static PyObject*
 Resampler_channel_mask(pcmconverter_Resampler *self, void *closure);
 
+static PyObject*
+Resampler_pcm_source(pcmconverter_Resampler *self, void *closure);
+
 static PyObject*
 Resampler_read(pcmconverter_Resampler *self, PyObject *args);
 
@@ -242,6 +276,7 @@ PyGetSetDef Resampler_getseters[] = {
     {"bits_per_sample", (getter)Resampler_bits_per_sample, NULL, "bits per sample", NULL},
     {"channels", (getter)Resampler_channels, NULL, "channels", NULL},
     {"channel_mask", (getter)Resampler_channel_mask, NULL, "channel_mask", NULL},
+    {"_pcm_source", (getter)Resampler_pcm_source, NULL, "native PCM source", NULL},
     {NULL}
 };
 
@@ -292,12 +327,124 @@ PyTypeObject pcmconverter_ResamplerType = {
     Resampler_new,             /* tp_new */
 };
 
+typedef struct {
+    PyObject_HEAD
+
+    struct PCMReader *pcmreader;
+    struct polyphase *resampler;     /*fixed-ratio filter bank state*/
+    int sample_rate;                 /*the output sample rate*/
+    unsigned block_size;             /*the most PCM frames output at once*/
+    float *input;                    /*input frames as floats*/
+    float *output;                   /*output frames as floats*/
+    PyObject* audiotools_pcm;
+} pcmconverter_PolyphaseResampler;
+
+static PyObject*
+PolyphaseResampler_sample_rate(pcmconverter_PolyphaseResampler *self,
+                               void *closure);
+
+static PyObject*
+PolyphaseResampler_bits_per_sample(pcmconverter_PolyphaseResampler *self,
+                                   void *closure);
+
+static PyObject*
+PolyphaseResampler_channels(pcmconverter_PolyphaseResampler *self,
+                            void *closure);
+
+static PyObject*
+PolyphaseResampler_channel_mask(pcmconverter_PolyphaseResampler *self,
+                                void *closure);
+
+static PyObject*
+PolyphaseResampler_pcm_source(pcmconverter_PolyphaseResampler *self,
+                              void *closure);
+
+static PyObject*
+PolyphaseResampler_read(pcmconverter_PolyphaseResampler *self,
+                        PyObject *args);
+
+static PyObject*
+PolyphaseResampler_close(pcmconverter_PolyphaseResampler *self,
+                         PyObject *args);
+
+static PyObject*
+PolyphaseResampler_new(PyTypeObject *type, PyObject *args, PyObject *kwds);
+
+int
+PolyphaseResampler_init(pcmconverter_PolyphaseResampler *self,
+                        PyObject *args,
+                        PyObject *kwds);
+
+void
+PolyphaseResampler_dealloc(pcmconverter_PolyphaseResampler *self);
+
+PyGetSetDef PolyphaseResampler_getseters[] = {
+    {"sample_rate", (getter)PolyphaseResampler_sample_rate,
+     NULL, "sample rate", NULL},
+    {"bits_per_sample", (getter)PolyphaseResampler_bits_per_sample,
+     NULL, "bits per sample", NULL},
+    {"channels", (getter)PolyphaseResampler_channels,
+     NULL, "channels", NULL},
+    {"channel_mask", (getter)PolyphaseResampler_channel_mask,
+     NULL, "channel_mask", NULL},
+    {"_pcm_source", (getter)PolyphaseResampler_pcm_source,
+     NULL, "native PCM source", NULL},
+    {NULL}
+};
+
+PyMethodDef PolyphaseResampler_methods[] = {
+    {"read", (PyCFunction)PolyphaseResampler_read, METH_VARARGS, ""},
+    {"close", (PyCFunction)PolyphaseResampler_close, METH_NOARGS, ""},
+    {NULL}
+};
+
+PyTypeObject pcmconverter_PolyphaseResamplerType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "pcmconverter.PolyphaseResampler", /*tp_name*/
+    sizeof(pcmconverter_PolyphaseResampler), /*tp_basicsize*/
+    0,                         /*tp_itemsize*/
+    (destructor)PolyphaseResampler_dealloc, /*tp_dealloc*/
+    0,                         /*tp_print*/
+    0,                         /*tp_getattr*/
+    0,                         /*tp_setattr*/
+    0,                         /*tp_compare*/
+    0,                         /*tp_repr*/
+    0,                         /*tp_as_number*/
+    0,                         /*tp_as_sequence*/
+    0,                         /*tp_as_mapping*/
+    0,                         /*tp_hash */
+    0,                         /*tp_call*/
+    0,                         /*tp_str*/
+    0,                         /*tp_getattro*/
+    0,                         /*tp_setattro*/
+    0,                         /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /*tp_flags*/
+    "PolyphaseResampler objects", /* tp_doc */
+    0,                         /* tp_traverse */
+    0,                         /* tp_clear */
+    0,                         /* tp_richcompare */
+    0,                         /* tp_weaklistoffset */
+    0,                         /* tp_iter */
+    0,                         /* tp_iternext */
+    PolyphaseResampler_methods, /* tp_methods */
+    0,                         /* tp_members */
+    PolyphaseResampler_getseters, /* tp_getset */
+    0,                         /* tp_base */
+    0,                         /* tp_dict */
+    0,                         /* tp_descr_get */
+    0,                         /* tp_descr_set */
+    0,                         /* tp_dictoffset */
+    (initproc)PolyphaseResampler_init, /* tp_init */
+    0,                         /* tp_alloc */
+    PolyphaseResampler_new,    /* tp_new */
+};
+
 typedef struct {
     PyObject_HEAD
 
     struct PCMReader *pcmreader;
     int bits_per_sample;
-    BitstreamReader *white_noise;
+    struct dither *dither;
     PyObject *audiotools_pcm;
 } pcmconverter_BPSConverter;
 
@@ -313,6 +460,9 @@ BPSConverter_channels(pcmconverter_BPSConverter *self, void *closure);
 static PyObject*
 BPSConverter_channel_mask(pcmconverter_BPSConverter *self, void *closure);
 
+static PyObject*
+BPSConverter_pcm_source(pcmconverter_BPSConverter *self, void *closure);
+
 static PyObject*
 BPSConverter_read(pcmconverter_BPSConverter *self, PyObject *args);
 
@@ -338,6 +488,8 @@ PyGetSetDef BPSConverter_getseters[] = {
      NULL, "channels", NULL},
     {"channel_mask", (getter)BPSConverter_channel_mask,
      NULL, "channel_mask", NULL},
+    {"_pcm_source", (getter)BPSConverter_pcm_source,
+     NULL, "native PCM source", NULL},
     {NULL}
 };
 
@@ -1,5 +1,8 @@
 #include <stdlib.h>
 #include "pcmreader.h"
+#ifndef STANDALONE
+#include "framelist.h"
+#endif
 
 #ifndef MIN
 #define MIN(x, y) ((x) < (y) ? (x) : (y))
@@ -41,6 +44,7 @@ READER_DEFS(raw)
 READER_DEFS(error)
 #else
 READER_DEFS(python)
+READER_DEFS(native)
 #endif
 
 
@@ -145,6 +149,28 @@ get_unsigned_attr(PyObject *obj, const char *attr, unsigned *value)
     return 0;
 }
 
+/*returns the pcm_source exported by the given object
+  or NULL if it doesn't export one*/
+static const struct pcm_source*
+get_pcm_source(PyObject *obj)
+{
+    PyObject *capsule = PyObject_GetAttrString(obj, "_pcm_source");
+    const struct pcm_source *source = NULL;
+
+    if (capsule == NULL) {
+        PyErr_Clear();
+        return NULL;
+    }
+
+    if (PyCapsule_IsValid(capsule, PCM_SOURCE_CAPSULE) &&
+        (PyCapsule_GetContext(capsule) == obj)) {
+        source = PyCapsule_GetPointer(capsule, PCM_SOURCE_CAPSULE);
+    }
+
+    Py_DECREF(capsule);
+    return source;
+}
+
 struct PCMReader*
 pcmreader_open_python(PyObject *obj)
 {
@@ -160,6 +186,27 @@ pcmreader_open_python(PyObject *obj)
     if (get_unsigned_attr(obj, "bits_per_sample", &(reader->bits_per_sample)))
         goto error;
 
+    /*read the object's samples directly if it exports them*/
+    if ((reader->input.native.source = get_pcm_source(obj)) != NULL) {
+        const unsigned block_size =
+            reader->input.native.source->block_size(obj);
+
+        Py_INCREF(obj);
+        reader->input.native.obj = obj;
+        reader->input.native.block_size = block_size;
+        reader->input.native.buffer =
+            malloc(block_size * reader->channels * sizeof(int));
+        reader->input.native.start = 0;
+        reader->input.native.frames_remaining = 0;
+
+        reader->status = PCM_OK;
+
+        reader->read = pcmreader_native_read;
+        reader->close = pcmreader_native_close;
+        reader->del = pcmreader_native_del;
+        return reader;
+    }
+
     reader->input.python.obj = obj;
 
     /*attach a pcm.FrameList type object for verification during reads*/
@@ -424,6 +471,79 @@ pcmreader_python_del(struct PCMReader *self) {
     free(self);
 }
 
+static unsigned
+pcmreader_native_read(struct PCMReader *self,
+                      unsigned pcm_frames,
+                      int *pcm_data)
+{
+    const unsigned initial_frames = pcm_frames;
+    const unsigned channels = self->channels;
+    PyObject *obj = self->input.native.obj;
+    const struct pcm_source *source = self->input.native.source;
+    int stream_finished = 0;
+
+    while (pcm_frames && !stream_finished) {
+        unsigned frames_read;
+
+        if (self->input.native.frames_remaining) {
+            /*transfer frames left over from an earlier block*/
+            const unsigned to_transfer =
+                MIN(self->input.native.frames_remaining, pcm_frames);
+
+            memcpy(pcm_data,
+                   self->input.native.buffer +
+                   (self->input.native.start * channels),
+                   sizeof(int) * channels * to_transfer);
+
+            pcm_frames -= to_transfer;
+            pcm_data += (to_transfer * channels);
+            self->input.native.start += to_transfer;
+            self->input.native.frames_remaining -= to_transfer;
+        } else if (pcm_frames >= self->input.native.block_size) {
+            /*a whole block fits, so decode it straight to the output*/
+            if (source->read(obj, pcm_data, &frames_read)) {
+                self->status = PCM_READ_ERROR;
+                return 0;
+            }
+
+            stream_finished = (frames_read == 0);
+            pcm_frames -= frames_read;
+            pcm_data += (frames_read * channels);
+        } else {
+            /*otherwise, decode to the buffer and transfer from there*/
+            if (source->read(obj, self->input.native.buffer, &frames_read)) {
+                self->status = PCM_READ_ERROR;
+                return 0;
+            }
+
+            stream_finished = (frames_read == 0);
+            self->input.native.start = 0;
+            self->input.native.frames_remaining = frames_read;
+        }
+    }
+
+    return initial_frames - pcm_frames;
+}
+
+static void
+pcmreader_native_close(struct PCMReader *self)
+{
+    PyObject *result =
+        PyObject_CallMethod(self->input.native.obj, "close", NULL);
+    if (result) {
+        Py_DECREF(result);
+    } else {
+        PyErr_Clear();
+    }
+}
+
+static void
+pcmreader_native_del(struct PCMReader *self) {
+    Py_XDECREF(self->input.native.obj);
+    free(self->input.native.buffer);
+    free(self);
+}
+
 #endif
 
 #ifdef EXECUTABLE
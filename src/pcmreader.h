@@ -54,6 +54,14 @@ struct PCMReader {
             pcm_FrameList *framelist;  /*framelist object*/
             unsigned frames_remaining; /*frames remaining in framelist*/
         } python;
+        struct {
+            PyObject *obj;                   /*PCMReader object*/
+            const struct pcm_source *source; /*object's exported source*/
+            unsigned block_size;             /*largest block from source*/
+            int *buffer;                     /*block_size * channels*/
+            unsigned start;                  /*first frame left in buffer*/
+            unsigned frames_remaining;       /*frames left in buffer*/
+        } native;
         #endif
     } input;
 
@@ -113,7 +121,10 @@ pcmreader_open_error(FILE *file,
 
 #else
 
-/*wraps a PCMReader struct around a PCMReader Python object*/
+/*wraps a PCMReader struct around a PCMReader Python object
+
+  if the object exports a pcm_source (see framelist.h)
+  its samples are read from that directly instead of through read()*/
 struct PCMReader*
 pcmreader_open_python(PyObject *obj);
 
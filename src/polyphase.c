@@ -0,0 +1,470 @@
+#include "polyphase.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/*the SSE2 dot product needs SSE2 at compile time,
+  which every x86-64 compiler provides,
+  while the AVX2 one is compiled per-function
+  and only chosen if the running CPU supports it*/
+#if defined(__GNUC__) && defined(__SSE2__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define POLYPHASE_X86
+#include <immintrin.h>
+#endif
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+#ifndef MIN
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+#endif
+#ifndef MAX
+#define MAX(x, y) ((x) > (y) ? (x) : (y))
+#endif
+
+/*the fraction of the lower rate's Nyquist frequency passed unattenuated*/
+#define POLYPHASE_BANDWIDTH 0.96
+
+/*the attenuation at and above the lower rate's Nyquist frequency, in dB*/
+#define POLYPHASE_ATTENUATION 120.0
+
+/*the most phases a ratio may have, such as 640 for 11025 to 48000*/
+#define POLYPHASE_MAX_PHASES 1024
+
+/*the most coefficients all of a ratio's phases may have together*/
+#define POLYPHASE_MAX_COEFFICIENTS (1 << 20)
+
+/*the most frames of input filtered at once*/
+#define POLYPHASE_CHUNK 4096
+
+/*filters are padded to a multiple of this many taps
+  so that the dot products need no scalar remainder*/
+#define POLYPHASE_TAP_ALIGNMENT 16
+
+static unsigned
+gcd(unsigned a, unsigned b)
+{
+    while (b) {
+        const unsigned r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+/*the zeroth-order modified Bessel function of the first kind*/
+static double
+bessel_i0(double x)
+{
+    const double y = (x * x) / 4.0;
+    double term = 1.0;
+    double sum = 1.0;
+    unsigned k;
+
+    for (k = 1; term > (sum * 1e-17); k++) {
+        term *= y / ((double)k * (double)k);
+        sum += term;
+    }
+    return sum;
+}
+
+/*the number of taps each phase needs to reach POLYPHASE_ATTENUATION
+  within the transition band left by POLYPHASE_BANDWIDTH,
+  using Kaiser's estimate of a windowed-sinc filter's length*/
+static unsigned
+filter_taps(unsigned phases, unsigned step)
+{
+    const double transition = (1.0 - POLYPHASE_BANDWIDTH) / 2.0;
+    double taps = (POLYPHASE_ATTENUATION - 7.95) / (14.36 * transition);
+
+    /*when downsampling, the filter's cutoff is the output's
+      Nyquist frequency, so it spans proportionally more input*/
+    if (step > phases) {
+        taps = (taps * step) / phases;
+    }
+
+    return (((unsigned)ceil(taps) + POLYPHASE_TAP_ALIGNMENT - 1) /
+            POLYPHASE_TAP_ALIGNMENT) * POLYPHASE_TAP_ALIGNMENT;
+}
+
+/*populates the resampler's bank with a Kaiser-windowed sinc
+  whose phase "p" holds the taps for output samples falling
+  p / phases of the way between two input samples,
+  with the taps in the same order as the input history*/
+static void
+build_bank(struct polyphase *resampler)
+{
+    const unsigned phases = resampler->phases;
+    const unsigned taps = resampler->taps;
+    const double half = taps / 2.0;
+    const double transition = (1.0 - POLYPHASE_BANDWIDTH) / 2.0;
+    /*cutoff centered in the transition band, as a fraction of
+      the input rate, lowered to the output's Nyquist if downsampling*/
+    const double cutoff = (0.5 - (transition / 2.0)) *
+        MIN(1.0, (double)phases / (double)resampler->step);
+    const double beta = 0.1102 * (POLYPHASE_ATTENUATION - 8.7);
+    const double window_scale = 1.0 / bessel_i0(beta);
+    double *phase_taps = malloc(sizeof(double) * taps);
+    unsigned p;
+
+    for (p = 0; p < phases; p++) {
+        double sum = 0.0;
+        unsigned j;
+
+        for (j = 0; j < taps; j++) {
+            /*distance from the output sample to tap j's input sample*/
+            const double t = (half - 1.0 - j) + ((double)p / phases);
+            const double x = t / half;
+            double value;
+
+            if (t == 0.0) {
+                value = 2.0 * cutoff;
+            } else {
+                value = sin(2.0 * M_PI * cutoff * t) / (M_PI * t);
+            }
+            if (fabs(x) < 1.0) {
+                value *= bessel_i0(beta * sqrt(1.0 - (x * x))) *
+                         window_scale;
+            } else {
+                value = 0.0;
+            }
+            phase_taps[j] = value;
+            sum += value;
+        }
+
+        /*give each phase unity gain so none of them adds a DC ripple*/
+        for (j = 0; j < taps; j++) {
+            resampler->bank[(p * taps) + j] = (float)(phase_taps[j] / sum);
+        }
+    }
+
+    free(phase_taps);
+}
+
+/*******************
+ * dot products    *
+ *******************/
+
+/*every dot product's "taps" is a multiple of POLYPHASE_TAP_ALIGNMENT*/
+
+#ifndef POLYPHASE_X86
+
+static float
+dot_scalar(const float coefficients[],
+           const float samples[],
+           unsigned taps)
+{
+    float sum0 = 0.0f;
+    float sum1 = 0.0f;
+    float sum2 = 0.0f;
+    float sum3 = 0.0f;
+    unsigned i;
+
+    for (i = 0; i < taps; i += 4) {
+        sum0 += coefficients[i] * samples[i];
+        sum1 += coefficients[i + 1] * samples[i + 1];
+        sum2 += coefficients[i + 2] * samples[i + 2];
+        sum3 += coefficients[i + 3] * samples[i + 3];
+    }
+
+    return (sum0 + sum1) + (sum2 + sum3);
+}
+
+#else
+
+static float
+dot_sse2(const float coefficients[],
+         const float samples[],
+         unsigned taps)
+{
+    /*independent accumulators keep successive adds from
+      waiting on each other's latency*/
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    __m128 sum2 = _mm_setzero_ps();
+    __m128 sum3 = _mm_setzero_ps();
+    unsigned i;
+
+    for (i = 0; i < taps; i += 16) {
+        sum0 = _mm_add_ps(sum0,
+                          _mm_mul_ps(_mm_loadu_ps(coefficients + i),
+                                     _mm_loadu_ps(samples + i)));
+        sum1 = _mm_add_ps(sum1,
+                          _mm_mul_ps(_mm_loadu_ps(coefficients + i + 4),
+                                     _mm_loadu_ps(samples + i + 4)));
+        sum2 = _mm_add_ps(sum2,
+                          _mm_mul_ps(_mm_loadu_ps(coefficients + i + 8),
+                                     _mm_loadu_ps(samples + i + 8)));
+        sum3 = _mm_add_ps(sum3,
+                          _mm_mul_ps(_mm_loadu_ps(coefficients + i + 12),
+                                     _mm_loadu_ps(samples + i + 12)));
+    }
+
+    sum0 = _mm_add_ps(_mm_add_ps(sum0, sum1), _mm_add_ps(sum2, sum3));
+    /*fold the four lanes together*/
+    sum0 = _mm_add_ps(sum0, _mm_movehl_ps(sum0, sum0));
+    sum0 = _mm_add_ss(sum0, _mm_shuffle_ps(sum0, sum0, 0x55));
+    return _mm_cvtss_f32(sum0);
+}
+
+__attribute__((target("avx2,fma"))) static float
+dot_avx2(const float coefficients[],
+         const float samples[],
+         unsigned taps)
+{
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    __m128 sum;
+    unsigned i;
+
+    for (i = 0; i < taps; i += 16) {
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(coefficients + i),
+                               _mm256_loadu_ps(samples + i),
+                               sum0);
+        sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(coefficients + i + 8),
+                               _mm256_loadu_ps(samples + i + 8),
+                               sum1);
+    }
+
+    sum0 = _mm256_add_ps(sum0, sum1);
+    sum = _mm_add_ps(_mm256_castps256_ps128(sum0),
+                     _mm256_extractf128_ps(sum0, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55));
+    return _mm_cvtss_f32(sum);
+}
+
+#endif
+
+static polyphase_dot_f
+best_dot(void)
+{
+#ifdef POLYPHASE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return dot_avx2;
+    } else {
+        return dot_sse2;
+    }
+#else
+    return dot_scalar;
+#endif
+}
+
+/*******************
+ * public routines *
+ *******************/
+
+struct polyphase*
+polyphase_open(unsigned input_rate,
+               unsigned output_rate,
+               unsigned channels)
+{
+    struct polyphase *resampler;
+    unsigned divisor;
+    unsigned phases;
+    unsigned step;
+    unsigned taps;
+    unsigned c;
+
+    if (!input_rate || !output_rate || !channels) {
+        return NULL;
+    }
+
+    divisor = gcd(input_rate, output_rate);
+    phases = output_rate / divisor;
+    step = input_rate / divisor;
+    if (phases > POLYPHASE_MAX_PHASES) {
+        return NULL;
+    }
+    taps = filter_taps(phases, step);
+    if (((uint64_t)phases * taps) > POLYPHASE_MAX_COEFFICIENTS) {
+        return NULL;
+    }
+
+    resampler = malloc(sizeof(struct polyphase));
+    resampler->channels = channels;
+    resampler->phases = phases;
+    resampler->step = step;
+    resampler->taps = taps;
+    resampler->bank = malloc(sizeof(float) * phases * taps);
+    build_bank(resampler);
+
+    /*after filtering, fewer than "taps" frames remain in the history
+      so there's always room for another chunk*/
+    resampler->capacity = taps + MAX(POLYPHASE_CHUNK, taps);
+    resampler->history = malloc(sizeof(float*) * channels);
+    for (c = 0; c < channels; c++) {
+        resampler->history[c] = malloc(sizeof(float) * resampler->capacity);
+        /*center the first output on the first input frame*/
+        memset(resampler->history[c], 0, sizeof(float) * (taps / 2 - 1));
+    }
+    resampler->buffered = taps / 2 - 1;
+    resampler->start = 0;
+    resampler->phase = 0;
+
+    resampler->frames_in = 0;
+    resampler->frames_out = 0;
+    resampler->flushed = 0;
+
+    resampler->dot = best_dot();
+
+    return resampler;
+}
+
+unsigned
+polyphase_max_output(const struct polyphase *resampler,
+                     unsigned input_frames)
+{
+    return (unsigned)((((uint64_t)input_frames + resampler->taps) *
+                       resampler->phases) / resampler->step) + 1;
+}
+
+/*generates frames until the history runs out or "limit" is reached
+  and then discards the history no longer needed
+
+  returns the number of frames output*/
+static unsigned
+filter_history(struct polyphase *resampler,
+               uint64_t limit,
+               float output[])
+{
+    const unsigned channels = resampler->channels;
+    const unsigned phases = resampler->phases;
+    const unsigned step = resampler->step;
+    const unsigned taps = resampler->taps;
+    const polyphase_dot_f dot = resampler->dot;
+    unsigned start = resampler->start;
+    unsigned phase = resampler->phase;
+    unsigned frames = 0;
+    unsigned discard;
+    unsigned c;
+
+    while (((start + taps) <= resampler->buffered) &&
+           (resampler->frames_out + frames < limit)) {
+        const float *coefficients = resampler->bank + (phase * taps);
+
+        for (c = 0; c < channels; c++) {
+            *output++ = dot(coefficients,
+                            resampler->history[c] + start,
+                            taps);
+        }
+        frames++;
+
+        phase += step;
+        start += phase / phases;
+        phase %= phases;
+    }
+
+    resampler->frames_out += frames;
+    resampler->phase = phase;
+
+    /*when downsampling, the next output may begin
+      past the end of the history*/
+    discard = MIN(start, resampler->buffered);
+    for (c = 0; c < channels; c++) {
+        memmove(resampler->history[c],
+                resampler->history[c] + discard,
+                sizeof(float) * (resampler->buffered - discard));
+    }
+    resampler->buffered -= discard;
+    resampler->start = start - discard;
+
+    return frames;
+}
+
+unsigned
+polyphase_process(struct polyphase *resampler,
+                  const float input[],
+                  unsigned input_frames,
+                  float output[])
+{
+    const unsigned channels = resampler->channels;
+    unsigned total = 0;
+
+    if (resampler->flushed) {
+        return 0;
+    }
+
+    while (input_frames) {
+        const unsigned chunk = MIN(input_frames,
+                                   resampler->capacity - resampler->buffered);
+        unsigned i;
+        unsigned c;
+
+        /*deinterleave the chunk onto the end of each channel's history*/
+        for (c = 0; c < channels; c++) {
+            float *history = resampler->history[c] + resampler->buffered;
+            for (i = 0; i < chunk; i++) {
+                history[i] = input[(i * channels) + c];
+            }
+        }
+        resampler->buffered += chunk;
+        resampler->frames_in += chunk;
+        input += chunk * channels;
+        input_frames -= chunk;
+
+        total += filter_history(resampler,
+                                UINT64_MAX,
+                                output + (total * channels));
+    }
+
+    return total;
+}
+
+unsigned
+polyphase_flush(struct polyphase *resampler, float output[])
+{
+    const unsigned padding = resampler->taps / 2;
+    uint64_t limit;
+    unsigned c;
+
+    if (resampler->flushed) {
+        return 0;
+    }
+    resampler->flushed = 1;
+
+    /*pad the history with enough silence to center
+      an output on the final input frame*/
+    for (c = 0; c < resampler->channels; c++) {
+        memset(resampler->history[c] + resampler->buffered,
+               0,
+               sizeof(float) * padding);
+    }
+    resampler->buffered += padding;
+
+    limit = ((resampler->frames_in * resampler->phases) +
+             resampler->step - 1) / resampler->step;
+
+    return filter_history(resampler, limit, output);
+}
+
+void
+polyphase_close(struct polyphase *resampler)
+{
+    unsigned c;
+
+    for (c = 0; c < resampler->channels; c++) {
+        free(resampler->history[c]);
+    }
+    free(resampler->history);
+    free(resampler->bank);
+    free(resampler);
+}
@@ -0,0 +1,97 @@
+#ifndef POLYPHASE_H
+#define POLYPHASE_H
+
+#include <stdint.h>
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+/*a resampler for fixed rational ratios such as 44100 to 48000 (160/147)
+
+  each of the ratio's output phases has its own precomputed
+  windowed-sinc filter, so every output sample is a single
+  dot product against the input history rather than
+  an interpolation of the filter, as libsamplerate does
+
+  samples are floats between -1.0 and 1.0, interleaved by channel*/
+
+typedef float (*polyphase_dot_f)(const float coefficients[],
+                                 const float samples[],
+                                 unsigned taps);
+
+struct polyphase {
+    unsigned channels;
+    unsigned phases;            /*output rate / gcd (upsampling factor)*/
+    unsigned step;              /*input rate / gcd (downsampling factor)*/
+    unsigned taps;              /*filter taps per phase*/
+    float *bank;                /*phases * taps coefficients*/
+
+    unsigned capacity;          /*frames each history may hold*/
+    float **history;            /*per-channel input, awaiting filtering*/
+    unsigned buffered;          /*frames in each history*/
+    unsigned start;             /*first history frame of next output*/
+    unsigned phase;             /*phase of next output*/
+
+    uint64_t frames_in;         /*total input frames received*/
+    uint64_t frames_out;        /*total output frames generated*/
+    int flushed;                /*whether the end of input is reached*/
+
+    polyphase_dot_f dot;
+};
+
+/*returns a new resampler from input_rate to output_rate
+  for the given number of channels
+  or NULL if the rates' ratio needs too many phases
+  or the channel count or either rate is 0*/
+struct polyphase*
+polyphase_open(unsigned input_rate,
+               unsigned output_rate,
+               unsigned channels);
+
+/*returns the largest number of frames polyphase_process()
+  may output from the given number of input frames*/
+unsigned
+polyphase_max_output(const struct polyphase *resampler,
+                     unsigned input_frames);
+
+/*takes "input_frames" frames of input
+  and places as many frames of output as are ready into "output",
+  which must hold polyphase_max_output(input_frames) frames
+
+  returns the number of frames output*/
+unsigned
+polyphase_process(struct polyphase *resampler,
+                  const float input[],
+                  unsigned input_frames,
+                  float output[]);
+
+/*marks the end of input and places the remaining frames
+  into "output", which must hold polyphase_max_output(taps) frames
+
+  afterward, the total frames output is the total frames input
+  times the ratio, rounded up
+
+  returns the number of frames output, or 0 if already flushed*/
+unsigned
+polyphase_flush(struct polyphase *resampler, float output[]);
+
+void
+polyphase_close(struct polyphase *resampler);
+
+#endif
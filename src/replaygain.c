@@ -841,10 +841,11 @@ ReplayGainReader_init(replaygain_ReplayGainReader *self,
                       PyObject *args, PyObject *kwds) {
     double replaygain;
     double peak;
+    uint64_t seed;
 
     self->stream_closed = 0;
     self->pcmreader = NULL;
-    self->white_noise = NULL;
+    self->dither = NULL;
     self->audiotools_pcm = NULL;
 
 
@@ -854,9 +855,11 @@ ReplayGainReader_init(replaygain_ReplayGainReader *self,
                           &(peak)))
         return -1;
 
-    if ((self->white_noise = open_dither()) == NULL)
+    if (dither_random_seed(&seed))
         return -1;
 
+    self->dither = dither_open(self->pcmreader->channels, seed, 0);
+
     if ((self->audiotools_pcm = open_audiotools_pcm()) == NULL)
         return -1;
 
@@ -871,8 +874,8 @@ void
 ReplayGainReader_dealloc(replaygain_ReplayGainReader* self) {
     if (self->pcmreader != NULL)
         self->pcmreader->del(self->pcmreader);
-    if (self->white_noise != NULL)
-        self->white_noise->close(self->white_noise);
+    if (self->dither != NULL)
+        dither_close(self->dither);
     Py_XDECREF(self->audiotools_pcm);
 
     Py_TYPE(self)->tp_free((PyObject*)self);
@@ -944,13 +947,11 @@ ReplayGainReader_read(replaygain_ReplayGainReader* self, PyObject *args) {
         }
 
         /*apply our multiplier to framelist's integer samples
-          and apply dithering*/
+          and apply dithering before rounding*/
         for (i = 0; i < total_samples; i++) {
-            framelist->samples[i] =
-                (int)lround(framelist->samples[i] * multiplier);
-            framelist->samples[i] =
-                (MIN(MAX(framelist->samples[i], min_value), max_value) ^
-                 self->white_noise->read(self->white_noise, 1));
+            const int s = (int)lround(framelist->samples[i] * multiplier +
+                                      dither_tpdf(self->dither));
+            framelist->samples[i] = MIN(MAX(s, min_value), max_value);
         }
 
         /*return integer samples as a new FrameList object*/
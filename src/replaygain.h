@@ -127,7 +127,7 @@ typedef struct {
 
     int stream_closed;
     struct PCMReader *pcmreader;
-    BitstreamReader *white_noise;
+    struct dither *dither;
     PyObject *audiotools_pcm;
     double multiplier;
 } replaygain_ReplayGainReader;
@@ -0,0 +1,596 @@
+#include "tags.h"
+#include <stdlib.h>
+#include <string.h>
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+const char*
+tag_strerror(tag_status status)
+{
+    switch (status) {
+    case TAG_OK:
+        return "no error";
+    case TAG_INVALID_HEADER:
+        return "invalid tag header";
+    case TAG_UNSUPPORTED_VERSION:
+        return "unsupported tag version";
+    case TAG_INVALID_SIZE:
+        return "invalid tag size";
+    case TAG_TRUNCATED:
+        return "tag truncated";
+    default:
+        return "unknown error";
+    }
+}
+
+static inline unsigned
+read_be24(const uint8_t *data)
+{
+    return ((unsigned)data[0] << 16) | ((unsigned)data[1] << 8) | data[2];
+}
+
+static inline unsigned
+read_be32(const uint8_t *data)
+{
+    return (((unsigned)data[0] << 24) | ((unsigned)data[1] << 16) |
+            ((unsigned)data[2] << 8) | data[3]);
+}
+
+static inline unsigned
+read_le32(const uint8_t *data)
+{
+    return (((unsigned)data[3] << 24) | ((unsigned)data[2] << 16) |
+            ((unsigned)data[1] << 8) | data[0]);
+}
+
+static inline void
+write_be24(unsigned value, uint8_t *data)
+{
+    data[0] = (value >> 16) & 0xFF;
+    data[1] = (value >> 8) & 0xFF;
+    data[2] = value & 0xFF;
+}
+
+static inline void
+write_be32(unsigned value, uint8_t *data)
+{
+    data[0] = (value >> 24) & 0xFF;
+    data[1] = (value >> 16) & 0xFF;
+    data[2] = (value >> 8) & 0xFF;
+    data[3] = value & 0xFF;
+}
+
+static inline void
+write_le32(unsigned value, uint8_t *data)
+{
+    data[0] = value & 0xFF;
+    data[1] = (value >> 8) & 0xFF;
+    data[2] = (value >> 16) & 0xFF;
+    data[3] = (value >> 24) & 0xFF;
+}
+
+/*reads a 28 bit sync-safe integer to "value" and returns 1
+  or returns 0 if any of its sync-safe bits are set*/
+static int
+read_syncsafe32(const uint8_t *data, unsigned *value)
+{
+    if ((data[0] | data[1] | data[2] | data[3]) & 0x80) {
+        return 0;
+    } else {
+        *value = ((data[0] << 21) | (data[1] << 14) |
+                  (data[2] << 7) | data[3]);
+        return 1;
+    }
+}
+
+static void
+write_syncsafe32(unsigned value, uint8_t *data)
+{
+    data[0] = (value >> 21) & 0x7F;
+    data[1] = (value >> 14) & 0x7F;
+    data[2] = (value >> 7) & 0x7F;
+    data[3] = value & 0x7F;
+}
+
+/*copies "size" bytes from "data" to "output"
+  with unsynchronization removed, which replaces each
+  0xFF 0x00 pair with a single 0xFF byte,
+  and returns the number of bytes written*/
+static unsigned
+remove_unsync(const uint8_t *data, unsigned size, uint8_t *output)
+{
+    const uint8_t *end = data + size;
+    uint8_t *start = output;
+
+    while (data < end) {
+        const uint8_t *ff = memchr(data, 0xFF, end - data);
+        if (ff == NULL) {
+            memcpy(output, data, end - data);
+            output += end - data;
+            break;
+        } else {
+            /*copy everything up to and including the 0xFF byte*/
+            memcpy(output, data, ff - data + 1);
+            output += ff - data + 1;
+            data = ff + 1;
+            if ((data < end) && (*data == 0x00)) {
+                data++;
+            }
+        }
+    }
+
+    return (unsigned)(output - start);
+}
+
+tag_status
+id3v2_parse(const uint8_t *data, unsigned size, struct id3v2_tag *tag)
+{
+    const uint8_t *body;
+    uint8_t *unsynced = NULL;
+    unsigned remaining;
+    unsigned id_size;
+    unsigned header_size;
+    unsigned frames_allocated = 0;
+
+    if ((size < 10) || memcmp(data, "ID3", 3)) {
+        return TAG_INVALID_HEADER;
+    }
+
+    tag->major_version = data[3];
+    tag->minor_version = data[4];
+    tag->flags = data[5];
+    if ((tag->major_version < 2) || (tag->major_version > 4)) {
+        return TAG_UNSUPPORTED_VERSION;
+    }
+    if (!read_syncsafe32(data + 6, &(tag->total_size))) {
+        return TAG_INVALID_SIZE;
+    }
+    if (tag->total_size > (size - 10)) {
+        return TAG_TRUNCATED;
+    }
+
+    body = data + 10;
+    remaining = tag->total_size;
+
+    /*prior to ID3v2.4, unsynchronization applies to the whole tag*/
+    if ((tag->major_version < 4) &&
+        (tag->flags & ID3V2_UNSYNCHRONIZATION)) {
+        unsynced = malloc(remaining ? remaining : 1);
+        remaining = remove_unsync(body, remaining, unsynced);
+        body = unsynced;
+    }
+
+    /*skip any extended header, whose size field
+      excludes itself in ID3v2.3 but includes itself in ID3v2.4*/
+    if ((tag->major_version > 2) && (tag->flags & ID3V2_EXTENDED_HEADER)) {
+        unsigned extended_size;
+
+        if (remaining < 4) {
+            free(unsynced);
+            return TAG_INVALID_SIZE;
+        } else if (tag->major_version == 3) {
+            extended_size = read_be32(body) + 4;
+        } else if (!read_syncsafe32(body, &extended_size)) {
+            free(unsynced);
+            return TAG_INVALID_SIZE;
+        }
+
+        if (extended_size > remaining) {
+            free(unsynced);
+            return TAG_INVALID_SIZE;
+        }
+        body += extended_size;
+        remaining -= extended_size;
+    }
+
+    id_size = id3v2_id_size(tag->major_version);
+    header_size = id3v2_frame_header_size(tag->major_version);
+    tag->frame_count = 0;
+    tag->frames = NULL;
+
+    while (remaining >= header_size) {
+        struct id3v2_frame *frame;
+        unsigned frame_size;
+        unsigned frame_flags;
+        const uint8_t *frame_data;
+
+        if (body[0] == 0) {
+            /*the remainder of the tag is padding*/
+            break;
+        }
+
+        switch (tag->major_version) {
+        case 2:
+            frame_size = read_be24(body + 3);
+            frame_flags = 0;
+            break;
+        case 3:
+            frame_size = read_be32(body + 4);
+            frame_flags = (body[8] << 8) | body[9];
+            break;
+        default:
+            if (!read_syncsafe32(body + 4, &frame_size)) {
+                free(unsynced);
+                id3v2_free(tag);
+                return TAG_INVALID_SIZE;
+            }
+            frame_flags = (body[8] << 8) | body[9];
+            break;
+        }
+
+        if (frame_size > (remaining - header_size)) {
+            /*treat a frame overrunning the tag as the end of the tag*/
+            break;
+        }
+
+        if (tag->frame_count == frames_allocated) {
+            frames_allocated = frames_allocated ? frames_allocated * 2 : 16;
+            tag->frames = realloc(tag->frames,
+                                  frames_allocated *
+                                  sizeof(struct id3v2_frame));
+        }
+        frame = &(tag->frames[tag->frame_count++]);
+        memset(frame->id, 0, 4);
+        memcpy(frame->id, body, id_size);
+        frame_data = body + header_size;
+        frame->data = malloc(frame_size ? frame_size : 1);
+
+        if (tag->major_version == 4) {
+            /*ID3v2.4 applies unsynchronization per frame*/
+            if ((frame_flags & ID3V24_FRAME_UNSYNCHRONIZATION) ||
+                (tag->flags & ID3V2_UNSYNCHRONIZATION)) {
+                frame->size = remove_unsync(frame_data,
+                                            frame_size,
+                                            frame->data);
+            } else {
+                memcpy(frame->data, frame_data, frame_size);
+                frame->size = frame_size;
+            }
+
+            /*and its data length indicator precedes the payload*/
+            if ((frame_flags & ID3V24_FRAME_DATA_LENGTH) &&
+                (frame->size >= 4)) {
+                frame->size -= 4;
+                memmove(frame->data, frame->data + 4, frame->size);
+            }
+
+            frame->flags = frame_flags & ~(ID3V24_FRAME_UNSYNCHRONIZATION |
+                                           ID3V24_FRAME_DATA_LENGTH);
+        } else {
+            memcpy(frame->data, frame_data, frame_size);
+            frame->size = frame_size;
+            frame->flags = frame_flags;
+        }
+
+        body += header_size + frame_size;
+        remaining -= header_size + frame_size;
+    }
+
+    free(unsynced);
+    return TAG_OK;
+}
+
+void
+id3v2_free(struct id3v2_tag *tag)
+{
+    unsigned i;
+
+    for (i = 0; i < tag->frame_count; i++) {
+        free(tag->frames[i].data);
+    }
+    free(tag->frames);
+    tag->frame_count = 0;
+    tag->frames = NULL;
+}
+
+/*returns the size of all frames and their headers*/
+static unsigned
+id3v2_frames_size(unsigned major_version,
+                  unsigned frame_count,
+                  const struct id3v2_frame frames[])
+{
+    const unsigned header_size = id3v2_frame_header_size(major_version);
+    unsigned size = 0;
+    unsigned i;
+
+    for (i = 0; i < frame_count; i++) {
+        size += header_size + frames[i].size;
+    }
+
+    return size;
+}
+
+unsigned
+id3v2_size(unsigned major_version,
+           unsigned frame_count,
+           const struct id3v2_frame frames[],
+           unsigned total_size)
+{
+    const unsigned frames_size =
+        id3v2_frames_size(major_version, frame_count, frames);
+
+    return 10 + (frames_size > total_size ? frames_size : total_size);
+}
+
+tag_status
+id3v2_build(unsigned major_version,
+            unsigned frame_count,
+            const struct id3v2_frame frames[],
+            unsigned total_size,
+            uint8_t *output)
+{
+    const unsigned id_size = id3v2_id_size(major_version);
+    const unsigned header_size = id3v2_frame_header_size(major_version);
+    const unsigned frames_size =
+        id3v2_frames_size(major_version, frame_count, frames);
+    const unsigned tag_size =
+        frames_size > total_size ? frames_size : total_size;
+    unsigned i;
+
+    if (tag_size >= (1 << 28)) {
+        return TAG_INVALID_SIZE;
+    }
+
+    memcpy(output, "ID3", 3);
+    output[3] = major_version;
+    output[4] = 0;
+    output[5] = 0;
+    write_syncsafe32(tag_size, output + 6);
+    output += 10;
+
+    for (i = 0; i < frame_count; i++) {
+        const struct id3v2_frame *frame = &(frames[i]);
+
+        memcpy(output, frame->id, id_size);
+        switch (major_version) {
+        case 2:
+            if (frame->size >= (1 << 24)) {
+                return TAG_INVALID_SIZE;
+            }
+            write_be24(frame->size, output + 3);
+            break;
+        case 3:
+            write_be32(frame->size, output + 4);
+            output[8] = output[9] = 0;
+            break;
+        default:
+            if (frame->size >= (1 << 28)) {
+                return TAG_INVALID_SIZE;
+            }
+            write_syncsafe32(frame->size, output + 4);
+            output[8] = output[9] = 0;
+            break;
+        }
+        memcpy(output + header_size, frame->data, frame->size);
+        output += header_size + frame->size;
+    }
+
+    /*pad the remainder of the tag with NULL bytes*/
+    memset(output, 0, tag_size - frames_size);
+
+    return TAG_OK;
+}
+
+
+tag_status
+id3v1_parse(const uint8_t data[ID3V1_SIZE], struct id3v1_tag *tag)
+{
+    if (memcmp(data, "TAG", 3)) {
+        return TAG_INVALID_HEADER;
+    }
+
+    memcpy(tag->track_name, data + 3, 30);
+    memcpy(tag->artist_name, data + 33, 30);
+    memcpy(tag->album_name, data + 63, 30);
+    memcpy(tag->year, data + 93, 4);
+    memcpy(tag->comment, data + 97, 28);
+    /*byte 125 is the ID3v1.1 NULL separator*/
+    tag->track_number = data[126];
+    tag->genre = data[127];
+
+    return TAG_OK;
+}
+
+void
+id3v1_build(const struct id3v1_tag *tag, uint8_t output[ID3V1_SIZE])
+{
+    memcpy(output, "TAG", 3);
+    memcpy(output + 3, tag->track_name, 30);
+    memcpy(output + 33, tag->artist_name, 30);
+    memcpy(output + 63, tag->album_name, 30);
+    memcpy(output + 93, tag->year, 4);
+    memcpy(output + 97, tag->comment, 28);
+    output[125] = 0;
+    output[126] = tag->track_number & 0xFF;
+    output[127] = tag->genre & 0xFF;
+}
+
+
+tag_status
+apev2_parse_footer(const uint8_t data[APEV2_FOOTER_SIZE],
+                   struct apev2_footer *footer)
+{
+    if (memcmp(data, "APETAGEX", 8)) {
+        return TAG_INVALID_HEADER;
+    }
+
+    footer->version = read_le32(data + 8);
+    footer->tag_size = read_le32(data + 12);
+    footer->item_count = read_le32(data + 16);
+    footer->flags = read_le32(data + 20);
+
+    if (footer->version != 2000) {
+        return TAG_UNSUPPORTED_VERSION;
+    } else if (footer->tag_size < APEV2_FOOTER_SIZE) {
+        return TAG_INVALID_SIZE;
+    } else {
+        return TAG_OK;
+    }
+}
+
+tag_status
+apev2_parse_items(const uint8_t *data,
+                  unsigned size,
+                  unsigned item_count,
+                  struct apev2_item **items)
+{
+    struct apev2_item *parsed;
+    unsigned i;
+
+    /*every item is at least 9 bytes,
+      which keeps a bogus count from allocating too much*/
+    if (item_count > (size / 9)) {
+        return TAG_TRUNCATED;
+    }
+
+    parsed = malloc((item_count ? item_count : 1) *
+                    sizeof(struct apev2_item));
+
+    for (i = 0; i < item_count; i++) {
+        struct apev2_item *item = &(parsed[i]);
+        const uint8_t *key_end;
+        unsigned flags;
+
+        if (size < 9) {
+            apev2_free_items(i, parsed);
+            return TAG_TRUNCATED;
+        }
+
+        item->value_size = read_le32(data);
+        flags = read_le32(data + 4);
+        item->read_only = flags & 1;
+        item->type = (flags >> 1) & 3;
+        data += 8;
+        size -= 8;
+
+        if ((key_end = memchr(data, 0, size)) == NULL) {
+            apev2_free_items(i, parsed);
+            return TAG_TRUNCATED;
+        }
+        item->key_size = (unsigned)(key_end - data);
+        size -= item->key_size + 1;
+
+        if (item->value_size > size) {
+            apev2_free_items(i, parsed);
+            return TAG_TRUNCATED;
+        }
+
+        item->key = malloc(item->key_size ? item->key_size : 1);
+        memcpy(item->key, data, item->key_size);
+        data = key_end + 1;
+
+        item->value = malloc(item->value_size ? item->value_size : 1);
+        memcpy(item->value, data, item->value_size);
+        data += item->value_size;
+        size -= item->value_size;
+    }
+
+    *items = parsed;
+    return TAG_OK;
+}
+
+void
+apev2_free_items(unsigned item_count, struct apev2_item *items)
+{
+    unsigned i;
+
+    for (i = 0; i < item_count; i++) {
+        free(items[i].key);
+        free(items[i].value);
+    }
+    free(items);
+}
+
+/*returns the size of all items*/
+static unsigned
+apev2_items_size(unsigned item_count, const struct apev2_item items[])
+{
+    unsigned size = 0;
+    unsigned i;
+
+    for (i = 0; i < item_count; i++) {
+        size += 8 + items[i].key_size + 1 + items[i].value_size;
+    }
+
+    return size;
+}
+
+unsigned
+apev2_size(unsigned item_count,
+           const struct apev2_item items[],
+           int has_header,
+           int has_footer)
+{
+    return (apev2_items_size(item_count, items) +
+            (has_header ? APEV2_FOOTER_SIZE : 0) +
+            (has_footer ? APEV2_FOOTER_SIZE : 0));
+}
+
+static void
+apev2_build_footer(unsigned tag_size,
+                   unsigned item_count,
+                   unsigned flags,
+                   uint8_t *output)
+{
+    memcpy(output, "APETAGEX", 8);
+    write_le32(2000, output + 8);
+    write_le32(tag_size, output + 12);
+    write_le32(item_count, output + 16);
+    write_le32(flags, output + 20);
+    memset(output + 24, 0, 8);
+}
+
+void
+apev2_build(unsigned item_count,
+            const struct apev2_item items[],
+            int has_header,
+            int has_footer,
+            uint8_t *output)
+{
+    /*the tag size is always calculated as if a footer is present*/
+    const unsigned tag_size =
+        apev2_items_size(item_count, items) + APEV2_FOOTER_SIZE;
+    const unsigned flags = ((has_header ? APEV2_HAS_HEADER : 0) |
+                            (has_footer ? 0 : APEV2_NO_FOOTER));
+    unsigned i;
+
+    if (has_header) {
+        apev2_build_footer(tag_size, item_count, flags | APEV2_IS_HEADER,
+                           output);
+        output += APEV2_FOOTER_SIZE;
+    }
+
+    for (i = 0; i < item_count; i++) {
+        const struct apev2_item *item = &(items[i]);
+
+        write_le32(item->value_size, output);
+        write_le32((item->type << 1) | (item->read_only & 1), output + 4);
+        memcpy(output + 8, item->key, item->key_size);
+        output[8 + item->key_size] = 0;
+        memcpy(output + 8 + item->key_size + 1,
+               item->value,
+               item->value_size);
+        output += 8 + item->key_size + 1 + item->value_size;
+    }
+
+    if (has_footer) {
+        apev2_build_footer(tag_size, item_count, flags, output);
+    }
+}
@@ -0,0 +1,218 @@
+#ifndef TAGS_H
+#define TAGS_H
+
+#include <stdint.h>
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+/*This is a tag engine for the ID3v2, ID3v1 and APEv2 formats
+  which operates on tags already read into memory.
+
+  ID3v2 tags are decoded into a flat table of frame IDs and payloads
+  with unsynchronization, extended headers and data length indicators
+  already removed, leaving the interpretation of each frame's payload
+  to the caller.*/
+
+typedef enum {
+    TAG_OK,
+    TAG_INVALID_HEADER,
+    TAG_UNSUPPORTED_VERSION,
+    TAG_INVALID_SIZE,
+    TAG_TRUNCATED
+} tag_status;
+
+/*returns a constant string describing the given status*/
+const char*
+tag_strerror(tag_status status);
+
+/*ID3v2 header flags*/
+#define ID3V2_UNSYNCHRONIZATION 0x80
+#define ID3V2_EXTENDED_HEADER   0x40
+
+/*ID3v2.4 frame format flags*/
+#define ID3V24_FRAME_UNSYNCHRONIZATION  0x0002
+#define ID3V24_FRAME_DATA_LENGTH        0x0001
+
+struct id3v2_frame {
+    /*ID3v2.2 frame IDs are 3 bytes, later versions are 4 bytes*/
+    uint8_t id[4];
+
+    /*the frame's flags with any handled by the parser cleared*/
+    unsigned flags;
+
+    unsigned size;
+    uint8_t *data;
+};
+
+struct id3v2_tag {
+    unsigned major_version;
+    unsigned minor_version;
+    unsigned flags;
+
+    /*the tag's size from its header, not including the header itself,
+      which includes any trailing padding*/
+    unsigned total_size;
+
+    unsigned frame_count;
+    struct id3v2_frame *frames;
+};
+
+/*returns the size of an ID3v2 frame ID for the given major version*/
+static inline unsigned
+id3v2_id_size(unsigned major_version)
+{
+    return major_version == 2 ? 3 : 4;
+}
+
+/*returns the size of an ID3v2 frame header for the given major version*/
+static inline unsigned
+id3v2_frame_header_size(unsigned major_version)
+{
+    return major_version == 2 ? 6 : 10;
+}
+
+/*given a complete ID3v2 tag including its 10 byte header,
+  populates "tag" with its frames and returns TAG_OK
+  or returns some error if the tag is invalid
+
+  parsing stops at the first frame of NULL bytes, which is padding,
+  or at the first frame whose size overruns the tag
+
+  the tag must be freed with id3v2_free() only if TAG_OK is returned*/
+tag_status
+id3v2_parse(const uint8_t *data, unsigned size, struct id3v2_tag *tag);
+
+void
+id3v2_free(struct id3v2_tag *tag);
+
+/*returns the size of the ID3v2 tag id3v2_build() generates,
+  including its header, which is never less than 10 + "total_size"*/
+unsigned
+id3v2_size(unsigned major_version,
+           unsigned frame_count,
+           const struct id3v2_frame frames[],
+           unsigned total_size);
+
+/*writes an ID3v2 tag of the given version to "output"
+  with the given frames followed by NULL padding up to "total_size"
+
+  frames are written without unsynchronization or frame flags
+  and "output" must have at least id3v2_size() bytes available
+
+  returns TAG_INVALID_SIZE if a size is too large to be stored*/
+tag_status
+id3v2_build(unsigned major_version,
+            unsigned frame_count,
+            const struct id3v2_frame frames[],
+            unsigned total_size,
+            uint8_t *output);
+
+
+#define ID3V1_SIZE 128
+
+struct id3v1_tag {
+    uint8_t track_name[30];
+    uint8_t artist_name[30];
+    uint8_t album_name[30];
+    uint8_t year[4];
+    uint8_t comment[28];
+    unsigned track_number;
+    unsigned genre;
+};
+
+/*given the 128 bytes at the end of a file,
+  populates "tag" and returns TAG_OK
+  or returns TAG_INVALID_HEADER if no ID3v1 tag is present
+
+  tags are always treated as ID3v1.1*/
+tag_status
+id3v1_parse(const uint8_t data[ID3V1_SIZE], struct id3v1_tag *tag);
+
+void
+id3v1_build(const struct id3v1_tag *tag, uint8_t output[ID3V1_SIZE]);
+
+
+#define APEV2_FOOTER_SIZE 32
+
+/*APEv2 header and footer flags*/
+#define APEV2_HAS_HEADER 0x80000000
+#define APEV2_NO_FOOTER  0x40000000
+#define APEV2_IS_HEADER  0x20000000
+
+struct apev2_footer {
+    unsigned version;
+
+    /*the size of all items plus the footer, but not the header*/
+    unsigned tag_size;
+
+    unsigned item_count;
+    unsigned flags;
+};
+
+struct apev2_item {
+    /*0 = UTF-8, 1 = binary, 2 = external, 3 = reserved*/
+    unsigned type;
+    unsigned read_only;
+
+    unsigned key_size;
+    uint8_t *key;
+
+    unsigned value_size;
+    uint8_t *value;
+};
+
+/*given a 32 byte APEv2 header or footer,
+  populates "footer" and returns TAG_OK
+  or returns some error if no APEv2 tag is present*/
+tag_status
+apev2_parse_footer(const uint8_t data[APEV2_FOOTER_SIZE],
+                   struct apev2_footer *footer);
+
+/*given a block of APEv2 items, places a newly allocated array
+  of "item_count" items in "items" and returns TAG_OK
+  or returns some error if the items are invalid
+
+  the items must be freed with apev2_free_items() only if TAG_OK is returned*/
+tag_status
+apev2_parse_items(const uint8_t *data,
+                  unsigned size,
+                  unsigned item_count,
+                  struct apev2_item **items);
+
+void
+apev2_free_items(unsigned item_count, struct apev2_item *items);
+
+/*returns the size of the APEv2 tag apev2_build() generates*/
+unsigned
+apev2_size(unsigned item_count,
+           const struct apev2_item items[],
+           int has_header,
+           int has_footer);
+
+/*writes a complete APEv2 tag with the given items to "output"
+  which must have at least apev2_size() bytes available*/
+void
+apev2_build(unsigned item_count,
+            const struct apev2_item items[],
+            int has_header,
+            int has_footer,
+            uint8_t *output);
+
+#endif
@@ -0,0 +1,407 @@
+#!/usr/bin/python
+
+# Audio Tools, a module and set of tools for manipulating audio data
+# Copyright (C) 2007-2016  Brian Langenberger
+
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+"""measures codec and PCM conversion performance
+
+every case reads from the deterministic generators in audiotools.decoders
+(or from the 1h.flac test file) and runs in its own subprocess
+so that its peak RSS isn't skewed by the cases before it
+
+results are written as JSON and may be compared against
+a previous run's results, exiting with an error if any case
+has regressed by more than the given threshold"""
+
+import sys
+import os
+import os.path
+import json
+import time
+import platform
+import resource
+import tempfile
+import audiotools
+from audiotools.decoders import Sine_Mono, Sine_Stereo, Sine_Simple, SameSample
+
+
+# PCM frames requested per read() call
+BLOCK_SIZE = 4096
+
+SAMPLE_RATE = 44100
+
+CORPUS = ["1h.flac"]
+
+
+# each source takes a total number of PCM frames
+# and returns a new PCMReader generating the same samples every time
+SOURCES = {
+    "sine16_stereo":
+    lambda pcm_frames: Sine_Stereo(16, pcm_frames, SAMPLE_RATE,
+                                   441.0, 0.50, 4410.0, 0.49, 1.0),
+    "sine24_stereo":
+    lambda pcm_frames: Sine_Stereo(24, pcm_frames, SAMPLE_RATE,
+                                   441.0, 0.50, 4410.0, 0.49, 1.0),
+    "sine24_mono":
+    lambda pcm_frames: Sine_Mono(24, pcm_frames, SAMPLE_RATE,
+                                 441.0, 0.61, 661.5, 0.37),
+    "simple16_mono":
+    lambda pcm_frames: Sine_Simple(pcm_frames, 16, SAMPLE_RATE,
+                                   32767, 100),
+    "same16_6ch":
+    lambda pcm_frames: SameSample(1000, pcm_frames, SAMPLE_RATE,
+                                  6, 0x3F, 16)}
+
+
+def __stage__(name):
+    from audiotools.pcmconverter import (Averager,
+                                         Downmixer,
+                                         Resampler,
+                                         PolyphaseResampler,
+                                         BPSConverter)
+
+    # each stage is a (source name, PCMReader wrapper) tuple
+    return {
+        "Averager":
+        ("sine16_stereo", lambda r: Averager(r)),
+        "Downmixer":
+        ("same16_6ch", lambda r: Downmixer(r)),
+        "Resampler":
+        ("simple16_mono", lambda r: Resampler(r, 48000)),
+        "PolyphaseResampler":
+        ("simple16_mono", lambda r: PolyphaseResampler(r, 48000)),
+        "BPSConverter":
+        ("sine24_mono", lambda r: BPSConverter(r, 16, 1)),
+        "PCMConverter":
+        ("sine24_stereo",
+         lambda r: audiotools.PCMConverter(r, 48000, 1, 0x4, 16))}[name]
+
+
+STAGES = ["Averager", "Downmixer", "Resampler", "PolyphaseResampler",
+          "BPSConverter", "PCMConverter"]
+
+
+def latency_stats(latencies):
+    """given a list of call durations in seconds
+    returns a dict of summary values in microseconds"""
+
+    if len(latencies) == 0:
+        return {"calls": 0}
+
+    latencies = sorted(latencies)
+
+    def percentile(p):
+        return latencies[min(int(len(latencies) * p), len(latencies) - 1)]
+
+    return {"calls": len(latencies),
+            "mean_us": sum(latencies) / len(latencies) * 1e6,
+            "p50_us": percentile(0.50) * 1e6,
+            "p99_us": percentile(0.99) * 1e6,
+            "max_us": latencies[-1] * 1e6}
+
+
+def read_all(pcmreader):
+    """reads pcmreader to its end, closes it
+    and returns (pcm_frames, elapsed, [read latencies]) in seconds"""
+
+    clock = time.perf_counter
+    latencies = []
+    pcm_frames = 0
+    start = clock()
+    while True:
+        before = clock()
+        frame = pcmreader.read(BLOCK_SIZE)
+        latencies.append(clock() - before)
+        if frame.frames == 0:
+            break
+        pcm_frames += frame.frames
+    elapsed = clock() - start
+    pcmreader.close()
+    return (pcm_frames, elapsed, latencies)
+
+
+def __encode__(audio_class, compression, source, pcm_frames, repeat,
+               temp_dir):
+    filename = os.path.join(temp_dir, "benchmark." + audio_class.SUFFIX)
+    times = []
+    for i in range(repeat):
+        start = time.perf_counter()
+        track = audio_class.from_pcm(filename,
+                                     SOURCES[source](pcm_frames),
+                                     compression,
+                                     pcm_frames)
+        times.append(time.perf_counter() - start)
+    return {"pcm_frames": pcm_frames,
+            "sample_rate": SAMPLE_RATE,
+            "elapsed": min(times),
+            "bytes": os.path.getsize(track.filename),
+            "latency": latency_stats(times)}
+
+
+def __decode__(filename, repeat):
+    track = audiotools.open(filename)
+    runs = [read_all(track.to_pcm()) for i in range(repeat)]
+    return {"pcm_frames": runs[0][0],
+            "sample_rate": track.sample_rate(),
+            "elapsed": min(r[1] for r in runs),
+            "latency": latency_stats([l for r in runs for l in r[2]])}
+
+
+def __convert__(stage, pcm_frames, repeat):
+    (source, wrapper) = __stage__(stage)
+    runs = [read_all(wrapper(SOURCES[source](pcm_frames)))
+            for i in range(repeat)]
+    return {"pcm_frames": pcm_frames,
+            "sample_rate": SAMPLE_RATE,
+            "elapsed": min(r[1] for r in runs),
+            "latency": latency_stats([l for r in runs for l in r[2]])}
+
+
+def __failed__(message):
+    raise ValueError(message)
+
+
+def run_case(function, *args):
+    """runs function(*args) in a subprocess which returns a dict of results
+    and returns that dict with its throughput and peak RSS added"""
+
+    from multiprocessing import Process, Pipe
+
+    def measure(result_pipe):
+        try:
+            rss_start = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+            result = function(*args)
+            usage = resource.getrusage(resource.RUSAGE_SELF)
+            result["peak_rss_kb"] = usage.ru_maxrss
+            result["rss_growth_kb"] = usage.ru_maxrss - rss_start
+            result_pipe.send((False, result))
+        except Exception as err:
+            result_pipe.send((True, "{}: {}".format(type(err).__name__, err)))
+        result_pipe.close()
+
+    (parent_conn, child_conn) = Pipe(False)
+    process = Process(target=measure, args=(child_conn,))
+    process.start()
+    child_conn.close()
+    try:
+        (error, result) = parent_conn.recv()
+    except EOFError:
+        (error, result) = (True, "subprocess exited unexpectedly")
+    process.join()
+
+    if error:
+        return {"error": result}
+    else:
+        if result["elapsed"] > 0:
+            result["frames_per_second"] = \
+                result["pcm_frames"] / result["elapsed"]
+            result["realtime"] = \
+                result["frames_per_second"] / result["sample_rate"]
+        return result
+
+
+def cases(options, temp_dir):
+    """yields (name, function, args) tuples for every case to run"""
+
+    pcm_frames = int(options.seconds * SAMPLE_RATE)
+
+    for audio_class in audiotools.AVAILABLE_TYPES:
+        if ((options.formats and
+             (audio_class.NAME not in options.formats))):
+            continue
+        elif not (audio_class.supports_from_pcm() and
+                  audio_class.supports_to_pcm()):
+            continue
+
+        for compression in audio_class.COMPRESSION_MODES:
+            name = "{}/{}".format(audio_class.NAME,
+                                  compression if compression else "default")
+            encoded = os.path.join(temp_dir,
+                                   "{}-{}.{}".format(audio_class.NAME,
+                                                     compression,
+                                                     audio_class.SUFFIX))
+            yield ("encode/" + name,
+                   __encode__,
+                   (audio_class, compression, options.source, pcm_frames,
+                    options.repeat, temp_dir))
+
+            # encode a copy to decode outside of the timed case
+            try:
+                audio_class.from_pcm(encoded,
+                                     SOURCES[options.source](pcm_frames),
+                                     compression,
+                                     pcm_frames)
+                yield ("decode/" + name,
+                       __decode__,
+                       (encoded, options.repeat))
+            except audiotools.EncodingError as err:
+                yield ("decode/" + name, __failed__, (str(err),))
+
+    if not options.formats:
+        for filename in CORPUS:
+            yield ("decode/corpus/" + filename,
+                   __decode__,
+                   (filename, options.repeat))
+
+        for stage in STAGES:
+            yield ("pcmconverter/" + stage,
+                   __convert__,
+                   (stage, pcm_frames, options.repeat))
+
+
+def compare(results, baseline, threshold, rss_threshold):
+    """returns a list of (case name, message) tuples
+    for every case in results which regressed from baseline"""
+
+    regressions = []
+    for (name, result) in sorted(results.items()):
+        if (name not in baseline) or ("error" in result):
+            continue
+        base = baseline[name]
+
+        if (("frames_per_second" in result) and
+                ("frames_per_second" in base)):
+            change = ((result["frames_per_second"] -
+                       base["frames_per_second"]) /
+                      base["frames_per_second"] * 100)
+            if change < -threshold:
+                regressions.append(
+                    (name, "throughput {:+.1f}%".format(change)))
+
+        if ((rss_threshold is not None) and
+                ("peak_rss_kb" in result) and ("peak_rss_kb" in base)):
+            change = ((result["peak_rss_kb"] - base["peak_rss_kb"]) /
+                      base["peak_rss_kb"] * 100)
+            if change > rss_threshold:
+                regressions.append(
+                    (name, "peak RSS {:+.1f}%".format(change)))
+
+    return regressions
+
+
+if (__name__ == '__main__'):
+    import argparse
+    import shutil
+
+    parser = argparse.ArgumentParser(
+        description="codec and PCM conversion benchmarks")
+
+    parser.add_argument("-o", "--output",
+                        dest="output",
+                        metavar="FILENAME",
+                        help="JSON file to write results to")
+
+    parser.add_argument("-b", "--baseline",
+                        dest="baseline",
+                        metavar="FILENAME",
+                        help="JSON results of a previous run to compare to")
+
+    parser.add_argument("-t", "--threshold",
+                        type=float,
+                        default=10.0,
+                        dest="threshold",
+                        metavar="PERCENT",
+                        help="largest allowed throughput loss from baseline")
+
+    parser.add_argument("--rss-threshold",
+                        type=float,
+                        default=None,
+                        dest="rss_threshold",
+                        metavar="PERCENT",
+                        help="largest allowed peak RSS gain from baseline")
+
+    parser.add_argument("-s", "--seconds",
+                        type=float,
+                        default=30.0,
+                        dest="seconds",
+                        help="seconds of generated audio per case")
+
+    parser.add_argument("-r", "--repeat",
+                        type=int,
+                        default=3,
+                        dest="repeat",
+                        help="runs per case, of which the fastest is kept")
+
+    parser.add_argument("--source",
+                        choices=sorted(SOURCES.keys()),
+                        default="sine16_stereo",
+                        dest="source",
+                        help="generated stream to encode")
+
+    parser.add_argument("-f", "--format",
+                        action="append",
+                        default=[],
+                        dest="formats",
+                        metavar="TYPE",
+                        help="only benchmark the given audio type, " +
+                        "which may be given more than once")
+
+    options = parser.parse_args()
+
+    if (options.seconds <= 0) or (options.repeat < 1):
+        parser.error("seconds and repeat must be positive")
+
+    baseline = None
+    if options.baseline is not None:
+        with open(options.baseline, "r") as f:
+            baseline = json.load(f)["results"]
+
+    results = {}
+    temp_dir = tempfile.mkdtemp()
+    try:
+        for (name, function, args) in cases(options, temp_dir):
+            sys.stderr.write("{} ... ".format(name))
+            sys.stderr.flush()
+            results[name] = result = run_case(function, *args)
+            if "error" in result:
+                sys.stderr.write("error: {}\n".format(result["error"]))
+            else:
+                sys.stderr.write(
+                    "{:.1f}x realtime, {:d} KiB peak RSS\n".format(
+                        result.get("realtime", 0.0), result["peak_rss_kb"]))
+    finally:
+        shutil.rmtree(temp_dir)
+
+    report = {"version": audiotools.VERSION,
+              "python": platform.python_version(),
+              "platform": platform.platform(),
+              "machine": platform.machine(),
+              "conversion_isa": audiotools.pcm.conversion_isas()[-1],
+              "seconds": options.seconds,
+              "repeat": options.repeat,
+              "source": options.source,
+              "block_size": BLOCK_SIZE,
+              "results": results}
+
+    if options.output is not None:
+        with open(options.output, "w") as f:
+            json.dump(report, f, indent=2, sort_keys=True)
+    else:
+        json.dump(report, sys.stdout, indent=2, sort_keys=True)
+        sys.stdout.write("\n")
+
+    failed = len([r for r in results.values() if "error" in r]) > 0
+
+    if baseline is not None:
+        regressions = compare(results, baseline,
+                              options.threshold, options.rss_threshold)
+        for (name, message) in regressions:
+            sys.stderr.write("REGRESSION {}: {}\n".format(name, message))
+        if len(regressions) > 0:
+            failed = True
+
+    sys.exit(1 if failed else 0)
@@ -427,6 +427,141 @@ class PCMReaderWindow(unittest.TestCase):
                 self.assertRaises(ValueError, main_reader.read, 2)
 
 
+class PCMSplitter(unittest.TestCase):
+    def __pcmreader__(self, samples, channels, bits_per_sample):
+        from audiotools.pcm import from_list
+
+        return audiotools.PCMFileReader(
+            BytesIO(from_list(samples,
+                              channels,
+                              bits_per_sample,
+                              True).to_bytes(False, True)),
+            sample_rate=44100,
+            channels=channels,
+            channel_mask=0,
+            bits_per_sample=bits_per_sample)
+
+    @LIB_PCM
+    def test_spans(self):
+        import random
+
+        channels = 2
+        for bits_per_sample in [8, 16, 24]:
+            limit = 1 << (bits_per_sample - 1)
+            samples = [random.randint(-limit, limit - 1)
+                       for i in range(20000 * channels)]
+
+            # spans with gaps, a span straddling the end of the stream
+            # and one entirely past it
+            spans = [(0, 0), (10, 5000), (5010, 3), (6000, 13000),
+                     (19000, 2000), (25000, 10)]
+
+            # a small buffer forces the splitter to wait on each reader
+            for buffer_size in [1, 1000, 2 ** 24]:
+                splitter = audiotools.PCMSplitter(
+                    self.__pcmreader__(samples, channels, bits_per_sample),
+                    spans,
+                    buffer_size)
+                for (index, (offset, pcm_frames)) in enumerate(spans):
+                    reader = splitter.reader(index)
+                    self.assertEqual(reader.sample_rate, 44100)
+                    self.assertEqual(reader.channels, channels)
+                    self.assertEqual(reader.bits_per_sample,
+                                     bits_per_sample)
+
+                    span = []
+                    f = reader.read(4096)
+                    while len(f) > 0:
+                        span.extend(list(f))
+                        f = reader.read(4096)
+                    reader.close()
+
+                    target = samples[offset * channels:
+                                     (offset + pcm_frames) * channels]
+                    target += [0] * (pcm_frames * channels - len(target))
+                    self.assertEqual(span, target)
+                splitter.close()
+
+    @LIB_PCM
+    def test_overlapping_spans(self):
+        import threading
+
+        samples = list(range(-10000, 10000))
+        spans = [(0, None), (500, 1000), (0, 20000), (19000, 3000),
+                 (15000, None)]
+        results = [None] * len(spans)
+
+        def read_span(reader, index):
+            span = []
+            f = reader.read(4096)
+            while len(f) > 0:
+                span.extend(list(f))
+                f = reader.read(4096)
+            reader.close()
+            results[index] = span
+
+        # overlapping spans are read concurrently
+        splitter = audiotools.PCMSplitter(
+            self.__pcmreader__(samples, 1, 16), spans, 1000)
+        threads = [threading.Thread(target=read_span,
+                                    args=(splitter.reader(i), i))
+                   for i in range(len(spans))]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        splitter.close()
+
+        self.assertEqual(results[0], samples)
+        self.assertEqual(results[1], samples[500:1500])
+        self.assertEqual(results[2], samples)
+        self.assertEqual(results[3], samples[19000:] + [0] * 2000)
+        self.assertEqual(results[4], samples[15000:])
+
+    @LIB_PCM
+    def test_unread_spans(self):
+        samples = list(range(-5000, 5000))
+        spans = [(0, 1000), (2000, 5000), (8000, 2000)]
+
+        # closing a span's reader early discards the rest of it
+        splitter = audiotools.PCMSplitter(
+            self.__pcmreader__(samples, 1, 16), spans, 1)
+        splitter.reader(0).close()
+        reader = splitter.reader(1)
+        self.assertEqual(list(reader.read(10)), samples[2000:2010])
+        reader.close()
+        reader = splitter.reader(2)
+        f = reader.read(10000)
+        self.assertEqual(list(f), samples[8000:10000])
+        reader.close()
+        splitter.close()
+
+        # spans which are never read are discarded when closed
+        splitter = audiotools.PCMSplitter(
+            self.__pcmreader__(samples, 1, 16), spans, 1)
+        splitter.close()
+
+    @LIB_PCM
+    def test_errors(self):
+        samples = list(range(100))
+
+        for spans in [[(-1, 10)], [(0, 10), (5, -1)]]:
+            self.assertRaises(ValueError,
+                              audiotools.PCMSplitter,
+                              self.__pcmreader__(samples, 1, 16),
+                              spans)
+
+        # decoding errors are raised once the splitter is closed
+        splitter = audiotools.PCMSplitter(
+            audiotools.PCMReaderError(u"error",
+                                      44100, 1, 0, 16),
+            [(0, 10)])
+        reader = splitter.reader(0)
+        self.assertEqual(len(reader.read(10)), 0)
+        reader.close()
+        self.assertRaises(audiotools.DecodingError, splitter.close)
+
+
 class Sines(unittest.TestCase):
     @LIB_PCM
     def test_pcm(self):
@@ -560,6 +695,45 @@ class CDDA(unittest.TestCase):
 
         self.assertRaises(ValueError, cdda.seek, 10)
 
+    @LIB_CDIO
+    def test_readahead(self):
+        from audiotools.cdio import CDDAReader
+
+        self.assertRaises(ValueError, CDDAReader, self.cue, False, -1)
+
+        # read-ahead buffers both smaller and larger than the reads
+        for readahead in [1, 10, 750]:
+            cdda = CDDAReader(self.cue, False, readahead)
+
+            # verify whole disc
+            checksum = md5()
+            frame = cdda.read(44100)
+            while len(frame) > 0:
+                checksum.update(frame.to_bytes(False, True))
+                frame = cdda.read(44100)
+            self.assertEqual(self.reader.hexdigest(),
+                             checksum.hexdigest())
+            self.assertEqual(cdda.read(44100).frames, 0)
+
+            # verify seeking discards whatever was read ahead
+            for track_num in sorted(cdda.track_offsets.keys(), reverse=True):
+                offset = cdda.track_offsets[track_num]
+                length = cdda.track_lengths[track_num]
+                remaining_offset = offset - cdda.seek(offset)
+                self.reader.reset()
+                self.assertTrue(audiotools.pcm_cmp(
+                    audiotools.PCMReaderWindow(cdda,
+                                               remaining_offset,
+                                               length,
+                                               False),
+                    audiotools.PCMReaderWindow(self.reader, offset, length)))
+
+            # verify closing mid-stream stops the reader thread
+            cdda.seek(0)
+            cdda.read(4410)
+            cdda.close()
+            self.assertRaises(ValueError, cdda.read, 10)
+
 
 class ChannelMask(unittest.TestCase):
     @LIB_CORE
@@ -861,6 +1035,168 @@ class PCMConverter(unittest.TestCase):
                 # when converter is closed
                 self.assertRaises(ValueError, main_reader.read, 4096)
 
+    @LIB_PCM
+    def test_polyphase_resampler(self):
+        from audiotools.pcmconverter import (Resampler,
+                                             PolyphaseResampler)
+
+        def sine(sample_rate):
+            return test_streams.Sine16_Stereo(sample_rate, sample_rate,
+                                              441.0, 0.50,
+                                              4410.0, 0.49, 1.0)
+
+        def samples(pcmreader):
+            data = []
+            f = pcmreader.read(4096)
+            while len(f) > 0:
+                data.extend(f)
+                f = pcmreader.read(4096)
+            pcmreader.close()
+            return data
+
+        for (input_rate, output_rate) in [(44100, 48000),
+                                          (22050, 48000),
+                                          (96000, 48000),
+                                          (48000, 44100)]:
+            resampler = PolyphaseResampler(sine(input_rate), output_rate)
+            self.assertEqual(resampler.sample_rate, output_rate)
+            self.assertEqual(resampler.channels, 2)
+            self.assertEqual(resampler.channel_mask, 0x3)
+            self.assertEqual(resampler.bits_per_sample, 16)
+            polyphase = samples(resampler)
+            reference = samples(Resampler(sine(input_rate), output_rate))
+
+            # one second of input yields one second of output
+            self.assertEqual(len(polyphase), output_rate * 2)
+            self.assertLessEqual(abs(len(polyphase) - len(reference)), 2)
+
+            # and is within 60dB of libsamplerate's best quality output
+            signal = sum(s * s for s in reference[:len(polyphase)])
+            noise = sum((p - r) ** 2 for (p, r) in zip(polyphase, reference))
+            self.assertGreater(signal, noise * 10 ** 6)
+
+        # a ratio too fine for a filter bank is rejected
+        self.assertRaises(ValueError, PolyphaseResampler, sine(44100), 48001)
+        self.assertRaises(ValueError, PolyphaseResampler, sine(44100), 0)
+
+        # streams too short for a whole filter still resample
+        self.assertEqual(
+            len(samples(PolyphaseResampler(
+                test_streams.Sine16_Stereo(3, 44100,
+                                           441.0, 0.50,
+                                           4410.0, 0.49, 1.0),
+                48000))),
+            4 * 2)
+
+    @LIB_PCM
+    def test_dither(self):
+        from audiotools.pcmconverter import BPSConverter
+
+        def sine():
+            return test_streams.Sine24_Stereo(200000, 48000,
+                                              441.0, 0.50,
+                                              441.0, 0.49, 1.0)
+
+        def samples(pcmreader):
+            data = []
+            f = pcmreader.read(4096)
+            while len(f) > 0:
+                data.extend(f)
+                f = pcmreader.read(4096)
+            pcmreader.close()
+            return data
+
+        def converted(seed, noise_shaping=False):
+            return samples(BPSConverter(sine(),
+                                        16,
+                                        seed=seed,
+                                        noise_shaping=noise_shaping))
+
+        # the same seed yields the same dither
+        self.assertEqual(converted(1), converted(1))
+        self.assertEqual(converted(1, True), converted(1, True))
+        self.assertNotEqual(converted(1), converted(2))
+        self.assertNotEqual(converted(1), converted(1, True))
+
+        # noise_shaping takes any truth value
+        self.assertEqual(converted(1, 1), converted(1, True))
+        self.assertEqual(converted(1, None), converted(1, False))
+
+        # TPDF dither stays within 1 LSB of the rounded sample
+        # and averages out to the original
+        source = [s / 256.0 for s in samples(sine())]
+        dithered = converted(None)
+        self.assertEqual(len(dithered), len(source))
+        for (d, s) in zip(dithered, source):
+            self.assertLess(abs(d - s), 1.5)
+        self.assertLess(abs(sum(d - s for (d, s) in
+                                zip(dithered, source)) / len(source)),
+                        0.01)
+
+        # noise shaping stays within a few LSBs of the original
+        for (d, s) in zip(converted(None, True), source):
+            self.assertLess(abs(d - s), 3.0)
+
+        self.assertRaises(TypeError, BPSConverter, sine(), 16, seed="seed")
+
+    @LIB_PCM
+    def test_pcm_source(self):
+        from audiotools.pcmconverter import (Averager,
+                                             Downmixer,
+                                             Resampler,
+                                             PolyphaseResampler,
+                                             BPSConverter)
+
+        class Forwarder(audiotools.PCMReader):
+            # hides any native source behind a Python read() method
+            def __init__(self, pcmreader):
+                audiotools.PCMReader.__init__(
+                    self,
+                    sample_rate=pcmreader.sample_rate,
+                    channels=pcmreader.channels,
+                    channel_mask=pcmreader.channel_mask,
+                    bits_per_sample=pcmreader.bits_per_sample)
+                self.pcmreader = pcmreader
+
+            def read(self, pcm_frames):
+                return self.pcmreader.read(pcm_frames)
+
+            def close(self):
+                self.pcmreader.close()
+
+        class SubclassedBPSConverter(BPSConverter):
+            pass
+
+        def sine():
+            return test_streams.Simple_Sine(100000, 48000, 0x3F, 24,
+                                            (1638400, 10000),
+                                            (2949120, 15000),
+                                            (4259840, 20000),
+                                            (5570560, 25000),
+                                            (1638400, 30000),
+                                            (2949120, 35000))
+
+        def chain(wrap):
+            return Resampler(
+                wrap(BPSConverter(
+                    wrap(Downmixer(wrap(sine()))), 16, seed=1)),
+                44100)
+
+        self.assertIsNotNone(chain(lambda r: r)._pcm_source)
+        self.assertIsNone(SubclassedBPSConverter(sine(), 16)._pcm_source)
+
+        # converters reading each other natively
+        # should produce the same stream as reading through FrameLists
+        self.assertIsNone(
+            audiotools.pcm_frame_cmp(chain(lambda r: r), chain(Forwarder)))
+        self.assertIsNone(
+            audiotools.pcm_frame_cmp(Averager(sine()),
+                                     Forwarder(Averager(Forwarder(sine())))))
+        self.assertIsNone(
+            audiotools.pcm_frame_cmp(
+                PolyphaseResampler(sine(), 44100),
+                Forwarder(PolyphaseResampler(Forwarder(sine()), 44100))))
+
 
 class Test_ReplayGain(unittest.TestCase):
     @LIB_CORE
@@ -916,6 +1252,93 @@ class Test_filename_to_type(unittest.TestCase):
             temp.close()
 
 
+class Test_convert_many(unittest.TestCase):
+    @LIB_CORE
+    def test_convert_many(self):
+        class HalfRateFlac(audiotools.FlacAudio):
+            @classmethod
+            def from_pcm_format(cls, sample_rate, channels, channel_mask,
+                                bits_per_sample):
+                return (sample_rate // 2, 1, 0x4, 16)
+
+        temp_dir = tempfile.mkdtemp()
+        try:
+            source = audiotools.WaveAudio.from_pcm(
+                os.path.join(temp_dir, "source.wav"),
+                test_streams.Sine16_Stereo(200000, 44100,
+                                           441.0, 0.50, 4410.0, 0.49, 1.0))
+
+            targets = [
+                (os.path.join(temp_dir, "1.flac"),
+                 audiotools.FlacAudio, "0"),
+                (os.path.join(temp_dir, "2.flac"),
+                 HalfRateFlac, "0"),
+                (os.path.join(temp_dir, "3.wav"),
+                 audiotools.WaveAudio, None),
+                (os.path.join(temp_dir, "4.flac"),
+                 HalfRateFlac, "8")]
+
+            progress = []
+            tracks = source.convert_many(targets, progress.append)
+            self.assertEqual(progress[-1], 1)
+
+            self.assertEqual(len(tracks), len(targets))
+            for (track, (filename, audio_class, compression)) in zip(
+                    tracks, targets):
+                self.assertIsInstance(track, audio_class)
+                self.assertEqual(track.filename, filename)
+
+            # unconverted targets are exact copies
+            for track in [tracks[0], tracks[2]]:
+                self.assertEqual(track.total_frames(), 200000)
+                self.assertIsNone(
+                    audiotools.pcm_frame_cmp(track.to_pcm(),
+                                             source.to_pcm()))
+
+            # converted targets match a single conversion
+            for track in [tracks[1], tracks[3]]:
+                self.assertEqual(track.sample_rate(), 22050)
+                self.assertEqual(track.channels(), 1)
+                self.assertEqual(track.bits_per_sample(), 16)
+                self.assertIsNone(
+                    audiotools.pcm_frame_cmp(
+                        track.to_pcm(),
+                        audiotools.PCMConverter(source.to_pcm(),
+                                                22050, 1, 0x4, 16)))
+
+            # encoding errors remove every target
+            for (filename, audio_class, compression) in targets:
+                os.unlink(filename)
+            self.assertRaises(
+                audiotools.EncodingError,
+                audiotools.from_pcm_many,
+                audiotools.PCMReaderError(u"error", 44100, 2, 0x3, 16),
+                targets)
+            for (filename, audio_class, compression) in targets:
+                self.assertFalse(os.path.isfile(filename))
+
+            # an encoding subprocess which dies is an error
+            # rather than leaving its result pipe open in its siblings
+            class DyingFlac(audiotools.FlacAudio):
+                @classmethod
+                def from_pcm(cls, filename, pcmreader,
+                             compression=None, total_pcm_frames=None):
+                    os._exit(1)
+
+            targets[1] = (targets[1][0], DyingFlac, "0")
+            self.assertRaises(
+                audiotools.EncodingError,
+                audiotools.from_pcm_many,
+                source.to_pcm(),
+                targets)
+            for (filename, audio_class, compression) in targets:
+                self.assertFalse(os.path.isfile(filename))
+        finally:
+            for f in os.listdir(temp_dir):
+                os.unlink(os.path.join(temp_dir, f))
+            os.rmdir(temp_dir)
+
+
 class Test_group_tracks(unittest.TestCase):
     @LIB_CORE
     def setUp(self):
@@ -1106,6 +1529,80 @@ class Test_open_files(unittest.TestCase):
         self.assertEqual([t.filename for t in tracks],
                          [t.filename for t in [track1, track2, track3]])
 
+    @LIB_CORE
+    def test_properties_cache(self):
+        from audiotools.propcache import (PropertiesCache, CachedAudioFile)
+
+        track1 = self.make_track(self.dir, 1)
+        track2 = self.make_track(self.dir, 2)
+        track2.set_replay_gain(audiotools.ReplayGain(-1.5, 0.5, -2.5, 0.75))
+        dummy1_name = os.path.join(self.dir, "3" + self.suffix)
+        dummy1 = open(dummy1_name, "wb")
+        dummy1.write(b"Hello World")
+        dummy1.close()
+        filenames = [track2.filename, dummy1_name, track1.filename]
+        cache_name = os.path.join(self.dir, "properties.db")
+
+        # the first pass opens files normally and populates the cache
+        with PropertiesCache(cache_name) as cache:
+            tracks = audiotools.open_files(filenames,
+                                           properties_cache=cache)
+            for t in tracks:
+                self.assertNotIsInstance(t, CachedAudioFile)
+            self.assertEqual([t.filename for t in tracks],
+                             [track1.filename, track2.filename])
+
+        # the second pass is answered from the cache
+        with PropertiesCache(cache_name) as cache:
+            self.assertIsNone(cache.open(dummy1_name))
+            tracks = audiotools.open_files(filenames,
+                                           properties_cache=cache)
+        self.assertEqual([t.filename for t in tracks],
+                         [track1.filename, track2.filename])
+        for (cached, track) in zip(tracks, [track1, track2]):
+            self.assertIsInstance(cached, CachedAudioFile)
+            self.assertIsInstance(cached, audiotools.FlacAudio)
+            self.assertIsNone(cached.__audiofile__)
+            self.assertEqual(cached.sample_rate(), track.sample_rate())
+            self.assertEqual(cached.channels(), track.channels())
+            self.assertEqual(int(cached.channel_mask()),
+                             int(track.channel_mask()))
+            self.assertEqual(cached.bits_per_sample(),
+                             track.bits_per_sample())
+            self.assertEqual(cached.total_frames(), track.total_frames())
+            self.assertEqual(cached.seconds_length(), track.seconds_length())
+            self.assertEqual(cached.get_replay_gain(),
+                             track.get_replay_gain())
+            self.assertEqual(cached, track)
+            self.assertIsNone(cached.__audiofile__)
+
+            # as are class attributes and methods
+            self.assertEqual(cached.NAME, track.NAME)
+            self.assertEqual(cached.SUFFIX, track.SUFFIX)
+            self.assertEqual(cached.lossless(), track.lossless())
+            self.assertEqual(cached.supports_metadata(),
+                             track.supports_metadata())
+            self.assertEqual(cached.supports_replay_gain(),
+                             track.supports_replay_gain())
+            self.assertEqual(cached.supports_cuesheet(),
+                             track.supports_cuesheet())
+            self.assertIsNone(cached.__audiofile__)
+
+            # anything else opens the actual file
+            self.assertEqual(cached.get_metadata(), track.get_metadata())
+            self.assertIsNotNone(cached.__audiofile__)
+
+        # modifying a file invalidates its entry
+        track1.set_metadata(audiotools.MetaData(track_name=u"Track Name",
+                                                track_number=4))
+        with PropertiesCache(cache_name) as cache:
+            tracks = audiotools.open_files(filenames,
+                                           properties_cache=cache)
+        self.assertEqual([t.filename for t in tracks],
+                         [track2.filename, track1.filename])
+        self.assertIsInstance(tracks[0], CachedAudioFile)
+        self.assertNotIsInstance(tracks[1], CachedAudioFile)
+
 
 class Test_sorted_tracks(unittest.TestCase):
     @LIB_CORE
@@ -1293,6 +1790,41 @@ class Test_pcm_frame_cmp(unittest.TestCase):
         self.assertEqual(reader1.closes_called, 1)
         self.assertEqual(reader2.closes_called, 1)
 
+    @LIB_CORE
+    def test_pcm_frame_cmp_offsets(self):
+        from io import BytesIO
+
+        data = bytearray(os.urandom(100000 * 4))
+
+        def pcmreader(data):
+            return audiotools.PCMFileReader(BytesIO(bytes(data)),
+                                            sample_rate=44100,
+                                            channels=2,
+                                            channel_mask=0x3,
+                                            bits_per_sample=16)
+
+        # streams read in differently-sized blocks should still match
+        self.assertIsNone(
+            audiotools.pcm_frame_cmp(pcmreader(data),
+                                     Variable_Reader(pcmreader(data))))
+
+        # a mismatch in either channel of any frame should be found
+        for frame in [0, 1, 4095, 65536, 70001, 99999]:
+            for channel in [0, 1]:
+                bad_data = bytearray(data)
+                bad_data[(frame * 4) + (channel * 2)] ^= 1
+                self.assertEqual(
+                    audiotools.pcm_frame_cmp(
+                        Variable_Reader(pcmreader(data)),
+                        pcmreader(bad_data)),
+                    frame)
+
+        # a stream ending early should return its length
+        self.assertEqual(
+            audiotools.pcm_frame_cmp(pcmreader(data),
+                                     pcmreader(data[0:70001 * 4])),
+            70001)
+
 
 class TestFrameList(unittest.TestCase):
     if sys.version_info[0] >= 3:
@@ -1770,6 +2302,63 @@ class TestFrameList(unittest.TestCase):
             audiotools.pcm.FrameList(s, 1, 24,
                                      False, True).to_bytes(False, True), s)
 
+    @LIB_CORE
+    def test_conversion_isas(self):
+        import audiotools.pcm
+        from random import Random
+
+        isas = audiotools.pcm.conversion_isas()
+        self.assertEqual(isas[0], "scalar")
+        self.assertRaises(ValueError,
+                          audiotools.pcm.set_conversion_isa,
+                          "foo")
+
+        # lengths which cover every kernel's block size
+        # along with any leftover samples handled afterward
+        rng = Random(42)
+        try:
+            for isa in isas:
+                audiotools.pcm.set_conversion_isa(isa)
+                for bps in [8, 16, 24]:
+                    width = bps // 8
+                    for samples in list(range(70)) + [255, 1024]:
+                        s = bytes(bytearray(rng.randint(0, 255)
+                                            for i in range(samples * width)))
+                        for big_endian in [True, False]:
+                            for signed in [True, False]:
+                                values = [
+                                    int.from_bytes(
+                                        s[i:i + width],
+                                        "big" if big_endian else "little",
+                                        signed=signed) -
+                                    (0 if signed else 1 << (bps - 1))
+                                    for i in range(0, len(s), width)]
+                                framelist = audiotools.pcm.FrameList(
+                                    s, 1, bps, big_endian, signed)
+                                self.assertEqual(list(framelist), values,
+                                                 isa)
+                                self.assertEqual(
+                                    framelist.to_bytes(big_endian, signed),
+                                    s,
+                                    isa)
+
+                # out-of-range values are clamped
+                for bps in [8, 16, 24]:
+                    width = bps // 8
+                    top = (1 << (bps - 1)) - 1
+                    expected = b"".join(
+                        [top.to_bytes(width, "little", signed=True),
+                         (-top - 1).to_bytes(width, "little", signed=True)] *
+                        20)
+                    self.assertEqual(
+                        audiotools.pcm.from_list(
+                            [1 << 30, -(1 << 30)] * 20,
+                            1, bps, True).to_bytes(False, True),
+                        expected,
+                        isa)
+        finally:
+            audiotools.pcm.set_conversion_isa(isas[-1])
+
     @LIB_CORE
     def test_conversion(self):
         import sys
@@ -2827,6 +3416,85 @@ class Bitstream(unittest.TestCase):
                                    build(format_string, True, values)),
                              values)
 
+    @LIB_BITSTREAM
+    def test_format(self):
+        from audiotools.bitstream import (Format, BitstreamReader,
+                                          BitstreamRecorder, BitstreamWriter,
+                                          format_size, format_byte_size,
+                                          parse, build)
+        from io import BytesIO
+
+        data = ints_to_bytes([0xB1, 0xED, 0x3B, 0xC1])
+
+        for fields in ["2u 3u 5u 3u 19u",
+                       "2s 3s 5s 3s 19s",
+                       "2u 3p 5u 3p 19u",
+                       "2p 1P 3u 19u",
+                       "2b 2b",
+                       "2u a 3u a 4u a 5u",
+                       "3* 2* 2u",
+                       "2u 10* 3? 3u",
+                       ""]:
+            compiled = Format(fields)
+
+            # a compiled Format behaves like its format string
+            self.assertEqual(compiled.size(), format_size(fields))
+            self.assertEqual(compiled.byte_size(), format_byte_size(fields))
+            self.assertEqual(format_size(compiled), format_size(fields))
+            for little_endian in [False, True]:
+                values = parse(fields, little_endian, data)
+                self.assertEqual(parse(compiled, little_endian, data),
+                                 values)
+                self.assertEqual(
+                    compiled.parse(BitstreamReader(BytesIO(data),
+                                                   little_endian)),
+                    values)
+                self.assertEqual(
+                    BitstreamReader(BytesIO(data),
+                                    little_endian).parse(compiled),
+                    values)
+
+                built = build(fields, little_endian, values)
+                self.assertEqual(build(compiled, little_endian, values),
+                                 built)
+                recorder = BitstreamRecorder(little_endian)
+                compiled.build(recorder, values)
+                self.assertEqual(recorder.data(), built)
+                recorder = BitstreamRecorder(little_endian)
+                recorder.build(compiled, values)
+                self.assertEqual(recorder.data(), built)
+                output = BytesIO()
+                writer = BitstreamWriter(output, little_endian)
+                compiled.build(writer, values)
+                writer.flush()
+                self.assertEqual(output.getvalue(), built)
+
+        # a Format may be reused across many streams
+        compiled = Format("8u 8u")
+        reader = BitstreamReader(BytesIO(data), False)
+        self.assertEqual(compiled.parse(reader), [0xB1, 0xED])
+        self.assertEqual(compiled.parse(reader), [0x3B, 0xC1])
+        self.assertRaises(IOError, compiled.parse, reader)
+
+        self.assertRaises(TypeError, Format)
+        self.assertRaises(TypeError, Format, 1)
+        self.assertRaises(TypeError, compiled.parse, None)
+        self.assertRaises(TypeError, compiled.build, None, [1, 2])
+        self.assertRaises(IndexError, compiled.build,
+                          BitstreamRecorder(False), [1])
+        self.assertRaises(TypeError, parse, 1, False, data)
+
+        # format strings past the cache's capacity remain usable
+        for i in range(1, 1000):
+            self.assertEqual(format_size("{:d}u".format(i)), i)
+            self.assertEqual(format_size("{:d}u".format(1000 - i)),
+                             1000 - i)
+
+        # as do frequently used ones while others are evicted
+        for i in range(1, 1000):
+            self.assertEqual(parse("8u 8u", False, data[0:2]), [0xB1, 0xED])
+            self.assertEqual(format_size("{:d}s".format(i)), i)
+
     @LIB_BITSTREAM
     def test_simple_reader(self):
         from audiotools.bitstream import BitstreamReader, HuffmanTree
@@ -3276,11 +3944,15 @@ class Bitstream(unittest.TestCase):
             recorder.write(8, 0xCC)
             recorder.write(8, 0xDD)
             recorder.write(8, 0xEE)
+            self.assertEqual(recorder.bits(), 40)
             recorder.reset()
+            self.assertEqual(recorder.bits(), 0)
+            self.assertEqual(recorder.bytes(), 0)
             recorder.write(8, 0xB1)
             recorder.write(8, 0xED)
             recorder.write(8, 0x3B)
             recorder.write(8, 0xC1)
+            self.assertEqual(recorder.bits(), 32)
             recorder.copy(writer)
             writer.close()
             self.__check_output_file__(temp)
@@ -3758,6 +4430,179 @@ class Bitstream(unittest.TestCase):
 
                 self.assertEqual(data, w.data())
 
+    @LIB_BITSTREAM
+    def test_writer_spans(self):
+        from io import BytesIO
+        from audiotools.bitstream import BitstreamWriter
+        from audiotools.bitstream import BitstreamRecorder
+        from audiotools.bitstream import BitstreamReader
+
+        # writes of any size must complete the same bytes
+        # and call callbacks on each of them exactly once
+        r = random.Random(34)
+        values = [(size, r.getrandbits(size))
+                  for size in [r.choice([1, 3, 7, 8, 13, 25, 31, 32])
+                               for i in range(1000)]]
+        total_bits = sum(size for (size, value) in values) + 48 + 61
+
+        for little_endian in [False, True]:
+            data = BytesIO()
+            writer = BitstreamWriter(data, little_endian)
+            recorder = BitstreamRecorder(little_endian)
+            for w in [writer, recorder]:
+                callback_bytes = []
+                w.add_callback(callback_bytes.append)
+                w.build("48p", [])
+                for (size, value) in values:
+                    w.write(size, value)
+                w.build("61p", [])
+                w.byte_align()
+                w.pop_callback()
+                w.flush()
+                self.assertEqual(len(callback_bytes),
+                                 (total_bits + 7) // 8)
+                if w is writer:
+                    written = data.getvalue()
+                else:
+                    written = w.data()
+                self.assertEqual(bytes(bytearray(callback_bytes)), written)
+
+                reader = BitstreamReader(BytesIO(written), little_endian)
+                reader.skip(48)
+                for (size, value) in values:
+                    self.assertEqual(reader.read(size), value)
+                self.assertEqual(reader.read(61), 0)
+            writer.close()
+
+    @LIB_BITSTREAM
+    def test_span_checksums(self):
+        from audiotools.bitstream import checksum
+
+        # sliced CRCs over whole spans must match
+        # the same CRCs fed one byte at a time
+        # regardless of the span's alignment or length
+        r = random.Random(35)
+        small = bytes(bytearray(r.getrandbits(8) for i in range(8 + 17)))
+        large = bytes(bytearray(r.getrandbits(8) for i in range(65536 + 8)))
+
+        for (algorithm, bits) in [("flac_crc8", 8),
+                                  ("flac_crc16", 16),
+                                  ("tta_crc32", 32),
+                                  ("ogg_crc", 32)]:
+            for initial in [0, (1 << bits) - 1, r.getrandbits(bits)]:
+                for start in range(8):
+                    for length in range(18):
+                        span = memoryview(small)[start:start + length]
+                        self.assertEqual(
+                            checksum(algorithm, span, initial, True),
+                            checksum(algorithm, span, initial, False))
+                    span = memoryview(large)[start:]
+                    self.assertEqual(
+                        checksum(algorithm, span, initial, True),
+                        checksum(algorithm, span, initial, False))
+
+        self.assertEqual(checksum("flac_crc16", b""), 0)
+        self.assertRaises(ValueError, checksum, "foo", b"data")
+
+    @LIB_BITSTREAM
+    def test_span_callbacks(self):
+        from io import BytesIO
+        from audiotools.bitstream import BitstreamWriter
+        from audiotools.bitstream import BitstreamRecorder
+        from audiotools.bitstream import BitstreamReader
+
+        r = random.Random(36)
+        data = bytes(bytearray(r.getrandbits(8) for i in range(64)))
+
+        def span_callback(spans):
+            return lambda span: spans.extend(bytearray(span))
+
+        # span callbacks receive the same bytes as per-byte callbacks
+        # for bit reads, byte reads, byte alignment, skips
+        # and across directly-called and popped callbacks
+        for little_endian in [False, True]:
+            reader = BitstreamReader(BytesIO(data), little_endian)
+            per_byte = []
+            spans = []
+            reader.add_callback(per_byte.append)
+            reader.add_span_callback(span_callback(spans))
+            reader.read(3)
+            reader.read(13)
+            reader.read(5)
+            reader.byte_align()
+            reader.read_bytes(10)
+            reader.skip_bytes(3)
+            reader.skip(4)
+            reader.byte_align()
+            reader.parse("8u 3b 4p 4u")
+            reader.call_callbacks(0x7F)
+            self.assertEqual(spans, per_byte)
+            self.assertEqual(bytes(bytearray(per_byte[0:-1])),
+                             data[0:len(per_byte) - 1])
+            consumed = len(per_byte) - 1
+
+            # with the span callback popped,
+            # only the per-byte callback sees these bytes
+            callback = reader.pop_callback()
+            reader.read_bytes(2)
+            self.assertEqual(len(spans), len(per_byte) - 2)
+            reader.add_span_callback(callback)
+            reader.read_bytes(20)
+            reader.read(7)
+            reader.byte_align()
+            self.assertEqual(spans,
+                             per_byte[0:consumed + 1] +
+                             per_byte[consumed + 3:])
+            self.assertEqual(bytes(bytearray(per_byte[consumed + 1:])),
+                             data[consumed:consumed + 2 + 20 + 1])
+            reader.pop_callback()
+            reader.pop_callback()
+
+        for little_endian in [False, True]:
+            output = BytesIO()
+            writer = BitstreamWriter(output, little_endian)
+            recorder = BitstreamRecorder(little_endian)
+            for w in [writer, recorder]:
+                per_byte = []
+                spans = []
+                w.add_callback(per_byte.append)
+                w.add_span_callback(span_callback(spans))
+                w.write(3, 5)
+                w.write(13, 0x1234)
+                w.write(5, 0x11)
+                w.byte_align()
+                w.write_bytes(data[0:10])
+                w.build("8u 3b 4p 4u", [0xAA, b"xyz", 9])
+                w.write_signed(12, -300)
+                w.unary(0, 6)
+                w.byte_align()
+                w.call_callbacks(0x7F)
+                self.assertEqual(spans, per_byte)
+                marker = len(per_byte) - 1
+
+                callback = w.pop_callback()
+                w.write_bytes(data[10:12])
+                self.assertEqual(len(spans), len(per_byte) - 2)
+                w.add_span_callback(callback)
+                w.write_bytes(data[12:32])
+                w.write(7, 0x55)
+                w.byte_align()
+                self.assertEqual(spans,
+                                 per_byte[0:marker + 1] +
+                                 per_byte[marker + 3:])
+                w.pop_callback()
+                w.pop_callback()
+                w.flush()
+
+                if w is writer:
+                    written = output.getvalue()
+                else:
+                    written = w.data()
+                self.assertEqual(bytes(bytearray(per_byte[0:marker] +
+                                                 per_byte[marker + 1:])),
+                                 written)
+            writer.close()
+
     @LIB_BITSTREAM
     def test_python_reader(self):
         from audiotools.bitstream import BitstreamReader
@@ -6978,6 +7823,80 @@ class Test_Ogg(unittest.TestCase):
             ogg_writer.close()
             ogg_reader.close()
 
+    @LIB_OGG
+    def test_rewrite_header_packets(self):
+        import audiotools.ogg
+
+        def build_stream(header_packets, audio_packets):
+            ogg_stream = tempfile.NamedTemporaryFile(suffix=".ogg")
+            ogg_writer = audiotools.ogg.PageWriter(open(ogg_stream.name,
+                                                        "wb"))
+            sequence_number = 0
+            for page in audiotools.ogg.packet_to_pages(b"identification",
+                                                       1234):
+                page.stream_beginning = True
+                ogg_writer.write(page)
+                sequence_number += 1
+            for page in audiotools.ogg.packets_to_pages(
+                    header_packets, 1234,
+                    starting_sequence_number=sequence_number):
+                ogg_writer.write(page)
+                sequence_number += 1
+            pages = list(audiotools.ogg.packets_to_pages(
+                audio_packets, 1234,
+                starting_sequence_number=sequence_number))
+            pages[-1].stream_end = True
+            for page in pages:
+                ogg_writer.write(page)
+            ogg_writer.close()
+            return ogg_stream
+
+        def read_packets(filename, count):
+            with audiotools.ogg.PacketReader(
+                    audiotools.ogg.PageReader(open(filename, "rb"))) as r:
+                return [r.read_packet() for i in range(count)]
+
+        audio_packets = [os.urandom(i * 100) for i in range(1, 20)]
+
+        for (old_size, new_size) in [(100, 10),
+                                     (1000, 999),
+                                     (10000, 254),
+                                     (70000, 5000),
+                                     (300000, 200000)]:
+            codebooks = os.urandom(3000)
+            ogg_stream = build_stream([os.urandom(old_size), codebooks],
+                                      audio_packets)
+            original_size = os.path.getsize(ogg_stream.name)
+            comment = os.urandom(new_size)
+
+            self.assertTrue(audiotools.ogg.rewrite_header_packets(
+                ogg_stream.name, [comment, codebooks]))
+
+            # file size and data packets are unchanged
+            # and the comment packet is padded with NULL bytes
+            self.assertEqual(os.path.getsize(ogg_stream.name),
+                             original_size)
+            packets = read_packets(ogg_stream.name,
+                                   3 + len(audio_packets))
+            self.assertEqual(packets[0], b"identification")
+            self.assertEqual(packets[1][0:new_size], comment)
+            self.assertEqual(packets[1][new_size:],
+                             b"\x00" * (len(packets[1]) - new_size))
+            self.assertEqual(packets[2], codebooks)
+            self.assertEqual(packets[3:], audio_packets)
+            ogg_stream.close()
+
+        # packets which are too large leave the file untouched
+        ogg_stream = build_stream([os.urandom(100), os.urandom(100)],
+                                  audio_packets)
+        with open(ogg_stream.name, "rb") as f:
+            original_data = f.read()
+        self.assertFalse(audiotools.ogg.rewrite_header_packets(
+            ogg_stream.name, [os.urandom(1000), os.urandom(100)]))
+        with open(ogg_stream.name, "rb") as f:
+            self.assertEqual(f.read(), original_data)
+        ogg_stream.close()
+
 
 class Test_Image(unittest.TestCase):
     @LIB_IMAGE
@@ -2242,6 +2242,34 @@ class AiffFileTest(TestForeignAiffChunks, LosslessFileTest):
 
         self.assertEqual(os.path.isfile("invalid.aiff"), False)
 
+    @FORMAT_AIFF
+    def test_aifc(self):
+        import struct
+        from audiotools.decoders import AiffDecoder
+
+        samples = [0, 1, -1, 32767, -32768, 1234, -4321, 7]
+        comm = (struct.pack(">hIh", 2, 4, 16) +
+                b"\x40\x0E\xAC\x44\x00\x00\x00\x00\x00\x00")
+
+        for (compression, data) in [(b"NONE", struct.pack(">8h", *samples)),
+                                    (b"sowt", struct.pack("<8h", *samples))]:
+            with tempfile.NamedTemporaryFile(suffix=".aiff") as temp:
+                # an SSND chunk whose offset skips 4 bytes of padding
+                temp.write(b"FORM" + struct.pack(">I", 0) + b"AIFC" +
+                           b"COMM" + struct.pack(">I", 24) + comm +
+                           compression + b"\x00\x00" +
+                           b"SSND" + struct.pack(">III",
+                                                 12 + len(data), 4, 0) +
+                           b"padd" + data)
+                temp.flush()
+                with AiffDecoder(temp.name) as decoder:
+                    self.assertEqual(decoder.sample_rate, 44100)
+                    self.assertEqual(decoder.channels, 2)
+                    self.assertEqual(decoder.total_pcm_frames, 4)
+                    self.assertEqual(list(decoder.read(4096)), samples)
+                    self.assertEqual(decoder.seek(2), 2)
+                    self.assertEqual(list(decoder.read(4096)), samples[4:])
+
     @FORMAT_AIFF
     def test_verify(self):
         import audiotools.aiff
@@ -2844,6 +2872,153 @@ class ALACFileTest(LosslessFileTest):
                   test_streams.Generate04]:
             self.__test_reader__(g(44100), 5, block_size=1152)
 
+    @FORMAT_ALAC
+    def test_unknown_length(self):
+        # an unknown-length stream should be written with
+        # its "moov" atom after "mdat" in a single pass
+        from audiotools.bitstream import BitstreamReader
+
+        with tempfile.NamedTemporaryFile(suffix=self.suffix) as temp:
+            track = self.audio_class.from_pcm(
+                temp.name,
+                test_streams.Sine16_Stereo(200000, 44100,
+                                           441.0, 0.50, 441.0, 0.49, 1.0))
+            self.assertEqual(track.total_frames(), 200000)
+
+            with open(temp.name, "rb") as f:
+                reader = BitstreamReader(f, False)
+                atoms = []
+                total_size = os.path.getsize(temp.name)
+                while total_size > 0:
+                    (size, name) = reader.parse("32u 4b")
+                    atoms.append(name)
+                    reader.skip_bytes(size - 8)
+                    total_size -= size
+            self.assertEqual(atoms, [b"ftyp", b"mdat", b"moov", b"free"])
+
+            self.assertEqual(
+                audiotools.pcm_frame_cmp(
+                    track.to_pcm(),
+                    test_streams.Sine16_Stereo(200000, 44100,
+                                               441.0, 0.50, 441.0, 0.49, 1.0)),
+                None)
+
+    @FORMAT_ALAC
+    def test_interlacing(self):
+        # a stereo sine's channels are closely correlated,
+        # so its frames should be interlaced
+        # with the leftweight that leaves the smallest residuals
+        from io import BytesIO
+        from audiotools.bitstream import BitstreamReader
+
+        with tempfile.NamedTemporaryFile(suffix=self.suffix) as temp:
+            with open(temp.name, "wb") as f:
+                self.encode(file=f,
+                            pcmreader=test_streams.Sine24_Stereo(
+                                200000, 44100,
+                                441.0, 0.50, 441.0, 0.49, 1.0),
+                            total_pcm_frames=200000,
+                            block_size=4096,
+                            initial_history=10,
+                            history_multiplier=40,
+                            maximum_k=14,
+                            version="version")
+
+            with open(temp.name, "rb") as f:
+                reader = BitstreamReader(f, False)
+                (size, name) = reader.parse("32u 4b")
+                while name != b"mdat":
+                    reader.skip_bytes(size - 8)
+                    (size, name) = reader.parse("32u 4b")
+                frame = BitstreamReader(BytesIO(reader.read_bytes(size - 8)),
+                                        False)
+
+            (channels,
+             has_sample_count,
+             uncompressed_LSBs,
+             not_compressed,
+             interlacing_shift,
+             interlacing_leftweight) = frame.parse("3u 16p 1u 2u 1u 8u 8u")
+            self.assertEqual(channels, 1)
+            self.assertEqual(has_sample_count, 0)
+            self.assertEqual(uncompressed_LSBs, 1)
+            self.assertEqual(not_compressed, 0)
+            self.assertEqual(interlacing_leftweight, 2)
+
+    @FORMAT_ALAC
+    def test_encoding_stats(self):
+        from audiotools.bitstream import BitstreamReader
+
+        def encode(file, **kwargs):
+            return self.encode(file=file,
+                               pcmreader=test_streams.Sine24_Stereo(
+                                   200000, 44100,
+                                   441.0, 0.50, 441.0, 0.49, 1.0),
+                               total_pcm_frames=200000,
+                               block_size=4096,
+                               initial_history=10,
+                               history_multiplier=40,
+                               maximum_k=14,
+                               version="version",
+                               **kwargs)
+
+        def mdat_data(filename):
+            with open(filename, "rb") as f:
+                reader = BitstreamReader(f, False)
+                while True:
+                    (size, name) = reader.parse("32u 4b")
+                    if name == b"mdat":
+                        return reader.read_bytes(size - 8)
+                    else:
+                        reader.skip_bytes(size - 8)
+
+        with tempfile.NamedTemporaryFile(suffix=self.suffix) as temp1:
+            with tempfile.NamedTemporaryFile(suffix=self.suffix) as temp2:
+                with open(temp1.name, "wb") as f:
+                    self.assertIsNone(encode(f))
+                with open(temp2.name, "wb") as f:
+                    stats = encode(f, stats=True)
+
+                # gathering stats doesn't change the encoded frames
+                frames = mdat_data(temp2.name)
+                self.assertEqual(mdat_data(temp1.name), frames)
+
+                self.assertEqual(set(stats["times"].keys()),
+                                 {"pcm_read", "md5", "lpc", "residual",
+                                  "write", "io", "other"})
+                for seconds in stats["times"].values():
+                    self.assertGreaterEqual(seconds, 0.0)
+
+                # one stereo frame per frameset
+                self.assertEqual(stats["framesets"], 49)
+                self.assertEqual(stats["compressed_frames"] +
+                                 stats["uncompressed_frames"],
+                                 stats["framesets"])
+                self.assertEqual(sum(stats["lpc_orders"]),
+                                 stats["compressed_frames"] * 2)
+                self.assertEqual(sum(stats["lpc_orders"]),
+                                 stats["lpc_orders"][4] +
+                                 stats["lpc_orders"][8])
+                self.assertEqual(sum(stats["interlacing_leftweights"]),
+                                 stats["compressed_frames"])
+
+                # every 24-bit sample's least-significant byte
+                # is stored uncompressed
+                self.assertEqual(stats["verbatim_bytes"], 200000 * 2)
+
+                # the byte counts cover all the frames in "mdat"
+                self.assertEqual(stats["header_bytes"] +
+                                 stats["residual_bytes"] +
+                                 stats["verbatim_bytes"],
+                                 len(frames))
+
+                self.assertEqual(
+                    audiotools.pcm_frame_cmp(
+                        audiotools.open(temp2.name).to_pcm(),
+                        test_streams.Sine24_Stereo(
+                            200000, 44100, 441.0, 0.50, 441.0, 0.49, 1.0)),
+                    None)
+
     @FORMAT_ALAC
     def test_full_scale_deflection(self):
         for (bps, fsd) in [(16, test_streams.fsd16),
@@ -2997,6 +3172,26 @@ class AUFileTest(LosslessFileTest):
 
         self.assertEqual(os.path.isfile("invalid.au"), False)
 
+    @FORMAT_AU
+    def test_unknown_data_size(self):
+        import struct
+        from audiotools.decoders import AuDecoder
+
+        samples = [0, 1, -1, 32767, -32768, 1234, -4321, 7]
+
+        with tempfile.NamedTemporaryFile(suffix=self.suffix) as temp:
+            # an annotated header whose data runs to the end of the file
+            temp.write(b".snd" +
+                       struct.pack(">5I", 32, 0xFFFFFFFF, 3, 44100, 2) +
+                       b"annotate" +
+                       struct.pack(">8h", *samples))
+            temp.flush()
+            with AuDecoder(temp.name) as decoder:
+                self.assertEqual(decoder.total_pcm_frames, 4)
+                self.assertEqual(list(decoder.read(4096)), samples)
+                self.assertEqual(decoder.seek(3), 3)
+                self.assertEqual(list(decoder.read(4096)), samples[6:])
+
     @FORMAT_AU
     def test_channel_mask(self):
         temp = tempfile.NamedTemporaryFile(suffix=self.suffix)
@@ -3374,6 +3569,22 @@ class FlacFileTest(TestForeignAiffChunks,
         self.assertEqual(audiotools.open("flac-allframes.flac").verify(),
                          True)
 
+        # the decoder's own verify() reports progress
+        # and the PCM offset of the first bad frame
+        progress = []
+        with audiotools.decoders.FlacDecoder(
+                open("flac-allframes.flac", "rb")) as decoder:
+            self.assertEqual(decoder.verify(progress.append),
+                             (80, None, None))
+        self.assertEqual(progress, [20, 40, 60, 80])
+
+        bad_data = list(flac_data)
+        bad_data[-3] ^= 1
+        with audiotools.decoders.FlacDecoder(
+                BytesIO(ints_to_bytes(bad_data))) as decoder:
+            self.assertEqual(decoder.verify(),
+                             (60, 60, "frame CRC-16 mismatch"))
+
         # try changing the file underfoot
         with tempfile.NamedTemporaryFile(suffix=".flac") as temp:
             temp.write(ints_to_bytes(flac_data))
@@ -3705,6 +3916,154 @@ class FlacFileTest(TestForeignAiffChunks,
                                  adaptive_mid_side=True,
                                  exhaustive_model_search=True)
 
+    @FORMAT_FLAC
+    def test_unknown_length(self):
+        # an unknown-length stream to a seekable file
+        # should get a complete STREAMINFO and SEEKTABLE in a single pass
+        with tempfile.NamedTemporaryFile(suffix=".flac") as temp:
+            track = audiotools.FlacAudio.from_pcm(
+                temp.name,
+                test_streams.Sine16_Stereo(200000, 44100,
+                                           441.0, 0.50, 441.0, 0.49, 1.0))
+            self.assertEqual(track.total_frames(), 200000)
+            metadata = track.get_metadata()
+            streaminfo = metadata.get_block(
+                audiotools.flac.Flac_STREAMINFO.BLOCK_ID)
+            self.assertNotEqual(streaminfo.md5sum, b"\x00" * 16)
+            self.assertNotEqual(streaminfo.maximum_frame_size, 0)
+            seektable = metadata.get_block(
+                audiotools.flac.Flac_SEEKTABLE.BLOCK_ID)
+            self.assertGreater(len(seektable.seekpoints), 0)
+
+            # the SEEKTABLE and PADDING fill the space reserved for them,
+            # which is an hour of seekpoints plus the default padding,
+            # so the unused reserve becomes additional padding
+            padding = metadata.get_block(
+                audiotools.flac.Flac_PADDING.BLOCK_ID)
+            self.assertEqual(seektable.size() + 4 + padding.length,
+                             (8 + 8 + 2) * 360 + 4096)
+            self.assertEqual(
+                audiotools.pcm_frame_cmp(
+                    track.to_pcm(),
+                    test_streams.Sine16_Stereo(200000, 44100,
+                                               441.0, 0.50, 441.0, 0.49, 1.0)),
+                None)
+
+    @FORMAT_FLAC
+    def test_encoding_stats(self):
+        from audiotools.bitstream import BitstreamReader
+
+        with tempfile.NamedTemporaryFile(suffix=".flac") as temp1:
+            with tempfile.NamedTemporaryFile(suffix=".flac") as temp2:
+                self.assertIsNone(
+                    self.encode(temp1.name,
+                                test_streams.Sine16_Stereo(
+                                    200000, 44100,
+                                    441.0, 0.50, 441.0, 0.49, 1.0),
+                                "version",
+                                max_lpc_order=8,
+                                adaptive_mid_side=True))
+                stats = self.encode(temp2.name,
+                                    test_streams.Sine16_Stereo(
+                                        200000, 44100,
+                                        441.0, 0.50, 441.0, 0.49, 1.0),
+                                    "version",
+                                    max_lpc_order=8,
+                                    adaptive_mid_side=True,
+                                    stats=True)
+
+                # gathering stats doesn't change the encoded file
+                with open(temp1.name, "rb") as f1:
+                    with open(temp2.name, "rb") as f2:
+                        self.assertEqual(f1.read(), f2.read())
+
+                self.assertEqual(set(stats["times"].keys()),
+                                 {"pcm_read", "md5", "lpc", "residual",
+                                  "write", "io", "other"})
+                for seconds in stats["times"].values():
+                    self.assertGreaterEqual(seconds, 0.0)
+
+                self.assertEqual(stats["frames"], 49)
+                self.assertEqual(sum(stats["subframe_types"].values()),
+                                 stats["frames"] * 2)
+                self.assertEqual(sum(stats["fixed_orders"]),
+                                 stats["subframe_types"]["fixed"])
+                self.assertEqual(sum(stats["lpc_orders"]),
+                                 stats["subframe_types"]["lpc"])
+                self.assertEqual(len(stats["lpc_orders"]), 33)
+                self.assertEqual(sum(stats["lpc_orders"][9:]), 0)
+                self.assertEqual(sum(stats["partition_orders"]),
+                                 stats["subframe_types"]["fixed"] +
+                                 stats["subframe_types"]["lpc"])
+                self.assertEqual(
+                    sum(stats["rice_parameters"]) +
+                    stats["escaped_partitions"],
+                    sum((2 ** order) * count for (order, count) in
+                        enumerate(stats["partition_orders"])))
+
+                # the byte counts cover all the file's frames
+                with open(temp2.name, "rb") as f:
+                    reader = BitstreamReader(f, False)
+                    self.assertEqual(reader.read_bytes(4), b"fLaC")
+                    frames_offset = 4
+                    last = 0
+                    while not last:
+                        (last, block_type, size) = reader.parse("1u 7u 24u")
+                        reader.skip_bytes(size)
+                        frames_offset += 4 + size
+                self.assertEqual(stats["header_bytes"] +
+                                 stats["residual_bytes"] +
+                                 stats["verbatim_bytes"],
+                                 os.path.getsize(temp2.name) - frames_offset)
+                self.assertGreater(stats["residual_bytes"],
+                                   stats["header_bytes"])
+
+                self.assertEqual(
+                    audiotools.pcm_frame_cmp(
+                        audiotools.open(temp2.name).to_pcm(),
+                        test_streams.Sine16_Stereo(
+                            200000, 44100, 441.0, 0.50, 441.0, 0.49, 1.0)),
+                    None)
+
+    @FORMAT_FLAC
+    def test_streaming(self):
+        # encoding to an unseekable output should write frames directly
+        # and leave STREAMINFO's length and MD5 sum unset
+        import threading
+
+        temp_dir = tempfile.mkdtemp()
+        fifo = os.path.join(temp_dir, "fifo")
+        output = os.path.join(temp_dir, "output.flac")
+        os.mkfifo(fifo)
+
+        def copy_fifo():
+            with open(fifo, "rb") as r:
+                with open(output, "wb") as w:
+                    w.write(r.read())
+
+        try:
+            copier = threading.Thread(target=copy_fifo)
+            copier.start()
+            self.encode(fifo,
+                        test_streams.Sine16_Stereo(200000, 44100,
+                                                   441.0, 0.50,
+                                                   441.0, 0.49, 1.0),
+                        "test")
+            copier.join()
+
+            track = audiotools.FlacAudio(output)
+            self.assertEqual(track.total_frames(), 0)
+            self.assertEqual(
+                audiotools.pcm_frame_cmp(
+                    track.to_pcm(),
+                    test_streams.Sine16_Stereo(200000, 44100,
+                                               441.0, 0.50, 441.0, 0.49, 1.0)),
+                None)
+        finally:
+            for f in os.listdir(temp_dir):
+                os.unlink(os.path.join(temp_dir, f))
+            os.rmdir(temp_dir)
+
     @FORMAT_FLAC
     def test_full_scale_deflection(self):
         for (bps, fsd) in [(8, test_streams.fsd8),
@@ -3945,6 +4304,124 @@ class FlacFileTest(TestForeignAiffChunks,
                            16385, 16386]:
             __perform_test__(4608, pcm_frames)
 
+    @FORMAT_FLAC
+    def test_known_encodings(self):
+        # each subframe is sized analytically rather than trial-written,
+        # so check the encoder still picks the same subframes
+        # by comparing against digests of the trial-writing encoder's output
+
+        from test_streams import FrameListReader
+
+        def fixture(channels, bits_per_sample, noise, wasted_bps):
+            # a triangle wave plus deterministic noise
+            full_scale = (1 << (bits_per_sample - 1 - wasted_bps)) - 1
+            seed = 0x1234
+            samples = []
+            for i in range(10000):
+                phase = (i * 97) % 2000
+                triangle = (phase if phase < 1000 else 2000 - phase) - 500
+                for c in range(channels):
+                    seed = (seed * 1103515245 + 12345) & 0x7FFFFFFF
+                    sample = ((triangle * (c + 2) * full_scale) // 2000 +
+                              ((seed >> 16) % (noise * 2 + 1)) - noise)
+                    sample = max(min(sample, full_scale), -full_scale - 1)
+                    samples.append(sample << wasted_bps)
+            return FrameListReader(samples, 44100, channels, bits_per_sample)
+
+        options = [{"block_size": 1152,
+                    "max_lpc_order": 0,
+                    "min_residual_partition_order": 0,
+                    "max_residual_partition_order": 3},
+                   {"block_size": 1152,
+                    "max_lpc_order": 0,
+                    "adaptive_mid_side": True,
+                    "min_residual_partition_order": 0,
+                    "max_residual_partition_order": 3},
+                   {"block_size": 4096,
+                    "max_lpc_order": 8,
+                    "mid_side": True,
+                    "min_residual_partition_order": 0,
+                    "max_residual_partition_order": 6},
+                   {"block_size": 4096,
+                    "max_lpc_order": 12,
+                    "adaptive_mid_side": True,
+                    "exhaustive_model_search": True,
+                    "min_residual_partition_order": 0,
+                    "max_residual_partition_order": 8},
+                   {"block_size": 576,
+                    "max_lpc_order": 8,
+                    "disable_verbatim_subframes": True,
+                    "disable_constant_subframes": True,
+                    "min_residual_partition_order": 2,
+                    "max_residual_partition_order": 4}]
+
+        # (channels, bits-per-sample, noise, wasted bits-per-sample)
+        # and the digest of each option's encoding
+        known_encodings = [
+            ((1, 8, 2, 0),
+             ["3746ec9bd7373c574b12fd9f8b9c9c8c",
+              "3746ec9bd7373c574b12fd9f8b9c9c8c",
+              "0db7ea344ac9884ae731d4f9b517f325",
+              "dbc339a4d499d771f439ea9f8d5af1be",
+              "cf7c21e4eb30278a0de47014260d5e1b"]),
+            ((2, 8, 0, 0),
+             ["8900bbdad7207c9bf0adebceb0e86f87",
+              "64c811268c8ba58ec99407de8b86c66b",
+              "2ca5b7ffad79e66267752371cfde985f",
+              "236fc1860dae6007bb3c6722f0acdae3",
+              "a13eda744e8953d0a0c25554971d2d05"]),
+            ((1, 16, 40, 0),
+             ["a0f3e3cab2121eccd0969e1f9ae4e7d2",
+              "a0f3e3cab2121eccd0969e1f9ae4e7d2",
+              "01fd19e3184fc44c4a8adc048b0517f1",
+              "b13c9585c53ca2c9e849573bace14ded",
+              "389b84bdcef5e4dc726a5efe3c85b8dc"]),
+            ((2, 16, 300, 0),
+             ["6650331b83e4a0306c9efb6a4cbf95d1",
+              "680f575479f87312834d5ac3acdac435",
+              "38e71720069cb85542260532845deadf",
+              "10b76ae0651fb7f3165781639851278c",
+              "f98afdeaa065c9aaa77ebe962df544ef"]),
+            ((2, 16, 32767, 0),
+             ["5057db418111030c30ddc0635a3be619",
+              "9b21d6e6012d7e52ddd8a826df34e302",
+              "c04c7f6476f82530c82cf1714a02bdd4",
+              "24587f26990e789249d7e4ede3f8a3cf",
+              "48598c658555396551cf10d3bff1a77b"]),
+            ((1, 24, 5000, 0),
+             ["3a238657a8d9c912e488e6d9c35f2185",
+              "3a238657a8d9c912e488e6d9c35f2185",
+              "f89fc0451c834decd4b3adf5d4dd9d0c",
+              "763aa0fde19afff52916e383ee113a00",
+              "3f5d6d3e29d9099e2f7595bf68b39474"]),
+            ((2, 24, 100, 0),
+             ["93029cdaaa510413ef36ed5dda085919",
+              "ec5b2ec461cd2483307849a3f3e402da",
+              "05936ab44ea1febc4a41f96af9a64a58",
+              "cd8dfd17677795eb316d1a57cc725564",
+              "2fbed11b655f92ae781965d1c9052676"]),
+            ((2, 16, 20, 3),
+             ["49981cbd9315499b913d0fe28eaf5062",
+              "cb0969b58122df321baa63387170cf5e",
+              "399afb0f20e2742a730a9de9cbd5833c",
+              "fba6408d8bec42240dca58902213ce97",
+              "59287b56d85ad047c4eb18f1eb2879bc"])]
+
+        for (args, digests) in known_encodings:
+            for (encode_options, digest) in zip(options, digests):
+                temp_file = tempfile.NamedTemporaryFile(suffix=".flac")
+                self.encode(filename=temp_file.name,
+                            pcmreader=fixture(*args),
+                            version="Python Audio Tools",
+                            **encode_options)
+                with open(temp_file.name, "rb") as f:
+                    self.assertEqual(
+                        md5(f.read()).hexdigest(),
+                        digest,
+                        "encoding of fixture {!r} with options {!r} "
+                        "has changed".format(args, encode_options))
+                temp_file.close()
+
     # PCMReaders don't yet support seeking,
     # so the seek tests can be skipped
 
@@ -4627,6 +5104,86 @@ class VorbisFileTest(OggVerify, LossyFileTest):
             self.assertEqual(original_pcm_sum.hexdigest(),
                              new_pcm_sum.hexdigest())
 
+    @FORMAT_VORBIS
+    def test_parallel_encoding(self):
+        from audiotools.encoders import encode_vorbis
+        from audiotools.ogg import PageReader
+        from math import log10
+
+        def decoded_samples(track):
+            reader = track.to_pcm()
+            samples = []
+            frame = reader.read(4096)
+            while len(frame) > 0:
+                samples.extend(frame)
+                frame = reader.read(4096)
+            reader.close()
+            return samples
+
+        def final_granule(track):
+            with PageReader(open(track.filename, "rb")) as reader:
+                page = reader.read()
+                while not page.stream_end:
+                    page = reader.read()
+                return page.granule_position
+
+        # segments of 65536 frames, so the parallel encoder
+        # splices several together, the last of them partial
+        for pcm_frames in [0, 1000, 65536, 352800, 400000]:
+            with tempfile.NamedTemporaryFile(
+                suffix=self.suffix) as serial_file:
+                with tempfile.NamedTemporaryFile(
+                    suffix=self.suffix) as parallel_file:
+                    for (track_file, threads) in [(serial_file, 1),
+                                                  (parallel_file, 3)]:
+                        encode_vorbis(track_file.name,
+                                      test_streams.Sine16_Stereo(
+                                          pcm_frames, 44100,
+                                          441.0, 0.50, 441.0, 0.49, 1.0),
+                                      0.3,
+                                      threads=threads,
+                                      segment_size=65536)
+
+                    serial = audiotools.open(serial_file.name)
+                    parallel = audiotools.open(parallel_file.name)
+
+                    # both streams end at the input's length
+                    # and decode to exactly that many frames
+                    for track in [serial, parallel]:
+                        self.assertEqual(track.total_frames(), pcm_frames)
+                        self.assertEqual(final_granule(track), pcm_frames)
+
+                    serial_samples = decoded_samples(serial)
+                    parallel_samples = decoded_samples(parallel)
+                    self.assertEqual(len(serial_samples), pcm_frames * 2)
+                    self.assertEqual(len(parallel_samples), pcm_frames * 2)
+
+                    # and the splices between segments are inaudible
+                    signal = sum(s * s for s in serial_samples)
+                    noise = sum((s - p) * (s - p) for (s, p) in
+                                zip(serial_samples, parallel_samples))
+                    if noise > 0:
+                        self.assertGreater(10 * log10(signal / noise), 30)
+
+        # threads and segment size must be positive
+        with tempfile.NamedTemporaryFile(suffix=self.suffix) as track_file:
+            self.assertRaises(ValueError,
+                              encode_vorbis,
+                              track_file.name,
+                              test_streams.Sine16_Stereo(
+                                  4410, 44100,
+                                  441.0, 0.50, 441.0, 0.49, 1.0),
+                              0.3,
+                              threads=0)
+            self.assertRaises(ValueError,
+                              encode_vorbis,
+                              track_file.name,
+                              test_streams.Sine16_Stereo(
+                                  4410, 44100,
+                                  441.0, 0.50, 441.0, 0.49, 1.0),
+                              0.3,
+                              segment_size=0)
+
 
 class OpusFileTest(OggVerify, LossyFileTest):
     def setUp(self):
@@ -4663,6 +5220,90 @@ class OpusFileTest(OggVerify, LossyFileTest):
             self.assertEqual(original_pcm_sum.hexdigest(),
                              new_pcm_sum.hexdigest())
 
+    @FORMAT_OPUS
+    def test_parallel_encoding(self):
+        from audiotools.encoders import encode_opus
+        from audiotools.ogg import PageReader
+        from math import log10
+
+        def decoded_samples(track):
+            reader = track.to_pcm()
+            samples = []
+            frame = reader.read(4096)
+            while len(frame) > 0:
+                samples.extend(frame)
+                frame = reader.read(4096)
+            reader.close()
+            return samples
+
+        def final_granule(track):
+            with PageReader(open(track.filename, "rb")) as reader:
+                page = reader.read()
+                while not page.stream_end:
+                    page = reader.read()
+                return page.granule_position
+
+        # chunks of 16 packets, so the parallel encoder splices
+        # a dozen chunks together, the last of them partial
+        for pcm_frames in [0, 1000, 46080, 576000, 577000]:
+            with tempfile.NamedTemporaryFile(
+                suffix=self.suffix) as serial_file:
+                with tempfile.NamedTemporaryFile(
+                    suffix=self.suffix) as parallel_file:
+                    for (track_file, threads) in [(serial_file, 1),
+                                                  (parallel_file, 3)]:
+                        encode_opus(track_file.name,
+                                    test_streams.Sine16_Stereo(
+                                        pcm_frames, 48000,
+                                        441.0, 0.50, 441.0, 0.49, 1.0),
+                                    quality=10,
+                                    original_sample_rate=48000,
+                                    threads=threads,
+                                    chunk_size=2880 * 16)
+
+                    serial = audiotools.open(serial_file.name)
+                    parallel = audiotools.open(parallel_file.name)
+
+                    # both streams end at the same granule position
+                    # and decode to exactly the input's length
+                    for track in [serial, parallel]:
+                        self.assertEqual(track.total_frames(), pcm_frames)
+                        self.assertEqual(final_granule(track),
+                                         track.__pre_skip__ + pcm_frames)
+
+                    serial_samples = decoded_samples(serial)
+                    parallel_samples = decoded_samples(parallel)
+                    self.assertEqual(len(serial_samples), pcm_frames * 2)
+                    self.assertEqual(len(parallel_samples), pcm_frames * 2)
+
+                    # and the splices between chunks are inaudible
+                    signal = sum(s * s for s in serial_samples)
+                    noise = sum((s - p) * (s - p) for (s, p) in
+                                zip(serial_samples, parallel_samples))
+                    if noise > 0:
+                        self.assertGreater(10 * log10(signal / noise), 30)
+
+        # threads and chunk size must be positive
+        with tempfile.NamedTemporaryFile(suffix=self.suffix) as track_file:
+            self.assertRaises(ValueError,
+                              encode_opus,
+                              track_file.name,
+                              test_streams.Sine16_Stereo(
+                                  4800, 48000,
+                                  441.0, 0.50, 441.0, 0.49, 1.0),
+                              quality=10,
+                              original_sample_rate=48000,
+                              threads=0)
+            self.assertRaises(ValueError,
+                              encode_opus,
+                              track_file.name,
+                              test_streams.Sine16_Stereo(
+                                  4800, 48000,
+                                  441.0, 0.50, 441.0, 0.49, 1.0),
+                              quality=10,
+                              original_sample_rate=48000,
+                              chunk_size=0)
+
 
 class SpeexFileTest(LossyFileTest):
     def setUp(self):
@@ -4696,6 +5337,65 @@ class WaveFileTest(TestForeignWaveChunks,
 
         self.assertEqual(os.path.isfile("invalid.wav"), False)
 
+    @FORMAT_WAVE
+    def test_wave_variants(self):
+        import struct
+        from audiotools.decoders import WaveDecoder
+
+        samples = [0, 1, -1, 32767, -32768, 1234, -4321, 7]
+        data = struct.pack("<8h", *samples)
+        fmt = struct.pack("<HHIIHH", 1, 2, 44100, 44100 * 4, 4, 16)
+        extensible = (struct.pack("<HHIIHHHHI",
+                                  0xFFFE, 2, 44100, 44100 * 4, 4, 16,
+                                  22, 16, 0x3) +
+                      b"\x01\x00\x00\x00\x00\x00\x10\x00" +
+                      b"\x80\x00\x00\xaa\x00\x38\x9b\x71")
+
+        # RF64 with its data size in the "ds64" chunk
+        rf64 = (b"RF64" + struct.pack("<I", 0xFFFFFFFF) + b"WAVE" +
+                b"ds64" + struct.pack("<IQQQI", 28, 0, len(data), 4, 0) +
+                b"fmt " + struct.pack("<I", 16) + fmt +
+                b"data" + struct.pack("<I", 0xFFFFFFFF) + data)
+
+        # WAVE_FORMAT_EXTENSIBLE following an odd-sized chunk
+        riff = (b"RIFF" + struct.pack("<I", 0) + b"WAVE" +
+                b"junk" + struct.pack("<I", 3) + b"abc\x00" +
+                b"fmt " + struct.pack("<I", 40) + extensible +
+                b"data" + struct.pack("<I", len(data)) + data)
+
+        for wave_data in [rf64, riff]:
+            with tempfile.NamedTemporaryFile(suffix=".wav") as temp:
+                temp.write(wave_data)
+                temp.flush()
+                with WaveDecoder(temp.name) as decoder:
+                    self.assertEqual(decoder.sample_rate, 44100)
+                    self.assertEqual(decoder.channels, 2)
+                    self.assertEqual(decoder.channel_mask, 0x3)
+                    self.assertEqual(decoder.bits_per_sample, 16)
+                    self.assertEqual(decoder.total_pcm_frames, 4)
+                    self.assertEqual(list(decoder.read(4096)), samples)
+                    self.assertEqual(decoder.read(4096).frames, 0)
+
+                    # seeking is exact
+                    self.assertEqual(decoder.seek(3), 3)
+                    self.assertEqual(list(decoder.read(4096)), samples[6:])
+                    self.assertEqual(decoder.seek(1), 1)
+                    self.assertEqual(list(decoder.read(1)), samples[2:4])
+                    self.assertEqual(decoder.seek(5), 4)
+                    self.assertEqual(decoder.read(4096).frames, 0)
+
+        # a data chunk larger than the file
+        # is readable up to where the file ends
+        with tempfile.NamedTemporaryFile(suffix=".wav") as temp:
+            temp.write(b"RIFF" + struct.pack("<I", 0) + b"WAVE" +
+                       b"fmt " + struct.pack("<I", 16) + fmt +
+                       b"data" + struct.pack("<I", len(data) * 2) + data)
+            temp.flush()
+            with WaveDecoder(temp.name) as decoder:
+                self.assertEqual(decoder.total_pcm_frames, 8)
+                self.assertEqual(list(decoder.read(4)), samples)
+                self.assertRaises(IOError, decoder.read, 4)
+
     @FORMAT_WAVE
     def test_verify(self):
         # test various truncated files with verify()
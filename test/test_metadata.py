@@ -3801,6 +3801,31 @@ class ID3v23MetaData(ID3v22MetaData):
         # this is tested by ID3v22 and doesn't need to be tested again
         self.assertTrue(True)
 
+    @METADATA_ID3V2
+    def test_unsynchronization(self):
+        from audiotools.bitstream import BitstreamRecorder
+
+        # a whole-tag unsynchronized ID3v2.3 tag with an extended header
+        frame = (b"TIT2" + b"\x00\x00\x00\x06" + b"\x00\x00" +
+                 b"\x00ab\xff\xe0c")
+        body = (b"\x00\x00\x00\x06" + b"\x00" * 6 +
+                frame).replace(b"\xff", b"\xff\x00")
+        data = b"ID3\x03\x00\xc0\x00\x00\x00\x1b" + body
+
+        metadata = self.metadata_class.parse_data(data)
+        self.assertEqual(len(metadata), 1)
+        self.assertEqual(metadata[b"TIT2"][0].data, b"ab\xff\xe0c")
+
+        # untouched frames are written back without being parsed
+        metadata = self.metadata_class.parse_data(data)
+        recorder = BitstreamRecorder(False)
+        metadata.build(recorder)
+        self.assertEqual(recorder.data()[0:10 + len(frame)],
+                         b"ID3\x03\x00\x00\x00\x00\x00\x1b" + frame)
+        self.assertEqual(len(recorder.data()), metadata.size())
+        self.assertEqual(self.metadata_class.parse_data(recorder.data()),
+                         self.metadata_class.parse_data(data))
+
     @METADATA_ID3V2
     def test_clean(self):
         from audiotools.text import (CLEAN_REMOVE_LEADING_WHITESPACE,
@@ -4004,6 +4029,20 @@ class ID3v24MetaData(ID3v22MetaData):
         # this is tested by ID3v22 and doesn't need to be tested again
         self.assertTrue(True)
 
+    @METADATA_ID3V2
+    def test_unsynchronization(self):
+        # an ID3v2.4 frame with its own unsynchronization
+        # and data length indicator
+        frame_data = b"\x00\x00\x00\x05" + b"\x00ab\xff\x00\xe0"
+        frame = b"TIT2" + b"\x00\x00\x00\x0a" + b"\x00\x03" + frame_data
+        data = (b"ID3\x04\x00\x00\x00\x00\x00\x1e" +
+                frame + b"\x00" * 10)
+
+        metadata = self.metadata_class.parse_data(data)
+        self.assertEqual(len(metadata), 1)
+        self.assertEqual(metadata.total_size, 30)
+        self.assertEqual(metadata[b"TIT2"][0].data, b"ab\xff\xe0")
+
     @METADATA_ID3V2
     def test_clean(self):
         from audiotools.text import (CLEAN_REMOVE_TRAILING_WHITESPACE,
@@ -4600,6 +4639,47 @@ class FlacMetaData(MetaDataTest):
             finally:
                 temp_file.close()
 
+    @METADATA_FLAC
+    def test_referenced_images(self):
+        for audio_class in self.supported_formats:
+            temp_file = tempfile.NamedTemporaryFile(
+                suffix="." + audio_class.SUFFIX)
+            try:
+                track = audio_class.from_pcm(temp_file.name,
+                                             BLANK_PCM_Reader(1))
+                metadata = self.empty_metadata()
+                metadata.add_image(
+                    audiotools.Image.new(TEST_COVER1, u"Text 1", 0))
+                track.set_metadata(metadata)
+
+                # image data stays on disk until it's needed
+                image = track.get_metadata().images()[0]
+                self.assertIsNotNone(image.data_reference())
+                self.assertNotIn("data", image.__dict__)
+                self.assertEqual(image.data_size(), len(TEST_COVER1))
+                self.assertEqual(image.data, TEST_COVER1)
+
+                # and remains valid after the file is rewritten
+                # in place and in full
+                metadata = track.get_metadata()
+                metadata.track_name = u"Foo"
+                track.update_metadata(metadata)
+                self.assertEqual(track.last_metadata_update(),
+                                 audiotools.flac.METADATA_IN_PLACE)
+                self.assertEqual(image.data, TEST_COVER1)
+
+                metadata = track.get_metadata()
+                metadata.track_name = u"Foo" * 0x10000
+                track.update_metadata(metadata)
+                self.assertEqual(track.last_metadata_update(),
+                                 audiotools.flac.METADATA_REWRITTEN)
+                self.assertEqual(image.data, TEST_COVER1)
+                self.assertEqual(metadata.images()[0].data, TEST_COVER1)
+                self.assertEqual(track.get_metadata().images()[0].data,
+                                 TEST_COVER1)
+            finally:
+                temp_file.close()
+
     @METADATA_FLAC
     def test_totals(self):
         metadata = self.empty_metadata()
@@ -6127,6 +6207,163 @@ class FlacMetaData(MetaDataTest):
                           Flac_APPLICATION(b"test", b"data"),
                           Flac_PADDING(1234)])
 
+    @METADATA_FLAC
+    def test_padding_budget(self):
+        import os
+        from audiotools.flac import (Flac_PADDING,
+                                     Flac_PICTURE,
+                                     METADATA_IN_PLACE,
+                                     METADATA_REWRITTEN)
+
+        with tempfile.NamedTemporaryFile(suffix=".flac") as temp_file:
+            # unknown-length encodes leave their unused SEEKTABLE
+            # reserve as additional padding (see FlacFileTest's
+            # test_unknown_length) so give a known length
+            # to start from the default padding budget
+            track = audiotools.FlacAudio.from_pcm(temp_file.name,
+                                                  BLANK_PCM_Reader(1),
+                                                  total_pcm_frames=44100)
+            original_size = os.path.getsize(temp_file.name)
+
+            # small changes are absorbed by existing padding
+            self.assertIsNone(track.last_metadata_update())
+            metadata = track.get_metadata()
+            metadata.track_name = u"Foo"
+            padding = [b.copy() for b in
+                       metadata.get_blocks(Flac_PADDING.BLOCK_ID)]
+            track.update_metadata(metadata)
+            self.assertEqual(track.last_metadata_update(),
+                             METADATA_IN_PLACE)
+            self.assertEqual(os.path.getsize(temp_file.name), original_size)
+
+            # the caller's PADDING blocks are left as-is
+            self.assertEqual(metadata.get_blocks(Flac_PADDING.BLOCK_ID),
+                             padding)
+            self.assertEqual(track.get_metadata().track_name, u"Foo")
+            self.assertEqual(track.verify(), True)
+
+            # changes larger than the padding rewrite the file
+            # and reserve a larger padding budget
+            metadata = track.get_metadata()
+            metadata.add_image(Flac_PICTURE.converted(
+                audiotools.Image.new(TEST_COVER1, u"", 0)))
+            metadata.add_image(Flac_PICTURE.converted(
+                audiotools.Image.new(TEST_COVER2, u"", 1)))
+            track.update_metadata(metadata)
+            self.assertEqual(track.last_metadata_update(),
+                             METADATA_REWRITTEN)
+            rewritten_size = os.path.getsize(temp_file.name)
+            padding = track.get_metadata().get_blocks(Flac_PADDING.BLOCK_ID)
+            self.assertEqual(len(padding), 1)
+            self.assertTrue(padding[0].length > 4096)
+            self.assertEqual(track.verify(), True)
+
+            # space from removed blocks is reclaimed as padding
+            metadata = track.get_metadata()
+            for image in metadata.images():
+                metadata.delete_image(image)
+            track.update_metadata(metadata)
+            self.assertEqual(track.last_metadata_update(),
+                             METADATA_IN_PLACE)
+            self.assertEqual(os.path.getsize(temp_file.name), rewritten_size)
+            self.assertEqual(len(track.get_metadata().images()), 0)
+            self.assertEqual(track.verify(), True)
+
+            # and can be used by later updates
+            metadata = track.get_metadata()
+            metadata.add_image(Flac_PICTURE.converted(
+                audiotools.Image.new(TEST_COVER1, u"", 0)))
+            metadata.add_image(Flac_PICTURE.converted(
+                audiotools.Image.new(TEST_COVER2, u"", 1)))
+            track.update_metadata(metadata)
+            self.assertEqual(track.last_metadata_update(),
+                             METADATA_IN_PLACE)
+            self.assertEqual(os.path.getsize(temp_file.name), rewritten_size)
+            self.assertEqual(len(track.get_metadata().images()), 2)
+            self.assertEqual(track.verify(), True)
+
+            # files without padding can still be updated in place
+            # if the new blocks fit
+            metadata = track.get_metadata()
+            metadata.replace_blocks(Flac_PADDING.BLOCK_ID, [])
+            track.update_metadata(metadata)
+            self.assertEqual(track.last_metadata_update(),
+                             METADATA_REWRITTEN)
+            metadata = track.get_metadata()
+            self.assertEqual(metadata.get_blocks(Flac_PADDING.BLOCK_ID), [])
+            metadata.delete_image(metadata.images()[1])
+            track.update_metadata(metadata)
+            self.assertEqual(track.last_metadata_update(),
+                             METADATA_IN_PLACE)
+            self.assertEqual(
+                len(track.get_metadata().get_blocks(Flac_PADDING.BLOCK_ID)),
+                1)
+            self.assertEqual(track.verify(), True)
+
+    @METADATA_FLAC
+    def test_metadata_journal(self):
+        import os
+        from audiotools.bitstream import build
+        from audiotools.flac import (metadata_journal_path,
+                                     replay_metadata_journal)
+        from zlib import crc32
+
+        with tempfile.NamedTemporaryFile(suffix=".flac") as temp_file:
+            track = audiotools.FlacAudio.from_pcm(temp_file.name,
+                                                  BLANK_PCM_Reader(1))
+            metadata = track.get_metadata()
+            metadata.track_name = u"Foo"
+            track.update_metadata(metadata)
+            journal_path = metadata_journal_path(temp_file.name)
+            self.assertFalse(os.path.exists(journal_path))
+
+            with open(temp_file.name, "rb") as f:
+                original_data = f.read()
+
+            # simulate a crash after journaling new metadata blocks
+            # but before they've been written to the file
+            metadata = track.get_metadata()
+            metadata.track_name = u"Bar"
+            header = audiotools.bitstream.BitstreamRecorder(False)
+            metadata.build(header)
+            entry = build("8b 64U 32u", False,
+                          (b"fLaCjrnl", 4, len(header.data())))
+            entry += header.data()
+            entry += build("32u", False, (crc32(entry) & 0xFFFFFFFF,))
+
+            # incomplete journals are discarded
+            with open(journal_path, "wb") as journal:
+                journal.write(entry[0:-1])
+            self.assertFalse(replay_metadata_journal(temp_file.name))
+            self.assertFalse(os.path.exists(journal_path))
+            with open(temp_file.name, "rb") as f:
+                self.assertEqual(f.read(), original_data)
+
+            # opening the file for reading leaves the journal alone
+            with open(journal_path, "wb") as journal:
+                journal.write(entry)
+            track = audiotools.open(temp_file.name)
+            self.assertTrue(os.path.exists(journal_path))
+            with open(temp_file.name, "rb") as f:
+                self.assertEqual(f.read(), original_data)
+
+            # but complete journals are replayed by the next write
+            # before the old metadata is read back
+            track.set_metadata(audiotools.MetaData(album_name=u"Baz"))
+            self.assertFalse(os.path.exists(journal_path))
+            self.assertIsNone(track.get_metadata().track_name)
+            self.assertEqual(track.get_metadata().album_name, u"Baz")
+            self.assertEqual(track.verify(), True)
+
+            with open(journal_path, "wb") as journal:
+                journal.write(entry)
+            metadata = track.get_metadata()
+            metadata.album_name = u"Qux"
+            track.update_metadata(metadata)
+            self.assertFalse(os.path.exists(journal_path))
+            self.assertEqual(track.get_metadata().album_name, u"Qux")
+            self.assertEqual(track.verify(), True)
+
 
 class M4AMetaDataTest(MetaDataTest):
     def setUp(self):
@@ -6217,6 +6454,37 @@ class M4AMetaDataTest(MetaDataTest):
             finally:
                 temp_file.close()
 
+    @METADATA_M4A
+    def test_chunk_offsets(self):
+        from audiotools._m4a import parse_file
+
+        # "moov" precedes "mdat" in this file
+        # so a rewrite which grows its metadata moves every chunk
+        with open("alac-allframes.m4a", "rb") as f:
+            alac_data = f.read()
+
+        with tempfile.NamedTemporaryFile(suffix=".m4a") as temp:
+            temp.write(alac_data)
+            temp.flush()
+            original = parse_file(temp.name)
+
+            track = audiotools.open(temp.name)
+            track.set_metadata(audiotools.MetaData(track_name=u"Foo",
+                                                   comment=u"Bar" * 4096))
+
+            rewritten = parse_file(temp.name)
+            self.assertGreater(rewritten.find(b"mdat").offset,
+                               original.find(b"mdat").offset)
+            self.assertEqual(rewritten.find(b"mdat").data(),
+                             original.find(b"mdat").data())
+
+            track = audiotools.open(temp.name)
+            self.assertEqual(track.get_metadata().track_name, u"Foo")
+            self.assertTrue(
+                audiotools.pcm_cmp(
+                    track.to_pcm(),
+                    audiotools.open("alac-allframes.m4a").to_pcm()))
+
     @METADATA_M4A
     def test_foreign_field(self):
         from audiotools.m4a_atoms import M4A_META_Atom